@@ -12,10 +12,174 @@
 #include "../TCP_Server/config.h"     
 #include "../TCP_Server/file_transfer.h"
 #include "../TCP_Server/util.h"
+#include "../TCP_Server/wire.h"
 
 
 #define BUFF_SIZE 8192 // Tăng kích thước buffer để nhận danh sách dài
 
+/* ============================================================================
+ * WIRE PROTOCOL (-b): binary frames under the same line-based calls
+ * ============================================================================ */
+
+/*
+ * With -b the client asks for BINARY after the greeting (wire.h). The rest
+ * of the client still speaks lines: net_send_line() encodes the hot
+ * commands as binary requests and wraps the others in WIRE_TEXT, and
+ * net_recv_line() hands back binary replies and deltas rendered as the
+ * text lines the server would have sent.
+ */
+static struct {
+    int binary;                     /**< BINARY accepted: frames both ways */
+    char pending[WIRE_MAX_FRAME];   /**< Lines of the last frame not yet returned */
+    size_t pending_len;
+    size_t pending_pos;
+    char login[64];                 /**< Name of the last LOGIN sent */
+    char username[64];              /**< Logged-in name, the attacker in FIRE replies */
+    char fire_target[64];           /**< Target of the FIRE awaiting its reply */
+} net;
+
+static int net_send_frame(int sock, const WireWriter *w) {
+    uint8_t head[WIRE_VARINT_MAX];
+    size_t head_len = wire_frame_header(head, w->len);
+    if (w->overflow) return -1;
+    if (send_all(sock, head, head_len) < 0 || send_all(sock, w->data, w->len) < 0) return -1;
+    return 0;
+}
+
+static int net_send_line(int sock, const char *line) {
+    if (!net.binary) return send_line(sock, line);
+
+    uint8_t payload[2048];
+    WireWriter w;
+    char target[64];
+    unsigned int weapon;
+    wire_writer_init(&w, payload, sizeof(payload));
+
+    if (sscanf(line, "FIRE %63s %u", target, &weapon) == 2) {
+        snprintf(net.fire_target, sizeof(net.fire_target), "%s", target);
+        wire_put_byte(&w, WIRE_FIRE);
+        wire_put_str(&w, target);
+        wire_put_uint(&w, weapon);
+    } else if (strcmp(line, "GET_HP") == 0) {
+        wire_put_byte(&w, WIRE_GET_HP);
+    } else if (strcmp(line, "GET_WEAPON") == 0) {
+        wire_put_byte(&w, WIRE_GET_WEAPON);
+    } else if (strcmp(line, "GETARMOR") == 0) {
+        wire_put_byte(&w, WIRE_GET_ARMOR);
+    } else {
+        if (sscanf(line, "LOGIN %63s", target) == 1) {
+            snprintf(net.login, sizeof(net.login), "%s", target);
+        }
+        size_t len = strlen(line);
+        wire_put_byte(&w, WIRE_TEXT);
+        if (w.len + len > w.cap) return -1;
+        memcpy(w.data + w.len, line, len);
+        w.len += len;
+    }
+    return net_send_frame(sock, &w);
+}
+
+static int recv_exact(int sock, void *buf, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = recv(sock, (char *)buf + got, len - got, 0);
+        if (n <= 0) return -1;
+        got += (size_t)n;
+    }
+    return 0;
+}
+
+/* The text line of a binary reply or delta, into net.pending */
+static void net_render(const uint8_t *payload, size_t len) {
+    WireReader r;
+    char *out = net.pending;
+    size_t size = sizeof(net.pending);
+    size_t n = 0;
+    wire_reader_init(&r, payload, len);
+    int type = wire_get_byte(&r);
+
+    if (type == WIRE_MATCH_DELTA) {
+        uint32_t match_id = wire_get_uint(&r);
+        uint32_t seq = wire_get_uint(&r);
+        uint32_t count = wire_get_uint(&r);
+        n = (size_t)snprintf(out, size, "%d MATCH_DELTA %u %u %u",
+                             RESP_MATCH_DELTA_NOTIFY, match_id, seq, count);
+        for (uint32_t i = 0; i < count && !r.error && n < size; i++) {
+            char user[64];
+            wire_get_str(&r, user, sizeof(user));
+            uint32_t mask = wire_get_uint(&r);
+            n += (size_t)snprintf(out + n, size - n, " %s %u", user, mask);
+            for (int bit = 0; bit < 6 && n < size; bit++) {
+                if (mask & (1u << bit)) n += (size_t)snprintf(out + n, size - n, " %u", wire_get_uint(&r));
+            }
+        }
+    } else if (type & WIRE_REPLY) {
+        uint32_t code = wire_get_uint(&r);
+        n = (size_t)snprintf(out, size, "%u", code);
+        if (type == (WIRE_FIRE | WIRE_REPLY) && r.pos < r.len) {
+            n += (size_t)snprintf(out + n, size - n, " %s %s", net.username, net.fire_target);
+        }
+        while (r.pos < r.len && !r.error && n < size) {
+            n += (size_t)snprintf(out + n, size - n, " %u", wire_get_uint(&r));
+        }
+    } else {
+        return;     // Unknown type: skip the frame
+    }
+    if (r.error || n + 2 >= size) return;
+    memcpy(out + n, "\r\n", 2);
+    net.pending_len = n + 2;
+    net.pending_pos = 0;
+}
+
+/* Read frames until one yields lines; -1 if the connection closed or broke */
+static int net_read_frame(int sock) {
+    static uint8_t payload[WIRE_MAX_FRAME];
+    while (net.pending_pos >= net.pending_len) {
+        // Length prefix: one varint byte at a time, so no bytes of the next frame are taken
+        size_t len = 0;
+        for (int i = 0; ; i++) {
+            uint8_t b;
+            if (i == WIRE_VARINT_MAX || recv_exact(sock, &b, 1) < 0) return -1;
+            len |= (size_t)(b & 0x7F) << (7 * i);
+            if (!(b & 0x80)) break;
+        }
+        if (len == 0 || len > sizeof(payload) || recv_exact(sock, payload, len) < 0) return -1;
+
+        if (payload[0] == WIRE_TEXT) {
+            memcpy(net.pending, payload + 1, len - 1);
+            net.pending_len = len - 1;
+            net.pending_pos = 0;
+        } else {
+            net_render(payload, len);
+        }
+    }
+    return 0;
+}
+
+/* Lines already received and waiting, which select() cannot see */
+static int net_pending(void) {
+    return net.binary && net.pending_pos < net.pending_len;
+}
+
+static ssize_t net_recv_line(int sock, char *buf, size_t size) {
+    if (!net.binary) return recv_line(sock, buf, size);
+    if (net_read_frame(sock) < 0) return -1;
+
+    const char *line = net.pending + net.pending_pos;
+    const char *nl = memchr(line, '\n', net.pending_len - net.pending_pos);
+    size_t len = nl ? (size_t)(nl - line) : net.pending_len - net.pending_pos;
+    net.pending_pos += nl ? len + 1 : len;
+    if (len > 0 && line[len - 1] == '\r') len--;
+    if (len >= size) len = size - 1;
+    memcpy(buf, line, len);
+    buf[len] = '\0';
+
+    if (strncmp(buf, "110", 3) == 0 && net.login[0]) {
+        snprintf(net.username, sizeof(net.username), "%s", net.login);
+    }
+    return (ssize_t)len;
+}
+
 /**
  * @brief Check and handle broadcast messages (like chest drop 141)
  * Non-blocking check for incoming messages
@@ -35,11 +199,11 @@ static int check_broadcast_messages(int sock) {
         timeout.tv_sec = 0;
         timeout.tv_usec = 0;
         
-        if (select(sock + 1, &readfds, NULL, NULL, &timeout) > 0) {
+        if (net_pending() || select(sock + 1, &readfds, NULL, NULL, &timeout) > 0) {
             if (FD_ISSET(sock, &readfds)) {
                 char msg[BUFF_SIZE];
                 // Dùng MSG_PEEK để kiểm tra, nhưng ở đây ta dùng recv_line luôn vì thiết kế hiện tại
-                ssize_t n = recv_line(sock, msg, sizeof(msg));
+                ssize_t n = net_recv_line(sock, msg, sizeof(msg));
                 
                 if (n > 0) {
                     int code;
@@ -66,6 +230,15 @@ static int check_broadcast_messages(int sock) {
                             printf("\n>>> MATCH STARTED!\n");
                             fflush(stdout);
                         }
+                        else if (code == RESP_MATCH_ENDED_NOTIFY) { // 152 hết giờ hoặc một đội bị chìm hết
+                            int mid, winner;
+                            if (sscanf(msg, "%*d MATCH_ENDED %d %d", &mid, &winner) == 2) {
+                                current_chest_id = -1;
+                                if (winner > 0) printf("\n>>> Trận %d kết thúc, đội %d thắng\n", mid, winner);
+                                else printf("\n>>> Trận %d kết thúc, hòa\n", mid);
+                                fflush(stdout);
+                            }
+                        }
                         else if (code == RESP_CHALLENGE_RECEIVED) { // 150
                             // ... In ra thông báo ...
                             printf("\n>>> Có lời mời thách đấu!\n");
@@ -86,12 +259,189 @@ static int check_broadcast_messages(int sock) {
     }
     return messages_handled;
 }
+
+/* ============================================================================
+ * MATCH FEED (MATCH_SUBSCRIBE): ship state pushed by the server
+ * ============================================================================ */
+
+#define FEED_MAX_SHIPS 16
+
+typedef struct {
+    char name[64];
+    int team_id;
+    int hp;
+    int armor;
+    int cannon;
+    int laser;
+    int missile;
+} FeedShip;
+
+static struct {
+    int match_id;           /**< Subscribed match, -1 if none */
+    int team1_id;
+    int team2_id;
+    unsigned long seq;      /**< Sequence of the last snapshot or delta applied */
+    int synced;             /**< 0 after a gap: subscribe again for a snapshot */
+    int ended;              /**< 152 MATCH_ENDED seen for match_id */
+    FeedShip ships[FEED_MAX_SHIPS];
+    int count;
+} feed = { .match_id = -1 };
+
+static FeedShip *feed_ship(const char *name) {
+    for (int i = 0; i < feed.count; i++) {
+        if (strcmp(feed.ships[i].name, name) == 0) return &feed.ships[i];
+    }
+    if (feed.count >= FEED_MAX_SHIPS) return NULL;
+    FeedShip *ship = &feed.ships[feed.count++];
+    memset(ship, 0, sizeof(*ship));
+    snprintf(ship->name, sizeof(ship->name), "%s", name);
+    return ship;
+}
+
+/* 154 MATCH_SNAPSHOT <match> <seq> <team1> <team2> <n> {<user> <team> <hp> <armor> <cannon> <laser> <missile>} */
+static void feed_apply_snapshot(const char *line) {
+    int match_id, team1, team2, n, pos = 0;
+    unsigned long seq;
+    if (sscanf(line, "%*d MATCH_SNAPSHOT %d %lu %d %d %d%n", &match_id, &seq, &team1, &team2, &n, &pos) != 5) return;
+
+    feed.match_id = match_id;
+    feed.team1_id = team1;
+    feed.team2_id = team2;
+    feed.seq = seq;
+    feed.synced = 1;
+    feed.ended = 0;
+    feed.count = 0;
+    const char *p = line + pos;
+    for (int i = 0; i < n; i++) {
+        char name[64];
+        int used = 0;
+        FeedShip s;
+        if (sscanf(p, "%63s %d %d %d %d %d %d%n", name, &s.team_id, &s.hp, &s.armor,
+                   &s.cannon, &s.laser, &s.missile, &used) != 7) break;
+        p += used;
+        FeedShip *ship = feed_ship(name);
+        if (!ship) break;
+        memcpy(s.name, ship->name, sizeof(s.name));
+        *ship = s;
+    }
+}
+
+/* 155 MATCH_DELTA <match> <seq> <n> {<user> <mask> <value per SHIP_DELTA_* bit>} */
+static void feed_apply_delta(const char *line) {
+    int match_id, n, pos = 0;
+    unsigned long seq;
+    if (sscanf(line, "%*d MATCH_DELTA %d %lu %d%n", &match_id, &seq, &n, &pos) != 3) return;
+    if (match_id != feed.match_id || !feed.synced) return;
+    if (seq <= feed.seq) return;            // Already in the snapshot
+    if (seq != feed.seq + 1) {              // Missed one: values are stale until resync
+        feed.synced = 0;
+        return;
+    }
+    feed.seq = seq;
+
+    const char *p = line + pos;
+    for (int i = 0; i < n; i++) {
+        char name[64];
+        int mask, used = 0;
+        if (sscanf(p, "%63s %d%n", name, &mask, &used) != 2) break;
+        p += used;
+        FeedShip *ship = feed_ship(name);
+        FeedShip scratch;
+        if (!ship) ship = &scratch;
+        int *fields[] = { &ship->team_id, &ship->hp, &ship->armor, &ship->cannon, &ship->laser, &ship->missile };
+        for (int bit = 0; bit < 6; bit++) {
+            if (!(mask & (1 << bit))) continue;
+            if (sscanf(p, "%d%n", fields[bit], &used) != 1) return;
+            p += used;
+        }
+    }
+}
+
+/**
+ * @brief Apply a line the server pushed on its own (deltas, events)
+ * @return 1 if it was one, 0 if it is a command reply
+ */
+static int feed_handle_line(const char *line) {
+    int code = 0;
+    if (sscanf(line, "%d", &code) != 1) return 0;
+
+    if (code == RESP_MATCH_DELTA_NOTIFY) {
+        feed_apply_delta(line);
+    } else if (code == RESP_MATCH_TICK_NOTIFY || strstr(line, "FIRE_EVENT")) {
+        // 153 / 131: the deltas carry the same ship values
+    } else if (code == RESP_MATCH_ENDED_NOTIFY) {
+        int match_id;
+        if (sscanf(line, "%*d MATCH_ENDED %d", &match_id) == 1 && match_id == feed.match_id) feed.ended = 1;
+        current_chest_id = -1;
+    } else if (code == RESP_CHEST_DROP_OK) {
+        int cid;
+        if (sscanf(line, "%*d %d", &cid) == 1) current_chest_id = cid;
+    } else if (code == RESP_CHEST_BROADCAST) {
+        current_chest_id = -1;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+/* net_recv_line() for a command's reply: pushed lines read on the way are applied */
+static ssize_t recv_reply(int sock, char *buf, size_t size) {
+    ssize_t n;
+    while ((n = net_recv_line(sock, buf, size)) > 0) {
+        if (!feed_handle_line(buf)) return n;
+    }
+    return n;
+}
+
+/* Apply everything already received without blocking; -1 if the connection closed */
+static int feed_drain(int sock) {
+    char line[BUFF_SIZE];
+    while (1) {
+        fd_set readfds;
+        struct timeval timeout = { 0, 0 };
+        FD_ZERO(&readfds);
+        FD_SET(sock, &readfds);
+        if (!net_pending() && select(sock + 1, &readfds, NULL, NULL, &timeout) <= 0) return 0;
+        if (net_recv_line(sock, line, sizeof(line)) <= 0) return -1;
+        feed_handle_line(line);
+    }
+}
+
+/**
+ * @brief Subscribe (or resync) to a match and load its snapshot
+ * @param buf Receives the error reply on failure
+ * @return 0 on success, -1 on failure
+ */
+static int feed_subscribe(int sock, int match_id, char *buf, size_t size) {
+    char cmd[64];
+    snprintf(cmd, sizeof(cmd), "MATCH_SUBSCRIBE %d", match_id);
+    feed.match_id = match_id;
+    feed.synced = 0;
+    if (net_send_line(sock, cmd) < 0 || recv_reply(sock, buf, size) <= 0) {
+        snprintf(buf, size, "%d", RESP_INTERNAL_ERROR);
+        return -1;
+    }
+    int code = 0;
+    sscanf(buf, "%d", &code);
+    if (code != RESP_MATCH_SNAPSHOT) return -1;
+    feed_apply_snapshot(buf);
+    return 0;
+}
+
+static void feed_unsubscribe(int sock) {
+    char line[BUFF_SIZE];
+    if (net_send_line(sock, "MATCH_UNSUBSCRIBE") >= 0) recv_reply(sock, line, sizeof(line));
+    feed.match_id = -1;
+    feed.count = 0;
+}
+
 /**
  * @brief Print program usage for the TCP client.
  * @param prog Executable name (argv[0]).
  */
 static void usage(const char *prog) {
-    fprintf(stderr, "Usage: %s <ServerIP> <PortNumber>\n", prog);
+    fprintf(stderr, "Usage: %s <ServerIP> <PortNumber> [-b]\n", prog);
+    fprintf(stderr, "  -b  Binary wire protocol (default: text)\n");
     fprintf(stderr, "Example: %s 127.0.0.1 5500\n", prog);
 }
 
@@ -103,10 +453,11 @@ static void usage(const char *prog) {
  * beautified into human-friendly text via beautify_result().
  */
 int main(int argc, char *argv[]) {
-    if (argc != 3) {
+    if (argc != 3 && !(argc == 4 && strcmp(argv[3], "-b") == 0)) {
         usage(argv[0]);
         return EXIT_FAILURE;
     }
+    int want_binary = (argc == 4);
 
     const char *server_ip = argv[1];
     int port = atoi(argv[2]);
@@ -141,12 +492,25 @@ int main(int argc, char *argv[]) {
      * 2. NHẬN TIN NHẮN CHÀO MỪNG
      * ========================================= */
     char recvbuf[BUFF_SIZE];
-    if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+    if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
         char pretty[1024];
         beautify_result(recvbuf, pretty, sizeof(pretty));
         printf("%s", pretty);
     }
 
+    // -b: frames from here on if the server knows BINARY, otherwise stay on text
+    if (want_binary) {
+        int code = 0;
+        if (send_line(sock, "BINARY") < 0 || recv_line(sock, recvbuf, sizeof(recvbuf)) <= 0) {
+            fprintf(stderr, "Connection closed.\n");
+            close(sock);
+            return EXIT_FAILURE;
+        }
+        sscanf(recvbuf, "%d", &code);
+        net.binary = (code == RESP_BINARY_OK);
+        printf("%s\n", net.binary ? "Binary protocol enabled." : "Server has no binary protocol, using text.");
+    }
+
 
     /* =========================================
      * 3. VÒNG LẶP CHÍNH (MAIN LOOP)
@@ -215,12 +579,12 @@ int main(int argc, char *argv[]) {
 #endif
                 char cmd[512];
                 snprintf(cmd, sizeof(cmd), "REGISTER %s %s", username, password);
-                if (send_line(sock, cmd) < 0) {
+                if (net_send_line(sock, cmd) < 0) {
                     perror("send() error");
                     break;
                 }
 
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
 #ifdef USE_NCURSES
                     char pretty[1024];
                     beautify_result(recvbuf, pretty, sizeof(pretty));
@@ -261,12 +625,12 @@ int main(int argc, char *argv[]) {
 #endif
                 char cmd[512];
                 snprintf(cmd, sizeof(cmd), "LOGIN %s %s", username, password);
-                if (send_line(sock, cmd) < 0) {
+                if (net_send_line(sock, cmd) < 0) {
                     perror("send() error");
                     break;
                 }
 
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
 #ifdef USE_NCURSES
                     char pretty[1024];
                     beautify_result(recvbuf, pretty, sizeof(pretty));
@@ -285,12 +649,12 @@ int main(int argc, char *argv[]) {
                     continue;
                 }
 #endif
-                if (send_line(sock, "BYE") < 0) {
+                if (net_send_line(sock, "BYE") < 0) {
                     perror("send() error");
                     break;
                 }
 
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
 #ifdef USE_NCURSES
                     char pretty[1024];
                     beautify_result(recvbuf, pretty, sizeof(pretty));
@@ -304,12 +668,12 @@ int main(int argc, char *argv[]) {
                 break;
             }
             case FUNC_WHOAMI: { /* Who am I? */
-                if (send_line(sock, "WHOAMI") < 0) {
+                if (net_send_line(sock, "WHOAMI") < 0) {
                     perror("send() error");
                     break;
                 }
 
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
 #ifdef USE_NCURSES
                     whoami_ui_ncurses(recvbuf);
 #else
@@ -336,12 +700,12 @@ int main(int argc, char *argv[]) {
             }
 
             case FUNC_CHECK_COIN: { /* Check my coin */
-                if (send_line(sock, "GETCOIN") < 0) {
+                if (net_send_line(sock, "GETCOIN") < 0) {
                     perror("send() error");
                     break;
                 }
 
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     int code;
                     long coin = 0;
                     if (sscanf(recvbuf, "%d %ld", &code, &coin) >= 2 && code == RESP_COIN_OK) {
@@ -355,12 +719,12 @@ int main(int argc, char *argv[]) {
                 break;
             }
             case FUNC_CHECK_ARMOR: { /* Check my armor */
-                if (send_line(sock, "GETARMOR") < 0) {
+                if (net_send_line(sock, "GETARMOR") < 0) {
                     perror("send() error");
                     break;
                 }
 
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     int code;
                     int slot1_type = 0, slot1_value = 0, slot2_type = 0, slot2_value = 0;
                     
@@ -393,8 +757,8 @@ int main(int argc, char *argv[]) {
                 if (armor_type < 1 || armor_type > 2) { printf("Invalid armor type.\n"); continue; }
                 
                 snprintf(cmd, sizeof(cmd), "BUYARMOR %d", armor_type);
-                if (send_line(sock, cmd) < 0) break;
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, cmd) < 0) break;
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                      char pretty[1024];
                      beautify_result(recvbuf, pretty, sizeof(pretty));
                      printf("%s", pretty);
@@ -421,8 +785,8 @@ int main(int argc, char *argv[]) {
                 int server_weapon_type = weapon_type - 1;
                 
                 snprintf(cmd, sizeof(cmd), "BUY_WEAPON %d", server_weapon_type);
-                if (send_line(sock, cmd) < 0) break;
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, cmd) < 0) break;
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                      char pretty[1024];
                      beautify_result(recvbuf, pretty, sizeof(pretty));
                      printf("%s", pretty);
@@ -431,11 +795,11 @@ int main(int argc, char *argv[]) {
             }
 
             case FUNC_GET_WEAPON: {
-                if (send_line(sock, "GET_WEAPON") < 0) {
+                if (net_send_line(sock, "GET_WEAPON") < 0) {
                     perror("send() error");
                     break;
                 }
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     int code;
                     int cannon_ammo = 0, laser_count = 0, missile_count = 0;
                     if (sscanf(recvbuf, "%d %d %d %d", &code, &cannon_ammo, &laser_count, &missile_count) == 4
@@ -477,11 +841,11 @@ int main(int argc, char *argv[]) {
                 }
                 
                 snprintf(cmd, sizeof(cmd), "START_MATCH %d", opponent_team_id);
-                if (send_line(sock, cmd) < 0) {
+                if (net_send_line(sock, cmd) < 0) {
                     perror("send() error");
                     break;
                 }
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     int code;
                     if (sscanf(recvbuf, "%d", &code) == 1 && code == RESP_START_MATCH_OK) {
                         printf("Match started successfully!\n");
@@ -507,8 +871,8 @@ int main(int argc, char *argv[]) {
                 if (match_id <= 0) { printf("Invalid match ID.\n"); continue; }
                 
                 snprintf(cmd, sizeof(cmd), "GET_MATCH_RESULT %d", match_id);
-                if (send_line(sock, cmd) < 0) break;
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, cmd) < 0) break;
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     // Expect: 143 <match_id> <winner_team_id> on success
                     int code = 0, recv_match_id = 0, winner_team_id = 0;
                     if (sscanf(recvbuf, "%d %d %d", &code, &recv_match_id, &winner_team_id) == 3 && code == RESP_MATCH_RESULT_OK) {
@@ -535,8 +899,8 @@ int main(int argc, char *argv[]) {
                 if (match_id <= 0) { printf("Invalid match ID.\n"); continue; }
                 
                 snprintf(cmd, sizeof(cmd), "END_MATCH %d", match_id);
-                if (send_line(sock, cmd) < 0) break;
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, cmd) < 0) break;
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                      char pretty[1024];
                      beautify_result(recvbuf, pretty, sizeof(pretty));
                      printf("%s", pretty);
@@ -550,8 +914,8 @@ int main(int argc, char *argv[]) {
                 if (strlen(team_name) == 0) continue;
 
                 snprintf(cmd, sizeof(cmd), "CREATE_TEAM %s", team_name);
-                if (send_line(sock, cmd) < 0) break;
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, cmd) < 0) break;
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     char pretty[1024];
                     beautify_result(recvbuf, pretty, sizeof(pretty));
                     printf("%s", pretty);
@@ -560,8 +924,8 @@ int main(int argc, char *argv[]) {
             }
 
             case FUNC_DELETE_TEAM: { 
-                if (send_line(sock, "DELETE_TEAM") < 0) break;
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, "DELETE_TEAM") < 0) break;
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     char pretty[1024];
                     beautify_result(recvbuf, pretty, sizeof(pretty));
                     printf("%s", pretty);
@@ -570,8 +934,8 @@ int main(int argc, char *argv[]) {
             }
 
             case FUNC_LIST_TEAMS: { 
-                if (send_line(sock, "LIST_TEAMS") < 0) break;
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, "LIST_TEAMS") < 0) break;
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     char *payload = strchr(recvbuf, ' ');
                     if (payload) {
                         printf("\n>>> TEAM LIST:\n%s\n", payload + 1);
@@ -593,11 +957,11 @@ int main(int argc, char *argv[]) {
                 }
                 char cmd[64];
                 snprintf(cmd, sizeof(cmd), "REPAIR %d", repair_amount);
-                if (send_line(sock, cmd) < 0) {
+                if (net_send_line(sock, cmd) < 0) {
                     perror("send() error");
                     break;
                 }
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     int code, newHP = 0;
                     long newCoin = 0;
                     int n = sscanf(recvbuf, "%d %d %ld", &code, &newHP, &newCoin);
@@ -632,13 +996,13 @@ int main(int argc, char *argv[]) {
                 snprintf(cmd, sizeof(cmd), "FIRE %s %s", target_id, weapon_id);
                 
                 // 1. Gửi lệnh
-                if (send_line(sock, cmd) < 0) {
+                if (net_send_line(sock, cmd) < 0) {
                     perror("send() error");
                     break;
                 }
 
                 // 2. Chờ phản hồi NGAY LẬP TỨC
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     int dam, hp, arm;
                     char atk_name[128], tar_name[128];
                     // Giả sử server trả về: "200 AtkID TarID Dam HP Armor" khi bắn trúng
@@ -665,11 +1029,11 @@ int main(int argc, char *argv[]) {
                 // Gửi SEND_CHALLENGE (chỉ tạo challenge record, chưa tạo match)
                 snprintf(cmd, sizeof(cmd), "SEND_CHALLENGE %s", team_id_str);
 
-                if (send_line(sock, cmd) < 0) {
+                if (net_send_line(sock, cmd) < 0) {
                     perror("send() error");
                     break;
                 }
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     int code, challenge_id;
                     // Parse: 130 CHALLENGE_SENT <challenge_id>
                     if (sscanf(recvbuf, "%d CHALLENGE_SENT %d", &code, &challenge_id) == 2 && code == RESP_CHALLENGE_SENT) {
@@ -689,12 +1053,12 @@ int main(int argc, char *argv[]) {
                 //     break;
                 // }
                 snprintf(cmd, sizeof(cmd), "ACCEPT_CHALLENGE"); // Gửi lệnh không kèm ID
-                if (send_line(sock, cmd) < 0) break;
+                if (net_send_line(sock, cmd) < 0) break;
                 
                 // Đọc response chính (131 CHALLENGE_ACCEPTED) - chỉ in INFO và EVENT
                 int response_received = 0;
                 while (!response_received) {
-                    if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                    if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                         int code_check;
                         if (sscanf(recvbuf, "%d", &code_check) == 1) {
                             if (code_check == RESP_CHALLENGE_ACCEPTED) {
@@ -740,9 +1104,9 @@ int main(int argc, char *argv[]) {
                 if (strlen(challenge_id_str) == 0) break;
                 
                 snprintf(cmd, sizeof(cmd), "DECLINE_CHALLENGE %s", challenge_id_str);
-                if (send_line(sock, cmd) < 0) break;
+                if (net_send_line(sock, cmd) < 0) break;
                 
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     char pretty[1024];
                     beautify_result(recvbuf, pretty, sizeof(pretty));
                     printf("%s", pretty);
@@ -763,12 +1127,12 @@ int main(int argc, char *argv[]) {
 
                 // 2. Gửi ID lên để lấy câu hỏi
                 snprintf(cmd, sizeof(cmd), "CHEST_OPEN %s", chest_id);
-                if (send_line(sock, cmd) < 0) break;
+                if (net_send_line(sock, cmd) < 0) break;
 
                 // 3. Nhận câu hỏi - có thể nhận được 211 (câu hỏi), 151 (MATCH_STARTED), hoặc 141 (CHEST_DROP)
                 int question_received = 0;
                 while (!question_received) {
-                    if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                    if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                         int code;
                         char question_text[256];
                         
@@ -791,12 +1155,12 @@ int main(int argc, char *argv[]) {
 
                             // 5. Gửi ID + Đáp án
                             snprintf(cmd, sizeof(cmd), "CHEST_OPEN %s %s", chest_id, answer);
-                            if (send_line(sock, cmd) < 0) break;
+                            if (net_send_line(sock, cmd) < 0) break;
                             
                             // 6. Nhận kết quả cuối cùng - có thể nhận được 127 (success), 210 (broadcast), hoặc error
                             int result_received = 0;
                             while (!result_received) {
-                                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                                     int result_code;
                                     if (sscanf(recvbuf, "%d", &result_code) == 1) {
                                         if (result_code == RESP_CHEST_OPEN_OK) {
@@ -866,8 +1230,8 @@ int main(int argc, char *argv[]) {
                 if (strlen(team_name) == 0) continue;
 
                 snprintf(cmd, sizeof(cmd), "JOIN_REQUEST %s", team_name);
-                if (send_line(sock, cmd) < 0) break;
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, cmd) < 0) break;
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     char pretty[1024];
                     beautify_result(recvbuf, pretty, sizeof(pretty));
                     printf("%s", pretty);
@@ -876,8 +1240,8 @@ int main(int argc, char *argv[]) {
             }
 
             case FUNC_LEAVE_TEAM: { 
-                if (send_line(sock, "LEAVE_TEAM") < 0) break;
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, "LEAVE_TEAM") < 0) break;
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     char pretty[1024];
                     beautify_result(recvbuf, pretty, sizeof(pretty));
                     printf("%s", pretty);
@@ -886,8 +1250,8 @@ int main(int argc, char *argv[]) {
             }
 
             case FUNC_TEAM_MEMBERS: { 
-                if (send_line(sock, "TEAM_MEMBER_LIST") < 0) break;
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, "TEAM_MEMBER_LIST") < 0) break;
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     char *payload = strchr(recvbuf, ' ');
                     if (payload) {
                         printf("\n>>> MEMBERS:\n%s\n", payload + 1);
@@ -904,8 +1268,8 @@ int main(int argc, char *argv[]) {
                 if (strlen(target_user) == 0) continue;
 
                 snprintf(cmd, sizeof(cmd), "KICK_MEMBER %s", target_user);
-                if (send_line(sock, cmd) < 0) break;
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, cmd) < 0) break;
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     char pretty[1024];
                     beautify_result(recvbuf, pretty, sizeof(pretty));
                     printf("%s", pretty);
@@ -919,8 +1283,8 @@ int main(int argc, char *argv[]) {
                 if (strlen(target_user) == 0) continue;
 
                 snprintf(cmd, sizeof(cmd), "JOIN_APPROVE %s", target_user);
-                if (send_line(sock, cmd) < 0) break;
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, cmd) < 0) break;
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     char pretty[1024];
                     beautify_result(recvbuf, pretty, sizeof(pretty));
                     printf("%s", pretty);
@@ -934,8 +1298,8 @@ int main(int argc, char *argv[]) {
                 if (strlen(target_user) == 0) continue;
 
                 snprintf(cmd, sizeof(cmd), "JOIN_REJECT %s", target_user);
-                if (send_line(sock, cmd) < 0) break;
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, cmd) < 0) break;
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     char pretty[1024];
                     beautify_result(recvbuf, pretty, sizeof(pretty));
                     printf("%s", pretty);
@@ -948,8 +1312,8 @@ int main(int argc, char *argv[]) {
                 printf("Enter username to invite: "); fflush(stdout); safeInput(target_user, sizeof(target_user));
                 
                 snprintf(cmd, sizeof(cmd), "INVITE %s", target_user);
-                if (send_line(sock, cmd) < 0) break;
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, cmd) < 0) break;
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     char pretty[1024];
                     beautify_result(recvbuf, pretty, sizeof(pretty));
                     printf("%s", pretty);
@@ -962,8 +1326,8 @@ int main(int argc, char *argv[]) {
                 printf("Enter team name to accept invite: "); fflush(stdout); safeInput(team_name, sizeof(team_name));
                 
                 snprintf(cmd, sizeof(cmd), "INVITE_ACCEPT %s", team_name);
-                if (send_line(sock, cmd) < 0) break;
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, cmd) < 0) break;
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     char pretty[1024];
                     beautify_result(recvbuf, pretty, sizeof(pretty));
                     printf("%s", pretty);
@@ -978,8 +1342,8 @@ int main(int argc, char *argv[]) {
                 if (strlen(team_name) == 0) break;
 
                 snprintf(cmd, sizeof(cmd), "INVITE_REJECT %s", team_name);
-                if (send_line(sock, cmd) < 0) break;
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, cmd) < 0) break;
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     char pretty[1024];
                     beautify_result(recvbuf, pretty, sizeof(pretty));
                     printf("%s", pretty);
@@ -1000,11 +1364,11 @@ int main(int argc, char *argv[]) {
                 snprintf(password, sizeof(password), "Admin@2024");
                 
                 snprintf(cmd, sizeof(cmd), "LOGIN %s %s", username, password);
-                if (send_line(sock, cmd) < 0) {
+                if (net_send_line(sock, cmd) < 0) {
                     perror("send() error");
                     break;
                 }
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
 #ifdef USE_NCURSES
                     char pretty[1024];
                     beautify_result(recvbuf, pretty, sizeof(pretty));
@@ -1022,8 +1386,8 @@ int main(int argc, char *argv[]) {
             case FUNC_SETUP_TEAM_ABC: {
                 // Create team
                 snprintf(cmd, sizeof(cmd), "CREATE_TEAM abc");
-                if (send_line(sock, cmd) < 0) break;
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, cmd) < 0) break;
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     char pretty[1024];
                     beautify_result(recvbuf, pretty, sizeof(pretty));
 #ifdef USE_NCURSES
@@ -1036,8 +1400,8 @@ int main(int argc, char *argv[]) {
                 
                 // Invite test2
                 snprintf(cmd, sizeof(cmd), "INVITE test2");
-                if (send_line(sock, cmd) < 0) break;
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, cmd) < 0) break;
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     char pretty[1024];
                     beautify_result(recvbuf, pretty, sizeof(pretty));
 #ifdef USE_NCURSES
@@ -1050,8 +1414,8 @@ int main(int argc, char *argv[]) {
                 
                 // Invite test3
                 snprintf(cmd, sizeof(cmd), "INVITE test3");
-                if (send_line(sock, cmd) < 0) break;
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, cmd) < 0) break;
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     char pretty[1024];
                     beautify_result(recvbuf, pretty, sizeof(pretty));
 #ifdef USE_NCURSES
@@ -1067,8 +1431,8 @@ int main(int argc, char *argv[]) {
             case FUNC_SETUP_TEAM_DEF: {
                 // Create team
                 snprintf(cmd, sizeof(cmd), "CREATE_TEAM def");
-                if (send_line(sock, cmd) < 0) break;
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, cmd) < 0) break;
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     char pretty[1024];
                     beautify_result(recvbuf, pretty, sizeof(pretty));
 #ifdef USE_NCURSES
@@ -1081,8 +1445,8 @@ int main(int argc, char *argv[]) {
                 
                 // Invite test5
                 snprintf(cmd, sizeof(cmd), "INVITE test5");
-                if (send_line(sock, cmd) < 0) break;
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, cmd) < 0) break;
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     char pretty[1024];
                     beautify_result(recvbuf, pretty, sizeof(pretty));
 #ifdef USE_NCURSES
@@ -1095,8 +1459,8 @@ int main(int argc, char *argv[]) {
                 
                 // Invite test6
                 snprintf(cmd, sizeof(cmd), "INVITE test6");
-                if (send_line(sock, cmd) < 0) break;
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, cmd) < 0) break;
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     char pretty[1024];
                     beautify_result(recvbuf, pretty, sizeof(pretty));
 #ifdef USE_NCURSES
@@ -1111,8 +1475,8 @@ int main(int argc, char *argv[]) {
             // Accept invite to team abc
             case FUNC_ACCEPT_ABC: {
                 snprintf(cmd, sizeof(cmd), "INVITE_ACCEPT abc");
-                if (send_line(sock, cmd) < 0) break;
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, cmd) < 0) break;
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     char pretty[1024];
                     beautify_result(recvbuf, pretty, sizeof(pretty));
 #ifdef USE_NCURSES
@@ -1127,8 +1491,8 @@ int main(int argc, char *argv[]) {
             // Accept invite to team def
             case FUNC_ACCEPT_DEF: {
                 snprintf(cmd, sizeof(cmd), "INVITE_ACCEPT def");
-                if (send_line(sock, cmd) < 0) break;
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, cmd) < 0) break;
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     char pretty[1024];
                     beautify_result(recvbuf, pretty, sizeof(pretty));
 #ifdef USE_NCURSES
@@ -1155,7 +1519,7 @@ int main(int argc, char *argv[]) {
                     // Login selected
                     if (login_ui_ncurses(username, sizeof(username), password, sizeof(password))) {
                         snprintf(cmd, sizeof(cmd), "LOGIN %s %s", username, password);
-                        if (send_line(sock, cmd) < 0) {
+                        if (net_send_line(sock, cmd) < 0) {
                             perror("send() error");
                             break;
                         }
@@ -1165,7 +1529,7 @@ int main(int argc, char *argv[]) {
                     // Register selected
                     if (register_ui_ncurses(username, sizeof(username), password, sizeof(password))) {
                         snprintf(cmd, sizeof(cmd), "REGISTER %s %s", username, password);
-                        if (send_line(sock, cmd) < 0) {
+                        if (net_send_line(sock, cmd) < 0) {
                             perror("send() error");
                             break;
                         }
@@ -1173,7 +1537,7 @@ int main(int argc, char *argv[]) {
                     }
                 }
                 
-                if (success && recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (success && net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     char pretty[1024];
                     beautify_result(recvbuf, pretty, sizeof(pretty));
                     show_message_ncurses(menu_choice == 0 ? "Login Result" : "Register Result", pretty);
@@ -1198,12 +1562,12 @@ int main(int argc, char *argv[]) {
                 }
                 
                 snprintf(cmd, sizeof(cmd), "MATCH_INFO %d", match_id);
-                if (send_line(sock, cmd) < 0) {
+                if (net_send_line(sock, cmd) < 0) {
                     perror("send() error");
                     break;
                 }
                 
-                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     // Parse response: code and data separated by space
                     int code = 0;
                     char *data_start = strchr(recvbuf, ' ');
@@ -1233,7 +1597,7 @@ int main(int argc, char *argv[]) {
                     // Buy Armor flow
                     // Fetch current coin from server
                     int coin = -1;
-                    if (send_line(sock, "GETCOIN") >= 0 && recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                    if (net_send_line(sock, "GETCOIN") >= 0 && net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                         int code_tmp = 0;
                         int coin_tmp = -1;
                         if (sscanf(recvbuf, "%d %d", &code_tmp, &coin_tmp) == 2) {
@@ -1244,8 +1608,8 @@ int main(int argc, char *argv[]) {
                     if (armor_sel == -1) break; // cancelled
                     int armor_type = (armor_sel == 0) ? 1 : 2; // 1 BASIC, 2 ENHANCED
                     snprintf(cmd, sizeof(cmd), "BUYARMOR %d", armor_type);
-                    if (send_line(sock, cmd) < 0) break;
-                    if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                    if (net_send_line(sock, cmd) < 0) break;
+                    if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                         char pretty[1024];
                         beautify_result(recvbuf, pretty, sizeof(pretty));
                         printf("%s", pretty);
@@ -1254,7 +1618,7 @@ int main(int argc, char *argv[]) {
                     // Buy Weapon flow
                     // Fetch current coin from server
                     int coin = -1;
-                    if (send_line(sock, "GETCOIN") >= 0 && recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                    if (net_send_line(sock, "GETCOIN") >= 0 && net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                         int code_tmp = 0;
                         int coin_tmp = -1;
                         if (sscanf(recvbuf, "%d %d", &code_tmp, &coin_tmp) == 2) {
@@ -1266,8 +1630,8 @@ int main(int argc, char *argv[]) {
                     // Map: 0=CANNON, 1=LASER, 2=MISSILE (matches server WeaponType)
                     int weapon_type = weapon_sel;
                     snprintf(cmd, sizeof(cmd), "BUY_WEAPON %d", weapon_type);
-                    if (send_line(sock, cmd) < 0) break;
-                    if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                    if (net_send_line(sock, cmd) < 0) break;
+                    if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                         char pretty[1024];
                         beautify_result(recvbuf, pretty, sizeof(pretty));
                         printf("%s", pretty);
@@ -1282,7 +1646,7 @@ int main(int argc, char *argv[]) {
            case FUNC_BATTLE_SCREEN: { 
 #ifdef USE_NCURSES
                 char my_username[128] = "";
-                if (send_line(sock, "WHOAMI") >= 0 && recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, "WHOAMI") >= 0 && net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     int code; sscanf(recvbuf, "%d %127s", &code, my_username);
                 }
                 
@@ -1295,82 +1659,40 @@ int main(int argc, char *argv[]) {
                     if (match_id <= 0) { printf("Invalid match ID.\n"); break; }
                 } else { printf("Please enter Match ID.\n"); break; }
 
+                // The server pushes ship changes (MATCH_DELTA) instead of being polled with MATCH_INFO
+                if (feed_subscribe(sock, match_id, recvbuf, sizeof(recvbuf)) != 0) {
+                    char p[1024]; beautify_result(recvbuf, p, sizeof(p)); printf("%s", p); break;
+                }
+
                 while (1) {
-                    snprintf(cmd, sizeof(cmd), "MATCH_INFO %d", match_id);
-                    if (send_line(sock, cmd) < 0) break;
-                    if (recv_line(sock, recvbuf, sizeof(recvbuf)) <= 0) break;
-                    
-                    int code = 0; sscanf(recvbuf, "%d", &code);
-                    
-                    // --- XỬ LÝ BROADCAST XEN NGANG ---
-                    if (code == RESP_CHEST_DROP_OK) { // 141
-                        int cid; sscanf(recvbuf, "%*d %d", &cid); current_chest_id = cid; continue;
-                    } else if (code == RESP_CHEST_BROADCAST) { // 210
-                        current_chest_id = -1; continue;
-                    } else if (code == RESP_FIRE_OK) { // 200
-                        continue; 
-                    } else if (code != RESP_MATCH_INFO_OK) {
-                        char p[1024]; beautify_result(recvbuf, p, sizeof(p)); printf("%s", p); break;
+                    // Apply what was pushed meanwhile; a sequence gap means a lost delta, so resync
+                    if (feed_drain(sock) < 0) break;
+                    if (feed.ended) {
+                        show_message_ncurses("MATCH ENDED", "The match is over.");
+                        break;
+                    }
+                    if (!feed.synced && feed_subscribe(sock, match_id, recvbuf, sizeof(recvbuf)) != 0) {
+                        char p[1024]; beautify_result(recvbuf, p, sizeof(p)); show_message_ncurses("MATCH", p);
+                        break;
                     }
 
-                    // --- PARSE DỮ LIỆU (VIẾT LẠI CHẶT CHẼ HƠN) ---
-                    char *ptr = strchr(recvbuf, ' '); 
-                    if (!ptr) continue; ptr++;
-                    
-                    char buf[8192]; 
-                    strncpy(buf, ptr, sizeof(buf)-1); buf[sizeof(buf)-1]='\0';
-                    
-                    // Reset dữ liệu
-                    char *tL_names[3]={0}; char *tR_names[3]={0};
                     const char *tL[3]={0}; const char *tR[3]={0};
                     int hpL[3]={0}, hpR[3]={0};
-                    int cntL=0, cntR=0, my_hp=0, team1=-1, team2=-1;
-                    int current_parsing_team = 0; // 1 or 2
-
-                    // Dùng strtok để cắt theo ký tự '|' (Server gửi ngăn cách bằng |)
-                    char *token = strtok(buf, "|");
-                    while (token != NULL) {
-                        // Trim space đầu đuôi token nếu cần (đơn giản hóa ở đây)
-                        while (*token == ' ') token++; // Bỏ space đầu
-                        
-                        if (strstr(token, "TEAM 1:")) {
-                            sscanf(strstr(token, "ID: ")+4, "%d", &team1);
-                            current_parsing_team = 1;
-                        } else if (strstr(token, "TEAM 2:")) {
-                            sscanf(strstr(token, "ID: ")+4, "%d", &team2);
-                            current_parsing_team = 2;
-                        } else if (strstr(token, "Player:")) {
-                            char pName[128]; int pHP=0;
-                            // Format: Player: abc | HP: 100 ...
-                            // Do strtok đã cắt '|', token hiện tại là "Player: abc"
-                            // Token TIẾP THEO sẽ là "HP: 100"
-                            sscanf(token, "Player: %s", pName);
-                            
-                            // Lấy token tiếp theo luôn cho HP
-                            char *hp_token = strtok(NULL, "|");
-                            if (hp_token && strstr(hp_token, "HP:")) {
-                                sscanf(strstr(hp_token, "HP:")+3, "%d", &pHP);
-                                
-                                // Lưu dữ liệu
-                                char *n = malloc(strlen(pName)+1); strcpy(n, pName);
-                                if (current_parsing_team == 1 && cntL < 3) {
-                                    tL_names[cntL] = n; tL[cntL] = n; hpL[cntL] = pHP; cntL++;
-                                } else if (current_parsing_team == 2 && cntR < 3) {
-                                    tR_names[cntR] = n; tR[cntR] = n; hpR[cntR] = pHP; cntR++;
-                                } else { free(n); }
-                                
-                                if (strcmp(pName, my_username)==0) my_hp = pHP;
-                            }
+                    int cntL=0, cntR=0, my_hp=0, my_armor=0, am_i_team2=0;
+                    for (int i = 0; i < feed.count; i++) {
+                        FeedShip *ship = &feed.ships[i];
+                        if (ship->team_id == feed.team1_id && cntL < 3) {
+                            tL[cntL] = ship->name; hpL[cntL] = ship->hp; cntL++;
+                        } else if (ship->team_id == feed.team2_id && cntR < 3) {
+                            tR[cntR] = ship->name; hpR[cntR] = ship->hp; cntR++;
+                        }
+                        if (strcmp(ship->name, my_username) == 0) {
+                            my_hp = ship->hp;
+                            my_armor = ship->armor;
+                            am_i_team2 = (ship->team_id == feed.team2_id);
                         }
-                        token = strtok(NULL, "|");
                     }
 
-                    // Determine Friend/Enemy (Giả định mình ở Team 1 nếu chưa xác định)
-                    // Cần logic check my_team_id, ở đây tạm thời:
-                    // Nếu user có trong list Team 2 -> Team 2 là Friendly
-                    int am_i_team2 = 0;
-                    for(int i=0; i<cntR; i++) if(strcmp(tR[i], my_username)==0) am_i_team2=1;
-
                     const char **frTeam, **enTeam;
                     int *frHP, *enHP; 
                     int frCnt, enCnt;
@@ -1383,15 +1705,8 @@ int main(int argc, char *argv[]) {
                         enTeam=tR; enHP=hpR; enCnt=cntR;
                     }
                     
-                    int my_armor = 0, my_coin = 0;
-                    if (send_line(sock, "GETARMOR") >= 0 && recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
-                        int code_armor, slot1_type, slot1_value, slot2_type, slot2_value;
-                        if (sscanf(recvbuf, "%d %d %d %d %d", &code_armor, &slot1_type, &slot1_value, &slot2_type, &slot2_value) >= 5 
-                            && code_armor == RESP_ARMOR_INFO_OK) {
-                            my_armor = slot1_value + slot2_value;
-                        }
-                    }
-                    if (send_line(sock, "GETCOIN") >= 0 && recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                    int my_coin = 0;
+                    if (net_send_line(sock, "GETCOIN") >= 0 && recv_reply(sock, recvbuf, sizeof(recvbuf)) > 0) {
                         int code_coin;
                         long coin_tmp = 0;
                         if (sscanf(recvbuf, "%d %ld", &code_coin, &coin_tmp) >= 2 && code_coin == RESP_COIN_OK) {
@@ -1408,8 +1723,6 @@ int main(int argc, char *argv[]) {
                         current_chest_id, 
                         target, sizeof(target), &wid
                     );
-                    
-                    for(int i=0; i<3; i++) { if(tL_names[i]) free(tL_names[i]); if(tR_names[i]) free(tR_names[i]); }
 
                     if (res == 0) {
                         int shop_sel = shop_menu_ncurses();
@@ -1418,7 +1731,7 @@ int main(int argc, char *argv[]) {
                         }
                         if (shop_sel == 0) {
                             int coin = -1;
-                            if (send_line(sock, "GETCOIN") >= 0 && recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                            if (net_send_line(sock, "GETCOIN") >= 0 && recv_reply(sock, recvbuf, sizeof(recvbuf)) > 0) {
                                 int code_tmp = 0;
                                 int coin_tmp = -1;
                                 if (sscanf(recvbuf, "%d %d", &code_tmp, &coin_tmp) == 2) {
@@ -1429,14 +1742,14 @@ int main(int argc, char *argv[]) {
                             if (armor_sel == -1) continue;
                             int armor_type = (armor_sel == 0) ? 1 : 2;
                             snprintf(cmd, sizeof(cmd), "BUYARMOR %d", armor_type);
-                            if (send_line(sock, cmd) < 0) break;
-                            if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                            if (net_send_line(sock, cmd) < 0) break;
+                            if (recv_reply(sock, recvbuf, sizeof(recvbuf)) > 0) {
                                 char p[1024]; beautify_result(recvbuf, p, sizeof(p));
                                 show_message_ncurses("BUY ARMOR", p);
                             }
                         } else if (shop_sel == 1) {
                             int coin = -1;
-                            if (send_line(sock, "GETCOIN") >= 0 && recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                            if (net_send_line(sock, "GETCOIN") >= 0 && recv_reply(sock, recvbuf, sizeof(recvbuf)) > 0) {
                                 int code_tmp = 0;
                                 int coin_tmp = -1;
                                 if (sscanf(recvbuf, "%d %d", &code_tmp, &coin_tmp) == 2) {
@@ -1447,29 +1760,29 @@ int main(int argc, char *argv[]) {
                             if (weapon_sel == -1) continue;
                             int weapon_type = weapon_sel;
                             snprintf(cmd, sizeof(cmd), "BUY_WEAPON %d", weapon_type);
-                            if (send_line(sock, cmd) < 0) break;
-                            if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                            if (net_send_line(sock, cmd) < 0) break;
+                            if (recv_reply(sock, recvbuf, sizeof(recvbuf)) > 0) {
                                 char p[1024]; beautify_result(recvbuf, p, sizeof(p));
                                 show_message_ncurses("BUY WEAPON", p);
                             }
                         }
                     } else if (res == 1) {
-                        snprintf(cmd, sizeof(cmd), "FIRE %s %d", target, wid); send_line(sock, cmd);
-                        if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                        snprintf(cmd, sizeof(cmd), "FIRE %s %d", target, wid); net_send_line(sock, cmd);
+                        if (recv_reply(sock, recvbuf, sizeof(recvbuf)) > 0) {
                             char p[1024]; beautify_result(recvbuf, p, sizeof(p)); show_message_ncurses("FIRE", p);
                         }
                     } else if (res == 2) {
-                        snprintf(cmd, sizeof(cmd), "CHEST_OPEN %d", current_chest_id); send_line(sock, cmd);
-                        if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                        snprintf(cmd, sizeof(cmd), "CHEST_OPEN %d", current_chest_id); net_send_line(sock, cmd);
+                        if (recv_reply(sock, recvbuf, sizeof(recvbuf)) > 0) {
                             int qc; char q[256];
                             if (sscanf(recvbuf, "%d %[^\n]", &qc, q) == 2 && qc == 211) {
                                 char ans[128];
                                 if (popup_input_ncurses("OPEN CHEST", q, ans, sizeof(ans))) {
                                     snprintf(cmd, sizeof(cmd), "CHEST_OPEN %d %s", current_chest_id, ans);
-                                    send_line(sock, cmd);
+                                    net_send_line(sock, cmd);
                                     
                                     int coin_before = -1;
-                                    if (send_line(sock, "GETCOIN") >= 0 && recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                                    if (net_send_line(sock, "GETCOIN") >= 0 && recv_reply(sock, recvbuf, sizeof(recvbuf)) > 0) {
                                         int code_tmp = 0;
                                         if (sscanf(recvbuf, "%d %d", &code_tmp, &coin_before) != 2) {
                                             coin_before = -1;
@@ -1477,12 +1790,12 @@ int main(int argc, char *argv[]) {
                                     }
                                     
                                     while(1) {
-                                        if (recv_line(sock, recvbuf, sizeof(recvbuf)) <= 0) break;
+                                        if (recv_reply(sock, recvbuf, sizeof(recvbuf)) <= 0) break;
                                         int rc; sscanf(recvbuf, "%d", &rc);
                                         
                                         if (rc == RESP_CHEST_OPEN_OK) {
                                             int coin_after = -1;
-                                            if (send_line(sock, "GETCOIN") >= 0 && recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                                            if (net_send_line(sock, "GETCOIN") >= 0 && recv_reply(sock, recvbuf, sizeof(recvbuf)) > 0) {
                                                 int code_tmp = 0;
                                                 if (sscanf(recvbuf, "%d %d", &code_tmp, &coin_after) != 2) {
                                                     coin_after = -1;
@@ -1523,6 +1836,7 @@ int main(int argc, char *argv[]) {
                         }
                     } else if (res == -1) break;
                 }
+                feed_unsubscribe(sock);
 #endif
                 break;
             }
@@ -1542,21 +1856,21 @@ int main(int argc, char *argv[]) {
                 int current_armor = -1;
                 
                 // Get username
-                if (send_line(sock, "WHOAMI") >= 0 && recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, "WHOAMI") >= 0 && net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     int code_tmp;
                     sscanf(recvbuf, "%d %127s", &code_tmp, current_username);
                 }
                 
                 // Get coin
-                if (send_line(sock, "GETCOIN") >= 0 && recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, "GETCOIN") >= 0 && net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     int code_tmp;
                     sscanf(recvbuf, "%d %ld", &code_tmp, &current_coin);
                 }
                 
                 // Get team info (from TEAM_MEMBER_LIST or similar)
-                if (send_line(sock, "TEAM_MEMBER_LIST") >= 0) {
+                if (net_send_line(sock, "TEAM_MEMBER_LIST") >= 0) {
 
-                    if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                    if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
 
                         // Format nhận được: "205 TeamName|Member1|Member2|"
 
@@ -1640,7 +1954,7 @@ int main(int argc, char *argv[]) {
                         }
                 
                 // Get HP and Armor (if in match)
-                if (send_line(sock, "GETARMOR") >= 0 && recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                if (net_send_line(sock, "GETARMOR") >= 0 && net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                     int code_tmp, slot1_type, slot1_value, slot2_type, slot2_value;
                     if (sscanf(recvbuf, "%d %d %d %d %d", &code_tmp, &slot1_type, &slot1_value, &slot2_type, &slot2_value) == 5) {
                         current_armor = slot1_value + slot2_value;
@@ -1660,8 +1974,8 @@ int main(int argc, char *argv[]) {
                     char team_name[128];
                     if (home_create_team_ncurses(team_name, sizeof(team_name))) {
                         snprintf(cmd, sizeof(cmd), "CREATE_TEAM %s", team_name);
-                        if (send_line(sock, cmd) < 0) break;
-                        if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                        if (net_send_line(sock, cmd) < 0) break;
+                        if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                             char pretty[1024];
                             beautify_result(recvbuf, pretty, sizeof(pretty));
                             show_message_ncurses("Create Team", pretty);
@@ -1672,8 +1986,8 @@ int main(int argc, char *argv[]) {
                     char team_name[128];
                     if (home_join_team_ncurses(team_name, sizeof(team_name))) {
                         snprintf(cmd, sizeof(cmd), "JOIN_REQUEST %s", team_name);
-                        if (send_line(sock, cmd) < 0) break;
-                        if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                        if (net_send_line(sock, cmd) < 0) break;
+                        if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                             char pretty[1024];
                             beautify_result(recvbuf, pretty, sizeof(pretty));
                             show_message_ncurses("Join Request", pretty);
@@ -1681,8 +1995,8 @@ int main(int argc, char *argv[]) {
                     }
                 } else if (home_sel == 2) {
                     // List All Teams
-                    if (send_line(sock, "LIST_TEAMS") < 0) break;
-                    if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                    if (net_send_line(sock, "LIST_TEAMS") < 0) break;
+                    if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                         char *payload = strchr(recvbuf, ' ');
                         if (payload) {
                             show_message_ncurses("Team List", payload + 1);
@@ -1694,8 +2008,8 @@ int main(int argc, char *argv[]) {
                     // View Invites - need to fetch invites first
                     // Assuming there's a command to get pending invites (e.g., GET_INVITES)
                     // For now, use a placeholder
-                    if (send_line(sock, "CHECK_INVITES") < 0) break;
-                    if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                    if (net_send_line(sock, "CHECK_INVITES") < 0) break;
+                    if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                         char *payload = strchr(recvbuf, ' ');
                         if (payload) {
                             char team_name_selected[128];
@@ -1712,8 +2026,8 @@ int main(int argc, char *argv[]) {
                                     snprintf(cmd, sizeof(cmd), "INVITE_REJECT %s", team_name_selected);
                                 }
                                 
-                                if (send_line(sock, cmd) < 0) break;
-                                if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                                if (net_send_line(sock, cmd) < 0) break;
+                                if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                                     char pretty[1024];
                                     beautify_result(recvbuf, pretty, sizeof(pretty));
                                     show_message_ncurses(action == 1 ? "Accept Invite" : "Reject Invite", pretty);
@@ -1756,8 +2070,8 @@ int main(int argc, char *argv[]) {
     int member_count = 0;
     char members_list[1024] = "";
 
-    if (send_line(sock, "TEAM_MEMBER_LIST") >= 0) {
-        if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+    if (net_send_line(sock, "TEAM_MEMBER_LIST") >= 0) {
+        if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
             int code_tmp = 0;
             if (sscanf(recvbuf, "%d", &code_tmp) == 1) {
                 char *payload = strchr(recvbuf, ' ');
@@ -1789,8 +2103,8 @@ int main(int argc, char *argv[]) {
     }
 
     if (team_sel == 0) {
-        if (send_line(sock, "LEAVE_TEAM") < 0) break;
-        if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+        if (net_send_line(sock, "LEAVE_TEAM") < 0) break;
+        if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
             char pretty[1024];
             beautify_result(recvbuf, pretty, sizeof(pretty));
             show_message_ncurses("Leave Team", pretty);
@@ -1800,8 +2114,8 @@ int main(int argc, char *argv[]) {
         char username[128];
         if (team_invite_member_ncurses(username, sizeof(username))) {
             snprintf(cmd, sizeof(cmd), "INVITE %s", username);
-            if (send_line(sock, cmd) < 0) break;
-            if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+            if (net_send_line(sock, cmd) < 0) break;
+            if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                 char pretty[1024];
                 beautify_result(recvbuf, pretty, sizeof(pretty));
                 show_message_ncurses("Invite Member", pretty);
@@ -1812,8 +2126,8 @@ int main(int argc, char *argv[]) {
         char username[128];
         if (team_kick_member_ncurses(username, sizeof(username))) {
             snprintf(cmd, sizeof(cmd), "KICK_MEMBER %s", username);
-            if (send_line(sock, cmd) < 0) break;
-            if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+            if (net_send_line(sock, cmd) < 0) break;
+            if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                 char pretty[1024];
                 beautify_result(recvbuf, pretty, sizeof(pretty));
                 show_message_ncurses("Kick Member", pretty);
@@ -1821,9 +2135,9 @@ int main(int argc, char *argv[]) {
         }
     }
     else if (team_sel == 3) {
-        if (send_line(sock, "CHECK_JOIN_REQUESTS") < 0) break;
+        if (net_send_line(sock, "CHECK_JOIN_REQUESTS") < 0) break;
         
-        if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+        if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
             char *payload = strchr(recvbuf, ' ');
             if (payload && strstr(recvbuf, "404") == NULL) {
                 char username_selected[128];
@@ -1835,8 +2149,8 @@ int main(int argc, char *argv[]) {
                     if (action == 1) snprintf(cmd, sizeof(cmd), "JOIN_APPROVE %s", username_selected);
                     else snprintf(cmd, sizeof(cmd), "JOIN_REJECT %s", username_selected);
                     
-                    if (send_line(sock, cmd) < 0) break;
-                    if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+                    if (net_send_line(sock, cmd) < 0) break;
+                    if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                         char pretty[1024];
                         beautify_result(recvbuf, pretty, sizeof(pretty));
                         show_message_ncurses(action == 1 ? "Approve" : "Reject", pretty);
@@ -1852,8 +2166,8 @@ int main(int argc, char *argv[]) {
         if (team_challenge_ncurses(target_team_id, sizeof(target_team_id))) {
             int opponent_id = atoi(target_team_id);
             snprintf(cmd, sizeof(cmd), "START_MATCH %d", opponent_id);
-            if (send_line(sock, cmd) < 0) break;
-            if (recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
+            if (net_send_line(sock, cmd) < 0) break;
+            if (net_recv_line(sock, recvbuf, sizeof(recvbuf)) > 0) {
                 char pretty[1024];
                 beautify_result(recvbuf, pretty, sizeof(pretty));
                 show_message_ncurses("Challenge Team", pretty);
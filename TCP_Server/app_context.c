@@ -1,9 +1,14 @@
+#define _GNU_SOURCE     // pthread_rwlockattr_setkind_np()
 #include "app_context.h"
 #include "users_io.h"
+#include "journal.h"
+#include "user_store.h"
+#include "db_store.h"
 #include "session.h"
 #include "config.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <pthread.h>
 
 /**
  * @file app_context.c
@@ -13,8 +18,30 @@
 // TODO: Declare global variables here
 // These will be accessed by router.c and other modules
 static UserTable *g_user_table = NULL;
+static pthread_rwlock_t g_world_lock;
+static pthread_mutex_t g_users_lock;
+static pthread_mutex_t g_match_locks[MATCH_LOCK_STRIPES];
+static TimerWheel g_world_timers;   /**< Guarded by g_world_lock (exclusive) */
+
+static void locks_init(void) {
+    // Writers first: commands that add or remove rows must not wait for a
+    // gap in the stream of shared holders
+    pthread_rwlockattr_t rw_attr;
+    pthread_rwlockattr_init(&rw_attr);
+    pthread_rwlockattr_setkind_np(&rw_attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&g_world_lock, &rw_attr);
+    pthread_rwlockattr_destroy(&rw_attr);
+
+    pthread_mutex_init(&g_users_lock, NULL);
+
+    for (int i = 0; i < MATCH_LOCK_STRIPES; i++) {
+        pthread_mutex_init(&g_match_locks[i], NULL);
+    }
+}
 
 int app_context_init(void) {
+    locks_init();
+
     // TODO: Step 1 - Initialize user hash table
     g_user_table = initUserTable(HASH_SIZE);
     if (!g_user_table) {
@@ -23,14 +50,45 @@ int app_context_init(void) {
     }
 
     // TODO: Step 2 - Load users from file
-    UserIOStatus status = loadUsers(g_user_table, USERS_FILE);
-    if (status != USER_IO_OK) {
-        fprintf(stderr, "[ERROR] Failed to load users (status=%d).\n", status);
+    // users.bin is mapped as-is (records load on first use); otherwise parse users.txt
+    unsigned long long snapshot_lsn = 0;
+    const char *snapshot = USERS_FILE;
+    UserStore *store = user_store_open(USERS_BIN_FILE);
+    if (store) {
+        attachUserStore(g_user_table, store);
+        snapshot_lsn = store->hdr->lsn;
+        snapshot = USERS_BIN_FILE;
+        printf("[INFO] Mapped %llu users from %s.\n",
+               (unsigned long long)store->hdr->count, USERS_BIN_FILE);
+    } else {
+        UserIOStatus status = loadUsers(g_user_table, USERS_FILE, &snapshot_lsn);
+        if (status != USER_IO_OK) {
+            fprintf(stderr, "[ERROR] Failed to load users (status=%d).\n", status);
+            freeUserTable(g_user_table);
+            g_user_table = NULL;
+            return -1;
+        }
+        printf("[INFO] Loaded users successfully.\n");
+    }
+
+    // Step 2b - Apply changes made since the snapshot, then keep journaling
+    if (journal_open(USERS_JOURNAL_FILE, snapshot, store != NULL, g_user_table, snapshot_lsn) != 0) {
+        fprintf(stderr, "[ERROR] Failed to open user journal.\n");
+        freeUserTable(g_user_table);
+        g_user_table = NULL;
+        return -1;
+    }
+
+    // Step 2c - Load teams, matches and challenges, then keep logging changes
+    // (restored challenges re-arm their expiry timers)
+    timer_wheel_init(&g_world_timers, timer_now_tick());
+    if (db_store_open(DB_DIR) != 0) {
+        fprintf(stderr, "[ERROR] Failed to load game tables.\n");
+        journal_close();
         freeUserTable(g_user_table);
         g_user_table = NULL;
         return -1;
     }
-    printf("[INFO] Loaded users successfully.\n");
 
     // TODO: Step 3 - Initialize session manager
     init_session_manager();
@@ -40,11 +98,9 @@ int app_context_init(void) {
 }
 
 void app_context_cleanup(void) {
-    // TODO: Save users to file before shutdown (optional)
-    // Uncomment if you want to persist changes:
-    // if (g_user_table) {
-    //     saveUsers(g_user_table, USERS_FILE);
-    // }
+    // Commit outstanding user changes and write the final checkpoint
+    journal_close();
+    db_store_close();
 
     // TODO: Cleanup session manager
     cleanup_session_manager();
@@ -62,3 +118,49 @@ UserTable* app_context_get_user_table(void) {
     // TODO: Return global user table
     return g_user_table;
 }
+
+void app_lock(void) {
+    pthread_rwlock_wrlock(&g_world_lock);
+    pthread_mutex_lock(&g_users_lock);
+}
+
+void app_unlock(void) {
+    pthread_mutex_unlock(&g_users_lock);
+    pthread_rwlock_unlock(&g_world_lock);
+}
+
+void app_lock_shared(void) {
+    pthread_rwlock_rdlock(&g_world_lock);
+}
+
+void app_unlock_shared(void) {
+    pthread_rwlock_unlock(&g_world_lock);
+}
+
+void app_match_lock(int match_id) {
+    pthread_mutex_lock(&g_match_locks[(unsigned int)match_id % MATCH_LOCK_STRIPES]);
+}
+
+void app_match_unlock(int match_id) {
+    pthread_mutex_unlock(&g_match_locks[(unsigned int)match_id % MATCH_LOCK_STRIPES]);
+}
+
+void app_users_lock(void) {
+    pthread_mutex_lock(&g_users_lock);
+}
+
+void app_users_unlock(void) {
+    pthread_mutex_unlock(&g_users_lock);
+}
+
+void app_timer_arm(Timer *timer, unsigned long delay_ms) {
+    timer_arm(&g_world_timers, timer, g_world_timers.now + timer_ms_to_ticks(delay_ms));
+}
+
+void app_timers_run(uint64_t now) {
+    // Most wake-ups are within the same tick; only this thread moves now
+    if (now == g_world_timers.now) return;
+    app_lock();
+    timer_wheel_advance(&g_world_timers, now);
+    app_unlock();
+}
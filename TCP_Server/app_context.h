@@ -2,15 +2,43 @@
 #define APP_CONTEXT_H
 
 #include "users.h"
+#include "timer_wheel.h"
+#include <stdint.h>
 
 /**
  * @file app_context.h
  * @brief Global application state and initialization
  * 
  * Manages shared resources accessed by multiple modules:
- * - User hash table (single-threaded access)
+ * - User hash table
  * - Configuration
  * - Session manager initialization
+ *
+ * Locking model (multi-reactor mode):
+ * - Each connection (socket, read buffer, write buffer) is owned by the
+ *   reactor thread that accepted it. Only that thread reads or closes it.
+ * - Game state shared across connections (SessionManager and the db.c
+ *   tables) is guarded by the world lock, a reader/writer lock:
+ *   - app_lock() takes it exclusively (and the user lock with it). Anything
+ *     may change: rows added or removed, sessions, teams, matches.
+ *   - app_lock_shared() lets holders run in parallel. They may read any
+ *     table, but only change the ships of one match, holding its match
+ *     lock (app_match_lock()), and the UserTable, holding the user lock.
+ * - The user lock (app_users_lock()) guards the UserTable, which findUser()
+ *   may change when it pages a record in from users.bin. Session logins
+ *   only change under app_lock(), which holds it, so the user lock alone
+ *   is enough to read the caller's own session.
+ * - The router picks per command: reads of the caller's account (GETCOIN,
+ *   WHOAMI) take only the user lock, reads and shots inside the caller's
+ *   match (GET_HP, GETARMOR, GET_WEAPON, FIRE) the shared world lock and
+ *   the match lock, everything else app_lock(). Handlers in router.c,
+ *   session.c and team_handler.c never lock themselves.
+ * - Lock order: world, then match, then user, then a connection's write
+ *   buffer lock. The last lets handlers queue output for sockets owned by
+ *   other reactors.
+ * - Timers on game state (match time limits, chest drops, challenge
+ *   expiry) live on one world timer wheel, guarded by the exclusive world
+ *   lock. Reactor 0 runs it, so their callbacks run like handlers.
  */
 
 /**
@@ -23,7 +51,9 @@
  * 
  * TODO: Implement this to:
  * 1. Call initUserTable(HASH_SIZE) and store in g_user_table
- * 2. Call loadUsers(g_user_table, USERS_FILE)
+ * 2. Call loadUsers(g_user_table, USERS_FILE), then journal_open() to
+ *    replay USERS_JOURNAL_FILE on top of the snapshot, then
+ *    db_store_open(DB_DIR) to load teams, matches and challenges
  * 3. Call init_session_manager() from session.h
  * 4. Return 0 if all succeed, -1 if any fail
  */
@@ -35,7 +65,7 @@ int app_context_init(void);
  * Called on server shutdown to free memory and save state.
  * 
  * TODO: Implement this to:
- * 1. Call saveUsers(g_user_table, USERS_FILE) if needed
+ * 1. Call journal_close() and db_store_close() to commit pending changes
  * 2. Call cleanup_session_manager()
  * 3. Call freeUserTable(g_user_table)
  */
@@ -45,10 +75,78 @@ void app_context_cleanup(void);
  * @brief Get global user table
  * 
  * Returns pointer to the shared user hash table.
- * Single-threaded epoll access, no locking needed.
+ * Callers must hold the user lock (see app_users_lock()).
  * 
  * @return Pointer to global UserTable
  */
 UserTable* app_context_get_user_table(void);
 
+/**
+ * @brief Acquire the world lock exclusively, then the user lock
+ *
+ * Not recursive: command handlers already run with it held.
+ */
+void app_lock(void);
+
+/**
+ * @brief Release app_lock()
+ */
+void app_unlock(void);
+
+/**
+ * @brief Acquire the world lock shared with other readers
+ *
+ * Not recursive either; app_lock() waiters go first, so a stream of
+ * readers cannot starve them.
+ */
+void app_lock_shared(void);
+
+/**
+ * @brief Release app_lock_shared()
+ */
+void app_unlock_shared(void);
+
+/**
+ * @brief Acquire the lock on the ships and tick queue of a match
+ *
+ * Taken under the shared world lock (app_lock() excludes every holder).
+ * Locks are striped by match_id, so rarely two matches share one.
+ */
+void app_match_lock(int match_id);
+
+/**
+ * @brief Release app_match_lock()
+ */
+void app_match_unlock(int match_id);
+
+/**
+ * @brief Acquire the user lock guarding the UserTable
+ *
+ * Taken alone by commands that only touch the caller's account and by
+ * journal checkpoints; app_lock() takes it too. Not recursive.
+ */
+void app_users_lock(void);
+
+/**
+ * @brief Release app_users_lock()
+ */
+void app_users_unlock(void);
+
+/**
+ * @brief Arm a timer on the world timer wheel
+ *
+ * Caller holds the world lock, as does the callback when it runs. Cancel
+ * with timer_cancel(), also under the lock.
+ *
+ * @param delay_ms Fires after at least this long (rounded up to a tick)
+ */
+void app_timer_arm(Timer *timer, unsigned long delay_ms);
+
+/**
+ * @brief Run world timers due up to tick now (takes the world lock)
+ *
+ * Called by reactor 0 every tick.
+ */
+void app_timers_run(uint64_t now);
+
 #endif // APP_CONTEXT_H
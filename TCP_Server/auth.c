@@ -0,0 +1,178 @@
+/**
+ * ============================================================================
+ * AUTH MODULE - IMPLEMENTATION
+ * ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#include "auth.h"
+#include "epoll.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/resource.h>
+
+#define AUTH_MAX_WORKERS    64
+#define AUTH_WORKER_NICE    5   /**< Added to the workers' nice value */
+
+static pthread_mutex_t auth_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t auth_cond = PTHREAD_COND_INITIALIZER;
+
+// Guarded by auth_lock
+static AuthJob *queue_head = NULL;
+static AuthJob *queue_tail = NULL;
+static size_t queue_len = 0;
+static bool auth_stopping = false;
+static bool auth_running = false;
+
+static pthread_t workers[AUTH_MAX_WORKERS];
+static int worker_count = 0;
+
+AuthJob* auth_job_new(AuthKind kind, int socket_fd, unsigned long session_id,
+                      const char *username, const char *password) {
+    AuthJob *job = calloc(1, sizeof(AuthJob));
+    if (!job) return NULL;
+    job->password = strdup(password);
+    if (!job->password) {
+        free(job);
+        return NULL;
+    }
+    job->kind = kind;
+    job->socket_fd = socket_fd;
+    job->session_id = session_id;
+    snprintf(job->username, sizeof(job->username), "%s", username);
+    return job;
+}
+
+void auth_job_free(AuthJob *job) {
+    if (!job) return;
+    if (job->password) {
+        explicit_bzero(job->password, strlen(job->password));
+        free(job->password);
+    }
+    free(job);
+}
+
+// Back on the socket's reactor
+static void auth_deliver(void *arg) {
+    AuthJob *job = arg;
+    if (job->done) job->done(job);
+    auth_job_free(job);
+}
+
+static void auth_run(AuthJob *job) {
+    if (job->kind == AUTH_LOGIN) {
+        job->password_ok = verifyPassword(job->password, job->stored_hash);
+        if (job->password_ok && passwordNeedsRehash(job->stored_hash)) {
+            hashPassword(job->password, job->new_hash);
+        }
+    } else {
+        hashPassword(job->password, job->new_hash);
+    }
+    explicit_bzero(job->password, strlen(job->password));
+}
+
+static void *auth_main(void *arg) {
+    (void)arg;
+
+    // Reactors win the CPU when a login burst saturates the workers
+    // (on Linux the nice value is per thread)
+    if (setpriority(PRIO_PROCESS, 0, getpriority(PRIO_PROCESS, 0) + AUTH_WORKER_NICE) != 0) {
+        perror("setpriority() auth worker:");
+    }
+
+    pthread_mutex_lock(&auth_lock);
+    while (1) {
+        while (!queue_head && !auth_stopping) {
+            pthread_cond_wait(&auth_cond, &auth_lock);
+        }
+        if (auth_stopping) break;
+
+        AuthJob *job = queue_head;
+        queue_head = job->next;
+        if (!queue_head) queue_tail = NULL;
+        queue_len--;
+        pthread_mutex_unlock(&auth_lock);
+
+        auth_run(job);
+        if (epoll_post(job->socket_fd, auth_deliver, job) != 0) {
+            auth_job_free(job);     // Reactors are gone; nobody to answer
+        }
+
+        pthread_mutex_lock(&auth_lock);
+    }
+    pthread_mutex_unlock(&auth_lock);
+    return NULL;
+}
+
+int auth_start(int count) {
+    sigset_t all, old;
+
+    if (count < 1) count = 1;
+    if (count > AUTH_MAX_WORKERS) count = AUTH_MAX_WORKERS;
+
+    auth_stopping = false;
+    auth_running = true;
+
+    // Signals stay with the main thread
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    for (int i = 0; i < count; i++) {
+        if (pthread_create(&workers[i], NULL, auth_main, NULL) != 0) {
+            perror("pthread_create() auth worker:");
+            break;
+        }
+        worker_count++;
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (worker_count == 0) {
+        auth_running = false;
+        return -1;
+    }
+    printf("[INFO] %d auth worker(s) running\n", worker_count);
+    return 0;
+}
+
+void auth_stop(void) {
+    pthread_mutex_lock(&auth_lock);
+    auth_stopping = true;
+    auth_running = false;
+    pthread_cond_broadcast(&auth_cond);
+    pthread_mutex_unlock(&auth_lock);
+
+    for (int i = 0; i < worker_count; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    worker_count = 0;
+
+    while (queue_head) {
+        AuthJob *job = queue_head;
+        queue_head = job->next;
+        auth_job_free(job);
+    }
+    queue_tail = NULL;
+    queue_len = 0;
+}
+
+int auth_submit(AuthJob *job) {
+    if (!job) return -1;
+
+    pthread_mutex_lock(&auth_lock);
+    if (!auth_running || queue_len >= AUTH_QUEUE_MAX) {
+        pthread_mutex_unlock(&auth_lock);
+        return -1;
+    }
+    job->next = NULL;
+    if (queue_tail) queue_tail->next = job;
+    else queue_head = job;
+    queue_tail = job;
+    queue_len++;
+    pthread_cond_signal(&auth_cond);
+    pthread_mutex_unlock(&auth_lock);
+    return 0;
+}
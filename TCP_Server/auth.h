@@ -0,0 +1,82 @@
+#ifndef AUTH_H
+#define AUTH_H
+
+#include "users.h"
+#include <stdbool.h>
+
+/**
+ * @file auth.h
+ * @brief Password hashing off the reactors
+ *
+ * Salted password hashes (hashPassword()) cost milliseconds of CPU on
+ * purpose, which would stall every connection of a reactor if LOGIN or
+ * REGISTER computed them inline. Instead the handler does the cheap
+ * checks, holds the connection (connection_hold()) and submits an
+ * AuthJob carrying the session handle. A pool of worker threads runs the
+ * KDF, then epoll_post() hands the job back to the reactor owning the
+ * socket, which calls job->done under no lock; done looks the session up
+ * again with find_session_by_handle() (it may be gone), finishes the
+ * command and releases the connection.
+ *
+ * Workers run at a lower scheduling priority than the reactors, so a
+ * burst of logins queues up here instead of delaying game traffic.
+ */
+
+typedef enum {
+    AUTH_LOGIN,         /**< Check password against stored_hash */
+    AUTH_REGISTER       /**< Hash password into new_hash */
+} AuthKind;
+
+typedef struct AuthJob AuthJob;
+
+/**
+ * @struct AuthJob
+ * @brief One LOGIN/REGISTER waiting for the KDF
+ */
+struct AuthJob {
+    AuthKind kind;
+    int socket_fd;                          /**< Session handle: socket ... */
+    unsigned long session_id;               /**< ... and ServerSession.session_id */
+    char username[MAX_USERNAME];
+    char *password;                         /**< Plain text; wiped by auth_job_free() */
+    char stored_hash[MAX_PASSWORD_HASH];    /**< LOGIN: hash to check against */
+    bool password_ok;                       /**< LOGIN: result of the check */
+    char new_hash[MAX_PASSWORD_HASH];       /**< REGISTER: the hash; LOGIN: upgraded hash or "" */
+    void (*done)(AuthJob *job);             /**< Runs on the socket's reactor; job is freed after */
+    AuthJob *next;
+};
+
+/**
+ * @brief Allocate a job (stored_hash and done are filled in by the caller)
+ * @return Job, or NULL if out of memory
+ */
+AuthJob* auth_job_new(AuthKind kind, int socket_fd, unsigned long session_id,
+                      const char *username, const char *password);
+
+/**
+ * @brief Wipe the password and free a job
+ */
+void auth_job_free(AuthJob *job);
+
+/**
+ * @brief Start the worker threads
+ * @param workers Number of threads (at least 1)
+ * @return 0 on success, -1 if no thread could be started
+ */
+int auth_start(int workers);
+
+/**
+ * @brief Stop the workers; jobs not started yet are dropped
+ *
+ * Call after the reactors have stopped.
+ */
+void auth_stop(void);
+
+/**
+ * @brief Queue a job
+ * @return 0 if queued (the job now belongs to the pool), -1 if the queue
+ *         is full (AUTH_QUEUE_MAX) or the pool is stopped
+ */
+int auth_submit(AuthJob *job);
+
+#endif // AUTH_H
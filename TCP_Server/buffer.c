@@ -0,0 +1,206 @@
+#include "buffer.h"
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+shared_buf_t *shared_buf_new(const char *data, size_t len) {
+    shared_buf_t *buf = (shared_buf_t *)malloc(sizeof(shared_buf_t) + len);
+    if (!buf) {
+        perror("malloc() error:");
+        return NULL;
+    }
+    atomic_init(&buf->refcnt, 1);
+    buf->len = len;
+    if (len > 0) memcpy(buf->data, data, len);
+    return buf;
+}
+
+shared_buf_t *shared_buf_printf(const char *fmt, ...) {
+    char stack[512];
+    va_list ap;
+
+    va_start(ap, fmt);
+    int n = vsnprintf(stack, sizeof(stack), fmt, ap);
+    va_end(ap);
+    if (n < 0) return NULL;
+    if ((size_t)n < sizeof(stack)) return shared_buf_new(stack, (size_t)n);
+
+    // Too long for the stack buffer: format straight into the payload
+    shared_buf_t *buf = (shared_buf_t *)malloc(sizeof(shared_buf_t) + (size_t)n + 1);
+    if (!buf) {
+        perror("malloc() error:");
+        return NULL;
+    }
+    va_start(ap, fmt);
+    vsnprintf(buf->data, (size_t)n + 1, fmt, ap);
+    va_end(ap);
+    atomic_init(&buf->refcnt, 1);
+    buf->len = (size_t)n;
+    return buf;
+}
+
+shared_buf_t *shared_buf_ref(shared_buf_t *buf) {
+    if (buf) atomic_fetch_add_explicit(&buf->refcnt, 1, memory_order_relaxed);
+    return buf;
+}
+
+void shared_buf_unref(shared_buf_t *buf) {
+    if (!buf) return;
+    if (atomic_fetch_sub_explicit(&buf->refcnt, 1, memory_order_acq_rel) == 1) {
+        free(buf);
+    }
+}
+
+/* ====== Output chain ====== */
+
+// Recycled segments; each reactor thread keeps its own list so no lock is needed
+static _Thread_local out_seg_t *free_private = NULL;
+static _Thread_local out_seg_t *free_shared = NULL;
+static _Thread_local int free_private_count = 0;
+static _Thread_local int free_shared_count = 0;
+
+static out_seg_t *seg_alloc(int is_private) {
+    out_seg_t *seg;
+    if (is_private && free_private) {
+        seg = free_private;
+        free_private = seg->next;
+        free_private_count--;
+    } else if (!is_private && free_shared) {
+        seg = free_shared;
+        free_shared = seg->next;
+        free_shared_count--;
+    } else {
+        size_t size = sizeof(out_seg_t) + (is_private ? OUT_SEG_SIZE : 0);
+        seg = (out_seg_t *)malloc(size);
+        if (!seg) {
+            perror("malloc() error:");
+            return NULL;
+        }
+    }
+    seg->next = NULL;
+    seg->shared = NULL;
+    seg->base = is_private ? (char *)(seg + 1) : NULL;
+    seg->start = seg->end = 0;
+    seg->cap = is_private ? OUT_SEG_SIZE : 0;
+    return seg;
+}
+
+static void seg_release(out_seg_t *seg) {
+    if (seg->shared) {
+        shared_buf_unref(seg->shared);
+        seg->shared = NULL;
+        if (free_shared_count < OUT_SEG_POOL_MAX) {
+            seg->next = free_shared;
+            free_shared = seg;
+            free_shared_count++;
+            return;
+        }
+    } else if (free_private_count < OUT_SEG_POOL_MAX) {
+        seg->next = free_private;
+        free_private = seg;
+        free_private_count++;
+        return;
+    }
+    free(seg);
+}
+
+static void chain_push(out_chain_t *chain, out_seg_t *seg) {
+    if (chain->tail) {
+        chain->tail->next = seg;
+    } else {
+        chain->head = seg;
+    }
+    chain->tail = seg;
+}
+
+int out_chain_append(out_chain_t *chain, const char *data, size_t len) {
+    out_seg_t *first_new = NULL;
+    out_seg_t *last_new = NULL;
+    size_t done = 0;
+
+    // Fill what is left of a private tail segment first
+    out_seg_t *tail = chain->tail;
+    size_t room = (tail && !tail->shared) ? tail->cap - tail->end : 0;
+
+    // Allocate the remaining segments up front so failure leaves the chain intact
+    size_t rest = len > room ? len - room : 0;
+    while (rest > 0) {
+        out_seg_t *seg = seg_alloc(1);
+        if (!seg) {
+            while (first_new) {
+                out_seg_t *next = first_new->next;
+                seg_release(first_new);
+                first_new = next;
+            }
+            return -1;
+        }
+        if (last_new) last_new->next = seg; else first_new = seg;
+        last_new = seg;
+        rest -= rest < OUT_SEG_SIZE ? rest : OUT_SEG_SIZE;
+    }
+
+    if (room > 0) {
+        size_t n = len < room ? len : room;
+        memcpy(tail->base + tail->end, data, n);
+        tail->end += n;
+        done = n;
+    }
+    for (out_seg_t *seg = first_new; seg; seg = seg->next) {
+        size_t n = len - done < seg->cap ? len - done : seg->cap;
+        memcpy(seg->base, data + done, n);
+        seg->end = n;
+        done += n;
+    }
+    if (first_new) {
+        chain_push(chain, first_new);
+        chain->tail = last_new;
+    }
+    chain->bytes += len;
+    return 0;
+}
+
+int out_chain_append_shared(out_chain_t *chain, shared_buf_t *buf) {
+    out_seg_t *seg = seg_alloc(0);
+    if (!seg) return -1;
+    seg->shared = shared_buf_ref(buf);
+    seg->base = buf->data;
+    seg->end = buf->len;
+    chain_push(chain, seg);
+    chain->bytes += buf->len;
+    return 0;
+}
+
+int out_chain_fill_iov(const out_chain_t *chain, struct iovec *iov, int max) {
+    int n = 0;
+    for (out_seg_t *seg = chain->head; seg && n < max; seg = seg->next) {
+        if (seg->end == seg->start) continue;
+        iov[n].iov_base = seg->base + seg->start;
+        iov[n].iov_len = seg->end - seg->start;
+        n++;
+    }
+    return n;
+}
+
+void out_chain_consume(out_chain_t *chain, size_t n) {
+    chain->bytes -= n;
+    while (chain->head) {
+        out_seg_t *seg = chain->head;
+        size_t pending = seg->end - seg->start;
+        if (n < pending) {
+            seg->start += n;
+            return;
+        }
+        n -= pending;
+        chain->head = seg->next;
+        if (!chain->head) chain->tail = NULL;
+        seg_release(seg);
+    }
+}
+
+void out_chain_clear(out_chain_t *chain) {
+    out_chain_consume(chain, chain->bytes);
+    chain->bytes = 0;
+}
@@ -0,0 +1,114 @@
+#ifndef BUFFER_H
+#define BUFFER_H
+
+/**
+ * @file buffer.h
+ * @brief Output buffers: shared broadcast buffers and per-connection chains
+ *
+ * A message pushed to many clients (FIRE_EVENT, CHEST_DROP, ...) is
+ * serialized once into a shared_buf_t. Every recipient's output queue
+ * holds a reference to the same bytes; the buffer is freed when the last
+ * connection has flushed (or dropped) it.
+ *
+ * References may be released from any reactor thread.
+ */
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include <sys/uio.h>
+
+typedef struct shared_buf {
+    atomic_int refcnt;      /**< Live references (queues + creator) */
+    size_t len;             /**< Payload length in bytes */
+    char data[];            /**< Payload, not NUL-terminated */
+} shared_buf_t;
+
+/**
+ * @brief Allocate a shared buffer holding a copy of data
+ *
+ * @param data Bytes to copy
+ * @param len  Number of bytes
+ * @return New buffer with one reference, or NULL on allocation failure
+ */
+shared_buf_t *shared_buf_new(const char *data, size_t len);
+
+/**
+ * @brief printf() into a new shared buffer
+ *
+ * @return New buffer with one reference, or NULL on failure
+ */
+shared_buf_t *shared_buf_printf(const char *fmt, ...)
+    __attribute__((format(printf, 1, 2)));
+
+/**
+ * @brief Take an extra reference
+ */
+shared_buf_t *shared_buf_ref(shared_buf_t *buf);
+
+/**
+ * @brief Drop a reference; frees the buffer when it was the last one
+ */
+void shared_buf_unref(shared_buf_t *buf);
+
+/* ====== Output chain ====== */
+
+/**
+ * @struct out_seg
+ * @brief One link of a connection's output chain.
+ *
+ * Private segments own OUT_SEG_SIZE bytes of inline storage that small
+ * responses are packed into. Shared segments point at a shared_buf_t.
+ * Segments come from a per-thread free list, so steady-state traffic
+ * does not hit malloc().
+ */
+typedef struct out_seg {
+    struct out_seg *next;
+    shared_buf_t *shared;   /**< Payload owner for shared segments, NULL if private */
+    char *base;             /**< Start of payload */
+    size_t start;           /**< First unsent byte */
+    size_t end;             /**< One past the last queued byte */
+    size_t cap;             /**< Storage size (private segments only) */
+} out_seg_t;
+
+/**
+ * @struct out_chain
+ * @brief FIFO of output segments, flushed with one sendmsg() per batch.
+ */
+typedef struct out_chain {
+    out_seg_t *head;
+    out_seg_t *tail;
+    size_t bytes;           /**< Unsent bytes across the chain */
+} out_chain_t;
+
+/**
+ * @brief Copy data to the end of the chain, packing into the tail segment
+ * @return 0 on success, -1 on allocation failure (chain unchanged)
+ */
+int out_chain_append(out_chain_t *chain, const char *data, size_t len);
+
+/**
+ * @brief Append a reference to a shared buffer (no copy)
+ * @return 0 on success, -1 on allocation failure
+ */
+int out_chain_append_shared(out_chain_t *chain, shared_buf_t *buf);
+
+/**
+ * @brief Describe the unsent bytes as an iovec array
+ *
+ * @param iov Output array
+ * @param max Capacity of iov
+ * @return Number of entries filled
+ */
+int out_chain_fill_iov(const out_chain_t *chain, struct iovec *iov, int max);
+
+/**
+ * @brief Mark n bytes as sent, recycling fully sent segments
+ */
+void out_chain_consume(out_chain_t *chain, size_t n);
+
+/**
+ * @brief Drop everything still queued
+ */
+void out_chain_clear(out_chain_t *chain);
+
+#endif // BUFFER_H
@@ -1,5 +1,6 @@
 #include "command.h"
 #include <string.h>
+#include <limits.h>
 
 /**
  * @file command.c
@@ -7,6 +8,10 @@
  * 
  * Simple parser that splits command line into type and arguments.
  * Copied from phu/command.c - proven to work.
+ *
+ * The argument tokenizer below replaces sscanf() in the router: it walks
+ * the line once, never copies, and parses integers without going through
+ * locale-aware format handling.
  */
 
 Command parse_command(char *input) {
@@ -26,7 +31,7 @@ Command parse_command(char *input) {
     if (space == NULL) {
         // No arguments - entire string is command type
         cmd.type = input;
-        cmd.user_input = "";
+        cmd.user_input = input + strlen(input);
     } else {
         // Split at space: before = type, after = arguments
         *space = '\0';
@@ -36,3 +41,82 @@ Command parse_command(char *input) {
 
     return cmd;
 }
+
+/* ============================================================================
+ * ARGUMENT TOKENIZER
+ * ============================================================================ */
+
+static int is_blank(char c) {
+    return c == ' ' || c == '\t';
+}
+
+void command_args_init(CommandArgs *args, char *payload) {
+    args->start = payload;
+    args->cur = payload;
+    args->end = payload + strlen(payload);
+}
+
+const char *command_next_token(CommandArgs *args, size_t *len) {
+    char *p = args->cur;
+    while (p < args->end && is_blank(*p)) p++;
+    if (p >= args->end) {
+        args->cur = args->end;
+        return NULL;
+    }
+
+    char *tok = p;
+    while (p < args->end && !is_blank(*p)) p++;
+    if (len) *len = (size_t)(p - tok);
+
+    if (p < args->end) {
+        *p = '\0';
+        p++;
+    }
+    args->cur = p;
+    return tok;
+}
+
+int command_next_int(CommandArgs *args, long min, long max, long *out) {
+    size_t len;
+    const char *tok = command_next_token(args, &len);
+    if (!tok) return -1;
+
+    const char *p = tok;
+    int neg = 0;
+    if (*p == '+' || *p == '-') {
+        neg = (*p == '-');
+        p++;
+    }
+    if (*p == '\0') return -1;
+
+    // Accumulate as a negative number so LONG_MIN fits too
+    long val = 0;
+    for (; *p; p++) {
+        if (*p < '0' || *p > '9') return -1;
+        int digit = *p - '0';
+        if (val < (LONG_MIN + digit) / 10) return -1;
+        val = val * 10 - digit;
+    }
+    if (!neg) {
+        if (val == LONG_MIN) return -1;
+        val = -val;
+    }
+
+    if (val < min || val > max) return -1;
+    *out = val;
+    return 0;
+}
+
+const char *command_rest(CommandArgs *args) {
+    char *p = args->cur;
+    while (p < args->end && is_blank(*p)) p++;
+    args->cur = args->end;
+    return p;
+}
+
+void command_args_restore(CommandArgs *args) {
+    for (char *p = args->start; p < args->end; p++) {
+        if (*p == '\0') *p = ' ';
+    }
+    args->cur = args->start;
+}
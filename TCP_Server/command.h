@@ -17,9 +17,24 @@
  */
 typedef struct {
     const char *type;        /**< Command type (e.g., "REGISTER", "LOGIN") */
-    const char *user_input;  /**< Remaining arguments as string */
+    char *user_input;        /**< Remaining arguments as string ("" if none) */
 } Command;
 
+/**
+ * @struct CommandArgs
+ * @brief Cursor over the arguments of a parsed command
+ *
+ * Tokens are returned as pointers into the line buffer itself: the
+ * separator after a token is overwritten with '\0', so nothing is copied.
+ * command_args_restore() puts the separators back (for logging the raw
+ * input after the handler ran).
+ */
+typedef struct {
+    char *cur;      /**< Next unread byte */
+    char *start;    /**< First byte of the arguments */
+    char *end;      /**< Terminating '\0' of the arguments */
+} CommandArgs;
+
 /**
  * @brief Parse raw command string into Command struct
  * 
@@ -38,4 +53,48 @@ typedef struct {
  */
 Command parse_command(char *input);
 
+/**
+ * @brief Start tokenizing the arguments of a command
+ *
+ * @param args    Cursor to initialize
+ * @param payload Command.user_input (will be modified by the token calls)
+ */
+void command_args_init(CommandArgs *args, char *payload);
+
+/**
+ * @brief Next blank-separated token
+ *
+ * @param args Cursor
+ * @param len  Optional, receives the token length
+ * @return NUL-terminated token inside the line buffer, or NULL if none left
+ */
+const char *command_next_token(CommandArgs *args, size_t *len);
+
+/**
+ * @brief Next token as a decimal integer in [min, max]
+ *
+ * The whole token must be an optionally signed decimal number.
+ *
+ * @param args Cursor
+ * @param min  Smallest accepted value
+ * @param max  Largest accepted value
+ * @param out  Receives the value on success
+ * @return 0 on success, -1 if the token is missing, malformed or out of range
+ */
+int command_next_int(CommandArgs *args, long min, long max, long *out);
+
+/**
+ * @brief Everything after the current position, leading blanks skipped
+ *
+ * Used for free-text arguments (team names, chest answers).
+ *
+ * @return Rest of the line ("" if nothing left); the cursor moves to the end
+ */
+const char *command_rest(CommandArgs *args);
+
+/**
+ * @brief Undo the in-place termination done by command_next_token()
+ */
+void command_args_restore(CommandArgs *args);
+
 #endif // COMMAND_H
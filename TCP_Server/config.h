@@ -9,8 +9,47 @@
 #define MAX_CLIENTS 10000
 #define MAX_EVENTS 1024
 #define DESIRED_NOFILE_LIMIT 65535
+#define MAX_LINE_LENGTH 4096    /**< Longest command line accepted before the connection is dropped */
+#define DEFAULT_REACTOR_THREADS 1    /**< Epoll threads when -t is not given */
+#define MAX_REACTORS 64    /**< Upper bound for -t */
+#define OUT_SEG_SIZE 4096    /**< Bytes per pooled output segment */
+#define OUT_SEG_POOL_MAX 1024    /**< Free segments cached per thread */
+#define OUT_IOV_MAX 64    /**< Segments flushed per sendmsg() */
+#define OUTPUT_HIGH_WATER (256 * 1024)    /**< Default queued bytes before a connection stops reading (-w) */
+#define OUTPUT_HARD_FACTOR 4    /**< Queued bytes above HIGH_WATER * this drop the connection */
 #define USERS_FILE "TCP_Server/users.txt"
+#define USERS_JOURNAL_FILE "TCP_Server/users.journal"
+#define USERS_BIN_FILE "TCP_Server/users.bin"    /**< Mapped instead of USERS_FILE when present (-c text2bin) */
+#define CHECKPOINT_DIRTY_RECORDS 10000    /**< Journal records that trigger a users.txt checkpoint */
+#define CHECKPOINT_INTERVAL_SEC 60    /**< Checkpoint at least this often while there are changes */
+#define DB_DIR "TCP_Server/"    /**< Directory of the team/match table logs (db_store.h) */
+#define DB_COMPACT_MIN_RECORDS 1000    /**< Appended records before a table log may be compacted */
+#define LOG_FILE "server_activity.log"
+#define LOG_RING_SIZE 8192    /**< Queued log records before new ones are dropped (power of two) */
+#define LOG_BATCH_BYTES (64 * 1024)    /**< Formatted bytes buffered by the log writer */
+#define LOG_FLUSH_MS 100    /**< Longest a formatted line waits before write() */
+#define LOG_FSYNC_MS 1000    /**< fdatasync() interval while the log is being written */
+#define LOG_IDLE_MS 10    /**< Log writer sleep when the ring is empty */
 #define HASH_SIZE 101
+#define PASSWORD_KDF_ITERATIONS 20000    /**< Default PBKDF2 cost of new password hashes (-k) */
+#define AUTH_WORKER_THREADS 2    /**< Password hashing threads when -a is not given */
+#define AUTH_QUEUE_MAX 4096    /**< Pending LOGIN/REGISTER jobs before RESP_SERVER_BUSY */
+#define USER_REHASH_STEP 64    /**< Old index slots moved per insert while the user table grows */
+#define TIMER_TICK_MS 50    /**< Timer wheel resolution (timer_wheel.h) */
+#define CONNECTION_IDLE_SEC 900    /**< Close connections silent this long (-i, 0 = never) */
+#define MATCH_TIME_LIMIT_SEC 900    /**< Running matches end after this long (-m, 0 = no limit) */
+#define CHEST_SPAWN_INTERVAL_SEC 60    /**< A chest drops in each running match this often */
+#define CHALLENGE_EXPIRE_SEC 120    /**< Pending challenges are canceled after this long */
+#define MATCH_TICK_HZ 10    /**< Match simulation ticks per second (-r, 0 = apply FIRE on arrival) */
+#define MATCH_LOCK_STRIPES 64    /**< Match locks (app_match_lock()), shared by match_id modulo */
+
+/* 155 MATCH_DELTA field mask: the values after a ship's name, in bit order */
+#define SHIP_DELTA_TEAM 0x01    /**< Ship new to the feed: its team id */
+#define SHIP_DELTA_HP 0x02
+#define SHIP_DELTA_ARMOR 0x04    /**< Both armor slots together */
+#define SHIP_DELTA_CANNON 0x08
+#define SHIP_DELTA_LASER 0x10
+#define SHIP_DELTA_MISSILE 0x20
 /**
  * @enum FunctionId
  * @brief IDs for user menu actions
@@ -109,6 +148,7 @@ typedef enum {
     RESP_END_MATCH_OK = 140,        /**< Match ended successfully */
     RESP_MATCH_INFO_OK = 206,     /**< Match info retrieved successfully */
     RESP_HP_INFO_OK = 207,         /**< HP info retrieved successfully */
+    RESP_BINARY_OK = 209,         /**< Binary framing on from the next byte (wire.h) */
     RESP_REPAIR_OK = 132,         /**< Repair successful */
 
     /* Client error codes - Command/Syntax */
@@ -195,6 +235,11 @@ typedef enum {
     RESP_CHALLENGE_CANCELED = 133,  /**< Challenge canceled */
     RESP_CHALLENGE_RECEIVED = 150,  /**< Thông báo có đội khác đang thách đấu mình */
     RESP_MATCH_STARTED_NOTIFY = 151, /**<Thông báo đối thủ đã chấp nhận, trận đấu bắt đầu */
+    RESP_MATCH_ENDED_NOTIFY = 152,  /**< Match ended by the server: time limit or last ship sunk (notification) */
+    RESP_MATCH_TICK_NOTIFY = 153,   /**< Ship state changed during a match tick (notification) */
+    RESP_MATCH_SNAPSHOT = 154,      /**< Subscribed: every ship of the match, with the feed sequence */
+    RESP_MATCH_DELTA_NOTIFY = 155,  /**< Ships that changed since the last delta (notification) */
+    RESP_MATCH_UNSUBSCRIBED = 156,  /**< No longer receiving match deltas */
 
     /* Error codes - Challenge */
     RESP_CHALLENGE_NOT_FOUND = 332, /**< Challenge ID does not exist */
@@ -245,6 +290,7 @@ static const ResponseMessage RESPONSE_MESSAGES[] = {
     {RESP_TEAM_MEMBERS_LIST_OK,   "Team members list retrieved successfully."},
     {RESP_MATCH_INFO_OK,     "Match information retrieved successfully."},
     {RESP_REPAIR_OK,         "Ship repaired successfully."},
+    {RESP_BINARY_OK,         "Binary protocol enabled."},
     
     /* Command/Syntax errors */
     {RESP_BAD_COMMAND,       "Unknown or invalid command."},
@@ -331,6 +377,11 @@ static const ResponseMessage RESPONSE_MESSAGES[] = {
     {RESP_CHALLENGE_SENT,       "136 Challenge sent successfully. Waiting for response..."},
     {RESP_CHALLENGE_RECEIVED,   "150 You have received a challenge!"},
     {RESP_MATCH_STARTED_NOTIFY, "151 Opponent accepted. Match started!"},
+    {RESP_MATCH_ENDED_NOTIFY,   "152 Match ended!"},
+    {RESP_MATCH_TICK_NOTIFY,    "153 Match state updated."},
+    {RESP_MATCH_SNAPSHOT,       "154 Subscribed to match updates."},
+    {RESP_MATCH_DELTA_NOTIFY,   "155 Ships updated."},
+    {RESP_MATCH_UNSUBSCRIBED,   "156 Unsubscribed from match updates."},
 };
 
 #define RESPONSE_MESSAGES_COUNT (sizeof(RESPONSE_MESSAGES) / sizeof(RESPONSE_MESSAGES[0]))
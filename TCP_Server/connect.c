@@ -4,9 +4,11 @@
 #include "router.h"
 #include "epoll.h"
 #include "session.h"
+#include "app_context.h"
 // #include "protocol.h"
-// #include "buffer.h"
-#include "file_transfer.h"
+#include "buffer.h"
+#include "timer_wheel.h"
+#include "wire.h"
 
 #include <unistd.h>
 #include <fcntl.h>
@@ -18,29 +20,89 @@
 #include <sys/socket.h>
 #include <sys/epoll.h>
 #include <sys/ioctl.h>
+#include <pthread.h>
 
 typedef struct connection {
     int sockfd;
     char read_buffer[BUFF_SIZE];
     size_t read_buffer_len;
-    char write_buffer[BUFF_SIZE];
-    size_t write_buffer_len;
+    size_t max_line_len;        /**< Framing policy: longest line before the peer is dropped */
+    pthread_mutex_t out_lock;   /**< Guards out/doomed/read_paused: other reactors may queue output */
+    out_chain_t out;            /**< Pending output, flushed with sendmsg() */
+    size_t high_water;          /**< Stop reading requests above this many queued bytes */
+    size_t hard_limit;          /**< Drop the connection above this many queued bytes */
+    unsigned int armed_events;  /**< Interest set currently registered with epoll */
+    int read_paused;            /**< Backpressure: EPOLLIN disarmed until output drains */
+    int held;                   /**< A reply is pending (connection_hold()); owner reactor only */
+    int doomed;                 /**< Over hard_limit; owner reactor will close it */
+    int binary;                 /**< wire.h frames instead of lines (after BINARY); world lock */
+    Timer idle_timer;           /**< Owner reactor's wheel; closes a silent connection */
+    uint64_t last_active;       /**< Tick of the last bytes received */
 } connection_t;
 
 static connection_t *connections[MAX_CLIENTS] = {0};
+static size_t output_high_water = OUTPUT_HIGH_WATER;
+static unsigned long idle_timeout_sec = CONNECTION_IDLE_SEC;
 
-void connection_enable_write(connection_t* conn) {
-    struct epoll_event ev;
-    ev.data.fd = conn->sockfd;
-    ev.events = EPOLLIN | EPOLLET | EPOLLOUT;
-    epoll_mod(conn->sockfd, ev.events);
+void connection_set_output_limit(size_t high_water) {
+    if (high_water > 0) output_high_water = high_water;
 }
 
-void connection_disable_write(connection_t* conn) {
-    struct epoll_event ev;
-    ev.data.fd = conn->sockfd;
-    ev.events = EPOLLIN | EPOLLET;
-    epoll_mod(conn->sockfd, ev.events);
+void connection_set_idle_timeout(unsigned long seconds) {
+    idle_timeout_sec = seconds;
+}
+
+/*
+ * Idle timer: receiving only stamps last_active, and the timer is pushed
+ * back when it fires, so busy connections never touch the wheel.
+ */
+static void connection_idle_expired(Timer *timer) {
+    connection_t *conn = timer->arg;
+    uint64_t limit = timer_ms_to_ticks((uint64_t)idle_timeout_sec * 1000);
+    uint64_t idle = timer_now_tick() - conn->last_active;
+
+    // A pending auth reply is not the peer's silence
+    if (idle < limit || conn->held) {
+        uint64_t left = idle < limit ? limit - idle : limit;
+        epoll_timer_arm(conn->sockfd, &conn->idle_timer, (unsigned long)(left * TIMER_TICK_MS));
+        return;
+    }
+    printf("[INFO] Socket %d idle for %lu s, closing\n", conn->sockfd, idle_timeout_sec);
+    connection_close(conn->sockfd);
+}
+
+/* Re-arm epoll for the current state, only if it changed. Caller holds out_lock. */
+static void connection_update_events(connection_t *conn) {
+    unsigned int events = EPOLLET;
+    if (!conn->read_paused) events |= EPOLLIN;
+    if (conn->out.bytes > 0) events |= EPOLLOUT;
+    if (events == conn->armed_events) return;
+    if (epoll_mod(conn->sockfd, events) == 0) {
+        conn->armed_events = events;
+    }
+}
+
+/**
+ * Optimistic write: with nothing queued, try the socket directly so the
+ * common case costs one sendmsg() and no epoll_ctl(). Caller holds out_lock.
+ *
+ * @return Bytes written (0 if the caller must queue everything)
+ */
+static size_t connection_try_send(connection_t *conn, struct iovec *iov, int iov_count) {
+    if (conn->out.bytes > 0 || conn->doomed) return 0;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = (size_t)iov_count;
+    while (1) {
+        ssize_t n = sendmsg(conn->sockfd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n >= 0) return (size_t)n;
+        if (errno == EINTR) continue;
+        // EAGAIN: queue it. Hard errors: queue it too; the owning reactor
+        // gets EPOLLERR/EPOLLHUP and closes the connection.
+        return 0;
+    }
 }
 
 void connection_create(int client_sock) {
@@ -61,55 +123,150 @@ void connection_create(int client_sock) {
 
     conn->sockfd = client_sock;
     conn->read_buffer_len = 0; 
-    conn->write_buffer_len = 0; 
-
-    connections[client_sock] = conn;
-    printf("Connection created for socket %d\n", client_sock);
+    conn->max_line_len = MAX_LINE_LENGTH < BUFF_SIZE ? MAX_LINE_LENGTH : BUFF_SIZE - 1;
+    conn->high_water = output_high_water;
+    conn->hard_limit = output_high_water * OUTPUT_HARD_FACTOR;
+    conn->armed_events = EPOLLIN | EPOLLET; // As registered by the accepting reactor
+    pthread_mutex_init(&conn->out_lock, NULL);
+    timer_init(&conn->idle_timer, connection_idle_expired, conn);
+    conn->last_active = timer_now_tick();
+    if (idle_timeout_sec > 0) {
+        epoll_timer_arm(client_sock, &conn->idle_timer, idle_timeout_sec * 1000);
+    }
 
     // Create empty session for this connection
     ServerSession new_session;
     initServerSession(&new_session);
     new_session.socket_fd = client_sock;
+
+    app_lock();
+    connections[client_sock] = conn;
     add_session(&new_session);
+    app_unlock();
+    printf("Connection created for socket %d\n", client_sock);
 
     // Send initial greeting so client recv_line() doesn't block
     // Use a dedicated welcome code to avoid confusion with REGISTER_OK
-    const char *greeting = "120"; // RESP_WELCOME
-    if (send_line(client_sock, greeting) < 0) {
-        // Fallback: enqueue via epoll-driven buffer if immediate send fails
-        const char *fallback = "120\r\n";
-        connection_send(client_sock, fallback, strlen(fallback));
+    const char *greeting = "120\r\n"; // RESP_WELCOME
+    connection_send(client_sock, greeting, strlen(greeting));
+}
+
+/**
+ * Pause reading when this connection's own output is piling up.
+ * The client is not draining its responses, so stop producing more.
+ */
+static void connection_check_backpressure(connection_t *conn) {
+    pthread_mutex_lock(&conn->out_lock);
+    if (!conn->read_paused && conn->out.bytes > conn->high_water) {
+        conn->read_paused = 1;
+        connection_update_events(conn);
+    }
+    pthread_mutex_unlock(&conn->out_lock);
+}
+
+/**
+ * Hand every complete line in the read buffer to the router.
+ * Lines end at LF, an optional CR before it is stripped. The partial tail
+ * (if any) is moved to the front of the buffer to wait for more bytes.
+ * Stops early when backpressure pauses the connection.
+ *
+ * In binary mode the buffer holds wire.h frames instead; the mode is
+ * checked per message, as the BINARY line switches it mid-buffer.
+ * The router takes whatever locks each command needs.
+ *
+ * @return 0 if the connection is still open, -1 if it was closed meanwhile
+ */
+static int connection_dispatch_lines(connection_t *conn) {
+    int client_sock = conn->sockfd;
+    size_t start = 0;
+
+    while (start < conn->read_buffer_len && !conn->read_paused && !conn->held) {
+        if (conn->binary) {
+            size_t head_len, payload_len;
+            int rc = wire_frame_parse(conn->read_buffer + start, conn->read_buffer_len - start,
+                                      conn->max_line_len, &head_len, &payload_len);
+            if (rc == 0) break;
+            if (rc < 0) {
+                fprintf(stderr, "[WARN] Socket %d sent a malformed frame, closing\n", client_sock);
+                connection_close(client_sock);
+                return -1;
+            }
+            const uint8_t *payload = (const uint8_t *)conn->read_buffer + start + head_len;
+            start += head_len + payload_len;
+
+            command_routes_frame(client_sock, payload, payload_len);
+        } else {
+            char *line = conn->read_buffer + start;
+            char *nl = memchr(line, '\n', conn->read_buffer_len - start);
+            if (!nl) break;
+
+            size_t line_len = (size_t)(nl - line);
+            if (line_len > 0 && line[line_len - 1] == '\r') line_len--;
+            line[line_len] = '\0';
+            start = (size_t)(nl - conn->read_buffer) + 1;
+
+            command_routes(client_sock, line);
+        }
+
+        // A handler may have torn the connection down
+        if (connections[client_sock] != conn) return -1;
+        connection_check_backpressure(conn);
+    }
+
+    if (start > 0) {
+        conn->read_buffer_len -= start;
+        if (conn->read_buffer_len > 0) {
+            memmove(conn->read_buffer, conn->read_buffer + start, conn->read_buffer_len);
+        }
     }
+    return 0;
 }
 
 void connection_on_read(int client_sock) {
     connection_t *conn = connections[client_sock];
     if(!conn) return;
-    while (1) {
-        char line[BUFF_SIZE];
-        ssize_t m = recv_line(client_sock, line, sizeof(line));
 
-        if (m < 0) {
-            // Treat anything other than EAGAIN/EWOULDBLOCK as hard error/EOF
-            if (errno == EWOULDBLOCK || errno == EAGAIN) {
-                // Drained all available data for now (edge-triggered)
-                break;
-            }
-            perror("recv_line() error");
+    if (conn->doomed) {
+        fprintf(stderr, "[WARN] Socket %d too slow to consume output, closing\n", client_sock);
+        connection_close(client_sock);
+        return;
+    }
+
+    // Lines left over from a backpressure pause go first
+    if (connection_dispatch_lines(conn) < 0) return;
+
+    // Edge-triggered: keep reading until the kernel has nothing more for us
+    // (while held, the rest waits in the kernel until connection_release())
+    while (!conn->read_paused && !conn->held) {
+        size_t room = sizeof(conn->read_buffer) - conn->read_buffer_len;
+        ssize_t n = recv(client_sock, conn->read_buffer + conn->read_buffer_len, room, 0);
+
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EWOULDBLOCK || errno == EAGAIN) break;
+            perror("recv() error");
             connection_close(client_sock);
             return;
         }
-
-        if (m > 0) {
-            // Process a full command line (without CRLF)
-            command_routes(client_sock, line);
-            // Continue looping to drain any pipelined commands
-            continue;
+        if (n == 0) {
+            // Peer closed; anything left without a newline is discarded
+            connection_close(client_sock);
+            return;
         }
 
-        // m == 0 is not expected from recv_line(); treat conservatively
-        // Break to avoid busy loop; next EPOLLIN will resume if more data arrives
-        break;
+        conn->read_buffer_len += (size_t)n;
+        conn->last_active = timer_now_tick();
+        if (connection_dispatch_lines(conn) < 0) return;
+
+        // Only a partial line can remain unless backpressure or a hold stopped dispatch
+        // (a partial frame was already checked against the limit by its header)
+        if (!conn->read_paused && !conn->held && !conn->binary
+            && conn->read_buffer_len > conn->max_line_len) {
+            fprintf(stderr, "[WARN] Socket %d exceeded max line length (%zu bytes), closing\n",
+                    client_sock, conn->max_line_len);
+            connection_close(client_sock);
+            return;
+        }
     }
 }
 
@@ -117,50 +274,193 @@ void connection_on_write(int client_sock) {
     connection_t *conn = connections[client_sock];
     if(!conn) return;
 
-    while (conn->write_buffer_len > 0) {
-        ssize_t n = send(client_sock, conn->write_buffer, conn->write_buffer_len, 0);
+    struct iovec iov[OUT_IOV_MAX];
+    struct msghdr msg;
+    int resume = 0;
+
+    memset(&msg, 0, sizeof(msg));
+    pthread_mutex_lock(&conn->out_lock);
+    while (conn->out.bytes > 0) {
+        // Gather as many segments as possible into one syscall
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t)out_chain_fill_iov(&conn->out, iov, OUT_IOV_MAX);
+        ssize_t n = sendmsg(client_sock, &msg, MSG_NOSIGNAL);
         if (n < 0) {
+            if (errno == EINTR) continue;
             if (errno == EWOULDBLOCK || errno == EAGAIN) {
-                break; // Socket not ready for writing
+                break; // Socket not ready for writing; wait for the next EPOLLOUT
             } else {
-                perror("send() error:");
+                perror("sendmsg() error:");
+                pthread_mutex_unlock(&conn->out_lock);
                 connection_close(client_sock);
                 return;
             }
-        } else if(n > 0) {
-            memmove(conn->write_buffer, conn->write_buffer + n, conn->write_buffer_len - n);
-            conn->write_buffer_len -= n;
         }
+        out_chain_consume(&conn->out, (size_t)n);
+    }
 
-        if(conn->write_buffer_len == 0) {
-            connection_disable_write(conn);
-        }
+    // Resume reading once the backlog is down to half the high-water mark
+    if (conn->read_paused && conn->out.bytes <= conn->high_water / 2) {
+        conn->read_paused = 0;
+        resume = 1;
+    }
+    if (conn->out.bytes == 0 || resume) {
+        connection_update_events(conn);
+    }
+    pthread_mutex_unlock(&conn->out_lock);
+
+    if (resume) {
+        connection_on_read(client_sock);
+    }
+}
+
+void connection_hold(int client_sock) {
+    connection_t *conn = connections[client_sock];
+    if (conn) conn->held = 1;
+}
+
+void connection_release(int client_sock) {
+    connection_t *conn = connections[client_sock];
+    if (!conn || !conn->held) return;
+    conn->held = 0;
+    connection_on_read(client_sock);
+}
+
+/**
+ * Enforce the hard limit before queuing len more bytes. Caller holds
+ * out_lock. A connection over the limit is shut down; its owner reactor
+ * sees the hangup and closes it, so this is safe from any thread.
+ *
+ * @return 0 if the bytes may be queued, -1 otherwise
+ */
+static int connection_reserve_output(connection_t *conn, size_t len) {
+    if (conn->doomed) return -1;
+    if (conn->out.bytes + len > conn->hard_limit) {
+        conn->doomed = 1;
+        out_chain_clear(&conn->out);
+        shutdown(conn->sockfd, SHUT_RDWR);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Send head (a frame header, possibly empty) then body, queuing whatever
+ * the socket does not take. body is copied unless it is shared->data, in
+ * which case the queue takes a reference instead. Caller holds out_lock.
+ *
+ * @return 0 on success, -1 if over the hard limit or out of memory
+ */
+static int connection_write(connection_t *conn, const uint8_t *head, size_t head_len,
+                            const char *body, size_t body_len, shared_buf_t *shared) {
+    struct iovec iov[2] = {
+        { (void *)head, head_len },
+        { (void *)body, body_len },
+    };
+    size_t total = head_len + body_len;
+    size_t sent = connection_try_send(conn, iov, 2);
+    if (sent == total) return 0;
+    if (connection_reserve_output(conn, total - sent) != 0) return -1;
+
+    int rc = 0;
+    if (sent < head_len) {
+        rc = out_chain_append(&conn->out, (const char *)head + sent, head_len - sent);
+        sent = 0;
+    } else {
+        sent -= head_len;
+    }
+    if (rc == 0 && shared) {
+        rc = out_chain_append_shared(&conn->out, shared);
+        // Only when the header went out whole, so the body leads the chain
+        if (rc == 0 && sent > 0) out_chain_consume(&conn->out, sent);
+    } else if (rc == 0) {
+        rc = out_chain_append(&conn->out, body + sent, body_len - sent);
     }
+    if (rc == 0) connection_update_events(conn);
+    return rc;
+}
+
+/* WIRE_TEXT header a binary connection puts before text output */
+static size_t connection_text_header(const connection_t *conn, size_t len, uint8_t *head) {
+    if (!conn->binary) return 0;
+    size_t n = wire_frame_header(head, len + 1);
+    head[n++] = WIRE_TEXT;
+    return n;
+}
+
+/* Caller holds the world lock, which keeps conn alive (see connection_close) */
+int connection_send_shared(int client_sock, shared_buf_t *buf) {
+    if (!buf || client_sock < 0 || client_sock >= MAX_CLIENTS) return -1;
+    connection_t *conn = connections[client_sock];
+    if(!conn) return -1;
+
+    uint8_t head[WIRE_HEADER_MAX];
+    pthread_mutex_lock(&conn->out_lock);
+    size_t head_len = connection_text_header(conn, buf->len, head);
+    int rc = connection_write(conn, head, head_len, buf->data, buf->len, buf);
+    pthread_mutex_unlock(&conn->out_lock);
+    return rc;
 }
 
+/* Caller holds the world lock, which keeps conn alive (see connection_close) */
 int connection_send(int client_sock, const char *response, size_t len) {
+    if (!response || client_sock < 0 || client_sock >= MAX_CLIENTS) return -1;
     connection_t *conn = connections[client_sock];
     if(!conn) return -1;
 
-    if(len > BUFF_SIZE - conn->write_buffer_len) {
-        return -1;
+    uint8_t head[WIRE_HEADER_MAX];
+    pthread_mutex_lock(&conn->out_lock);
+    size_t head_len = connection_text_header(conn, len, head);
+    int rc = connection_write(conn, head, head_len, response, len, NULL);
+    pthread_mutex_unlock(&conn->out_lock);
+    return rc;
+}
+
+/* Caller holds the world lock, which keeps conn alive (see connection_close) */
+int connection_send_frame(int client_sock, const void *payload, size_t len, shared_buf_t *shared) {
+    if ((!payload && !shared) || client_sock < 0 || client_sock >= MAX_CLIENTS) return -1;
+    connection_t *conn = connections[client_sock];
+    if (!conn || !conn->binary) return -1;
+
+    if (shared) {
+        payload = shared->data;
+        len = shared->len;
     }
+    uint8_t head[WIRE_VARINT_MAX];
+    pthread_mutex_lock(&conn->out_lock);
+    size_t head_len = wire_frame_header(head, len);
+    int rc = connection_write(conn, head, head_len, (const char *)payload, len, shared);
+    pthread_mutex_unlock(&conn->out_lock);
+    return rc;
+}
 
-    memcpy(conn->write_buffer + conn->write_buffer_len, response, len);
-    conn->write_buffer_len += len;
+void connection_set_binary(int client_sock) {
+    connection_t *conn = connections[client_sock];
+    if (conn) conn->binary = 1;
+}
 
-    connection_enable_write(conn);
-    return 0;
+bool connection_is_binary(int client_sock) {
+    if (client_sock < 0 || client_sock >= MAX_CLIENTS) return false;
+    connection_t *conn = connections[client_sock];
+    return conn && conn->binary;
 }
 
 void connection_close(int client_sock) {
     connection_t *conn = connections[client_sock];
     if(!conn) return;
+    // Unpublish first: once the slot is NULL under the world lock no other
+    // thread can reach conn, so it is safe to free without further locking
+    app_lock();
     // Remove associated session to avoid leaks
     remove_session_by_socket(client_sock);
+    connections[client_sock] = NULL;
+    app_unlock();
+    timer_cancel(&conn->idle_timer);
     epoll_del(client_sock);
     close(client_sock);
+    // Unsent output is dropped; shared buffers live on in other queues
+    out_chain_clear(&conn->out);
+    pthread_mutex_destroy(&conn->out_lock);
     free(conn);
-    connections[client_sock] = NULL;
     printf("Connection closed for socket %d\n", client_sock);
 }
\ No newline at end of file
@@ -2,7 +2,9 @@
 #define CONNECT_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include<stddef.h>
+#include "buffer.h"
 
 typedef struct connection connection_t;
 
@@ -12,4 +14,77 @@ void connection_on_write(int fd);
 void connection_close(int fd);
 int connection_send(int fd, const char *response, size_t len);
 
+/**
+ * @brief Queue a shared (broadcast) buffer on a connection
+ *
+ * Takes its own reference; the caller keeps and later drops its own.
+ * Output is flushed by the owning reactor on EPOLLOUT, so a slow peer
+ * never blocks the sender.
+ *
+ * @return 0 on success, -1 if the connection is gone or out of memory
+ */
+int connection_send_shared(int fd, shared_buf_t *buf);
+
+/**
+ * @brief Queue one binary frame (wire.h) on a connection in binary mode
+ *
+ * Text sent with connection_send() / connection_send_shared() to such a
+ * connection is framed as WIRE_TEXT on the way; this sends a payload with
+ * its own type. With shared set, its bytes are the payload (payload and
+ * len are ignored) and the queue takes its own reference.
+ *
+ * @return 0 on success, -1 if the connection is gone, not binary or out
+ *         of memory
+ */
+int connection_send_frame(int fd, const void *payload, size_t len, shared_buf_t *shared);
+
+/**
+ * @brief Switch a connection to binary framing (wire.h), both directions
+ *
+ * Output queued after this call is framed, and bytes read after the
+ * line that asked for it are parsed as frames. World lock held, from
+ * that line's handler once its text reply is queued.
+ */
+void connection_set_binary(int fd);
+
+/**
+ * @brief Whether a connection uses binary framing (world lock held, shared or not)
+ */
+bool connection_is_binary(int fd);
+
+/**
+ * @brief Set the output high-water mark for new connections
+ *
+ * Above it a connection stops reading requests until its output drains
+ * to half; above OUTPUT_HARD_FACTOR times it the connection is dropped.
+ *
+ * @param high_water Queued bytes (0 keeps the current value)
+ */
+void connection_set_output_limit(size_t high_water);
+
+/**
+ * @brief Set how long new connections may stay silent
+ *
+ * A connection that sends nothing for this long is closed by its reactor.
+ *
+ * @param seconds Idle limit (0 = never close idle connections)
+ */
+void connection_set_idle_timeout(unsigned long seconds);
+
+/**
+ * @brief Stop handing this connection's lines to the router
+ *
+ * For a command whose reply comes later (LOGIN/REGISTER wait for an auth
+ * worker): lines after it stay in the read buffer, so replies keep the
+ * order of requests. Owner reactor only, e.g. from a command handler.
+ */
+void connection_hold(int fd);
+
+/**
+ * @brief Undo connection_hold() and dispatch what arrived meanwhile
+ *
+ * Owner reactor only (see epoll_post()), without the world lock.
+ */
+void connection_release(int fd);
+
 #endif
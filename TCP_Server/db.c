@@ -9,12 +9,22 @@
  *   - users.h/c         : User struct & HashTable operations
  *   - users_io.h/c      : User file I/O (users.txt)
  *   - session.h/c       : Session manager with mutex
- *   - hash.h/c          : Hash function (djb2)
+ *   - hash.h/c          : Hash function (wyhash, seeded at startup)
  * 
  * This file handles:
  *   - Teams, team members, join requests, invites
  *   - Matches, challenges
  *   - Ships (in-match only, temporary)
+ *
+ * Lookups by key go through the hash indexes below (db_index.h), which
+ * every insert, update and delete in this file keeps in sync. Code
+ * outside db.c must change teams, members, matches and ships through
+ * these functions, not by writing the tables directly.
+ *
+ * Rows that come and go all the time (members, join requests, invites,
+ * ships) live in slot maps (slot_map.h): insert and delete are O(1),
+ * row pointers stay valid, and a team or match keeps the handles of its
+ * own rows so it never scans the whole table.
  * ============================================================================
  */
 
@@ -25,7 +35,9 @@
 
 
 #include "db_schema.h"
-#include "hash.h"
+#include "db_index.h"
+#include "db_store.h"
+#include "app_context.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -33,33 +45,30 @@
 /* ============================================================================
  * IN-MEMORY STORAGE
  * ============================================================================ */
-Team         teams[MAX_TEAMS];
-static int          team_count = 0;
+static SlotMap team_store         = SLOT_MAP_INIT(Team);
+static SlotMap member_store       = SLOT_MAP_INIT(TeamMember);
+static SlotMap join_request_store = SLOT_MAP_INIT(JoinRequest);
+static SlotMap invite_store       = SLOT_MAP_INIT(TeamInvite);
+static SlotMap challenge_store    = SLOT_MAP_INIT(Challenge);
+static SlotMap match_store        = SLOT_MAP_INIT(Match);
 
-TeamMember   team_members[MAX_TEAMS * MAX_TEAM_MEMBERS];
-int          team_member_count = 0;
+static SlotMap ship_store = SLOT_MAP_INIT(Ship);  // Temporary, in-memory only
 
-JoinRequest  join_requests[MAX_JOIN_REQUESTS];
-int          join_request_count = 0;
+static DbLimits db_limits = DB_LIMITS_DEFAULT;
 
-TeamInvite   team_invites[MAX_TEAM_INVITES];
-int          team_invite_count = 0;
-
-Challenge    challenges[MAX_CHALLENGES];
-int          challenge_count = 0;
-
-Match        matches[MAX_MATCHES];
-int          match_count = 0;
+void db_set_limits(const DbLimits *limits) {
+    if (limits) db_limits = *limits;
+}
 
-Ship         ships[MAX_SHIPS];  // Temporary, in-memory only
-int          ship_count = 0;
+static bool at_limit(const SlotMap *store, int max) {
+    return max > 0 && slot_map_count(store) >= (size_t)max;
+}
 
 Ship active_ships[100];
 int num_active_ships = 0;
 // TODO: UserTable from users.h/c
 UserTable *g_user_table = NULL;
 
-TreasureChest active_chests[MAX_TEAMS]; 
 ChestPuzzle puzzles[] = {
     {"1 + 1 = ?", "2"},             // Đồng
     {"Thủ đô của Việt Nam?", "Ha Noi"}, // Bạc
@@ -72,6 +81,24 @@ WeaponTemplate weapon_templates[] = {
     {3, "Tên lửa", 800, 2000, 1}
 };
 
+/* ============================================================================
+ * INDEXES
+ * ============================================================================ */
+static DbIndex team_by_id      = DB_INDEX_INIT;  /* team_id -> Team* */
+static DbIndex team_by_name    = DB_INDEX_INIT;  /* name -> Team* (active teams only) */
+static DbIndex team_by_member  = DB_INDEX_INIT;  /* username -> Team* */
+static DbIndex match_by_id     = DB_INDEX_INIT;  /* match_id -> Match* */
+static DbIndex match_by_team   = DB_INDEX_INIT;  /* team_id -> running Match* */
+static DbIndex ship_by_player  = DB_INDEX_INIT;  /* (match_id, username) -> Ship* */
+static DbIndex challenge_by_id = DB_INDEX_INIT;  /* challenge_id -> Challenge* */
+static DbIndex request_by_key  = DB_INDEX_INIT;  /* (team_id, username) -> JoinRequest* */
+static DbIndex invite_by_key   = DB_INDEX_INIT;  /* (team_id, invitee_id) -> TeamInvite* */
+
+// Name part of an invite_by_key key: the invitee's user id in decimal
+static const char* invitee_key(int invitee_id, char buf[16]) {
+    snprintf(buf, 16, "%d", invitee_id);
+    return buf;
+}
  
 
 /* ============================================================================
@@ -94,12 +121,8 @@ int next_match_id = 1;
 int find_team_id_by_username(const char *username) {
     if (!username) return -1;
     
-    for (int i = 0; i < team_member_count; i++) {
-        if (strcmp(team_members[i].username, username) == 0) {
-            return team_members[i].team_id;
-        }
-    }
-    return -1;
+    Team *team = db_index_get(&team_by_member, 0, username);
+    return team ? team->team_id : -1;
 }
 
 /**
@@ -109,13 +132,8 @@ int find_team_id_by_username(const char *username) {
 int find_running_match_by_team(int team_id) {
     if (team_id <= 0) return -1;
     
-    for (int i = 0; i < match_count; i++) {
-        if (matches[i].status == MATCH_RUNNING &&
-            (matches[i].team1_id == team_id || matches[i].team2_id == team_id)) {
-            return matches[i].match_id;
-        }
-    }
-    return -1;
+    Match *match = db_index_get(&match_by_team, team_id, NULL);
+    return match ? match->match_id : -1;
 }
 
 /**
@@ -132,40 +150,41 @@ int find_current_match_by_username(const char *username) {
 
 /**
  * Find an available opponent team for matchmaking
- * Returns first team that is not the user's team and not currently in a match
+ * Returns the oldest (lowest id) team that is not the user's team and not currently in a match
  * @param user_team_id The user's team ID to exclude
  * @return opponent team_id or -1 if no available teams
  */
 int find_available_opponent_team(int user_team_id) {
     if (user_team_id <= 0) return -1;
     
-    for (int i = 0; i < team_count; i++) {
-        int candidate_team_id = teams[i].team_id;
+    int best_team_id = -1;
+    int count = get_team_count();
+    for (int i = 0; i < count; i++) {
+        Team *candidate = get_team_at(i);
+        int candidate_team_id = candidate->team_id;
         
         // Skip user's own team
         if (candidate_team_id == user_team_id) continue;
         
         // Skip teams with status != TEAM_ACTIVE
-        if (teams[i].status != TEAM_ACTIVE) continue;
+        if (candidate->status != TEAM_ACTIVE) continue;
         
         // Check if this team is already in a running match
         if (find_running_match_by_team(candidate_team_id) >= 0) continue;
         
-        // Found an available team!
-        return candidate_team_id;
+        if (best_team_id < 0 || candidate_team_id < best_team_id) {
+            best_team_id = candidate_team_id;
+        }
     }
     
-    // No available teams found
-    return -1;
+    // -1 if no available teams found
+    return best_team_id;
 }
 
 Ship* find_ship(int match_id, const char *username) {  
     if (!match_id || !username) return NULL;
 
-    for (int i = 0; i < ship_count; i++) {
-        if (ships[i].match_id == match_id && strcmp(ships[i].player_username, username) == 0) return &ships[i];
-    }
-    return NULL;
+    return db_index_get(&ship_by_player, match_id, username);
 }
 
 
@@ -188,29 +207,6 @@ int get_armor_value(ArmorType type) {
     }
 }
 
-//Tìm tàu theo tên người chơi
-Ship* find_ship_by_name(char* target_name) {
-    if (!target_name) return NULL;
-
-    // Duyệt qua danh sách tàu đang có (biến ship_count và mảng ships khai báo trong db.c)
-    extern Ship ships[]; 
-    extern int ship_count;
-
-    
-    for (int i = 0; i < ship_count; i++) {
-        printf(" -> Checked ship [%d]: '%s' (Match ID: %d)\n", 
-               i, ships[i].player_username, ships[i].match_id);
-        
-        if (strcmp(ships[i].player_username, target_name) == 0) {
-           
-            return &ships[i];
-        }
-    }
-    
-    return NULL;
-}
-
-
 // //Lấy template vũ khí
 // WeaponTemplate* get_weapon_template(int weapon_id) {
 //     for (int i = 0; i < 3; i++) {
@@ -236,34 +232,27 @@ void update_ship_state(Ship* ship) {
 Team* find_team_by_id(int team_id) {
     if (team_id <= 0) return NULL;
     
-    for (int i = 0; i < team_count; i++) {
-        if (teams[i].team_id == team_id && teams[i].status == TEAM_ACTIVE) {
-            return &teams[i];
-        }
-    }
-    return NULL;
+    Team *team = db_index_get(&team_by_id, team_id, NULL);
+    return (team && team->status == TEAM_ACTIVE) ? team : NULL;
 }
 
 Team* find_team_by_name(const char *name) {
     if (!name) return NULL;
-    for (int i = 0; i < team_count; i++) {
-        if (strcmp(teams[i].name, name) == 0 && teams[i].status == TEAM_ACTIVE) {
-            return &teams[i];
-        }
-    }
-    return NULL;
+    return db_index_get(&team_by_name, 0, name);
 }
 
 Team* create_team(const char *name, const char *creator_username) {
     if (!name || !creator_username) return NULL;
     
     // Check capacity
-    if (team_count >= MAX_TEAMS) {
+    if (at_limit(&team_store, db_limits.max_teams)) {
         return NULL;
     }
     
     // Create team
-    Team *team = &teams[team_count++];
+    SlotHandle handle;
+    Team *team = slot_map_insert(&team_store, &handle);
+    if (!team) return NULL;
     team->team_id = next_team_id++;
     strncpy(team->name, name, TEAM_NAME_LEN - 1);
     team->name[TEAM_NAME_LEN - 1] = '\0';
@@ -272,33 +261,123 @@ Team* create_team(const char *name, const char *creator_username) {
     team->member_limit = MAX_TEAM_MEMBERS;
     team->status = TEAM_ACTIVE;
     team->created_at = time(NULL);
-    team_count++;
+    team->member_count = 0;
+
+    if (!db_index_put(&team_by_id, team->team_id, NULL, team) ||
+        !db_index_put(&team_by_name, 0, team->name, team)) {
+        db_index_remove(&team_by_id, team->team_id, NULL);
+        slot_map_remove(&team_store, handle);
+        return NULL;
+    }
+    
+    db_log_team(team);
     
     // Add creator as team member
-    if (team_member_count < MAX_TEAMS * MAX_TEAM_MEMBERS) {
-        TeamMember *member = &team_members[team_member_count];
-        member->team_id = team->team_id;
-        strncpy(member->username, creator_username, MAX_USERNAME - 1);
-        member->username[MAX_USERNAME - 1] = '\0';
-        member->role = ROLE_CREATOR;
-        member->joined_at = time(NULL);
-        team_member_count++;
-    }
+    add_team_member(team->team_id, creator_username, ROLE_CREATOR);
     
     return team;
 }
 
+int get_team_count(void) {
+    return (int)slot_map_count(&team_store);
+}
+
+Team* get_team_at(int index) {
+    if (index < 0 || index >= get_team_count()) return NULL;
+    return slot_map_at(&team_store, (size_t)index);
+}
+
 int get_team_member_count(int team_id) {
     if (team_id <= 0) return 0;
     
-    int count = 0;
-    for (int i = 0; i < team_member_count; i++) {
-        if (team_members[i].team_id == team_id) {
-            count++;
+    Team *team = db_index_get(&team_by_id, team_id, NULL);
+    return team ? team->member_count : 0;
+}
+
+static TeamMember* insert_member(Team *team, const char *username, TeamRole role, time_t joined_at) {
+    if (team->member_count >= MAX_TEAM_MEMBERS) return NULL;
+
+    SlotHandle handle;
+    TeamMember *member = slot_map_insert(&member_store, &handle);
+    if (!member) return NULL;
+    if (!db_index_put(&team_by_member, 0, username, team)) {
+        slot_map_remove(&member_store, handle);
+        return NULL;
+    }
+
+    member->team_id = team->team_id;
+    strncpy(member->username, username, MAX_USERNAME - 1);
+    member->username[MAX_USERNAME - 1] = '\0';
+    member->role = role;
+    member->joined_at = joined_at;
+    team->members[team->member_count++] = handle;
+    return member;
+}
+
+TeamMember* add_team_member(int team_id, const char *username, TeamRole role) {
+    if (!username) return NULL;
+    Team *team = db_index_get(&team_by_id, team_id, NULL);
+    if (!team) return NULL;
+
+    TeamMember *member = insert_member(team, username, role, time(NULL));
+    if (member) db_log_member(member);
+    return member;
+}
+
+bool remove_team_member(int team_id, const char *username) {
+    if (!username) return false;
+    Team *team = db_index_get(&team_by_id, team_id, NULL);
+    if (!team) return false;
+
+    for (int i = 0; i < team->member_count; i++) {
+        TeamMember *member = slot_map_get(&member_store, team->members[i]);
+        if (!member || strcmp(member->username, username) != 0) continue;
+
+        if (db_index_get(&team_by_member, 0, username) == team) {
+            db_index_remove(&team_by_member, 0, username);
         }
+        db_log_member_delete(member->username);
+        slot_map_remove(&member_store, team->members[i]);
+        // Keep join order: the first member left becomes captain
+        for (int j = i; j < team->member_count - 1; j++) {
+            team->members[j] = team->members[j + 1];
+        }
+        team->member_count--;
+        return true;
     }
+    return false;
+}
 
-    return count;
+bool set_team_captain(int team_id, const char *username) {
+    if (!username) return false;
+    Team *team = find_team_by_id(team_id);
+    if (!team) return false;
+
+    for (int i = 0; i < team->member_count; i++) {
+        TeamMember *member = slot_map_get(&member_store, team->members[i]);
+        if (!member || strcmp(member->username, username) != 0) continue;
+
+        strncpy(team->creator_username, member->username, MAX_USERNAME - 1);
+        team->creator_username[MAX_USERNAME - 1] = '\0';
+        member->role = ROLE_CREATOR;
+        db_log_team(team);
+        db_log_member(member);
+        return true;
+    }
+    return false;
+}
+
+int get_team_members(int team_id, TeamMember **out, int max) {
+    if (!out) return 0;
+    Team *team = db_index_get(&team_by_id, team_id, NULL);
+    if (!team) return 0;
+
+    int n = 0;
+    for (int i = 0; i < team->member_count && n < max; i++) {
+        TeamMember *member = slot_map_get(&member_store, team->members[i]);
+        if (member) out[n++] = member;
+    }
+    return n;
 }
 
 bool delete_team(int team_id) {
@@ -308,74 +387,164 @@ bool delete_team(int team_id) {
     if (!team) return false;
     
     team->status = TEAM_DELETED;
+    db_index_remove(&team_by_name, 0, team->name);
     
-    return true;
-    
-    // Remove all team members
-    for (int i = team_member_count - 1; i >= 0; i--) {
-        if (team_members[i].team_id == team_id) {
-            for (int j = i; j < team_member_count - 1; j++) {
-                team_members[j] = team_members[j + 1];
-            }
-            team_member_count--;
-        }
+    // Remove all team members so they can join or create another team
+    while (team->member_count > 0) {
+        TeamMember *member = slot_map_get(&member_store, team->members[team->member_count - 1]);
+        if (!member || !remove_team_member(team_id, member->username)) break;
     }
     
-    for (int i = join_request_count - 1; i >= 0; i--) {
-        if (join_requests[i].team_id == team_id) {
-            for (int j = i; j < join_request_count - 1; j++) {
-                join_requests[j] = join_requests[j + 1];
-            }
-            join_request_count--;
-        }
+    // Backwards: a delete moves the last row into the hole
+    for (int i = get_join_request_count() - 1; i >= 0; i--) {
+        JoinRequest *req = get_join_request_at(i);
+        if (req->team_id == team_id) delete_join_request(req);
     }
      
     // Remove all invites for this team
-    for (int i = team_invite_count - 1; i >= 0; i--) {
-        if (team_invites[i].team_id == team_id) {
-            for (int j = i; j < team_invite_count - 1; j++) {
-                team_invites[j] = team_invites[j + 1];
-            }
-            team_invite_count--;
-        }
+    for (int i = get_team_invite_count() - 1; i >= 0; i--) {
+        TeamInvite *invite = get_team_invite_at(i);
+        if (invite->team_id == team_id) delete_team_invite(invite);
     }
     
+    // Nothing keeps a Team* across calls, so the row can go now
+    db_log_team_delete(team_id);
+    db_index_remove(&team_by_id, team_id, NULL);
+    slot_map_remove(&team_store, slot_map_handle_of(&team_store, team));
     return true;
 }
 
+/* ============================================================================
+ * JOIN REQUESTS
+ * ============================================================================ */
+JoinRequest* create_join_request(int team_id, const char *username) {
+    if (!username) return NULL;
+    if (slot_map_count(&join_request_store) >= MAX_JOIN_REQUESTS) return NULL;
+
+    SlotHandle handle;
+    JoinRequest *req = slot_map_insert(&join_request_store, &handle);
+    if (!req) return NULL;
+    if (!db_index_put(&request_by_key, team_id, username, req)) {
+        slot_map_remove(&join_request_store, handle);
+        return NULL;
+    }
+    req->request_id = next_request_id++;
+    req->team_id = team_id;
+    strncpy(req->username, username, MAX_USERNAME - 1);
+    req->username[MAX_USERNAME - 1] = '\0';
+    req->requested_at = time(NULL);
+    req->status = STATUS_PENDING;
+    db_log_join_request(req);
+    return req;
+}
+
+JoinRequest* find_join_request(int team_id, const char *username) {
+    if (!username) return NULL;
+
+    JoinRequest *req = db_index_get(&request_by_key, team_id, username);
+    return req && req->status == STATUS_PENDING ? req : NULL;
+}
+
+void delete_join_request(JoinRequest *req) {
+    if (!req) return;
+    db_log_join_request_delete(req->request_id);
+    if (db_index_get(&request_by_key, req->team_id, req->username) == req) {
+        db_index_remove(&request_by_key, req->team_id, req->username);
+    }
+    slot_map_remove(&join_request_store, slot_map_handle_of(&join_request_store, req));
+}
+
+int get_join_request_count(void) {
+    return (int)slot_map_count(&join_request_store);
+}
+
+JoinRequest* get_join_request_at(int index) {
+    if (index < 0 || index >= get_join_request_count()) return NULL;
+    return slot_map_at(&join_request_store, (size_t)index);
+}
+
 /* ============================================================================
  * CLEAR REQUESTS
  * ============================================================================ */
 void clear_user_requests(const char *username) {
     if (!username) return;
-    User *user = findUser(g_user_table, username);
-    if (!user) return;
-
-    int i = 0;
-    while (i < join_request_count) {
-        if (strcmp(join_requests[i].username, username) == 0) {
-            for (int j = i; j < join_request_count - 1; j++) {
-                join_requests[j] = join_requests[j + 1];
-            }
-            join_request_count--;
-            
-        } else {
-            i++; 
-        }
+
+    // A scan: nothing calls this per command, and the table is capped
+    for (int i = get_join_request_count() - 1; i >= 0; i--) {
+        JoinRequest *req = get_join_request_at(i);
+        if (strcmp(req->username, username) == 0) delete_join_request(req);
     }
 
     printf("[INFO] Cleared join requests for user: %s\n", username);
 }
 
+/* ============================================================================
+ * TEAM INVITES
+ * ============================================================================ */
+TeamInvite* create_team_invite(int team_id, int inviter_id, int invitee_id) {
+    if (slot_map_count(&invite_store) >= MAX_TEAM_INVITES) return NULL;
+
+    char key[16];
+    SlotHandle handle;
+    TeamInvite *invite = slot_map_insert(&invite_store, &handle);
+    if (!invite) return NULL;
+    if (!db_index_put(&invite_by_key, team_id, invitee_key(invitee_id, key), invite)) {
+        slot_map_remove(&invite_store, handle);
+        return NULL;
+    }
+    invite->invite_id = next_invite_id++;
+    invite->team_id = team_id;
+    invite->inviter_id = inviter_id;
+    invite->invitee_id = invitee_id;
+    invite->invited_at = time(NULL);
+    invite->status = STATUS_PENDING;
+    db_log_invite(invite);
+    return invite;
+}
+
+TeamInvite* find_team_invite(int team_id, int invitee_id) {
+    char key[16];
+    TeamInvite *invite = db_index_get(&invite_by_key, team_id, invitee_key(invitee_id, key));
+    return invite && invite->status == STATUS_PENDING ? invite : NULL;
+}
+
+void delete_team_invite(TeamInvite *invite) {
+    if (!invite) return;
+    db_log_invite_delete(invite->invite_id);
+    char key[16];
+    invitee_key(invite->invitee_id, key);
+    if (db_index_get(&invite_by_key, invite->team_id, key) == invite) {
+        db_index_remove(&invite_by_key, invite->team_id, key);
+    }
+    slot_map_remove(&invite_store, slot_map_handle_of(&invite_store, invite));
+}
+
+int get_team_invite_count(void) {
+    return (int)slot_map_count(&invite_store);
+}
+
+TeamInvite* get_team_invite_at(int index) {
+    if (index < 0 || index >= get_team_invite_count()) return NULL;
+    return slot_map_at(&invite_store, (size_t)index);
+}
+
 /* ============================================================================
  * SHIP OPERATIONS
  * ============================================================================ */
 
 Ship* create_ship(int match_id, const char *username) {
     if (!username) return NULL;
-    if (ship_count >= MAX_SHIPS) return NULL;
+    // Ships are bounded per match, and matches by the match limit
+    Match *match = db_index_get(&match_by_id, match_id, NULL);
+    if (!match || match->ship_count >= MATCH_ROSTER_SIZE) return NULL;
     
-    Ship *ship = &ships[ship_count];
+    SlotHandle handle;
+    Ship *ship = slot_map_insert(&ship_store, &handle);
+    if (!ship) return NULL;
+    if (!db_index_put(&ship_by_player, match_id, username, ship)) {
+        slot_map_remove(&ship_store, handle);
+        return NULL;
+    }
     ship->match_id = match_id;
     strncpy(ship->player_username, username, MAX_USERNAME - 1);
     ship->player_username[MAX_USERNAME - 1] = '\0';
@@ -387,19 +556,32 @@ Ship* create_ship(int match_id, const char *username) {
     ship->cannon_ammo = SHIP_DEFAULT_CANNON;
     ship->laser_count = SHIP_DEFAULT_LASER;
     ship->missile_count = SHIP_DEFAULT_MISSILE;
-    ship_count++;
+    match->ships[match->ship_count++] = handle;
     return ship;
 }
 
 void delete_ships_by_match(int match_id) {
-    for (int i = ship_count - 1; i >= 0; i--) {
-        if (ships[i].match_id == match_id) {
-            for (int j = i; j < ship_count - 1; j++) {
-                ships[j] = ships[j + 1];
-            }
-            ship_count--;
-        }
+    Match *match = db_index_get(&match_by_id, match_id, NULL);
+    if (!match) return;
+
+    for (int i = 0; i < match->ship_count; i++) {
+        Ship *ship = slot_map_get(&ship_store, match->ships[i]);
+        if (!ship) continue;
+        db_index_remove(&ship_by_player, ship->match_id, ship->player_username);
+        slot_map_remove(&ship_store, match->ships[i]);
+    }
+    match->ship_count = 0;
+}
+
+int get_match_ships(const Match *match, Ship **out, int max) {
+    if (!match || !out) return 0;
+
+    int count = 0;
+    for (int i = 0; i < match->ship_count && count < max; i++) {
+        Ship *ship = slot_map_get(&ship_store, match->ships[i]);
+        if (ship) out[count++] = ship;
     }
+    return count;
 }
 
 // /**
@@ -446,13 +628,10 @@ void delete_ships_by_match(int match_id) {
 // }
 
 int get_team_id_by_player_id(int player_id) {
-    // Resolve team by hashing username instead of storing numeric user_id
-    for (int i = 0; i < team_member_count; i++) {
-        if (hashFunc(team_members[i].username) == player_id) {
-            return team_members[i].team_id;
-        }
-    }
-    return -1; // Không tìm thấy
+    // player_id is User.user_id; members are stored by username
+    User *user = findUserById(app_context_get_user_table(), player_id);
+    if (!user) return -1; // Không tìm thấy
+    return find_team_id_by_username(user->username);
 }
 /**
  * Buy armor for ship (with mutex)
@@ -570,18 +749,36 @@ ResponseCode ship_buy_weapon(UserTable *user_table, Ship *ship, const char *user
  * MATCH OPERATIONS
  * ============================================================================ */
 Match* find_match_by_id(int match_id) {
-    for (int i = 0; i < match_count; i++) {
-        if (matches[i].match_id == match_id) {
-            return &matches[i];
-        }
+    return db_index_get(&match_by_id, match_id, NULL);
+}
+
+/*
+ * Drop finished or canceled matches that ended at least retain_sec ago
+ * (from memory only: matches.txt keeps them as history)
+ */
+static void reclaim_matches(time_t now, int retain_sec) {
+    // Backwards: a removal moves the last row into the hole
+    for (int i = (int)slot_map_count(&match_store) - 1; i >= 0; i--) {
+        Match *match = slot_map_at(&match_store, (size_t)i);
+        if (match->status != MATCH_FINISHED && match->status != MATCH_CANCELED) continue;
+        if (now - (match->started_at + match->duration) < retain_sec) continue;
+
+        delete_ships_by_match(match->match_id);
+        db_index_remove(&match_by_id, match->match_id, NULL);
+        slot_map_remove(&match_store, slot_map_handle_of(&match_store, match));
     }
-    return NULL;
 }
 
 Match* create_match(int team1_id, int team2_id) {
     if (team1_id <= 0 || team2_id <= 0) return NULL;
     if (team1_id == team2_id) return NULL;  // Can't match same team
-    if (match_count >= MAX_MATCHES) return NULL;
+
+    time_t now = time(NULL);
+    reclaim_matches(now, MATCH_RETAIN_SEC);
+    if (at_limit(&match_store, db_limits.max_matches)) {
+        reclaim_matches(now, 0);
+        if (at_limit(&match_store, db_limits.max_matches)) return NULL;
+    }
     
     // Verify both teams exist
     Team *team1 = find_team_by_id(team1_id);
@@ -592,7 +789,9 @@ Match* create_match(int team1_id, int team2_id) {
     if (find_running_match_by_team(team1_id) >= 0) return NULL;
     if (find_running_match_by_team(team2_id) >= 0) return NULL;
     
-    Match *match = &matches[match_count];
+    SlotHandle handle;
+    Match *match = slot_map_insert(&match_store, &handle);
+    if (!match) return NULL;
     match->match_id = next_match_id++;
     match->team1_id = team1_id;
     match->team2_id = team2_id;
@@ -600,22 +799,32 @@ Match* create_match(int team1_id, int team2_id) {
     match->duration = 0;
     match->status = MATCH_RUNNING;
     match->winner_team_id = -1;  // No winner yet
+    match->roster_count = 0;
+    match->ship_count = 0;
+
+    if (!db_index_put(&match_by_id, match->match_id, NULL, match) ||
+        !db_index_put(&match_by_team, team1_id, NULL, match) ||
+        !db_index_put(&match_by_team, team2_id, NULL, match)) {
+        db_index_remove(&match_by_id, match->match_id, NULL);
+        db_index_remove(&match_by_team, team1_id, NULL);
+        db_index_remove(&match_by_team, team2_id, NULL);
+        slot_map_remove(&match_store, handle);
+        return NULL;
+    }
     
-    match_count++;
-    
+    TeamMember *members[MAX_TEAM_MEMBERS];
     // Create a ship for each player in team1
-    for (int i = 0; i < team_member_count; i++) {
-        if (team_members[i].team_id == team1_id) {
-            create_ship(match->match_id, team_members[i].username);
-        }
+    int n = get_team_members(team1_id, members, MAX_TEAM_MEMBERS);
+    for (int i = 0; i < n; i++) {
+        create_ship(match->match_id, members[i]->username);
     }
     // Create a ship for each player in team2
-    for (int i = 0; i < team_member_count; i++) {
-        if (team_members[i].team_id == team2_id) {
-            create_ship(match->match_id, team_members[i].username);
-        }
+    n = get_team_members(team2_id, members, MAX_TEAM_MEMBERS);
+    for (int i = 0; i < n; i++) {
+        create_ship(match->match_id, members[i]->username);
     }
     
+    db_log_match(match);
     return match;  // Return the new match pointer
 }
 
@@ -626,37 +835,69 @@ void end_match(int match_id, int winner_team_id) {
     match->status = MATCH_FINISHED;
     match->winner_team_id = winner_team_id;
     match->duration = (int)(time(NULL) - match->started_at);
+    timer_cancel(&match->limit_timer);
+    timer_cancel(&match->chest_timer);
+    db_log_match(match);
+    if (db_index_get(&match_by_team, match->team1_id, NULL) == match) {
+        db_index_remove(&match_by_team, match->team1_id, NULL);
+    }
+    if (db_index_get(&match_by_team, match->team2_id, NULL) == match) {
+        db_index_remove(&match_by_team, match->team2_id, NULL);
+    }
     
     // Delete all ships for this match
     delete_ships_by_match(match_id);
 }
 
-bool can_end_match(int match_id, int *winner_team_id) {
-    Match *match = find_match_by_id(match_id);
-    if (!match) return false;
+bool match_roster_add(Match *match, int socket_fd) {
+    if (!match || socket_fd < 0) return false;
 
-    int team1_alive = 0;
-    int team2_alive = 0;
+    for (int i = 0; i < match->roster_count; i++) {
+        if (match->roster[i] == socket_fd) return true;
+    }
+    if (match->roster_count >= MATCH_ROSTER_SIZE) return false;
 
-    // Count alive ships per team for this match
-    for (int i = 0; i < ship_count; i++) {
-        if (ships[i].match_id != match_id) continue;
+    match->roster[match->roster_count++] = socket_fd;
+    return true;
+}
 
-        // Resolve team of this ship via team_members
-        int ship_team_id = -1;
-        for (int tm = 0; tm < team_member_count; tm++) {
-            if (strcmp(ships[i].player_username, team_members[tm].username) == 0) {
-                ship_team_id = team_members[tm].team_id;
-                break;
-            }
+void match_roster_remove(Match *match, int socket_fd) {
+    if (!match) return;
+
+    for (int i = 0; i < match->roster_count; i++) {
+        if (match->roster[i] == socket_fd) {
+            // Order does not matter: move the last entry into the hole
+            match->roster[i] = match->roster[--match->roster_count];
+            return;
         }
+    }
+}
+
+/* Count alive ships per team for this match */
+static void count_alive_ships(const Match *match, int *team1_alive, int *team2_alive) {
+    *team1_alive = 0;
+    *team2_alive = 0;
+    for (int i = 0; i < match->ship_count; i++) {
+        Ship *ship = slot_map_get(&ship_store, match->ships[i]);
+        if (!ship) continue;
+
+        // Resolve team of this ship via team_members
+        int ship_team_id = find_team_id_by_username(ship->player_username);
 
         if (ship_team_id == match->team1_id) {
-            if (ships[i].hp > 0) team1_alive++;
+            if (ship->hp > 0) (*team1_alive)++;
         } else if (ship_team_id == match->team2_id) {
-            if (ships[i].hp > 0) team2_alive++;
+            if (ship->hp > 0) (*team2_alive)++;
         }
     }
+}
+
+bool can_end_match(int match_id, int *winner_team_id) {
+    Match *match = find_match_by_id(match_id);
+    if (!match) return false;
+
+    int team1_alive, team2_alive;
+    count_alive_ships(match, &team1_alive, &team2_alive);
 
     // Determine if match can be ended and winner
     if (team1_alive == 0 && team2_alive == 0) {
@@ -676,6 +917,17 @@ bool can_end_match(int match_id, int *winner_team_id) {
     return false; // Both teams still have alive ships
 }
 
+int match_timeout_winner(int match_id) {
+    Match *match = find_match_by_id(match_id);
+    if (!match) return -1;
+
+    int team1_alive, team2_alive;
+    count_alive_ships(match, &team1_alive, &team2_alive);
+    if (team1_alive > team2_alive) return match->team1_id;
+    if (team2_alive > team1_alive) return match->team2_id;
+    return -1;
+}
+
 int get_match_result(int match_id) {
     Match *match = find_match_by_id(match_id);
     if (!match) return -2; // Not found
@@ -686,31 +938,83 @@ int get_match_result(int match_id) {
 
 
 // Hàm tạo bản ghi thách đấu
+/* Nobody answered in time: cancel, as if the sender had (CANCEL_CHALLENGE) */
+static void challenge_expired(Timer *timer) {
+    Challenge *ch = timer->arg;
+    if ((int)ch->status != CHALLENGE_PENDING) return;
+    printf("[INFO] Challenge %d expired\n", ch->challenge_id);
+    respond_challenge(ch, CHALLENGE_CANCELED);
+}
+
+/* Arm the expiry of a pending challenge created at created_at */
+static void challenge_arm_expiry(Challenge *ch, time_t now) {
+    timer_init(&ch->expiry_timer, challenge_expired, ch);
+    time_t left = ch->created_at + CHALLENGE_EXPIRE_SEC - now;
+    app_timer_arm(&ch->expiry_timer, left > 0 ? (unsigned long)left * 1000 : 0);
+}
+
+/*
+ * Drop challenges answered at least retain_sec ago, and pending ones
+ * whose teams are gone (nobody can answer them any more)
+ */
+static void reclaim_challenges(time_t now, int retain_sec) {
+    for (int i = (int)slot_map_count(&challenge_store) - 1; i >= 0; i--) {
+        Challenge *ch = slot_map_at(&challenge_store, (size_t)i);
+        if ((int)ch->status == CHALLENGE_PENDING) {
+            if (find_team_by_id(ch->sender_team_id) && find_team_by_id(ch->target_team_id)) continue;
+        } else if (now - ch->responded_at < retain_sec) {
+            continue;
+        }
+
+        timer_cancel(&ch->expiry_timer);
+        db_log_challenge_delete(ch->challenge_id);
+        db_index_remove(&challenge_by_id, ch->challenge_id, NULL);
+        slot_map_remove(&challenge_store, slot_map_handle_of(&challenge_store, ch));
+    }
+}
+
 int create_challenge_record(int sender_team_id, int target_team_id) {
-    if (challenge_count >= MAX_CHALLENGES) return -1;
+    time_t now = time(NULL);
+    reclaim_challenges(now, CHALLENGE_RETAIN_SEC);
+    if (at_limit(&challenge_store, db_limits.max_challenges)) {
+        reclaim_challenges(now, 0);
+        if (at_limit(&challenge_store, db_limits.max_challenges)) return -1;
+    }
     
-    Challenge *ch = &challenges[challenge_count];
-    ch->challenge_id = next_challenge_id++;
+    SlotHandle handle;
+    Challenge *ch = slot_map_insert(&challenge_store, &handle);
+    if (!ch) return -1;
+    ch->challenge_id = next_challenge_id;
+    if (!db_index_put(&challenge_by_id, ch->challenge_id, NULL, ch)) {
+        slot_map_remove(&challenge_store, handle);
+        return -1;
+    }
+    next_challenge_id++;
     ch->sender_team_id = sender_team_id;
     ch->target_team_id = target_team_id;
-    ch->created_at = time(NULL);
+    ch->created_at = now;
     ch->status = CHALLENGE_PENDING;
     ch->responded_at = 0;
+    challenge_arm_expiry(ch, now);
+    db_log_challenge(ch);
     
-    challenge_count++;
     return ch->challenge_id;
 }
 
+// Ghi nhận câu trả lời (accept/decline/cancel); row được thu hồi sau CHALLENGE_RETAIN_SEC
+void respond_challenge(Challenge *ch, ChallengeStatus status) {
+    if (!ch) return;
+    ch->status = (RequestStatus)status;
+    ch->responded_at = time(NULL);
+    timer_cancel(&ch->expiry_timer);
+    db_log_challenge(ch);
+}
+
 // Hàm tìm bản ghi thách đấu
 Challenge* find_challenge_by_id(int challenge_id) {
     if (challenge_id <= 0) return NULL;
     
-    for (int i = 0; i < challenge_count; i++) {
-        if (challenges[i].challenge_id == challenge_id) {
-            return &challenges[i];
-        }
-    }
-    return NULL;
+    return db_index_get(&challenge_by_id, challenge_id, NULL);
 }
 
 // Hàm tìm challenge PENDING mới nhất của team (target_team_id)
@@ -720,17 +1024,139 @@ int find_latest_pending_challenge_for_team(int target_team_id) {
     int latest_id = -1;
     time_t latest_time = 0;
     
-    for (int i = 0; i < challenge_count; i++) {
+    size_t count = slot_map_count(&challenge_store);
+    for (size_t i = 0; i < count; i++) {
+        Challenge *ch = slot_map_at(&challenge_store, i);
         // So sánh với STATUS_PENDING (0) từ enum RequestStatus
         // RequestStatus có STATUS_PENDING = 0
-        if (challenges[i].target_team_id == target_team_id &&
-            (int)challenges[i].status == 0) { // STATUS_PENDING = 0
-            if (challenges[i].created_at > latest_time) {
-                latest_time = challenges[i].created_at;
-                latest_id = challenges[i].challenge_id;
+        if (ch->target_team_id == target_team_id &&
+            (int)ch->status == 0) { // STATUS_PENDING = 0
+            // Cùng giây: giữ challenge tạo trước (id nhỏ hơn)
+            if (ch->created_at > latest_time ||
+                (ch->created_at == latest_time && ch->challenge_id < latest_id)) {
+                latest_time = ch->created_at;
+                latest_id = ch->challenge_id;
             }
         }
     }
     
     return latest_id;
 }
+
+/* ============================================================================
+ * RESTORE (rows loaded by db_store.c at startup; not logged again)
+ * ============================================================================ */
+static void raise_next_id(int *next_id, int used) {
+    if (used >= *next_id) *next_id = used + 1;
+}
+
+Team* restore_team(const Team *row) {
+    if (!row || row->team_id <= 0 || row->status != TEAM_ACTIVE) return NULL;
+    if (db_index_get(&team_by_id, row->team_id, NULL) || find_team_by_name(row->name)) return NULL;
+
+    SlotHandle handle;
+    Team *team = slot_map_insert(&team_store, &handle);
+    if (!team) return NULL;
+    *team = *row;
+    team->member_count = 0;
+
+    if (!db_index_put(&team_by_id, team->team_id, NULL, team) ||
+        !db_index_put(&team_by_name, 0, team->name, team)) {
+        db_index_remove(&team_by_id, team->team_id, NULL);
+        slot_map_remove(&team_store, handle);
+        return NULL;
+    }
+    raise_next_id(&next_team_id, team->team_id);
+    return team;
+}
+
+bool restore_team_member(const TeamMember *row) {
+    if (!row) return false;
+    Team *team = find_team_by_id(row->team_id);
+    if (!team || find_team_id_by_username(row->username) > 0) return false;
+    return insert_member(team, row->username, row->role, row->joined_at) != NULL;
+}
+
+bool restore_join_request(const JoinRequest *row) {
+    if (!row || !find_team_by_id(row->team_id)) return false;
+
+    SlotHandle handle;
+    JoinRequest *req = slot_map_insert(&join_request_store, &handle);
+    if (!req) return false;
+    *req = *row;
+    if (!db_index_put(&request_by_key, req->team_id, req->username, req)) {
+        slot_map_remove(&join_request_store, handle);
+        return false;
+    }
+    raise_next_id(&next_request_id, req->request_id);
+    return true;
+}
+
+bool restore_team_invite(const TeamInvite *row) {
+    if (!row || !find_team_by_id(row->team_id)) return false;
+
+    char key[16];
+    SlotHandle handle;
+    TeamInvite *invite = slot_map_insert(&invite_store, &handle);
+    if (!invite) return false;
+    *invite = *row;
+    if (!db_index_put(&invite_by_key, invite->team_id, invitee_key(invite->invitee_id, key), invite)) {
+        slot_map_remove(&invite_store, handle);
+        return false;
+    }
+    raise_next_id(&next_invite_id, invite->invite_id);
+    return true;
+}
+
+bool restore_challenge(const Challenge *row) {
+    if (!row || row->challenge_id <= 0 || find_challenge_by_id(row->challenge_id)) return false;
+
+    SlotHandle handle;
+    Challenge *ch = slot_map_insert(&challenge_store, &handle);
+    if (!ch) return false;
+    *ch = *row;
+    timer_init(&ch->expiry_timer, NULL, NULL);
+    if (!db_index_put(&challenge_by_id, ch->challenge_id, NULL, ch)) {
+        slot_map_remove(&challenge_store, handle);
+        return false;
+    }
+    raise_next_id(&next_challenge_id, ch->challenge_id);
+
+    // The time a challenge waited before the restart counts
+    if ((int)ch->status == CHALLENGE_PENDING) challenge_arm_expiry(ch, time(NULL));
+    return true;
+}
+
+bool restore_match(const Match *row) {
+    if (!row || row->match_id <= 0 || find_match_by_id(row->match_id)) return false;
+    raise_next_id(&next_match_id, row->match_id);
+
+    // Old history stays on disk only
+    time_t now = time(NULL);
+    bool ended = row->status == MATCH_FINISHED || row->status == MATCH_CANCELED;
+    if (ended && now - (row->started_at + row->duration) >= MATCH_RETAIN_SEC) return true;
+
+    SlotHandle handle;
+    Match *match = slot_map_insert(&match_store, &handle);
+    if (!match) return false;
+    *match = *row;
+    match->roster_count = 0;
+    match->ship_count = 0;
+    timer_init(&match->limit_timer, NULL, NULL);
+    timer_init(&match->chest_timer, NULL, NULL);
+    memset(&match->chest, 0, sizeof(match->chest));
+    match->ticker = NULL;
+    match->feed = NULL;
+    if (!db_index_put(&match_by_id, match->match_id, NULL, match)) {
+        slot_map_remove(&match_store, handle);
+        return false;
+    }
+
+    // Ships are memory-only, so a match cut off by a restart cannot go on
+    if (!ended) {
+        match->status = MATCH_CANCELED;
+        match->duration = (int)(now - match->started_at);
+        db_log_match(match);
+    }
+    return true;
+}
@@ -0,0 +1,111 @@
+/**
+ * ============================================================================
+ * DB INDEX MODULE - IMPLEMENTATION
+ * ============================================================================
+ */
+
+#include "db_index.h"
+#include "hash.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SLOT_EMPTY      0
+#define SLOT_REMOVED    1
+
+static uint64_t key_hash(int id, const char *name) {
+    uint64_t h = name ? (uint64_t)hashFunc(name) : 0;
+    // Fold the id in and finish with a multiply-xorshift so nearby ids spread out
+    h ^= (uint64_t)(unsigned int)id * 0x9e3779b97f4a7c15ULL;
+    h ^= h >> 32;
+    h *= 0xd6e8feb86659fd93ULL;
+    h ^= h >> 32;
+    return h > SLOT_REMOVED ? h : h + 2;
+}
+
+static bool key_equal(const DbIndexEntry *e, uint64_t hash, int id, const char *name) {
+    return e->hash == hash && e->id == id && strcmp(e->name, name ? name : "") == 0;
+}
+
+static DbIndexEntry* find_slot(const DbIndex *ix, uint64_t hash, int id, const char *name) {
+    if (ix->size == 0) return NULL;
+    size_t mask = ix->size - 1;
+    for (size_t i = (size_t)hash & mask, n = 0; n < ix->size; i = (i + 1) & mask, n++) {
+        DbIndexEntry *e = &ix->entries[i];
+        if (e->hash == SLOT_EMPTY) return NULL;
+        if (key_equal(e, hash, id, name)) return e;
+    }
+    return NULL;
+}
+
+// Rebuild into new_size slots, dropping tombstones
+static bool rebuild(DbIndex *ix, size_t new_size) {
+    DbIndexEntry *entries = calloc(new_size, sizeof(DbIndexEntry));
+    if (!entries) return false;
+
+    size_t mask = new_size - 1;
+    for (size_t i = 0; i < ix->size; i++) {
+        const DbIndexEntry *e = &ix->entries[i];
+        if (e->hash <= SLOT_REMOVED) continue;
+        size_t j = (size_t)e->hash & mask;
+        while (entries[j].hash != SLOT_EMPTY) j = (j + 1) & mask;
+        entries[j] = *e;
+    }
+    free(ix->entries);
+    ix->entries = entries;
+    ix->size = new_size;
+    ix->used = ix->live;
+    return true;
+}
+
+bool db_index_put(DbIndex *ix, int id, const char *name, void *value) {
+    if (!ix) return false;
+    uint64_t hash = key_hash(id, name);
+
+    DbIndexEntry *e = find_slot(ix, hash, id, name);
+    if (e) {
+        e->value = value;
+        return true;
+    }
+
+    if ((ix->used + 1) * 10 > ix->size * 7) {
+        size_t new_size = ix->size ? ix->size : 16;
+        // Grow only if live entries need it; otherwise just sweep tombstones
+        while ((ix->live + 1) * 10 > new_size * 5) new_size *= 2;
+        if (!rebuild(ix, new_size)) return false;
+    }
+
+    size_t mask = ix->size - 1;
+    size_t i = (size_t)hash & mask;
+    while (ix->entries[i].hash > SLOT_REMOVED) i = (i + 1) & mask;
+    e = &ix->entries[i];
+    if (e->hash == SLOT_EMPTY) ix->used++;
+    e->hash = hash;
+    e->id = id;
+    strncpy(e->name, name ? name : "", MAX_USERNAME - 1);
+    e->name[MAX_USERNAME - 1] = '\0';
+    e->value = value;
+    ix->live++;
+    return true;
+}
+
+void* db_index_get(const DbIndex *ix, int id, const char *name) {
+    if (!ix) return NULL;
+    DbIndexEntry *e = find_slot(ix, key_hash(id, name), id, name);
+    return e ? e->value : NULL;
+}
+
+void db_index_remove(DbIndex *ix, int id, const char *name) {
+    if (!ix) return;
+    DbIndexEntry *e = find_slot(ix, key_hash(id, name), id, name);
+    if (!e) return;
+    e->hash = SLOT_REMOVED;
+    e->value = NULL;
+    ix->live--;
+}
+
+void db_index_clear(DbIndex *ix) {
+    if (!ix) return;
+    free(ix->entries);
+    ix->entries = NULL;
+    ix->size = ix->used = ix->live = 0;
+}
@@ -0,0 +1,80 @@
+/**
+ * ============================================================================
+ * DB INDEX MODULE
+ * ============================================================================
+ *
+ * Hash indexes over the in-memory tables of db.c.
+ *
+ * A DbIndex maps a key made of an integer part and a name part (either may
+ * be unused: pass 0 / NULL) to a pointer into one of the tables:
+ *
+ *   team_id            -> Team*         (id, NULL)
+ *   team name          -> Team*         (0, name)
+ *   (match, username)  -> Ship*         (match_id, username)
+ *   (team, username)   -> JoinRequest*  (team_id, username)
+ *   (team, invitee)    -> TeamInvite*   (team_id, invitee_id in decimal)
+ *
+ * Keys are copied into the index; values are not, so a value must stay
+ * at the same address for as long as it is indexed.
+ *
+ * Open addressing with linear probing. Removed entries leave a tombstone
+ * that later inserts reuse; the table is rebuilt when live entries plus
+ * tombstones pass 70% of the slots.
+ * ============================================================================
+ */
+
+#ifndef DB_INDEX_H
+#define DB_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "users.h"
+
+/**
+ * @struct DbIndexEntry
+ * @brief One slot of a DbIndex
+ */
+typedef struct {
+    uint64_t    hash;               /**< 0 = empty, 1 = removed, else hash of the key */
+    int         id;                 /**< Integer part of the key */
+    char        name[MAX_USERNAME]; /**< Name part of the key ("" if unused) */
+    void       *value;
+} DbIndexEntry;
+
+/**
+ * @struct DbIndex
+ * @brief Hash index; zero-initialize (DB_INDEX_INIT) before use
+ */
+typedef struct {
+    DbIndexEntry *entries;
+    size_t        size;     /**< Number of slots (power of two, or 0) */
+    size_t        used;     /**< Live entries + tombstones */
+    size_t        live;     /**< Live entries */
+} DbIndex;
+
+#define DB_INDEX_INIT { NULL, 0, 0, 0 }
+
+/**
+ * @brief Insert a key or replace its value
+ * @return false if out of memory
+ */
+bool db_index_put(DbIndex *ix, int id, const char *name, void *value);
+
+/**
+ * @brief Look a key up
+ * @return The value, or NULL if the key is absent
+ */
+void* db_index_get(const DbIndex *ix, int id, const char *name);
+
+/**
+ * @brief Remove a key (no-op if absent)
+ */
+void db_index_remove(DbIndex *ix, int id, const char *name);
+
+/**
+ * @brief Remove every key and free the slots
+ */
+void db_index_clear(DbIndex *ix);
+
+#endif // DB_INDEX_H
@@ -18,6 +18,7 @@
  *   - hash.h/c          : Hash function (djb2)
  *   - db_schema.h       : Struct definitions for other tables (this file)
  *   - db.c              : Operations for teams, matches, ships, etc.
+ *   - db_store.h/c      : Change logs of those tables (FILE_* below)
  * ============================================================================
  */
 
@@ -28,17 +29,32 @@
 #include <stdbool.h>
 #include "users.h"
 #include "config.h"    
+#include "slot_map.h"
+#include "timer_wheel.h"
 
 /* ============================================================================
  * CONSTANTS & LIMITS
  * ============================================================================ */
-#define MAX_TEAMS           50
 #define MAX_TEAM_MEMBERS    3
 #define MAX_JOIN_REQUESTS   100
 #define MAX_TEAM_INVITES    100
-#define MAX_CHALLENGES      50
-#define MAX_MATCHES         50
-#define MAX_SHIPS           300  
+#define MATCH_ROSTER_SIZE   (2 * MAX_TEAM_MEMBERS)
+
+/*
+ * Teams, matches and challenges are stored in growable slot maps, so
+ * these are only upper bounds (server -T/-M/-C; 0 = unlimited).
+ */
+#define DEFAULT_MAX_TEAMS       1000
+#define DEFAULT_MAX_MATCHES     1000
+#define DEFAULT_MAX_CHALLENGES  1000
+
+/*
+ * Finished matches stay readable (MATCH_INFO, results) and answered
+ * challenges stay answerable with "already responded" for this long,
+ * then their rows are reclaimed. At the limit they go sooner.
+ */
+#define MATCH_RETAIN_SEC        300
+#define CHALLENGE_RETAIN_SEC    300
 
 #define TEAM_NAME_LEN       32
 
@@ -169,6 +185,9 @@ typedef struct {
     int         member_limit;                   // Default 3
     TeamStatus  status;                         // active | deleted
     time_t      created_at;
+    /* Runtime only: member rows (TeamMember), in join order */
+    SlotHandle  members[MAX_TEAM_MEMBERS];
+    int         member_count;
 } Team;
 
 /* ============================================================================
@@ -179,7 +198,7 @@ typedef struct {
  * ============================================================================ */
 typedef struct {
     int         team_id;                        // FK -> TEAMS.team_id
-    // int         user_id;                        // FK -> USERS.user_id (hash of username)
+    // int         user_id;                        // FK -> USERS.user_id
     char        username[MAX_USERNAME];         // Username for easy lookup
     TeamRole    role;                           // creator | member
     time_t      joined_at;
@@ -224,6 +243,8 @@ typedef struct {
     time_t          created_at;
     RequestStatus   status;                     // pending | accepted | declined | canceled
     time_t          responded_at;
+    /* Runtime only: cancels the challenge if still pending after CHALLENGE_EXPIRE_SEC */
+    Timer           expiry_timer;
 } Challenge;
 
 /* ============================================================================
@@ -239,6 +260,21 @@ typedef struct {
     int             duration;                   // In seconds
     MatchStatus     status;                     // pending | running | finished | canceled
     int             winner_team_id;             // Nullable, FK -> TEAMS.team_id, -1 = no winner
+    /* Runtime only: sockets of the online participants, used for broadcasts */
+    int             roster[MATCH_ROSTER_SIZE];
+    int             roster_count;
+    /* Runtime only: ship rows (Ship) of this match */
+    SlotHandle      ships[MATCH_ROSTER_SIZE];
+    int             ship_count;
+    /* Runtime only: time limit and periodic chest drops (armed by session.c) */
+    Timer           limit_timer;
+    Timer           chest_timer;
+    /* Runtime only: the last chest dropped (chest_id 0 = none yet) */
+    TreasureChest   chest;
+    /* Runtime only: tick engine state (match_engine.h), NULL without one */
+    struct MatchTicker *ticker;
+    /* Runtime only: MATCH_SUBSCRIBE state (match_feed.h), NULL until someone subscribes */
+    struct MatchFeed *feed;
 } Match;
 
 /* ============================================================================
@@ -283,10 +319,8 @@ typedef struct {
 } RepairResult;
 
 
-//Fire result
+//Fire result (the replies name both ships by username)
 typedef struct {
-    int attacker_id;
-    int target_id;
     int damage_dealt;
     int target_remaining_hp;
     int target_remaining_armor;
@@ -339,18 +373,59 @@ typedef struct {
 #define FILE_CHALLENGES     "challenges.txt"
 #define FILE_MATCHES        "matches.txt"
 
+/**
+ * @struct DbLimits
+ * @brief Row limits applied by db.c (0 or less = unlimited)
+ */
+typedef struct {
+    int max_teams;
+    int max_matches;        /**< Running matches plus retained finished ones */
+    int max_challenges;
+} DbLimits;
+
+#define DB_LIMITS_DEFAULT { DEFAULT_MAX_TEAMS, DEFAULT_MAX_MATCHES, DEFAULT_MAX_CHALLENGES }
+
 /* ============================================================================
  * FUNCTION DECLARATIONS (implemented in db.c)
  * 
  * NOTE: User operations are in users.h/c
  * ============================================================================ */
 
+/* Set before the server starts */
+void db_set_limits(const DbLimits *limits);
+
 /* Team operations */
 Team* find_team_by_id(int team_id);
 Team* find_team_by_name(const char *name);
 Team* create_team(const char *name, const char *creator_username);
 int get_team_member_count(int team_id);
 bool delete_team(int team_id);
+/* Iterate active teams: get_team_at(0 .. get_team_count() - 1) */
+int get_team_count(void);
+Team* get_team_at(int index);
+
+/* Team membership (keeps the username -> team index in sync) */
+TeamMember* add_team_member(int team_id, const char *username, TeamRole role);
+bool remove_team_member(int team_id, const char *username);
+/* Copies up to max member pointers, in join order; returns how many */
+int get_team_members(int team_id, TeamMember **out, int max);
+/* Make a current member the team's creator (captain) */
+bool set_team_captain(int team_id, const char *username);
+
+/* Join requests */
+JoinRequest* create_join_request(int team_id, const char *username);
+JoinRequest* find_join_request(int team_id, const char *username);
+void delete_join_request(JoinRequest *req);
+void clear_user_requests(const char *username);
+int get_join_request_count(void);
+JoinRequest* get_join_request_at(int index);
+
+/* Team invites (by user id) */
+TeamInvite* create_team_invite(int team_id, int inviter_id, int invitee_id);
+TeamInvite* find_team_invite(int team_id, int invitee_id);
+void delete_team_invite(TeamInvite *invite);
+int get_team_invite_count(void);
+TeamInvite* get_team_invite_at(int index);
 
 /* Lookup helpers (username -> team -> match) */
 int find_team_id_by_username(const char *username);
@@ -362,6 +437,10 @@ Match* find_match_by_id(int match_id);
 Match* create_match(int team1_id, int team2_id);
 void end_match(int match_id, int winner_team_id);
 
+/* Match roster (online participants, by socket fd) */
+bool match_roster_add(Match *match, int socket_fd);
+void match_roster_remove(Match *match, int socket_fd);
+
 /* Match evaluation helpers */
 /*
  * Determines if a match can be ended based on ship states.
@@ -369,6 +448,11 @@ void end_match(int match_id, int winner_team_id);
  * Returns true if the match can be ended, false otherwise.
  */
 bool can_end_match(int match_id, int *winner_team_id);
+/**
+ * Winner of a match stopped by its time limit: the team with more ships
+ * still afloat, or -1 (draw) when both have as many.
+ */
+int match_timeout_winner(int match_id);
 /**
  * Retrieves the result of a match by its ID.
  * Returns the winning team ID, or -1 for a draw.
@@ -384,6 +468,8 @@ int get_match_result(int match_id);
 Ship* find_ship(int match_id, const char *username);
 Ship* create_ship(int match_id, const char *username);
 void delete_ships_by_match(int match_id);
+/* Copies up to max ship pointers of the match, in creation order; returns how many */
+int get_match_ships(const Match *match, Ship **out, int max);
 // int ship_take_damage(Ship *s, int damage);
 ResponseCode ship_buy_armor(UserTable *user_table, Ship *ship, const char *username, ArmorType type);
 ResponseCode ship_buy_weapon(UserTable *user_table, Ship *ship, const char *username, WeaponType type);
@@ -395,13 +481,27 @@ int get_armor_value(ArmorType type);
 /* Challenge operations */
 Challenge* find_challenge_by_id(int challenge_id);
 int create_challenge_record(int sender_team_id, int target_team_id);
-Challenge* find_challenge_by_id(int challenge_id);
-int create_challenge_record(int sender_team_id, int target_team_id);
+void respond_challenge(Challenge *ch, ChallengeStatus status);
 int find_latest_pending_challenge_for_team(int target_team_id);
 
 // Hàm hỗ trợ đội/nhóm
 int get_team_id_by_player_id(int player_id);
 
+/* Auto-increment ids (raised by db_store.c so ids are never reused) */
+extern int next_team_id;
+extern int next_request_id;
+extern int next_invite_id;
+extern int next_challenge_id;
+extern int next_match_id;
+
+/* Restore rows loaded by db_store.c at startup (not logged again) */
+Team* restore_team(const Team *row);
+bool restore_team_member(const TeamMember *row);
+bool restore_join_request(const JoinRequest *row);
+bool restore_team_invite(const TeamInvite *row);
+bool restore_challenge(const Challenge *row);
+bool restore_match(const Match *row);
+
 // Hàm Game/Vũ khí
 WeaponTemplate* get_weapon_template(int weapon_id);
 
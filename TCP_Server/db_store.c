@@ -0,0 +1,560 @@
+/**
+ * ============================================================================
+ * DB STORE MODULE - IMPLEMENTATION
+ * ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#include "db_store.h"
+#include "db_index.h"
+#include "users_io.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+typedef enum {
+    TABLE_TEAMS,
+    TABLE_MEMBERS,
+    TABLE_JOIN_REQUESTS,
+    TABLE_INVITES,
+    TABLE_CHALLENGES,
+    TABLE_MATCHES,
+    TABLE_COUNT
+} StoreTable;
+
+/* Load order: members, requests and invites need their team */
+static const char *const table_files[TABLE_COUNT] = {
+    FILE_TEAMS, FILE_TEAM_MEMBERS, FILE_JOIN_REQUESTS,
+    FILE_TEAM_INVITES, FILE_CHALLENGES, FILE_MATCHES
+};
+
+/* Id counter of each table (members are keyed by username) */
+static int *const table_next_ids[TABLE_COUNT] = {
+    &next_team_id, NULL, &next_request_id, &next_invite_id, &next_challenge_id, &next_match_id
+};
+
+typedef struct {
+    char   *data;
+    size_t  len;
+    size_t  cap;
+} Batch;
+
+static pthread_mutex_t store_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t store_cond = PTHREAD_COND_INITIALIZER;
+
+// Guarded by store_lock
+static Batch pending[TABLE_COUNT];
+static bool store_stop = false;
+static bool store_running = false;
+
+// Writer thread only (after db_store_open())
+static char table_paths[TABLE_COUNT][512];
+static int table_fds[TABLE_COUNT] = { -1, -1, -1, -1, -1, -1 };
+static size_t appended[TABLE_COUNT];      /**< Records written since the last fold */
+static size_t folded_rows[TABLE_COUNT];   /**< Rows in the file after the last fold */
+static pthread_t store_thread;
+
+/* ============================================================================
+ * FOLDING
+ * ============================================================================ */
+
+/* Latest P line per key, in order of first insert */
+typedef struct {
+    char  **lines;      /**< NULL once the key is deleted */
+    size_t  count;
+    size_t  cap;
+    size_t  rows;       /**< Non-NULL lines */
+    DbIndex keys;       /**< key -> line number + 1 */
+    long    max_id;     /**< Highest numeric key or N record seen */
+} Fold;
+
+static void fold_free(Fold *f) {
+    for (size_t i = 0; i < f->count; i++) free(f->lines[i]);
+    free(f->lines);
+    db_index_clear(&f->keys);
+    memset(f, 0, sizeof(*f));
+}
+
+static bool fold_put(Fold *f, const char *key, const char *line) {
+    char *copy = strdup(line);
+    if (!copy) return false;
+
+    uintptr_t ref = (uintptr_t)db_index_get(&f->keys, 0, key);
+    if (ref) {
+        free(f->lines[ref - 1]);
+        f->lines[ref - 1] = copy;
+        return true;
+    }
+
+    if (f->count == f->cap) {
+        size_t cap = f->cap ? f->cap * 2 : 64;
+        char **grown = realloc(f->lines, cap * sizeof(char*));
+        if (!grown) {
+            free(copy);
+            return false;
+        }
+        f->lines = grown;
+        f->cap = cap;
+    }
+    if (!db_index_put(&f->keys, 0, key, (void *)(uintptr_t)(f->count + 1))) {
+        free(copy);
+        return false;
+    }
+    f->lines[f->count++] = copy;
+    f->rows++;
+    return true;
+}
+
+static void fold_delete(Fold *f, const char *key) {
+    uintptr_t ref = (uintptr_t)db_index_get(&f->keys, 0, key);
+    if (!ref) return;
+    free(f->lines[ref - 1]);
+    f->lines[ref - 1] = NULL;
+    f->rows--;
+    db_index_remove(&f->keys, 0, key);
+}
+
+// Read a log into f; stops at a torn or unknown line. Returns -1 on I/O or memory error.
+static int fold_file(const char *path, Fold *f) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return errno == ENOENT ? 0 : -1;
+
+    char line[512];
+    int rc = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        char *nl = strchr(line, '\n');
+        if (!nl) break;     // Torn write at the tail
+        *nl = '\0';
+
+        char op;
+        char key[MAX_USERNAME];
+        if (sscanf(line, "%c %63s", &op, key) != 2) break;
+
+        char *end;
+        long id = strtol(key, &end, 10);
+        if (*end == '\0' && id > f->max_id) f->max_id = id;
+
+        if (op == 'P') {
+            if (!fold_put(f, key, line)) {
+                rc = -1;
+                break;
+            }
+        } else if (op == 'D') {
+            fold_delete(f, key);
+        } else if (op != 'N') {
+            break;
+        }
+    }
+    fclose(fp);
+    return rc;
+}
+
+static char* fold_format(const Fold *f, size_t *len_out) {
+    size_t len = 32;
+    for (size_t i = 0; i < f->count; i++) {
+        if (f->lines[i]) len += strlen(f->lines[i]) + 1;
+    }
+
+    char *data = malloc(len);
+    if (!data) return NULL;
+
+    size_t off = 0;
+    if (f->max_id > 0) off += (size_t)snprintf(data, len, "N %ld\n", f->max_id);
+    for (size_t i = 0; i < f->count; i++) {
+        if (!f->lines[i]) continue;
+        size_t n = strlen(f->lines[i]);
+        memcpy(data + off, f->lines[i], n);
+        data[off + n] = '\n';
+        off += n + 1;
+    }
+    *len_out = off;
+    return data;
+}
+
+// Fold a table's file into a new one (writer thread, or startup)
+static int compact_table(StoreTable t) {
+    Fold f = {0};
+    size_t len;
+
+    if (fold_file(table_paths[t], &f) != 0) {
+        fold_free(&f);
+        return -1;
+    }
+    if (!table_next_ids[t]) f.max_id = 0;
+    char *data = fold_format(&f, &len);
+    size_t rows = f.rows;
+    fold_free(&f);
+    if (!data) return -1;
+
+    UserIOStatus status = writeUsersFile(table_paths[t], data, len);
+    free(data);
+    if (status != USER_IO_OK) return -1;
+
+    // The old descriptor still points at the replaced file
+    if (table_fds[t] >= 0) close(table_fds[t]);
+    table_fds[t] = open(table_paths[t], O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (table_fds[t] < 0) return -1;
+
+    appended[t] = 0;
+    folded_rows[t] = rows;
+    return 0;
+}
+
+/* ============================================================================
+ * APPEND (callers hold the world lock)
+ * ============================================================================ */
+
+static void store_append(StoreTable t, const char *fmt, ...) {
+    char line[512];
+    va_list ap;
+
+    va_start(ap, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (len < 0 || (size_t)len >= sizeof(line)) {
+        fprintf(stderr, "[ERROR] %s record too long, dropped\n", table_files[t]);
+        return;
+    }
+
+    pthread_mutex_lock(&store_lock);
+    if (!store_running) {
+        pthread_mutex_unlock(&store_lock);
+        return;
+    }
+
+    Batch *b = &pending[t];
+    if (b->len + (size_t)len > b->cap) {
+        size_t cap = b->cap ? b->cap * 2 : 4096;
+        while (cap < b->len + (size_t)len) cap *= 2;
+        char *grown = realloc(b->data, cap);
+        if (!grown) {
+            fprintf(stderr, "[ERROR] Out of memory, %s record dropped\n", table_files[t]);
+            pthread_mutex_unlock(&store_lock);
+            return;
+        }
+        b->data = grown;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, line, (size_t)len);
+    b->len += (size_t)len;
+
+    pthread_cond_signal(&store_cond);
+    pthread_mutex_unlock(&store_lock);
+}
+
+void db_log_team(const Team *team) {
+    // Name last: it is the only field that may contain spaces
+    store_append(TABLE_TEAMS, "P %d %s %d %d %ld %s\n",
+                 team->team_id, team->creator_username, team->member_limit,
+                 (int)team->status, (long)team->created_at, team->name);
+}
+
+void db_log_team_delete(int team_id) {
+    store_append(TABLE_TEAMS, "D %d\n", team_id);
+}
+
+void db_log_member(const TeamMember *member) {
+    store_append(TABLE_MEMBERS, "P %s %d %d %ld\n",
+                 member->username, member->team_id, (int)member->role, (long)member->joined_at);
+}
+
+void db_log_member_delete(const char *username) {
+    store_append(TABLE_MEMBERS, "D %s\n", username);
+}
+
+void db_log_join_request(const JoinRequest *req) {
+    store_append(TABLE_JOIN_REQUESTS, "P %d %d %s %ld %d\n",
+                 req->request_id, req->team_id, req->username,
+                 (long)req->requested_at, (int)req->status);
+}
+
+void db_log_join_request_delete(int request_id) {
+    store_append(TABLE_JOIN_REQUESTS, "D %d\n", request_id);
+}
+
+void db_log_invite(const TeamInvite *invite) {
+    store_append(TABLE_INVITES, "P %d %d %d %d %ld %d\n",
+                 invite->invite_id, invite->team_id, invite->inviter_id,
+                 invite->invitee_id, (long)invite->invited_at, (int)invite->status);
+}
+
+void db_log_invite_delete(int invite_id) {
+    store_append(TABLE_INVITES, "D %d\n", invite_id);
+}
+
+void db_log_challenge(const Challenge *ch) {
+    store_append(TABLE_CHALLENGES, "P %d %d %d %ld %d %ld\n",
+                 ch->challenge_id, ch->sender_team_id, ch->target_team_id,
+                 (long)ch->created_at, (int)ch->status, (long)ch->responded_at);
+}
+
+void db_log_challenge_delete(int challenge_id) {
+    store_append(TABLE_CHALLENGES, "D %d\n", challenge_id);
+}
+
+void db_log_match(const Match *match) {
+    store_append(TABLE_MATCHES, "P %d %d %d %ld %d %d %d\n",
+                 match->match_id, match->team1_id, match->team2_id,
+                 (long)match->started_at, match->duration,
+                 (int)match->status, match->winner_team_id);
+}
+
+/* ============================================================================
+ * WRITER THREAD
+ * ============================================================================ */
+
+static int write_all(int fd, const char *data, size_t len) {
+    size_t off = 0;
+    while (off < len) {
+        ssize_t n = write(fd, data + off, len - off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        off += (size_t)n;
+    }
+    return 0;
+}
+
+static size_t count_lines(const char *data, size_t len) {
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] == '\n') n++;
+    }
+    return n;
+}
+
+static void *store_main(void *arg) {
+    (void)arg;
+    Batch batch[TABLE_COUNT];
+    memset(batch, 0, sizeof(batch));
+
+    for (;;) {
+        bool stopping;
+        bool any = false;
+
+        pthread_mutex_lock(&store_lock);
+        for (int t = 0; t < TABLE_COUNT; t++) any = any || pending[t].len > 0;
+        if (!any && !store_stop) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += 1;
+            pthread_cond_timedwait(&store_cond, &store_lock, &deadline);
+        }
+        // Swap buffers so appenders keep going while we write
+        any = false;
+        for (int t = 0; t < TABLE_COUNT; t++) {
+            Batch tmp = batch[t];
+            batch[t] = pending[t];
+            pending[t] = tmp;
+            pending[t].len = 0;
+            any = any || batch[t].len > 0;
+        }
+        stopping = store_stop;
+        pthread_mutex_unlock(&store_lock);
+
+        for (int t = 0; t < TABLE_COUNT; t++) {
+            if (batch[t].len == 0) continue;
+            if (write_all(table_fds[t], batch[t].data, batch[t].len) != 0 ||
+                fdatasync(table_fds[t]) != 0) {
+                fprintf(stderr, "[ERROR] %s: write failed: %s\n", table_paths[t], strerror(errno));
+                continue;
+            }
+            appended[t] += count_lines(batch[t].data, batch[t].len);
+        }
+
+        bool final = stopping && !any;
+        for (int t = 0; t < TABLE_COUNT; t++) {
+            bool due = appended[t] >= DB_COMPACT_MIN_RECORDS && appended[t] >= folded_rows[t];
+            if ((due || (final && appended[t] > 0)) && compact_table((StoreTable)t) != 0) {
+                fprintf(stderr, "[ERROR] %s: compaction failed\n", table_paths[t]);
+            }
+        }
+
+        if (final) break;
+    }
+
+    for (int t = 0; t < TABLE_COUNT; t++) free(batch[t].data);
+    return NULL;
+}
+
+/* ============================================================================
+ * LOADING & LIFECYCLE
+ * ============================================================================ */
+
+static void raise_id(int *next_id, long used) {
+    if (used >= *next_id) *next_id = (int)used + 1;
+}
+
+// Parse one folded P line and give the row to db.c; false if malformed
+static bool restore_line(StoreTable t, const char *line) {
+    int n = 0;
+    switch (t) {
+    case TABLE_TEAMS: {
+        Team row = {0};
+        int status;
+        long created_at;
+        if (sscanf(line, "P %d %63s %d %d %ld %n", &row.team_id, row.creator_username,
+                   &row.member_limit, &status, &created_at, &n) != 5 || line[n] == '\0') return false;
+        snprintf(row.name, TEAM_NAME_LEN, "%s", line + n);
+        row.status = (TeamStatus)status;
+        row.created_at = (time_t)created_at;
+        return restore_team(&row) != NULL;
+    }
+    case TABLE_MEMBERS: {
+        TeamMember row = {0};
+        int role;
+        long joined_at;
+        if (sscanf(line, "P %63s %d %d %ld", row.username, &row.team_id, &role, &joined_at) != 4) return false;
+        row.role = (TeamRole)role;
+        row.joined_at = (time_t)joined_at;
+        return restore_team_member(&row);
+    }
+    case TABLE_JOIN_REQUESTS: {
+        JoinRequest row = {0};
+        int status;
+        long requested_at;
+        if (sscanf(line, "P %d %d %63s %ld %d", &row.request_id, &row.team_id, row.username,
+                   &requested_at, &status) != 5) return false;
+        row.requested_at = (time_t)requested_at;
+        row.status = (RequestStatus)status;
+        return restore_join_request(&row);
+    }
+    case TABLE_INVITES: {
+        TeamInvite row = {0};
+        int status;
+        long invited_at;
+        if (sscanf(line, "P %d %d %d %d %ld %d", &row.invite_id, &row.team_id, &row.inviter_id,
+                   &row.invitee_id, &invited_at, &status) != 6) return false;
+        row.invited_at = (time_t)invited_at;
+        row.status = (RequestStatus)status;
+        return restore_team_invite(&row);
+    }
+    case TABLE_CHALLENGES: {
+        Challenge row = {0};
+        int status;
+        long created_at, responded_at;
+        if (sscanf(line, "P %d %d %d %ld %d %ld", &row.challenge_id, &row.sender_team_id,
+                   &row.target_team_id, &created_at, &status, &responded_at) != 6) return false;
+        row.created_at = (time_t)created_at;
+        row.status = (RequestStatus)status;
+        row.responded_at = (time_t)responded_at;
+        return restore_challenge(&row);
+    }
+    case TABLE_MATCHES: {
+        Match row = {0};
+        int status;
+        long started_at;
+        if (sscanf(line, "P %d %d %d %ld %d %d %d", &row.match_id, &row.team1_id, &row.team2_id,
+                   &started_at, &row.duration, &status, &row.winner_team_id) != 7) return false;
+        row.started_at = (time_t)started_at;
+        row.status = (MatchStatus)status;
+        return restore_match(&row);
+    }
+    default:
+        return false;
+    }
+}
+
+int db_store_open(const char *dir) {
+    for (int t = 0; t < TABLE_COUNT; t++) {
+        if (snprintf(table_paths[t], sizeof(table_paths[t]), "%s%s", dir, table_files[t])
+                >= (int)sizeof(table_paths[t])) {
+            return -1;
+        }
+    }
+
+    // Rows restored below may log fixes (e.g. interrupted matches); keep them
+    pthread_mutex_lock(&store_lock);
+    store_stop = false;
+    store_running = true;
+    pthread_mutex_unlock(&store_lock);
+
+    for (int t = 0; t < TABLE_COUNT; t++) {
+        Fold f = {0};
+        if (fold_file(table_paths[t], &f) != 0) {
+            fprintf(stderr, "[ERROR] Failed to read %s\n", table_paths[t]);
+            fold_free(&f);
+            goto fail;
+        }
+
+        int loaded = 0, skipped = 0;
+        for (size_t i = 0; i < f.count; i++) {
+            if (!f.lines[i]) continue;
+            if (restore_line((StoreTable)t, f.lines[i])) loaded++;
+            else skipped++;
+        }
+        if (table_next_ids[t]) raise_id(table_next_ids[t], f.max_id);
+        fold_free(&f);
+
+        // Start from a folded file; this also cuts a torn tail
+        if (compact_table((StoreTable)t) != 0) {
+            fprintf(stderr, "[ERROR] Failed to rewrite %s\n", table_paths[t]);
+            goto fail;
+        }
+        if (loaded > 0 || skipped > 0) {
+            printf("[INFO] %s: loaded %d row(s), skipped %d\n", table_files[t], loaded, skipped);
+        }
+    }
+
+    // Keep SIGINT/SIGTERM on the main thread
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    int rc = pthread_create(&store_thread, NULL, store_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (rc != 0) {
+        fprintf(stderr, "[ERROR] Failed to start db store thread\n");
+        goto fail;
+    }
+    return 0;
+
+fail:
+    pthread_mutex_lock(&store_lock);
+    store_running = false;
+    for (int t = 0; t < TABLE_COUNT; t++) {
+        free(pending[t].data);
+        memset(&pending[t], 0, sizeof(pending[t]));
+    }
+    pthread_mutex_unlock(&store_lock);
+    for (int t = 0; t < TABLE_COUNT; t++) {
+        if (table_fds[t] >= 0) close(table_fds[t]);
+        table_fds[t] = -1;
+    }
+    return -1;
+}
+
+void db_store_close(void) {
+    pthread_mutex_lock(&store_lock);
+    if (!store_running) {
+        pthread_mutex_unlock(&store_lock);
+        return;
+    }
+    store_stop = true;
+    pthread_cond_signal(&store_cond);
+    pthread_mutex_unlock(&store_lock);
+
+    pthread_join(store_thread, NULL);
+
+    pthread_mutex_lock(&store_lock);
+    store_running = false;
+    for (int t = 0; t < TABLE_COUNT; t++) {
+        free(pending[t].data);
+        memset(&pending[t], 0, sizeof(pending[t]));
+    }
+    pthread_mutex_unlock(&store_lock);
+
+    for (int t = 0; t < TABLE_COUNT; t++) {
+        if (table_fds[t] >= 0) close(table_fds[t]);
+        table_fds[t] = -1;
+    }
+}
@@ -0,0 +1,69 @@
+/**
+ * ============================================================================
+ * DB STORE MODULE
+ * ============================================================================
+ *
+ * Persistence for the db.c tables. Each table has one append-only change
+ * log in DB_DIR, named by the FILE_* constants in db_schema.h, with one
+ * line per change:
+ *
+ *   P <key> <fields...>     row inserted or updated (whole row)
+ *   D <key>                 row deleted
+ *   N <id>                  ids below this were used (written by compaction)
+ *
+ * The key is the row id, or the username for team_members.txt.
+ *
+ * db.c calls db_log_*() after each change with the world lock held; that
+ * only formats the line into a memory buffer. A writer thread appends
+ * each table's batch with one write() + fdatasync(), so reactors never
+ * wait for the disk (a reply may go out a few milliseconds before its
+ * change is durable, as with the user journal).
+ *
+ * Compaction folds a log: the last P per key survives, a D drops the
+ * key. The writer compacts a table once DB_COMPACT_MIN_RECORDS records,
+ * and at least as many as the table had rows, were appended since the
+ * last fold. It is the only thread touching the files, so new records
+ * just wait in memory meanwhile. db_store_close() compacts every table
+ * that changed.
+ *
+ * db_store_open() folds each log, hands the rows to db.c (restore_*()),
+ * and rewrites the folded file, which also drops a torn last line.
+ * Finished matches are kept in matches.txt as history even after db.c
+ * reclaims them from memory.
+ * ============================================================================
+ */
+
+#ifndef DB_STORE_H
+#define DB_STORE_H
+
+#include "db_schema.h"
+
+/**
+ * @brief Load every table from dir and start the writer thread
+ *
+ * Call once at startup, before any other db.c function.
+ *
+ * @param dir Directory prefix for the FILE_* names (e.g. DB_DIR)
+ * @return 0 on success, -1 on error
+ */
+int db_store_open(const char *dir);
+
+/**
+ * @brief Write everything pending, compact, stop the writer thread
+ */
+void db_store_close(void);
+
+/* Change records (callers hold the world lock) */
+void db_log_team(const Team *team);
+void db_log_team_delete(int team_id);
+void db_log_member(const TeamMember *member);
+void db_log_member_delete(const char *username);
+void db_log_join_request(const JoinRequest *req);
+void db_log_join_request_delete(int request_id);
+void db_log_invite(const TeamInvite *invite);
+void db_log_invite_delete(int invite_id);
+void db_log_challenge(const Challenge *ch);
+void db_log_challenge_delete(int challenge_id);
+void db_log_match(const Match *match);
+
+#endif // DB_STORE_H
@@ -1,14 +1,92 @@
 #ifndef EPOLL_H
 #define EPOLL_H
 
-void epoll_init(int listen_sock);
+#include "timer_wheel.h"
+
+/**
+ * @file epoll.h
+ * @brief Event loop (reactor) API
+ *
+ * The server runs one or more reactors. Each reactor is a thread with its
+ * own epoll instance and its own listening socket (SO_REUSEPORT), so the
+ * kernel spreads new connections across reactors. A client socket belongs
+ * to the reactor that accepted it for its whole lifetime: only that thread
+ * reads from it or closes it.
+ *
+ * Each reactor also keeps a timer wheel for its connections (idle
+ * timeouts); epoll_wait() wakes every TIMER_TICK_MS while it holds
+ * timers. Reactor 0 wakes every tick regardless to run the world timers
+ * (app_timers_run()).
+ */
+
+/**
+ * @brief Create the reactors.
+ *
+ * @param listen_socks One listening socket per reactor. The same socket may
+ *                     appear several times when SO_REUSEPORT is unavailable;
+ *                     it is then shared with EPOLLEXCLUSIVE.
+ * @param count        Number of reactors (1..MAX_REACTORS)
+ */
+void epoll_init(const int *listen_socks, int count);
+
+/**
+ * @brief Run all reactors until epoll_request_stop() is called.
+ *
+ * Reactor 0 runs on the calling thread, the others on their own threads.
+ * Returns once every reactor has stopped.
+ */
 void epoll_run(void);
 
 // Helpers to modify/delete fd subscriptions without exposing internal epollfd
+// (they act on the epoll instance of the reactor owning the fd)
 int epoll_mod(int fd, unsigned int events);
 int epoll_del(int fd);
 
-// Request the epoll loop to stop (used by signal handlers)
+/**
+ * @brief Arm a connection's timer on the wheel of the reactor owning fd.
+ *
+ * Owner reactor only (e.g. from connection code); the callback runs on
+ * that thread without the world lock. Cancel with timer_cancel().
+ *
+ * @param delay_ms Fires after at least this long (rounded up to a tick)
+ */
+void epoll_timer_arm(int fd, Timer *timer, unsigned long delay_ms);
+
+// Request the epoll loop to stop (used by signal handlers, async-signal-safe)
 void epoll_request_stop(void);
 
-#endif // EPOLL_H
\ No newline at end of file
+/**
+ * @brief Run fn(arg) on the reactor that owns fd.
+ *
+ * Safe from any thread (e.g. a worker handing back a result). The task is
+ * queued on the owner reactor and the reactor is woken through its
+ * eventfd; fn then runs on that thread, without the world lock, so it may
+ * touch the connection like an event handler. Tasks still queued when a
+ * reactor stops run before epoll_run() returns.
+ *
+ * @return 0 if queued, -1 if the reactor has stopped or out of memory
+ *         (fn will not run; the caller still owns arg)
+ */
+int epoll_post(int fd, void (*fn)(void *arg), void *arg);
+
+/**
+ * @brief Number of reactors (valid once epoll_init() has run)
+ */
+int epoll_reactor_count(void);
+
+/**
+ * @brief Like epoll_post(), for a reactor picked by index (0..count-1)
+ *
+ * For work sharded across reactors rather than tied to a socket.
+ */
+int epoll_post_reactor(int reactor, void (*fn)(void *arg), void *arg);
+
+/**
+ * @brief Arm a timer on a reactor's wheel; that reactor's thread only
+ *
+ * E.g. from a task posted with epoll_post_reactor() or from the timer's
+ * own callback.
+ */
+void epoll_reactor_timer_arm(int reactor, Timer *timer, unsigned long delay_ms);
+
+#endif // EPOLL_H
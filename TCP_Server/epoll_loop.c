@@ -1,72 +1,164 @@
+#define _GNU_SOURCE
+
 #include "epoll.h"
 #include "config.h"
 #include "connect.h"
+#include "app_context.h"
+#include "timer_wheel.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <signal.h>
 
-static int epollfd;
-static int listen_sock;
+/**
+ * @struct reactor_task
+ * @brief Work handed to a reactor by epoll_post().
+ */
+typedef struct reactor_task {
+    void (*fn)(void *arg);
+    void *arg;
+    struct reactor_task *next;
+} reactor_task_t;
+
+/**
+ * @struct reactor
+ * @brief One event loop thread.
+ */
+typedef struct reactor {
+    int id;
+    int epollfd;
+    int listen_sock;
+    int wake_fd;            /**< eventfd written to interrupt epoll_wait() */
+    pthread_t thread;
+    pthread_mutex_t task_lock;  /**< Guards the task queue and tasks_closed */
+    reactor_task_t *task_head;  /**< Posted tasks, oldest first */
+    reactor_task_t *task_tail;
+    int tasks_closed;           /**< Reactor stopped; epoll_post() refuses */
+    TimerWheel timers;          /**< Timers of the connections it owns; this thread only */
+} reactor_t;
+
+static reactor_t reactors[MAX_REACTORS];
+static int reactor_count = 0;
+static int fd_owner[MAX_CLIENTS];   /**< Reactor index owning each client fd */
 static volatile sig_atomic_t epoll_should_stop = 0;
 
-void epoll_init(int listen_fd) {
-    listen_sock = listen_fd;
-    epollfd = epoll_create1(0);
-    if (epollfd == -1) {
-        perror("epoll_create1() error:");
-        close(listen_sock);
-        exit(EXIT_FAILURE);
-    }
-    
-    struct epoll_event ev; // Create event structure
-    ev.events = EPOLLIN; // Monitor for input events
-    ev.data.fd = listen_sock; // Associate with listening socket
-    if(epoll_ctl(epollfd, EPOLL_CTL_ADD, listen_sock, &ev) == -1) {
-        perror("epoll_ctl() error:");
-        close(listen_sock);
-        exit(EXIT_FAILURE);
+void epoll_init(const int *listen_socks, int count) {
+    if (count < 1) count = 1;
+    if (count > MAX_REACTORS) count = MAX_REACTORS;
+
+    for (int i = 0; i < count; i++) {
+        reactor_t *r = &reactors[i];
+        r->id = i;
+        r->listen_sock = listen_socks[i];
+        r->epollfd = epoll_create1(0);
+        if (r->epollfd == -1) {
+            perror("epoll_create1() error:");
+            exit(EXIT_FAILURE);
+        }
+
+        r->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (r->wake_fd == -1) {
+            perror("eventfd() error:");
+            exit(EXIT_FAILURE);
+        }
+        pthread_mutex_init(&r->task_lock, NULL);
+        r->task_head = r->task_tail = NULL;
+        r->tasks_closed = 0;
+        timer_wheel_init(&r->timers, timer_now_tick());
+
+        struct epoll_event ev; // Create event structure
+        ev.events = EPOLLIN; // Monitor for input events
+        if (count > 1) ev.events |= EPOLLEXCLUSIVE; // Avoid thundering herd on a shared socket
+        ev.data.fd = r->listen_sock; // Associate with listening socket
+        if(epoll_ctl(r->epollfd, EPOLL_CTL_ADD, r->listen_sock, &ev) == -1) {
+            perror("epoll_ctl() error:");
+            exit(EXIT_FAILURE);
+        }
+
+        ev.events = EPOLLIN;
+        ev.data.fd = r->wake_fd;
+        if(epoll_ctl(r->epollfd, EPOLL_CTL_ADD, r->wake_fd, &ev) == -1) {
+            perror("epoll_ctl() error:");
+            exit(EXIT_FAILURE);
+        }
     }
+    reactor_count = count;
 }
 
-static void handle_accept(void) {
+static void handle_accept(reactor_t *r) {
     while(1) {
-        int client_sock = accept(listen_sock, NULL, NULL);
+        int client_sock = accept(r->listen_sock, NULL, NULL);
         if (client_sock < 0) {
             if(errno == EWOULDBLOCK || errno == EAGAIN) {
                 break; // No more incoming connections
+            } else if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
             } else {
                 perror("accept() error:");
                 break;
             }
         }
-        connection_create(client_sock);
+        if (client_sock >= MAX_CLIENTS) {
+            fprintf(stderr, "[WARN] fd %d exceeds MAX_CLIENTS, rejecting\n", client_sock);
+            close(client_sock);
+            continue;
+        }
+
+        // Ownership must be known before the connection becomes visible
+        fd_owner[client_sock] = r->id;
 
+        // Register first so connection_create() can queue the greeting and
+        // arm EPOLLOUT; events are only handled after we return
         struct epoll_event ev;
         ev.events = EPOLLIN | EPOLLET; // Edge-triggered for client sockets
         ev.data.fd = client_sock;
-        if(epoll_ctl(epollfd, EPOLL_CTL_ADD, client_sock, &ev) == -1) {
+        if(epoll_ctl(r->epollfd, EPOLL_CTL_ADD, client_sock, &ev) == -1) {
             perror("epoll_ctl() error:");
             close(client_sock);
+            continue;
         }
+        connection_create(client_sock);
     }
 }
 
-void epoll_run(void) {
+/* Run everything posted so far; with close set, also refuse further posts */
+static void run_tasks(reactor_t *r, int close) {
+    pthread_mutex_lock(&r->task_lock);
+    reactor_task_t *task = r->task_head;
+    r->task_head = r->task_tail = NULL;
+    if (close) r->tasks_closed = 1;
+    pthread_mutex_unlock(&r->task_lock);
+
+    while (task) {
+        reactor_task_t *next = task->next;
+        task->fn(task->arg);
+        free(task);
+        task = next;
+    }
+}
+
+static void *reactor_main(void *arg) {
+    reactor_t *r = (reactor_t *)arg;
     struct epoll_event events[MAX_EVENTS];
     while (1) {
         if (epoll_should_stop) {
             break;
         }
-        int n = epoll_wait(epollfd, events, MAX_EVENTS, -1);
+        // Wake every tick while timers are pending; reactor 0 also runs
+        // the world timers (app_timers_run())
+        int timeout = (r->id == 0 || r->timers.count > 0) ? TIMER_TICK_MS : -1;
+        int n = epoll_wait(r->epollfd, events, MAX_EVENTS, timeout);
         if (n < 0) {
             if (errno == EINTR) {
                 // Interrupted by signal; check stop flag
@@ -77,12 +169,20 @@ void epoll_run(void) {
             break;
         }
 
+        uint64_t now = timer_now_tick();
+        timer_wheel_advance(&r->timers, now);
+        if (r->id == 0) app_timers_run(now);
+
         for (int i = 0; i < n; i++) {
             int fd = events[i].data.fd;
-            if (fd == listen_sock) {
-                handle_accept();
+            if (fd == r->listen_sock) {
+                handle_accept(r);
+            } else if (fd == r->wake_fd) {
+                uint64_t junk;
+                while (read(r->wake_fd, &junk, sizeof(junk)) > 0) {}
+                run_tasks(r, 0);
             } else {
-                if(events[i].events & EPOLLIN) {
+                if(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
                     connection_on_read(fd);
                 }
                 if(events[i].events & EPOLLOUT) {
@@ -91,19 +191,96 @@ void epoll_run(void) {
             }
         }
     }
+    run_tasks(r, 1);
+    return NULL;
+}
+
+void epoll_run(void) {
+    sigset_t all, old;
+
+    // Worker reactors never take signals; SIGINT/SIGTERM land on the main thread
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    for (int i = 1; i < reactor_count; i++) {
+        if (pthread_create(&reactors[i].thread, NULL, reactor_main, &reactors[i]) != 0) {
+            perror("pthread_create() error:");
+            reactor_count = i;
+            break;
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    printf("[INFO] %d reactor thread(s) running\n", reactor_count);
+    reactor_main(&reactors[0]);
+
+    // Make sure the others notice even if the stop came from an epoll error
+    epoll_request_stop();
+    for (int i = 1; i < reactor_count; i++) {
+        pthread_join(reactors[i].thread, NULL);
+    }
 }
 
 int epoll_mod(int fd, unsigned int events) {
     struct epoll_event ev;
     ev.data.fd = fd;
     ev.events = events;
-    return epoll_ctl(epollfd, EPOLL_CTL_MOD, fd, &ev);
+    return epoll_ctl(reactors[fd_owner[fd]].epollfd, EPOLL_CTL_MOD, fd, &ev);
 }
 
 int epoll_del(int fd) {
-    return epoll_ctl(epollfd, EPOLL_CTL_DEL, fd, NULL);
+    return epoll_ctl(reactors[fd_owner[fd]].epollfd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+int epoll_reactor_count(void) {
+    return reactor_count;
+}
+
+void epoll_reactor_timer_arm(int reactor, Timer *timer, unsigned long delay_ms) {
+    TimerWheel *w = &reactors[reactor].timers;
+    timer_arm(w, timer, w->now + timer_ms_to_ticks(delay_ms));
+}
+
+void epoll_timer_arm(int fd, Timer *timer, unsigned long delay_ms) {
+    epoll_reactor_timer_arm(fd_owner[fd], timer, delay_ms);
+}
+
+int epoll_post(int fd, void (*fn)(void *arg), void *arg) {
+    if (fd < 0 || fd >= MAX_CLIENTS) return -1;
+    return epoll_post_reactor(fd_owner[fd], fn, arg);
+}
+
+int epoll_post_reactor(int reactor, void (*fn)(void *arg), void *arg) {
+    if (reactor < 0 || reactor >= reactor_count || !fn) return -1;
+    reactor_t *r = &reactors[reactor];
+
+    reactor_task_t *task = malloc(sizeof(reactor_task_t));
+    if (!task) return -1;
+    task->fn = fn;
+    task->arg = arg;
+    task->next = NULL;
+
+    pthread_mutex_lock(&r->task_lock);
+    if (r->tasks_closed) {
+        pthread_mutex_unlock(&r->task_lock);
+        free(task);
+        return -1;
+    }
+    if (r->task_tail) r->task_tail->next = task;
+    else r->task_head = task;
+    r->task_tail = task;
+    pthread_mutex_unlock(&r->task_lock);
+
+    uint64_t one = 1;
+    ssize_t w = write(r->wake_fd, &one, sizeof(one));
+    (void)w;
+    return 0;
 }
 
 void epoll_request_stop(void) {
+    uint64_t one = 1;
     epoll_should_stop = 1;
-}
\ No newline at end of file
+    for (int i = 0; i < reactor_count; i++) {
+        ssize_t w = write(reactors[i].wake_fd, &one, sizeof(one));
+        (void)w;
+    }
+}
@@ -1,9 +1,100 @@
+#define _GNU_SOURCE
+
 #include "hash.h"
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/random.h>
+
+static uint64_t hash_seed = 0x9e3779b97f4a7c15ULL;
+
+// wyhash final v4 constants
+static const uint64_t wyp[4] = {
+  0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+  0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+};
+
+// 64x64 -> 128 bit multiply, both halves
+static inline void wymum(uint64_t *a, uint64_t *b) {
+  unsigned __int128 r = (unsigned __int128)*a * *b;
+  *a = (uint64_t)r;
+  *b = (uint64_t)(r >> 64);
+}
+
+static inline uint64_t wymix(uint64_t a, uint64_t b) {
+  wymum(&a, &b);
+  return a ^ b;
+}
+
+// Unaligned little-endian reads (memcpy compiles to a single load)
+static inline uint64_t wyr8(const uint8_t *p) {
+  uint64_t v;
+  memcpy(&v, p, 8);
+  return v;
+}
+
+static inline uint64_t wyr4(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+static inline uint64_t wyr3(const uint8_t *p, size_t k) {
+  return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
+uint64_t hash_bytes(const void *key, size_t len, uint64_t seed) {
+  const uint8_t *p = key;
+  uint64_t a, b;
+
+  seed ^= wymix(seed ^ wyp[0], wyp[1]);
+  if (len <= 16) {
+    // Usernames (3-20 chars) mostly end up here: two overlapping reads
+    if (len >= 4) {
+      a = (wyr4(p) << 32) | wyr4(p + ((len >> 3) << 2));
+      b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - ((len >> 3) << 2));
+    } else if (len > 0) {
+      a = wyr3(p, len);
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    size_t i = len;
+    if (i > 48) {
+      uint64_t see1 = seed, see2 = seed;
+      do {
+        seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+        see1 = wymix(wyr8(p + 16) ^ wyp[2], wyr8(p + 24) ^ see1);
+        see2 = wymix(wyr8(p + 32) ^ wyp[3], wyr8(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+      seed ^= see1 ^ see2;
+    }
+    while (i > 16) {
+      seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+    a = wyr8(p + i - 16);
+    b = wyr8(p + i - 8);
+  }
+  a ^= wyp[1];
+  b ^= seed;
+  wymum(&a, &b);
+  return wymix(a ^ wyp[0] ^ len, b ^ wyp[1]);
+}
+
+void hash_seed_init(void) {
+  uint64_t seed;
+  if (getrandom(&seed, sizeof(seed), 0) != (ssize_t)sizeof(seed)) {
+    // No entropy source: still differs per run
+    seed = (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32);
+  }
+  hash_seed = seed;
+}
 
 unsigned long hashFunc(const char * str) {
-  unsigned long hash = 5381;
-  int c;
-  while ((c = * str++))
-    hash = ((hash << 5) + hash) + c; // hash * 33 + c
-  return hash;
+  return (unsigned long)hash_bytes(str, strlen(str), hash_seed);
 }
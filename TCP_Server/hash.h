@@ -1,8 +1,41 @@
 #ifndef HASH_H
 #define HASH_H
 
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file hash.h
+ * @brief Keyed string hashing
+ *
+ * hashFunc() used to be djb2 with a fixed start value, so anyone could
+ * pick usernames that land in the same user-table slot. It is now
+ * wyhash (final version 4): 16 bytes per step through 64x64->128 bit
+ * multiplies, keyed with a seed drawn at startup by hash_seed_init().
+ * hashFunc() values are only stable within one process; never store
+ * them on disk. hash_bytes() with an explicit seed is deterministic on
+ * one host: users.bin keeps its index seed in the header (user_store.h).
+ */
+
+/**
+ * @brief Draw the process-wide seed from the kernel.
+ *
+ * Call once at startup, before any table is filled. Until then the seed
+ * is a fixed constant (fine for offline tools).
+ */
+void hash_seed_init(void);
+
+/**
+ * @brief 64-bit wyhash of a byte string.
+ * @param key Input bytes.
+ * @param len Number of bytes.
+ * @param seed Key.
+ * @return Hash value.
+ */
+uint64_t hash_bytes(const void *key, size_t len, uint64_t seed);
+
 /**
- * @brief Simple string hash function (djb2).
+ * @brief Hash a string with the process seed.
  * @param str Input string.
  * @return Unsigned long hash value.
  */
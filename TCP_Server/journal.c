@@ -0,0 +1,389 @@
+#define _GNU_SOURCE
+
+#include "journal.h"
+#include "users_io.h"
+#include "user_store.h"
+#include "app_context.h"
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+/**
+ * @file journal.c
+ * @brief Write-ahead journal implementation
+ *
+ * Lock order: user lock, then journal_lock. The writer thread never
+ * holds journal_lock while it takes the user lock for a checkpoint.
+ */
+
+static pthread_mutex_t journal_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t journal_cond = PTHREAD_COND_INITIALIZER;
+
+// Guarded by journal_lock
+static char *pending = NULL;            /**< Formatted records not yet written */
+static size_t pending_len = 0;
+static size_t pending_cap = 0;
+static unsigned long long next_lsn = 1;
+static bool journal_stop = false;
+static bool journal_running = false;
+
+// Writer thread only (after journal_open())
+static int journal_fd = -1;
+static unsigned long long checkpoint_lsn = 0;  /**< Last LSN contained in users.txt */
+static UserTable *journal_table = NULL;
+static const char *snapshot_path = NULL;
+static bool snapshot_binary = false;        /**< Checkpoint as users.bin instead of text */
+static pthread_t journal_thread;
+
+/* ============================================================================
+ * APPEND (callers hold the user lock)
+ * ============================================================================ */
+
+static void journal_append(const char *fmt, ...) {
+    char line[512];
+    va_list ap;
+
+    pthread_mutex_lock(&journal_lock);
+    if (!journal_running) {
+        pthread_mutex_unlock(&journal_lock);
+        return;
+    }
+
+    unsigned long long lsn = next_lsn++;
+    int head = snprintf(line, sizeof(line), "%llu ", lsn);
+    va_start(ap, fmt);
+    int body = vsnprintf(line + head, sizeof(line) - (size_t)head, fmt, ap);
+    va_end(ap);
+    size_t len = (size_t)head + (size_t)body;
+    if (body < 0 || len >= sizeof(line)) {
+        fprintf(stderr, "[ERROR] Journal record %llu too long, dropped\n", lsn);
+        pthread_mutex_unlock(&journal_lock);
+        return;
+    }
+
+    if (pending_len + len > pending_cap) {
+        size_t cap = pending_cap ? pending_cap * 2 : 4096;
+        while (cap < pending_len + len) cap *= 2;
+        char *grown = realloc(pending, cap);
+        if (!grown) {
+            fprintf(stderr, "[ERROR] Out of memory, journal record %llu dropped\n", lsn);
+            pthread_mutex_unlock(&journal_lock);
+            return;
+        }
+        pending = grown;
+        pending_cap = cap;
+    }
+    memcpy(pending + pending_len, line, len);
+    pending_len += len;
+
+    pthread_cond_signal(&journal_cond);
+    pthread_mutex_unlock(&journal_lock);
+}
+
+void journal_log_new_user(const User *user) {
+    journal_append("N %s %s %d %ld %ld %ld %d\n",
+                   user->username, user->password_hash, (int)user->status,
+                   user->coin, (long)user->created_at, (long)user->updated_at, user->user_id);
+}
+
+void journal_log_coin(const User *user, long delta) {
+    journal_append("C %s %ld %ld\n", user->username, delta, (long)user->updated_at);
+}
+
+void journal_log_status(const User *user) {
+    journal_append("S %s %d %ld\n", user->username, (int)user->status, (long)user->updated_at);
+}
+
+void journal_log_password(const User *user) {
+    journal_append("P %s %s %ld\n", user->username, user->password_hash, (long)user->updated_at);
+}
+
+/* ============================================================================
+ * WRITER THREAD
+ * ============================================================================ */
+
+static int write_all(int fd, const char *data, size_t len) {
+    size_t off = 0;
+    while (off < len) {
+        ssize_t n = write(fd, data + off, len - off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        off += (size_t)n;
+    }
+    return 0;
+}
+
+// Fold the journal into a new users.txt, then empty it
+static void journal_checkpoint(void) {
+    unsigned long long lsn;
+    size_t count, len;
+
+    // Every journaled change holds the user lock, so copying the loaded
+    // users under it matches lsn. Merging the never-loaded accounts,
+    // formatting and disk I/O run without it.
+    app_users_lock();
+    pthread_mutex_lock(&journal_lock);
+    lsn = next_lsn - 1;
+    pthread_mutex_unlock(&journal_lock);
+    User *users = copyLoadedUsers(journal_table, &count);
+    app_users_unlock();
+    if (users) users = mergeStoredUsers(journal_table->store, users, count, &count);
+
+    if (!users) {
+        fprintf(stderr, "[ERROR] Checkpoint: out of memory\n");
+        return;
+    }
+
+    UserIOStatus status;
+    if (snapshot_binary) {
+        status = user_store_write(snapshot_path, users, count, lsn);
+    } else {
+        char *data = formatUsers(users, count, lsn, &len);
+        status = data ? writeUsersFile(snapshot_path, data, len) : USER_IO_MEMORY_ERROR;
+        free(data);
+    }
+    free(users);
+    if (status != USER_IO_OK) {
+        fprintf(stderr, "[ERROR] Checkpoint: %s\n", getUserIOStatusMessage(status));
+        return;
+    }
+    checkpoint_lsn = lsn;
+
+    // Records up to lsn are in the snapshot. Ones still pending are
+    // written after the truncation and skipped on replay.
+    if (ftruncate(journal_fd, 0) != 0) {
+        perror("ftruncate() journal error:");
+    }
+}
+
+static void *journal_main(void *arg) {
+    (void)arg;
+    char *batch = NULL;
+    size_t batch_cap = 0;
+    time_t last_checkpoint = time(NULL);
+
+    for (;;) {
+        size_t len;
+        bool stopping;
+        unsigned long long last_lsn;
+
+        pthread_mutex_lock(&journal_lock);
+        if (pending_len == 0 && !journal_stop) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += 1;
+            pthread_cond_timedwait(&journal_cond, &journal_lock, &deadline);
+        }
+        // Take everything queued so far as one group; swap buffers so
+        // appenders keep going while we write
+        char *tmp = batch;
+        size_t tmp_cap = batch_cap;
+        batch = pending;
+        batch_cap = pending_cap;
+        len = pending_len;
+        pending = tmp;
+        pending_cap = tmp_cap;
+        pending_len = 0;
+        stopping = journal_stop;
+        last_lsn = next_lsn - 1;
+        pthread_mutex_unlock(&journal_lock);
+
+        if (len > 0) {
+            if (write_all(journal_fd, batch, len) != 0 || fdatasync(journal_fd) != 0) {
+                perror("journal write error:");
+            }
+        }
+
+        // Dirty = changes not yet in users.txt
+        unsigned long long dirty = last_lsn - checkpoint_lsn;
+        bool final = stopping && len == 0;
+        time_t now = time(NULL);
+        if (dirty >= CHECKPOINT_DIRTY_RECORDS ||
+            (dirty > 0 && (final || now - last_checkpoint >= CHECKPOINT_INTERVAL_SEC))) {
+            journal_checkpoint();
+            last_checkpoint = now;
+        }
+
+        if (final) break;
+    }
+
+    free(batch);
+    return NULL;
+}
+
+/* ============================================================================
+ * RECOVERY & LIFECYCLE
+ * ============================================================================ */
+
+static void replay_new_user(UserTable *ut, const char *name, const char *hash,
+                            int status, long coin, long created_at, long updated_at, int user_id) {
+    if (findUser(ut, name)) return;
+    User *user = malloc(sizeof(User));
+    if (!user) return;
+    strncpy(user->username, name, MAX_USERNAME - 1);
+    user->username[MAX_USERNAME - 1] = '\0';
+    strncpy(user->password_hash, hash, MAX_PASSWORD_HASH - 1);
+    user->password_hash[MAX_PASSWORD_HASH - 1] = '\0';
+    user->status = (UserStatus)status;
+    user->coin = coin;
+    user->created_at = (time_t)created_at;
+    user->updated_at = (time_t)updated_at;
+    user->user_id = user_id;
+    if (!insertUser(ut, user)) free(user);
+}
+
+// Apply records newer than snapshot_lsn; returns the offset after the last good line
+static off_t journal_replay(FILE *fp, UserTable *ut, unsigned long long snapshot_lsn,
+                            unsigned long long *max_lsn, int *applied) {
+    char line[1024];
+    off_t good = 0;
+
+    while (fgets(line, sizeof(line), fp)) {
+        if (!strchr(line, '\n')) break;     // Torn write at the tail
+
+        unsigned long long lsn;
+        char type;
+        char name[MAX_USERNAME];
+        int consumed = 0;
+        if (sscanf(line, "%llu %c %63s %n", &lsn, &type, name, &consumed) != 3) break;
+        const char *rest = line + consumed;
+
+        if (type == 'N') {
+            char hash[MAX_PASSWORD_HASH];
+            int status;
+            long coin, created_at, updated_at;
+            int user_id = 0;    // Absent in journals written before user ids
+            if (sscanf(rest, "%127s %d %ld %ld %ld %d", hash, &status, &coin, &created_at, &updated_at, &user_id) < 5) break;
+            if (lsn > snapshot_lsn) {
+                replay_new_user(ut, name, hash, status, coin, created_at, updated_at, user_id);
+                (*applied)++;
+            }
+        } else if (type == 'C') {
+            long delta, updated_at;
+            if (sscanf(rest, "%ld %ld", &delta, &updated_at) != 2) break;
+            User *user = findUser(ut, name);
+            if (user && lsn > snapshot_lsn) {
+                user->coin += delta;
+                user->updated_at = (time_t)updated_at;
+                (*applied)++;
+            }
+        } else if (type == 'S') {
+            int status;
+            long updated_at;
+            if (sscanf(rest, "%d %ld", &status, &updated_at) != 2) break;
+            User *user = findUser(ut, name);
+            if (user && lsn > snapshot_lsn) {
+                user->status = (UserStatus)status;
+                user->updated_at = (time_t)updated_at;
+                (*applied)++;
+            }
+        } else if (type == 'P') {
+            char hash[MAX_PASSWORD_HASH];
+            long updated_at;
+            if (sscanf(rest, "%127s %ld", hash, &updated_at) != 2) break;
+            User *user = findUser(ut, name);
+            if (user && lsn > snapshot_lsn) {
+                memcpy(user->password_hash, hash, MAX_PASSWORD_HASH);
+                user->updated_at = (time_t)updated_at;
+                (*applied)++;
+            }
+        } else {
+            break;
+        }
+
+        if (lsn > *max_lsn) *max_lsn = lsn;
+        good = (off_t)ftello(fp);
+    }
+    return good;
+}
+
+int journal_open(const char *path, const char *snapshot, bool binary,
+                 UserTable *ut, unsigned long long snapshot_lsn) {
+    unsigned long long max_lsn = snapshot_lsn;
+    int applied = 0;
+    off_t good = 0;
+
+    FILE *fp = fopen(path, "r");
+    if (fp) {
+        good = journal_replay(fp, ut, snapshot_lsn, &max_lsn, &applied);
+        fclose(fp);
+    }
+
+    journal_fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (journal_fd < 0) {
+        perror("open() journal error:");
+        return -1;
+    }
+
+    // Cut a torn or corrupt tail so new records start on a clean line
+    off_t size = lseek(journal_fd, 0, SEEK_END);
+    if (size > good) {
+        fprintf(stderr, "[WARN] Journal: discarding %lld bytes after offset %lld\n",
+                (long long)(size - good), (long long)good);
+        if (ftruncate(journal_fd, good) != 0) perror("ftruncate() journal error:");
+    }
+    checkpoint_lsn = snapshot_lsn;
+    journal_table = ut;
+    snapshot_path = snapshot;
+    snapshot_binary = binary;
+
+    pthread_mutex_lock(&journal_lock);
+    next_lsn = max_lsn + 1;
+    journal_stop = false;
+    journal_running = true;
+    pthread_mutex_unlock(&journal_lock);
+
+    // Keep SIGINT/SIGTERM on the main thread
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    int rc = pthread_create(&journal_thread, NULL, journal_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (rc != 0) {
+        fprintf(stderr, "[ERROR] Failed to start journal thread\n");
+        pthread_mutex_lock(&journal_lock);
+        journal_running = false;
+        pthread_mutex_unlock(&journal_lock);
+        close(journal_fd);
+        journal_fd = -1;
+        return -1;
+    }
+
+    printf("[INFO] Journal: replayed %d record(s), next lsn %llu\n", applied, max_lsn + 1);
+    return 0;
+}
+
+void journal_close(void) {
+    pthread_mutex_lock(&journal_lock);
+    if (!journal_running) {
+        pthread_mutex_unlock(&journal_lock);
+        return;
+    }
+    journal_stop = true;
+    pthread_cond_signal(&journal_cond);
+    pthread_mutex_unlock(&journal_lock);
+
+    pthread_join(journal_thread, NULL);
+
+    pthread_mutex_lock(&journal_lock);
+    journal_running = false;
+    free(pending);
+    pending = NULL;
+    pending_len = pending_cap = 0;
+    pthread_mutex_unlock(&journal_lock);
+
+    close(journal_fd);
+    journal_fd = -1;
+}
@@ -0,0 +1,77 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+/**
+ * @file journal.h
+ * @brief Write-ahead journal for user account mutations
+ *
+ * users.txt is only a snapshot. Every later change to an account is
+ * appended to USERS_JOURNAL_FILE as one short line:
+ *
+ *   <lsn> N <username> <password_hash> <status> <coin> <created_at> <updated_at> <user_id>
+ *   <lsn> C <username> <delta> <updated_at>
+ *   <lsn> S <username> <status> <updated_at>
+ *   <lsn> P <username> <password_hash> <updated_at>
+ *
+ * Callers (holding the user lock, app_users_lock(), which app_lock()
+ * also takes) only format the line into a memory buffer. A writer thread appends whatever has accumulated with a single
+ * write() + fdatasync() (group commit), so a reply may reach the client a
+ * few milliseconds before its change is on disk.
+ *
+ * The same thread checkpoints: after CHECKPOINT_DIRTY_RECORDS changes, or
+ * every CHECKPOINT_INTERVAL_SEC while there are any, it copies the loaded
+ * users under the user lock (a memcpy each, copyLoadedUsers()), then
+ * merges the untouched users.bin records, formats the copy and
+ * atomically replaces the snapshot without the lock (see writeUsersFile()
+ * and mergeStoredUsers()). The snapshot is stamped with the last LSN it
+ * contains, then the journal is truncated. On startup, records with an
+ * LSN not above the snapshot's are skipped, so a crash between the two
+ * steps does not apply a delta twice. journal_close() writes a final checkpoint.
+ */
+
+#include "users.h"
+#include <stdbool.h>
+
+/**
+ * @brief Replay the journal into the table and start the writer thread
+ *
+ * A torn last line (crash mid-write) ends the replay and is cut off.
+ *
+ * @param path         Journal file (created if missing)
+ * @param snapshot     Snapshot path rewritten by checkpoints
+ * @param binary       Checkpoint in users.bin format (user_store.h)
+ * @param ut           Table already loaded from the snapshot
+ * @param snapshot_lsn LSN from the snapshot header (see loadUsers())
+ * @return 0 on success, -1 on error
+ */
+int journal_open(const char *path, const char *snapshot, bool binary,
+                 UserTable *ut, unsigned long long snapshot_lsn);
+
+/**
+ * @brief Commit everything pending, checkpoint, stop the writer thread
+ *
+ * Must be called without the world or user lock held.
+ */
+void journal_close(void);
+
+/**
+ * @brief Record a newly created account
+ */
+void journal_log_new_user(const User *user);
+
+/**
+ * @brief Record a coin change already applied to user
+ */
+void journal_log_coin(const User *user, long delta);
+
+/**
+ * @brief Record a status change (ban/unban) already applied to user
+ */
+void journal_log_status(const User *user);
+
+/**
+ * @brief Record a password hash change already applied to user
+ */
+void journal_log_password(const User *user);
+
+#endif // JOURNAL_H
@@ -0,0 +1,169 @@
+#include "kdf.h"
+#include <string.h>
+
+/* ============================================================================
+ * SHA-256 (FIPS 180-4)
+ * ============================================================================ */
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t sha256_iv[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+typedef struct {
+    uint32_t h[8];
+    uint8_t  buf[64];
+    size_t   fill;      /**< Bytes in buf */
+    uint64_t total;     /**< Bytes hashed so far */
+} Sha256;
+
+#define ROR32(x, n)  (((x) >> (n)) | ((x) << (32 - (n))))
+
+static inline uint32_t load_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline void store_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static void sha256_compress(uint32_t h[8], const uint8_t block[64]) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) w[i] = load_be32(block + 4 * i);
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROR32(w[i - 15], 7) ^ ROR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROR32(w[i - 2], 17) ^ ROR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+    uint32_t e = h[4], f = h[5], g = h[6], k = h[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = k + (ROR32(e, 6) ^ ROR32(e, 11) ^ ROR32(e, 25)) + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+        uint32_t t2 = (ROR32(a, 2) ^ ROR32(a, 13) ^ ROR32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        k = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+static void sha256_init(Sha256 *s) {
+    memcpy(s->h, sha256_iv, sizeof(s->h));
+    s->fill = 0;
+    s->total = 0;
+}
+
+static void sha256_update(Sha256 *s, const void *data, size_t len) {
+    const uint8_t *p = data;
+    s->total += len;
+    while (len > 0) {
+        size_t n = 64 - s->fill;
+        if (n > len) n = len;
+        memcpy(s->buf + s->fill, p, n);
+        s->fill += n;
+        p += n;
+        len -= n;
+        if (s->fill == 64) {
+            sha256_compress(s->h, s->buf);
+            s->fill = 0;
+        }
+    }
+}
+
+static void sha256_final(Sha256 *s, uint8_t out[KDF_SHA256_LEN]) {
+    uint64_t bits = s->total * 8;
+    uint8_t pad = 0x80;
+    sha256_update(s, &pad, 1);
+    pad = 0;
+    while (s->fill != 56) sha256_update(s, &pad, 1);
+    for (int i = 7; i >= 0; i--) {
+        pad = (uint8_t)(bits >> (8 * i));
+        sha256_update(s, &pad, 1);
+    }
+    for (int i = 0; i < 8; i++) store_be32(out + 4 * i, s->h[i]);
+}
+
+/* ============================================================================
+ * PBKDF2-HMAC-SHA256
+ * ============================================================================ */
+
+// Hash one 32-byte message that follows a 64-byte prefix already absorbed into start
+static void sha256_after_pad(const uint32_t start[8], const uint8_t msg[KDF_SHA256_LEN],
+                             uint8_t out[KDF_SHA256_LEN]) {
+    // Padding for a 96-byte message: 0x80, zeros, bit length 768
+    uint8_t block[64] = {0};
+    memcpy(block, msg, KDF_SHA256_LEN);
+    block[KDF_SHA256_LEN] = 0x80;
+    block[62] = 0x03;
+
+    uint32_t h[8];
+    memcpy(h, start, sizeof(h));
+    sha256_compress(h, block);
+    for (int i = 0; i < 8; i++) store_be32(out + 4 * i, h[i]);
+}
+
+void kdf_pbkdf2_sha256(const void *password, size_t password_len,
+                       const uint8_t *salt, size_t salt_len,
+                       uint32_t iterations, uint8_t *out, size_t out_len) {
+    uint8_t key[64] = {0};
+    if (password_len > sizeof(key)) {
+        Sha256 s;
+        sha256_init(&s);
+        sha256_update(&s, password, password_len);
+        sha256_final(&s, key);
+    } else if (password_len > 0) {
+        memcpy(key, password, password_len);
+    }
+
+    // Inner and outer HMAC states after their key pads, reused for every block
+    Sha256 inner, outer;
+    uint8_t pad[64];
+    for (int i = 0; i < 64; i++) pad[i] = key[i] ^ 0x36;
+    sha256_init(&inner);
+    sha256_update(&inner, pad, sizeof(pad));
+    for (int i = 0; i < 64; i++) pad[i] = key[i] ^ 0x5c;
+    sha256_init(&outer);
+    sha256_update(&outer, pad, sizeof(pad));
+
+    if (iterations < 1) iterations = 1;
+    for (uint32_t block = 1; out_len > 0; block++) {
+        uint8_t u[KDF_SHA256_LEN], t[KDF_SHA256_LEN], be[4];
+
+        // U1 = HMAC(P, S || INT(block))
+        Sha256 s = inner;
+        sha256_update(&s, salt, salt_len);
+        store_be32(be, block);
+        sha256_update(&s, be, sizeof(be));
+        sha256_final(&s, u);
+        s = outer;
+        sha256_update(&s, u, sizeof(u));
+        sha256_final(&s, u);
+        memcpy(t, u, sizeof(t));
+
+        // U(j) = HMAC(P, U(j-1)): one compression for each side
+        for (uint32_t j = 1; j < iterations; j++) {
+            sha256_after_pad(inner.h, u, u);
+            sha256_after_pad(outer.h, u, u);
+            for (int i = 0; i < KDF_SHA256_LEN; i++) t[i] ^= u[i];
+        }
+
+        size_t n = out_len < sizeof(t) ? out_len : sizeof(t);
+        memcpy(out, t, n);
+        out += n;
+        out_len -= n;
+    }
+}
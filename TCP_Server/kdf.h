@@ -0,0 +1,34 @@
+#ifndef KDF_H
+#define KDF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file kdf.h
+ * @brief Password key derivation (PBKDF2-HMAC-SHA256, RFC 8018)
+ *
+ * Slow on purpose: the cost is the iteration count, which is stored with
+ * each password hash so it can be raised without breaking old accounts.
+ * Each iteration is two SHA-256 compressions (the HMAC key pads are
+ * hashed once up front). The server runs it on the auth workers
+ * (auth.h), never on a reactor.
+ */
+
+#define KDF_SHA256_LEN  32
+
+/**
+ * @brief PBKDF2 with HMAC-SHA256 as the PRF.
+ * @param password Password bytes.
+ * @param password_len Number of password bytes.
+ * @param salt Salt bytes.
+ * @param salt_len Number of salt bytes.
+ * @param iterations Cost (>= 1).
+ * @param out Derived key.
+ * @param out_len Bytes of key to derive.
+ */
+void kdf_pbkdf2_sha256(const void *password, size_t password_len,
+                       const uint8_t *salt, size_t salt_len,
+                       uint32_t iterations, uint8_t *out, size_t out_len);
+
+#endif
@@ -0,0 +1,323 @@
+#define _GNU_SOURCE
+
+#include "logger.h"
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+
+/**
+ * @file logger.c
+ * @brief Asynchronous activity log implementation
+ *
+ * The ring is a bounded multi-producer queue (one sequence number per
+ * cell): producers claim a cell with a CAS on ring_head, fill it and
+ * publish it by bumping the cell's sequence. The single writer thread
+ * consumes cells in order. Nothing on the producer side blocks or makes
+ * a syscall besides time().
+ */
+
+#define LOG_ACTION_MAX  32
+#define LOG_USER_MAX    64
+#define LOG_INPUT_MAX   256
+#define LOG_LINE_MAX    (LOG_ACTION_MAX + LOG_USER_MAX + LOG_INPUT_MAX + 256)
+
+/**
+ * @struct LogRecord
+ * @brief Fixed-size binary record copied by log_activity()
+ */
+typedef struct {
+    time_t ts;
+    int code;
+    bool logged_in;
+    char action[LOG_ACTION_MAX];
+    char user[LOG_USER_MAX];
+    char input[LOG_INPUT_MAX];
+} LogRecord;
+
+typedef struct {
+    atomic_size_t seq;      /**< == position when free, position + 1 when filled */
+    LogRecord rec;
+} LogCell;
+
+static LogCell ring[LOG_RING_SIZE];
+static atomic_size_t ring_head;         /**< Next position a producer claims */
+static size_t ring_tail;                /**< Next position the writer reads (writer only) */
+static atomic_ulong dropped;            /**< Records lost to a full ring since last report */
+static atomic_int min_level = LOG_LEVEL_INFO;
+static atomic_bool running = false;
+static atomic_bool stop_requested = false;
+
+static int log_fd = -1;
+static pthread_t writer_thread;
+
+/* ============================================================================
+ * PRODUCER SIDE
+ * ============================================================================ */
+
+static LogLevel level_for_code(int code) {
+    if (code >= 500) return LOG_LEVEL_ERROR;
+    if (code >= 300) return LOG_LEVEL_WARN;
+    return LOG_LEVEL_INFO;
+}
+
+// strncpy() without the zero fill of the whole tail
+static void copy_field(char *dst, size_t cap, const char *src) {
+    size_t i = 0;
+    if (src) {
+        for (; i < cap - 1 && src[i]; i++) dst[i] = src[i];
+    }
+    dst[i] = '\0';
+}
+
+void log_activity(const char *action,
+                  const char *username,
+                  bool is_logged_in,
+                  const char *user_input,
+                  ResponseCode code) {
+    if (!atomic_load_explicit(&running, memory_order_relaxed)) return;
+    if ((int)level_for_code((int)code) < atomic_load_explicit(&min_level, memory_order_relaxed)) return;
+
+    // Claim a cell
+    size_t pos = atomic_load_explicit(&ring_head, memory_order_relaxed);
+    LogCell *cell;
+    for (;;) {
+        cell = &ring[pos & (LOG_RING_SIZE - 1)];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring_head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            // Writer is a full ring behind
+            atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+            return;
+        } else {
+            pos = atomic_load_explicit(&ring_head, memory_order_relaxed);
+        }
+    }
+
+    LogRecord *rec = &cell->rec;
+    rec->ts = time(NULL);
+    rec->code = (int)code;
+    rec->logged_in = is_logged_in;
+    copy_field(rec->action, sizeof(rec->action), action);
+    copy_field(rec->user, sizeof(rec->user), username);
+    copy_field(rec->input, sizeof(rec->input), user_input);
+
+    // Publish
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+}
+
+/* ============================================================================
+ * WRITER THREAD
+ * ============================================================================ */
+
+static char batch[LOG_BATCH_BYTES];
+static size_t batch_len = 0;
+
+static time_t cached_sec = (time_t)-1;
+static char cached_ts[32] = "";
+
+static const char *level_tag(LogLevel lvl) {
+    switch (lvl) {
+    case LOG_LEVEL_ERROR: return "[ERROR]";
+    case LOG_LEVEL_WARN:  return "[WARN]";
+    case LOG_LEVEL_DEBUG: return "[DEBUG]";
+    default:              return "[INFO]";
+    }
+}
+
+// localtime_r() + strftime() once per second rather than once per line
+static const char *timestamp(time_t t) {
+    if (t != cached_sec) {
+        struct tm tm_info;
+        if (localtime_r(&t, &tm_info)) {
+            strftime(cached_ts, sizeof(cached_ts), "%Y-%m-%d %H:%M:%S", &tm_info);
+        } else {
+            cached_ts[0] = '\0';
+        }
+        cached_sec = t;
+    }
+    return cached_ts;
+}
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+static void batch_flush(void) {
+    size_t off = 0;
+    while (off < batch_len) {
+        ssize_t n = write(log_fd, batch + off, batch_len - off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;  // Disk trouble: lose this batch rather than stall the writer
+        }
+        off += (size_t)n;
+    }
+    batch_len = 0;
+}
+
+static void format_record(const LogRecord *rec) {
+    if (batch_len + LOG_LINE_MAX > sizeof(batch)) batch_flush();
+
+    char input[LOG_INPUT_MAX];
+    size_t i;
+    for (i = 0; rec->input[i]; i++) {
+        unsigned char c = (unsigned char)rec->input[i];
+        input[i] = (c < 0x20 || c == 0x7f) ? ' ' : (char)c;
+    }
+    input[i] = '\0';
+
+    const char *msg = get_response_message((ResponseCode)rec->code);
+    if (!msg) msg = "UNKNOWN";
+
+    const char *user_field = (rec->logged_in && rec->user[0] != '\0') ? rec->user : "-";
+    const char *action_field = rec->action[0] ? rec->action : "-";
+
+    /* Format: 2025-12-24 12:34:56 [info] action=LOGIN user=alice input="..." code=110 message="..." */
+    int n = snprintf(batch + batch_len, sizeof(batch) - batch_len,
+                     "%s %s action=%s user=%s input=\"%s\" code=%d message=\"%s\"\n",
+                     timestamp(rec->ts), level_tag(level_for_code(rec->code)),
+                     action_field, user_field, input, rec->code, msg);
+    if (n > 0) {
+        size_t room = sizeof(batch) - batch_len - 1;
+        batch_len += (size_t)n < room ? (size_t)n : room;
+    }
+}
+
+static void report_drops(void) {
+    unsigned long n = atomic_exchange_explicit(&dropped, 0, memory_order_relaxed);
+    if (n == 0) return;
+    if (batch_len + LOG_LINE_MAX > sizeof(batch)) batch_flush();
+    int len = snprintf(batch + batch_len, sizeof(batch) - batch_len,
+                       "%s [WARN] action=LOGGER user=- input=\"\" code=0 message=\"dropped %lu records\"\n",
+                       timestamp(time(NULL)), n);
+    if (len > 0) batch_len += (size_t)len;
+}
+
+// Pop one record into the batch; returns 0 if the ring was empty
+static int drain_one(void) {
+    LogCell *cell = &ring[ring_tail & (LOG_RING_SIZE - 1)];
+    size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+    if (seq != ring_tail + 1) return 0;
+
+    format_record(&cell->rec);
+    atomic_store_explicit(&cell->seq, ring_tail + LOG_RING_SIZE, memory_order_release);
+    ring_tail++;
+    return 1;
+}
+
+static void *writer_main(void *arg) {
+    (void)arg;
+    uint64_t first_buffered = 0;    // When the oldest unflushed line was formatted
+    uint64_t last_sync = now_ms();
+    int dirty = 0;                  // Written since the last fdatasync()
+
+    for (;;) {
+        int stopping = atomic_load(&stop_requested);
+        int got = 0;
+        for (;;) {
+            // Checked before drain_one(), which formats into the batch
+            bool was_empty = batch_len == 0;
+            if (!drain_one()) break;
+            if (was_empty) first_buffered = now_ms();
+            got++;
+        }
+        if (batch_len == 0) first_buffered = now_ms();  // A drop report may start one
+        report_drops();
+
+        uint64_t now = now_ms();
+        if (batch_len > 0 && (stopping || now - first_buffered >= LOG_FLUSH_MS)) {
+            batch_flush();
+            dirty = 1;
+        }
+        if (dirty && (stopping || now - last_sync >= LOG_FSYNC_MS)) {
+            fdatasync(log_fd);
+            last_sync = now;
+            dirty = 0;
+        }
+
+        if (stopping) break;
+        if (!got) {
+            struct timespec idle = { 0, LOG_IDLE_MS * 1000000L };
+            nanosleep(&idle, NULL);
+        }
+    }
+    return NULL;
+}
+
+/* ============================================================================
+ * LIFECYCLE
+ * ============================================================================ */
+
+int logger_init(const char *path) {
+    for (size_t i = 0; i < LOG_RING_SIZE; i++) {
+        atomic_init(&ring[i].seq, i);
+    }
+    atomic_store(&ring_head, 0);
+    ring_tail = 0;
+    atomic_store(&dropped, 0);
+    atomic_store(&stop_requested, false);
+
+    log_fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (log_fd < 0) {
+        perror("open() log file error:");
+        return -1;
+    }
+
+    // The writer must not take SIGINT/SIGTERM meant for the main thread
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    int rc = pthread_create(&writer_thread, NULL, writer_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (rc != 0) {
+        fprintf(stderr, "[ERROR] Failed to start log writer thread\n");
+        close(log_fd);
+        log_fd = -1;
+        return -1;
+    }
+
+    atomic_store(&running, true);
+    return 0;
+}
+
+void logger_shutdown(void) {
+    if (!atomic_load(&running)) return;
+    atomic_store(&running, false);
+    atomic_store(&stop_requested, true);
+    pthread_join(writer_thread, NULL);
+
+    close(log_fd);
+    log_fd = -1;
+}
+
+void logger_set_level(LogLevel level) {
+    atomic_store(&min_level, (int)level);
+}
+
+int logger_parse_level(const char *name, LogLevel *out) {
+    static const char *names[] = { "debug", "info", "warn", "error" };
+    for (int i = 0; i < 4; i++) {
+        if (strcasecmp(name, names[i]) == 0) {
+            *out = (LogLevel)i;
+            return 0;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,87 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+/**
+ * @file logger.h
+ * @brief Asynchronous activity log
+ *
+ * log_activity() runs on the reactor threads for every command, so it
+ * only copies a fixed-size record into a lock-free ring. A background
+ * writer thread formats the records, batches them and write()s them to
+ * LOG_FILE, flushing when the batch is large or LOG_FLUSH_MS old, and
+ * fdatasync()ing every LOG_FSYNC_MS. When the ring is full, records are
+ * dropped and counted; the writer reports the count in the log itself.
+ */
+
+#include <stdbool.h>
+#include "config.h"
+
+/**
+ * @enum LogLevel
+ * @brief Severity of a log record, derived from the response code
+ */
+typedef enum {
+    LOG_LEVEL_DEBUG = 0,
+    LOG_LEVEL_INFO  = 1,    /**< code < 300 */
+    LOG_LEVEL_WARN  = 2,    /**< 300 <= code < 500 */
+    LOG_LEVEL_ERROR = 3     /**< code >= 500 */
+} LogLevel;
+
+/**
+ * @brief Open the log file and start the writer thread
+ *
+ * @param path Log file (opened for append, created if missing)
+ * @return 0 on success, -1 on error (log_activity() then discards records)
+ */
+int logger_init(const char *path);
+
+/**
+ * @brief Drain the ring, flush and fsync, stop the writer thread
+ */
+void logger_shutdown(void);
+
+/**
+ * @brief Records below this level are discarded before being queued
+ */
+void logger_set_level(LogLevel level);
+
+/**
+ * @brief Parse "debug", "info", "warn" or "error"
+ *
+ * @return 0 on success, -1 if the name is unknown
+ */
+int logger_parse_level(const char *name, LogLevel *out);
+
+/**
+ * @brief Write a structured activity log line.
+ *
+ * Fields written per line:
+ *   timestamp, level ([info]|[warn]|[error]), action, user, input, code, message
+ *
+ * - Level is derived automatically from code: <300 => info, 300-499 => warn, >=500 => error
+ * - If not logged in, user will be "-".
+ * - Control characters in input are sanitized to spaces.
+ * - Fields longer than the record are truncated.
+ *
+ * @param action       Operation name, e.g. "REGISTER", "LOGIN"
+ * @param username     Username if known (NULL or empty if anonymous)
+ * @param is_logged_in Whether the session is logged in
+ * @param user_input   Raw user payload (will be sanitized)
+ * @param code         Response code
+ */
+void log_activity(const char *action,
+                  const char *username,
+                  bool is_logged_in,
+                  const char *user_input,
+                  ResponseCode code);
+
+/* Convenience macro when you have a ServerSession pointer available. */
+/* Intentionally not including session.h here to avoid coupling.        */
+#define LOG_ACTIVITY_SESSION(action, sessionPtr, input, code)                                       \
+	do {                                                                                           \
+		const char *_u_ = ((sessionPtr) && (sessionPtr)->isLoggedIn) ? (sessionPtr)->username : NULL; \
+		bool _lg_ = ((sessionPtr) && (sessionPtr)->isLoggedIn);                                    \
+		log_activity((action), _u_, _lg_, (input), (code));                                        \
+	} while (0)
+
+#endif // LOGGER_H
@@ -0,0 +1,205 @@
+/**
+ * ============================================================================
+ * MATCH ENGINE - IMPLEMENTATION
+ * ============================================================================
+ */
+
+#include "match_engine.h"
+#include "app_context.h"
+#include "session.h"
+#include "connect.h"
+#include "buffer.h"
+#include "epoll.h"
+#include "match_feed.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @struct MatchTicker
+ * @brief Per-match engine state
+ *
+ * The timer belongs to the shard reactor's wheel and is only touched by
+ * that thread; the input queue is guarded by the match lock, which FIRE
+ * holds under the shared world lock (app_match_lock()).
+ */
+typedef struct MatchTicker {
+    Timer timer;
+    int match_id;
+    int shard;                  /**< Reactor running the ticks */
+    unsigned long tick;         /**< Ticks run so far */
+    MatchInput *head;           /**< Inputs since the last tick, oldest first */
+    MatchInput *tail;
+} MatchTicker;
+
+static unsigned int tick_hz = MATCH_TICK_HZ;
+
+void match_engine_set_rate(unsigned int hz) {
+    unsigned int max_hz = 1000 / TIMER_TICK_MS;
+    tick_hz = hz > max_hz ? max_hz : hz;
+}
+
+static unsigned long tick_interval_ms(void) {
+    return tick_hz > 0 ? 1000 / tick_hz : 0;
+}
+
+// On the socket's reactor, without the world lock
+static void input_release(void *arg) {
+    MatchInput *in = arg;
+
+    app_lock_shared();
+    bool same = find_session_by_handle(in->socket_fd, in->session_id) != NULL;
+    app_unlock_shared();
+    if (same) connection_release(in->socket_fd);
+    free(in);
+}
+
+/* Roster members get the tick's output as one shared buffer */
+static void send_to_roster(const Match *match, const char *data, size_t len) {
+    if (!match || len == 0) return;
+    shared_buf_t *buf = shared_buf_new(data, len);
+    if (!buf) return;
+    for (int i = 0; i < match->roster_count; i++) {
+        SessionNode *node = find_session_by_socket(match->roster[i]);
+        if (node && node->session.isLoggedIn) {
+            connection_send_shared(node->session.socket_fd, buf);
+        }
+    }
+    shared_buf_unref(buf);
+}
+
+/* Add a ship to the tick's hit list once */
+static int note_hit(char hit[][MAX_USERNAME], int count, const char *username) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(hit[i], username) == 0) return count;
+    }
+    if (count >= MATCH_ROSTER_SIZE) return count;
+    snprintf(hit[count], MAX_USERNAME, "%s", username);
+    return count + 1;
+}
+
+static void ticker_run(Timer *timer) {
+    MatchTicker *tk = timer->arg;
+    char out[BUFF_SIZE];
+    size_t len = 0;
+    char hit[MATCH_ROSTER_SIZE][MAX_USERNAME];
+    int hit_count = 0;
+
+    // Only this match's ships change: other matches tick and shared
+    // commands run meanwhile
+    app_lock_shared();
+    app_match_lock(tk->match_id);
+    Match *match = find_match_by_id(tk->match_id);
+    bool running = match && match->status == MATCH_RUNNING;
+    tk->tick++;
+
+    // 1. Apply what arrived since the last tick, in order
+    MatchInput *in = tk->head;
+    tk->head = tk->tail = NULL;
+    while (in) {
+        MatchInput *next = in->next;
+        int code = in->apply(in);
+        if (code == RESP_FIRE_OK) {
+            // Only players with a ship can hit, one shot each per tick,
+            // so the events of a tick always fit
+            int n = snprintf(out + len, sizeof(out) - len, "131 FIRE_EVENT %s %s %d %d %d\r\n",
+                             in->attacker, in->target, in->result.damage_dealt,
+                             in->result.target_remaining_hp, in->result.target_remaining_armor);
+            if (n > 0 && (size_t)n < sizeof(out) - len) len += (size_t)n;
+            hit_count = note_hit(hit, hit_count, in->target);
+        }
+        if (code < 0 || epoll_post(in->socket_fd, input_release, in) != 0) {
+            free(in);   // Session gone, or its reactor stopped
+        }
+        in = next;
+    }
+
+    // 2. One state line with where the ships hit ended up
+    if (running && hit_count > 0) {
+        char state[512];
+        size_t slen = (size_t)snprintf(state, sizeof(state), "%d MATCH_TICK %d %lu %d",
+                                       RESP_MATCH_TICK_NOTIFY, tk->match_id, tk->tick, hit_count);
+        for (int i = 0; i < hit_count && slen < sizeof(state); i++) {
+            Ship *ship = find_ship(tk->match_id, hit[i]);
+            if (!ship) continue;
+            slen += (size_t)snprintf(state + slen, sizeof(state) - slen, " %s %d %d", hit[i], ship->hp,
+                                     ship->armor_slot_1_value + ship->armor_slot_2_value);
+        }
+        if (slen + 2 < sizeof(state) && len + slen + 2 < sizeof(out)) {
+            memcpy(out + len, state, slen);
+            memcpy(out + len + slen, "\r\n", 2);
+            len += slen + 2;
+        }
+    }
+    send_to_roster(match, out, len);
+    if (running) match_feed_publish(match);
+
+    int winner_team_id = -1;
+    bool decided = running && hit_count > 0 && can_end_match(tk->match_id, &winner_team_id);
+
+    // Over: inputs queued meanwhile are answered by one last tick
+    if (!running && !tk->head) {
+        if (match && match->ticker == tk) match->ticker = NULL;
+        app_match_unlock(tk->match_id);
+        app_unlock_shared();
+        free(tk);
+        return;
+    }
+    app_match_unlock(tk->match_id);
+    app_unlock_shared();
+
+    // 3. A side with no ship afloat loses. Ending a match touches teams
+    // and sessions, so it takes the world lock; only this reactor runs
+    // the match's ticks, but a command may have ended it in between.
+    if (decided) {
+        app_lock();
+        match = find_match_by_id(tk->match_id);
+        if (match && match->status == MATCH_RUNNING && can_end_match(tk->match_id, &winner_team_id)) {
+            printf("[INFO] Match %d decided at tick %lu, winner %d\n", tk->match_id, tk->tick, winner_team_id);
+            server_finish_match(match, winner_team_id);
+        }
+        if (!tk->head && (!match || match->status != MATCH_RUNNING)) {
+            if (match && match->ticker == tk) match->ticker = NULL;
+            app_unlock();
+            free(tk);
+            return;
+        }
+        app_unlock();
+    }
+
+    epoll_reactor_timer_arm(tk->shard, &tk->timer, tick_interval_ms());
+}
+
+// On the shard reactor: its wheel may only be touched from there
+static void ticker_attach(void *arg) {
+    MatchTicker *tk = arg;
+    epoll_reactor_timer_arm(tk->shard, &tk->timer, tick_interval_ms());
+}
+
+void match_engine_start(Match *match) {
+    match->ticker = NULL;
+    if (tick_hz == 0) return;
+
+    MatchTicker *tk = calloc(1, sizeof(MatchTicker));
+    if (!tk) return;
+    tk->match_id = match->match_id;
+    tk->shard = match->match_id % epoll_reactor_count();
+    timer_init(&tk->timer, ticker_run, tk);
+    if (epoll_post_reactor(tk->shard, ticker_attach, tk) != 0) {
+        free(tk);
+        return;
+    }
+    match->ticker = tk;
+}
+
+int match_engine_submit(Match *match, MatchInput *in) {
+    MatchTicker *tk = match ? match->ticker : NULL;
+    if (!tk || match->status != MATCH_RUNNING) return -1;
+
+    in->next = NULL;
+    if (tk->tail) tk->tail->next = in;
+    else tk->head = in;
+    tk->tail = in;
+    return 0;
+}
@@ -0,0 +1,82 @@
+#ifndef MATCH_ENGINE_H
+#define MATCH_ENGINE_H
+
+#include "db_schema.h"
+
+/**
+ * @file match_engine.h
+ * @brief Fixed-tick match simulation
+ *
+ * With a tick rate set (-r), a shot does not change ship state when FIRE
+ * arrives. The handler queues a MatchInput on the match and holds the
+ * connection (connection_hold()), so each player has at most one shot
+ * in flight. Every 1/rate seconds the match's tick runs under the shared
+ * world lock and the match's lock (app_match_lock()), so ticks of
+ * different matches and read-only commands do not wait on each other:
+ *
+ *   1. Apply the inputs queued since the last tick in arrival order;
+ *      each one's apply callback answers its shooter.
+ *   2. Send the roster one buffer holding the tick's 131 FIRE_EVENT
+ *      lines and a "153 MATCH_TICK" line with the final hp/armor of
+ *      every ship hit, then push the tick's 155 MATCH_DELTA to the
+ *      match's subscribers (match_feed.h).
+ *   3. If something was hit, check can_end_match() and end the match
+ *      (152 MATCH_ENDED) when one side is sunk. Only this step takes
+ *      the world lock exclusively, after the tick's locks are dropped.
+ *
+ * Ticks are sharded across reactors by match_id (match_id % reactors):
+ * a match's timer lives on its shard's timer wheel, so busy matches
+ * spread over the threads instead of queueing behind each other. Inputs
+ * still queued when a match ends are answered by the next tick (the
+ * match is over, so they fail), then the ticker is freed.
+ */
+
+typedef struct MatchInput MatchInput;
+
+/**
+ * @struct MatchInput
+ * @brief One FIRE waiting for its match's tick
+ */
+struct MatchInput {
+    int socket_fd;                  /**< Session handle: socket ... */
+    unsigned long session_id;       /**< ... and ServerSession.session_id */
+    char attacker[MAX_USERNAME];
+    char target[MAX_USERNAME];
+    int weapon;
+    int match_id;                   /**< Match whose lock the tick holds */
+    int wire;                       /**< Sent as a binary frame: answer with one (wire.h) */
+    FireResult result;              /**< Filled by apply on a hit */
+    /**
+     * Runs at the tick under the shared world lock and the match's
+     * lock: apply the shot, reply and log. Returns the reply code
+     * (RESP_FIRE_OK on a hit), or -1 if the session is gone.
+     */
+    int (*apply)(MatchInput *in);
+    MatchInput *next;
+};
+
+/**
+ * @brief Set the tick rate of matches started from now on
+ * @param hz Ticks per second (0 = no engine: FIRE applies on arrival);
+ *           at most 1000 / TIMER_TICK_MS
+ */
+void match_engine_set_rate(unsigned int hz);
+
+/**
+ * @brief Start ticking a new match (world lock held)
+ *
+ * Leaves match->ticker NULL when the engine is off or out of memory;
+ * FIRE then applies on arrival.
+ */
+void match_engine_start(Match *match);
+
+/**
+ * @brief Queue an input for the match's next tick
+ *
+ * Caller holds the world lock, shared or not, and the match's lock.
+ * @return 0 if queued (the input now belongs to the engine, which frees
+ *         it after replying), -1 if the match has no running ticker
+ */
+int match_engine_submit(Match *match, MatchInput *in);
+
+#endif // MATCH_ENGINE_H
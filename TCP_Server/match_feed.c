@@ -0,0 +1,260 @@
+/**
+ * ============================================================================
+ * MATCH FEED - IMPLEMENTATION
+ * ============================================================================
+ */
+
+#include "match_feed.h"
+#include "connect.h"
+#include "buffer.h"
+#include "config.h"
+#include "wire.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @struct ShipView
+ * @brief Ship values as subscribers last saw them
+ */
+typedef struct {
+    int team_id;
+    int hp;
+    int armor;
+    int cannon;
+    int laser;
+    int missile;
+} ShipView;
+
+/**
+ * @struct MatchFeed
+ * @brief Per-match subscription state (Match.feed)
+ *
+ * sent[i] is the ship get_match_ships() returns at index i: ships are
+ * only added during a match and all removed when it ends.
+ */
+typedef struct MatchFeed {
+    unsigned long seq;                  /**< Sequence of the last delta */
+    ShipView sent[MATCH_ROSTER_SIZE];
+    int sent_count;
+    int *subscribers;                   /**< Socket fds */
+    int subscriber_count;
+    int subscriber_cap;
+} MatchFeed;
+
+static void ship_view(const Ship *ship, int team_id, ShipView *view) {
+    view->team_id = team_id;
+    view->hp = ship->hp;
+    view->armor = ship->armor_slot_1_value + ship->armor_slot_2_value;
+    view->cannon = ship->cannon_ammo;
+    view->laser = ship->laser_count;
+    view->missile = ship->missile_count;
+}
+
+/* " <user> <mask> <values>" for the fields in mask; returns bytes written */
+static size_t format_ship_delta(char *out, size_t size, const char *username, int mask, const ShipView *v) {
+    const int values[] = { v->team_id, v->hp, v->armor, v->cannon, v->laser, v->missile };
+    size_t len = (size_t)snprintf(out, size, " %s %d", username, mask);
+
+    for (int bit = 0; bit < (int)(sizeof(values) / sizeof(values[0])) && len < size; bit++) {
+        if (mask & (1 << bit)) {
+            len += (size_t)snprintf(out + len, size - len, " %d", values[bit]);
+        }
+    }
+    return len < size ? len : size;
+}
+
+/* WIRE_MATCH_DELTA payload of the same delta; returns bytes written, 0 if too big */
+static size_t encode_ship_deltas(uint8_t *out, size_t size, const Match *match, Ship **ships,
+                                 const int *index, const int *masks, int changed) {
+    const MatchFeed *feed = match->feed;
+    WireWriter w;
+    wire_writer_init(&w, out, size);
+    wire_put_byte(&w, WIRE_MATCH_DELTA);
+    wire_put_uint(&w, (uint32_t)match->match_id);
+    wire_put_uint(&w, (uint32_t)feed->seq);
+    wire_put_uint(&w, (uint32_t)changed);
+    for (int c = 0; c < changed; c++) {
+        const ShipView *v = &feed->sent[index[c]];
+        const int values[] = { v->team_id, v->hp, v->armor, v->cannon, v->laser, v->missile };
+        wire_put_str(&w, ships[index[c]]->player_username);
+        wire_put_uint(&w, (uint32_t)masks[c]);
+        for (int bit = 0; bit < (int)(sizeof(values) / sizeof(values[0])); bit++) {
+            if (masks[c] & (1 << bit)) wire_put_uint(&w, (uint32_t)values[bit]);
+        }
+    }
+    return w.overflow ? 0 : w.len;
+}
+
+/*
+ * Sessions still subscribed to this match get one shared buffer per
+ * protocol; the binary one is only encoded if a binary subscriber exists
+ */
+static void send_to_subscribers(const Match *match, Ship **ships, const int *index,
+                                const int *masks, int changed, const char *text, size_t text_len) {
+    MatchFeed *feed = match->feed;
+    shared_buf_t *text_buf = NULL;
+    shared_buf_t *wire_buf = NULL;
+    int wire_failed = 0;
+
+    for (int i = 0; i < feed->subscriber_count; i++) {
+        SessionNode *node = find_session_by_socket(feed->subscribers[i]);
+        if (!node || node->session.subscribed_match_id != match->match_id) continue;
+        int fd = node->session.socket_fd;
+
+        if (connection_is_binary(fd)) {
+            if (!wire_buf && !wire_failed) {
+                uint8_t payload[BUFF_SIZE];
+                size_t len = encode_ship_deltas(payload, sizeof(payload), match, ships, index, masks, changed);
+                wire_buf = len ? shared_buf_new((const char *)payload, len) : NULL;
+                wire_failed = !wire_buf;
+            }
+            if (wire_buf) connection_send_frame(fd, NULL, 0, wire_buf);
+        } else {
+            if (!text_buf) text_buf = shared_buf_new(text, text_len);
+            if (text_buf) connection_send_shared(fd, text_buf);
+        }
+    }
+    if (text_buf) shared_buf_unref(text_buf);
+    if (wire_buf) shared_buf_unref(wire_buf);
+}
+
+void match_feed_publish(Match *match) {
+    MatchFeed *feed = match ? match->feed : NULL;
+    if (!feed) return;
+
+    Ship *ships[MATCH_ROSTER_SIZE];
+    int count = get_match_ships(match, ships, MATCH_ROSTER_SIZE);
+    char body[BUFF_SIZE];
+    size_t len = 0;
+    int changed = 0;
+    int index[MATCH_ROSTER_SIZE];
+    int masks[MATCH_ROSTER_SIZE];
+
+    for (int i = 0; i < count; i++) {
+        ShipView now;
+        int mask = 0;
+        if (i < feed->sent_count) {
+            const ShipView *was = &feed->sent[i];
+            ship_view(ships[i], was->team_id, &now);
+            if (now.hp != was->hp) mask |= SHIP_DELTA_HP;
+            if (now.armor != was->armor) mask |= SHIP_DELTA_ARMOR;
+            if (now.cannon != was->cannon) mask |= SHIP_DELTA_CANNON;
+            if (now.laser != was->laser) mask |= SHIP_DELTA_LASER;
+            if (now.missile != was->missile) mask |= SHIP_DELTA_MISSILE;
+        } else {
+            // Joined after the last delta: send all of it
+            ship_view(ships[i], find_team_id_by_username(ships[i]->player_username), &now);
+            mask = SHIP_DELTA_TEAM | SHIP_DELTA_HP | SHIP_DELTA_ARMOR
+                 | SHIP_DELTA_CANNON | SHIP_DELTA_LASER | SHIP_DELTA_MISSILE;
+        }
+        if (mask == 0) continue;
+
+        feed->sent[i] = now;
+        len += format_ship_delta(body + len, sizeof(body) - len, ships[i]->player_username, mask, &now);
+        index[changed] = i;
+        masks[changed] = mask;
+        changed++;
+    }
+    feed->sent_count = count;
+    if (changed == 0 || feed->subscriber_count == 0) return;
+
+    feed->seq++;
+    char line[BUFF_SIZE + 64];
+    int n = snprintf(line, sizeof(line), "%d MATCH_DELTA %d %lu %d%.*s\r\n",
+                     RESP_MATCH_DELTA_NOTIFY, match->match_id, feed->seq, changed, (int)len, body);
+    if (n > 0 && (size_t)n < sizeof(line)) {
+        send_to_subscribers(match, ships, index, masks, changed, line, (size_t)n);
+    }
+}
+
+static bool add_subscriber(MatchFeed *feed, int socket_fd) {
+    for (int i = 0; i < feed->subscriber_count; i++) {
+        if (feed->subscribers[i] == socket_fd) return true;
+    }
+    if (feed->subscriber_count == feed->subscriber_cap) {
+        int cap = feed->subscriber_cap ? feed->subscriber_cap * 2 : 8;
+        int *grown = realloc(feed->subscribers, (size_t)cap * sizeof(int));
+        if (!grown) return false;
+        feed->subscribers = grown;
+        feed->subscriber_cap = cap;
+    }
+    feed->subscribers[feed->subscriber_count++] = socket_fd;
+    return true;
+}
+
+int match_feed_subscribe(ServerSession *session, int match_id, char *out, size_t out_size) {
+    if (!session || !out || out_size == 0) return RESP_INTERNAL_ERROR;
+
+    Match *match = find_match_by_id(match_id);
+    if (!match) return RESP_MATCH_NOT_FOUND;
+    if (match->status != MATCH_RUNNING) return RESP_MATCH_FINISHED;
+
+    if (!match->feed) {
+        match->feed = calloc(1, sizeof(MatchFeed));
+        if (!match->feed) return RESP_INTERNAL_ERROR;
+    }
+    // Bring current subscribers up to date so the snapshot follows their last delta
+    match_feed_publish(match);
+
+    if (session->subscribed_match_id != match_id) {
+        match_feed_unsubscribe(session);
+        if (!add_subscriber(match->feed, session->socket_fd)) return RESP_INTERNAL_ERROR;
+        session->subscribed_match_id = match_id;
+    }
+
+    MatchFeed *feed = match->feed;
+    Ship *ships[MATCH_ROSTER_SIZE];
+    int count = get_match_ships(match, ships, MATCH_ROSTER_SIZE);
+    if (count > feed->sent_count) count = feed->sent_count;
+
+    size_t len = (size_t)snprintf(out, out_size, "%d MATCH_SNAPSHOT %d %lu %d %d %d",
+                                  RESP_MATCH_SNAPSHOT, match_id, feed->seq,
+                                  match->team1_id, match->team2_id, count);
+    for (int i = 0; i < count && len < out_size; i++) {
+        const ShipView *v = &feed->sent[i];
+        len += (size_t)snprintf(out + len, out_size - len, " %s %d %d %d %d %d %d",
+                                ships[i]->player_username, v->team_id, v->hp, v->armor,
+                                v->cannon, v->laser, v->missile);
+    }
+    if (len < out_size) snprintf(out + len, out_size - len, "\r\n");
+    return RESP_MATCH_SNAPSHOT;
+}
+
+int match_feed_unsubscribe(ServerSession *session) {
+    if (!session || session->subscribed_match_id <= 0) return RESP_MATCH_UNSUBSCRIBED;
+
+    Match *match = find_match_by_id(session->subscribed_match_id);
+    MatchFeed *feed = match ? match->feed : NULL;
+    if (feed) {
+        for (int i = 0; i < feed->subscriber_count; i++) {
+            if (feed->subscribers[i] == session->socket_fd) {
+                feed->subscribers[i] = feed->subscribers[--feed->subscriber_count];
+                break;
+            }
+        }
+    }
+    session->subscribed_match_id = -1;
+    return RESP_MATCH_UNSUBSCRIBED;
+}
+
+void match_feed_close(Match *match) {
+    MatchFeed *feed = match ? match->feed : NULL;
+    if (!feed) return;
+
+    char msg[128];
+    int n = snprintf(msg, sizeof(msg), "%d MATCH_ENDED %d %d\r\n",
+                     RESP_MATCH_ENDED_NOTIFY, match->match_id, match->winner_team_id);
+    for (int i = 0; i < feed->subscriber_count; i++) {
+        SessionNode *node = find_session_by_socket(feed->subscribers[i]);
+        if (!node || node->session.subscribed_match_id != match->match_id) continue;
+        // Players hear about it with the rest of the roster
+        if (node->session.current_match_id != match->match_id) {
+            connection_send(node->session.socket_fd, msg, (size_t)n);
+        }
+        node->session.subscribed_match_id = -1;
+    }
+    free(feed->subscribers);
+    free(feed);
+    match->feed = NULL;
+}
@@ -0,0 +1,64 @@
+#ifndef MATCH_FEED_H
+#define MATCH_FEED_H
+
+#include "db_schema.h"
+#include "session.h"
+
+/**
+ * @file match_feed.h
+ * @brief Match state pushed to subscribed clients
+ *
+ * Instead of polling MATCH_INFO, a client sends MATCH_SUBSCRIBE <id> and
+ * is answered with every ship of the match:
+ *
+ *   154 MATCH_SNAPSHOT <match_id> <seq> <team1_id> <team2_id> <n>
+ *       {<user> <team_id> <hp> <armor> <cannon> <laser> <missile>}
+ *
+ * Wherever ship state may have changed (a match tick, or a command that
+ * buys, repairs or fires) match_feed_publish() compares each ship with
+ * what was last sent, and pushes only the ships and fields that differ:
+ *
+ *   155 MATCH_DELTA <match_id> <seq> <n> {<user> <mask> <value>...}
+ *
+ * mask is made of SHIP_DELTA_* bits (config.h), with one value per set
+ * bit in bit order. seq goes up by one per delta and the snapshot carries
+ * the current one, so a client expecting anything but seq + 1 missed a
+ * line and sends MATCH_SUBSCRIBE again to resync.
+ *
+ * A session has at most one subscription; MATCH_UNSUBSCRIBE, logout,
+ * disconnect and the end of the match drop it. All functions run with
+ * app_lock() held, except match_feed_publish(), which may also run under
+ * the shared world lock holding the match's lock.
+ */
+
+/**
+ * @brief Subscribe a session to a running match
+ * @param out Filled with the 154 MATCH_SNAPSHOT line (CRLF included)
+ * @return RESP_MATCH_SNAPSHOT, RESP_MATCH_NOT_FOUND, RESP_MATCH_FINISHED
+ *         (match not running) or RESP_INTERNAL_ERROR
+ */
+int match_feed_subscribe(ServerSession *session, int match_id, char *out, size_t out_size);
+
+/**
+ * @brief Drop the session's subscription, if any
+ * @return RESP_MATCH_UNSUBSCRIBED
+ */
+int match_feed_unsubscribe(ServerSession *session);
+
+/**
+ * @brief Push a 155 MATCH_DELTA of the ships that changed since the last one
+ *
+ * No-op for a NULL match, a match nobody subscribed to, or when nothing
+ * changed.
+ */
+void match_feed_publish(Match *match);
+
+/**
+ * @brief Close the feed of a match that just ended (after end_match())
+ *
+ * Subscribers that are not playing in it get 152 MATCH_ENDED; every
+ * subscription is dropped.
+ */
+void match_feed_close(Match *match);
+
+#endif // MATCH_FEED_H
@@ -7,10 +7,17 @@
 #include "config.h"
 #include "db_schema.h"
 #include "util.h"
+#include "logger.h"
 #include "team_handler.h" // Team management handlers
+#include "auth.h"
+#include "match_engine.h"
+#include "match_feed.h"
+#include "wire.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
 
 /**
  * @file router.c
@@ -18,640 +25,1058 @@
  * Routes incoming commands to appropriate handlers.
  * Routes commands to existing handlers in session.c, users.c, db.c
  * This is the glue layer between network I/O and business logic.
+ *
+ * Commands live in a static registry (route_table). router_init() picks a
+ * hash seed under which every command name gets its own slot in
+ * route_index, so a lookup costs one hash and one strcmp() however many
+ * commands exist. The shared preamble (login check, match lookup,
+ * activity log, sending the reply) is done once in route_dispatch();
+ * handlers only parse their payload and format the reply.
+ *
+ * The dispatcher also takes the locks a route needs (app_context.h):
+ * ROUTE_USERS and ROUTE_SHARED routes run in parallel across reactors,
+ * the rest under app_lock().
+ *
+ * Binary frames (wire.h) enter through command_routes_frame(): the hot
+ * requests are turned back into the text arguments of the same routes,
+ * and ctx->wire tells their handlers to answer with a binary reply.
  */
 
-void command_routes(int client_sock, char *command) {
-    // TODO Step 1: Parse the command
-    Command cmd = parse_command(command);
-    const char *type = cmd.type ? cmd.type : "";
-    const char *payload = cmd.user_input ? cmd.user_input : "";
+/* ============================================================================
+ * ROUTE TYPES
+ * ============================================================================ */
 
-    // TODO Step 2: Find session by socket
-    // This gives us the ServerSession for this connection
-    SessionNode *node = find_session_by_socket(client_sock);
-    if (!node) {
-        // No session found - this shouldn't happen since connection_create() creates session
-        fprintf(stderr, "[ERROR] No session for socket %d\n", client_sock);
-        const char *err = "500 INTERNAL_ERROR no_session\r\n";
-        connection_send(client_sock, err, strlen(err));
+#define ROUTE_AUTH   0x01   /**< Reply RESP_NOT_LOGGED unless logged in */
+#define ROUTE_MATCH  0x02   /**< Resolve ctx->match_id, reply RESP_NOT_IN_MATCH if none */
+#define ROUTE_SHIP   0x04   /**< May change ship state: push match deltas after the reply */
+#define ROUTE_SHARED 0x08   /**< Only the caller's match: shared world lock plus its match lock */
+#define ROUTE_USERS  0x10   /**< Only the caller's account: the user lock alone */
+
+/**
+ * @struct RouteContext
+ * @brief Per-command state shared by the dispatcher and a handler
+ */
+typedef struct {
+    int client_sock;
+    ServerSession *session;
+    const char *payload;            /**< Arguments after the command name ("" if none) */
+    CommandArgs args;               /**< Tokenizer over payload */
+    char *response;                 /**< Reply buffer, sent by the dispatcher */
+    size_t response_size;
+    int response_code;              /**< Code written to the activity log */
+    int match_id;                   /**< Resolved match for ROUTE_MATCH routes */
+    const char *log_user;           /**< Username to log; NULL = session username */
+    const char *log_input;          /**< Input to log; NULL = payload */
+    char user_before[MAX_USERNAME]; /**< Session username before the handler ran */
+    int sent;                       /**< Handler already sent the reply itself */
+    int deferred;                   /**< Reply and log come later (route_auth_done()) */
+    int wire;                       /**< WireType of a binary request; WIRE_TEXT for a line */
+    size_t response_len;            /**< Bytes of a binary reply in response */
+} RouteContext;
+
+typedef void (*RouteHandler)(RouteContext *ctx);
+
+/**
+ * @struct Route
+ * @brief One entry of the command registry
+ */
+typedef struct {
+    const char *name;       /**< Command keyword sent by the client */
+    RouteHandler handler;
+    unsigned int flags;     /**< ROUTE_AUTH | ROUTE_MATCH | ROUTE_SHIP, ROUTE_SHARED or ROUTE_USERS */
+    const char *log_name;   /**< Action name passed to log_activity() */
+} Route;
+
+// Binary reply to a request of the given type; returns bytes written
+static size_t encode_reply(void *out, size_t size, int type, int code,
+                           const uint32_t *fields, int field_count) {
+    WireWriter w;
+    wire_writer_init(&w, out, size);
+    wire_put_byte(&w, (uint8_t)(type | WIRE_REPLY));
+    wire_put_uint(&w, (uint32_t)code);
+    for (int i = 0; i < field_count; i++) wire_put_uint(&w, fields[i]);
+    return w.len;
+}
+
+// Reply to a binary request: the code, then the fields of its layout
+static void reply_wire(RouteContext *ctx, int code, const uint32_t *fields, int field_count) {
+    ctx->response_code = code;
+    ctx->response_len = encode_reply(ctx->response, ctx->response_size, ctx->wire,
+                                     code, fields, field_count);
+}
+
+// Reply with just the response code
+static void reply_code(RouteContext *ctx, int code) {
+    if (ctx->wire) {
+        reply_wire(ctx, code, NULL, 0);
         return;
     }
+    ctx->response_code = code;
+    snprintf(ctx->response, ctx->response_size, "%d\r\n", code);
+}
+
+// Log under a username that only lives on the handler's stack
+static void log_as(RouteContext *ctx, const char *username) {
+    strncpy(ctx->user_before, username, MAX_USERNAME - 1);
+    ctx->user_before[MAX_USERNAME - 1] = '\0';
+    ctx->log_user = ctx->user_before;
+}
+
+// Next argument as an int; -1 if missing or not a number
+static int next_int(RouteContext *ctx, int *out) {
+    long v;
+    if (command_next_int(&ctx->args, INT_MIN, INT_MAX, &v) != 0) return -1;
+    *out = (int)v;
+    return 0;
+}
+
+// Next argument as a positive id, 0 if missing (what atoi() used to give)
+static int next_id(RouteContext *ctx) {
+    long v;
+    if (command_next_int(&ctx->args, 1, INT_MAX, &v) != 0) return 0;
+    return (int)v;
+}
+
+/* ============================================================================
+ * AUTHENTICATION COMMANDS
+ * ============================================================================ */
+
+// Second half of LOGIN/REGISTER, on the reactor owning the socket
+static void route_auth_done(AuthJob *job) {
+    char response[32];
+
+    app_lock();
+    SessionNode *node = find_session_by_handle(job->socket_fd, job->session_id);
+    if (!node) {
+        app_unlock();
+        return;     // Closed while the worker was busy
+    }
     ServerSession *session = &node->session;
+    UserTable *ut = app_context_get_user_table();
+    int code;
+    if (job->kind == AUTH_LOGIN) {
+        code = server_login_finish(session, ut, job->username, job->password_ok,
+                                   job->stored_hash, job->new_hash);
+    } else {
+        code = server_register_finish(ut, job->username, job->new_hash);
+    }
+    log_activity(job->kind == AUTH_LOGIN ? "LOGIN" : "REGISTER", job->username,
+                 session->isLoggedIn, job->username, code);
+    snprintf(response, sizeof(response), "%d\r\n", code);
+    connection_send(job->socket_fd, response, strlen(response));
+    app_unlock();
 
-    // Prepare response buffer (increased for MATCH_INFO)
-    char response[8192];
-    int response_code;
-
-    // TODO Step 3: Route commands to handlers
-    
-    // ========== Authentication Commands ==========
-    if (strcmp(type, "REGISTER") == 0) {
-        // TODO: Parse username and password from payload
-        // Expected format: "username password"
-        char username[128], password[128];
-        if (sscanf(payload, "%127s %127s", username, password) != 2) {
-            response_code = RESP_SYNTAX_ERROR;
-            snprintf(response, sizeof(response), "%d\r\n", response_code);
-            log_activity("REGISTER", NULL, false, payload, response_code);
-        } else {
-            // Call handler (single-threaded, no locking needed)
-            response_code = server_handle_register(app_context_get_user_table(), username, password);
-            snprintf(response, sizeof(response), "%d\r\n", response_code);
-            log_activity("REGISTER", username, false, payload, response_code);
-        }
+    connection_release(job->socket_fd);
+}
+
+/**
+ * Hand the password work to an auth worker. The connection is held until
+ * route_auth_done() replies, so later commands are answered in order.
+ *
+ * @return 0 if deferred, otherwise the code to reply now
+ */
+static int route_defer_auth(RouteContext *ctx, AuthKind kind, const char *username,
+                            const char *password, const char *stored_hash) {
+    AuthJob *job = auth_job_new(kind, ctx->client_sock, ctx->session->session_id, username, password);
+    if (!job) return RESP_INTERNAL_ERROR;
+    if (stored_hash) memcpy(job->stored_hash, stored_hash, MAX_PASSWORD_HASH);
+    job->done = route_auth_done;
+    if (auth_submit(job) != 0) {
+        auth_job_free(job);
+        return RESP_SERVER_BUSY;
     }
-    else if (strcmp(type, "LOGIN") == 0) {
-        // TODO: Parse username and password
-        char username[128], password[128];
-        if (sscanf(payload, "%127s %127s", username, password) != 2) {
-            response_code = RESP_SYNTAX_ERROR;
-            snprintf(response, sizeof(response), "%d\r\n", response_code);
-            log_activity("LOGIN", NULL, false, payload, response_code);
-        } else {
-            // Call handler (single-threaded, no locking needed)
-            response_code = server_handle_login(session, app_context_get_user_table(), username, password);
-            snprintf(response, sizeof(response), "%d\r\n", response_code);
-            log_activity("LOGIN", username, session->isLoggedIn, payload, response_code);
-        }
+    connection_hold(ctx->client_sock);
+    ctx->deferred = 1;
+    return 0;
+}
+
+static void route_register(RouteContext *ctx) {
+    // Expected format: "username password"
+    const char *username = command_next_token(&ctx->args, NULL);
+    const char *password = command_next_token(&ctx->args, NULL);
+    if (!username || !password) {
+        reply_code(ctx, RESP_SYNTAX_ERROR);
+        return;
     }
-    else if (strcmp(type, "WHOAMI") == 0) {
-        // TODO: Get username from session
-        char username[MAX_USERNAME];
-        response_code = server_handle_whoami(session, username);
-        if (response_code == RESP_WHOAMI_OK) {
-            snprintf(response, sizeof(response), "%d %s\r\n", response_code, username);
-            log_activity("WHOAMI", username, session->isLoggedIn, payload, response_code);
-        } else {
-            snprintf(response, sizeof(response), "%d\r\n", response_code);
-            log_activity("WHOAMI", NULL, false, payload, response_code);
-        }
+    int code = server_register_begin(app_context_get_user_table(), username, password);
+    if (code == 0) code = route_defer_auth(ctx, AUTH_REGISTER, username, password, NULL);
+    if (code != 0) reply_code(ctx, code);
+    log_as(ctx, username);
+}
+
+static void route_login(RouteContext *ctx) {
+    const char *username = command_next_token(&ctx->args, NULL);
+    const char *password = command_next_token(&ctx->args, NULL);
+    if (!username || !password) {
+        reply_code(ctx, RESP_SYNTAX_ERROR);
+        return;
     }
-    else if (strcmp(type, "BYE") == 0 || strcmp(type, "LOGOUT") == 0) {
-        // Preserve username before logout for accurate logging
-        char user_before[MAX_USERNAME];
-        strncpy(user_before, session->username, MAX_USERNAME - 1);
-        user_before[MAX_USERNAME - 1] = '\0';
+    char stored_hash[MAX_PASSWORD_HASH];
+    int code = server_login_begin(ctx->session, app_context_get_user_table(), username, stored_hash);
+    if (code == 0) code = route_defer_auth(ctx, AUTH_LOGIN, username, password, stored_hash);
+    if (code != 0) reply_code(ctx, code);
+    log_as(ctx, username);
+}
+
+static void route_whoami(RouteContext *ctx) {
+    char username[MAX_USERNAME];
+    ctx->response_code = server_handle_whoami(ctx->session, username);
+    if (ctx->response_code == RESP_WHOAMI_OK)
+        snprintf(ctx->response, ctx->response_size, "%d %s\r\n", ctx->response_code, username);
+    else
+        reply_code(ctx, ctx->response_code);
+}
 
-        // Call logout handler
-        response_code = server_handle_bye(session);
-        snprintf(response, sizeof(response), "%d\r\n", response_code);
+static void route_logout(RouteContext *ctx) {
+    reply_code(ctx, server_handle_bye(ctx->session));
+    // Log with the username the session had before logging out
+    ctx->log_user = ctx->user_before;
+}
 
-        // After logout, mark is_logged_in=false and use preserved username
-        log_activity("LOGOUT", user_before, false, payload, response_code);
+/* ============================================================================
+ * GAME COMMANDS
+ * ============================================================================ */
+
+static void route_getcoin(RouteContext *ctx) {
+    User *user = findUser(app_context_get_user_table(), ctx->session->username);
+    if (!user) {
+        reply_code(ctx, RESP_INTERNAL_ERROR);
+        return;
     }
+    ctx->response_code = RESP_COIN_OK;
+    snprintf(ctx->response, ctx->response_size, "%d %ld\r\n", ctx->response_code, user->coin);
+}
 
-    // ========== Game Commands ==========
-    else if (strcmp(type, "GETCOIN") == 0) {
-        // TODO: Check if logged in
-        if (!session->isLoggedIn) {
-            response_code = RESP_NOT_LOGGED;
-            snprintf(response, sizeof(response), "%d\r\n", response_code);
-            log_activity("GETCOIN", session->username, false, payload, response_code);
-        } else {
-            // TODO: Find user and get coin balance
-            User *user = findUser(app_context_get_user_table(), session->username);
-            if (user) {
-                response_code = RESP_COIN_OK;
-                snprintf(response, sizeof(response), "%d %ld\r\n", response_code, user->coin);
-                log_activity("GETCOIN", session->username, session->isLoggedIn, payload, response_code);
-            } else {
-                response_code = RESP_INTERNAL_ERROR;
-                snprintf(response, sizeof(response), "%d\r\n", response_code);
-                log_activity("GETCOIN", session->username, session->isLoggedIn, payload, response_code);
-            }
-        }
+static void route_getarmor(RouteContext *ctx) {
+    Ship *ship = find_ship(ctx->match_id, ctx->session->username);
+    if (!ship) {
+        reply_code(ctx, RESP_INTERNAL_ERROR);
+        return;
     }
-    else if (strcmp(type, "GETARMOR") == 0) {
-        // TODO: Check if logged in
-        if (!session->isLoggedIn) {
-            response_code = RESP_NOT_LOGGED;
-            snprintf(response, sizeof(response), "%d\r\n", response_code);
-            log_activity("GETARMOR", session->username, false, payload, response_code);
-        } else {
-            // TODO: Get match_id from session or lookup
-            int match_id = session->current_match_id;
-            if (match_id <= 0) {
-                match_id = find_current_match_by_username(session->username);
-            }
-            
-            if (match_id <= 0) {
-                response_code = RESP_NOT_IN_MATCH;
-                snprintf(response, sizeof(response), "%d\r\n", response_code);
-                log_activity("GETARMOR", session->username, session->isLoggedIn, payload, response_code);
-            } else {
-                // TODO: Find ship and format armor info
-                Ship *ship = find_ship(match_id, session->username);
-                if (ship) {
-                    response_code = RESP_ARMOR_INFO_OK;
-                    snprintf(response, sizeof(response), "%d %d %d %d %d\r\n",
-                             response_code,
-                             ship->armor_slot_1_type, ship->armor_slot_1_value,
-                             ship->armor_slot_2_type, ship->armor_slot_2_value);
-                    log_activity("GETARMOR", session->username, session->isLoggedIn, payload, response_code);
-                } else {
-                    response_code = RESP_INTERNAL_ERROR;
-                    snprintf(response, sizeof(response), "%d\r\n", response_code);
-                    log_activity("GETARMOR", session->username, session->isLoggedIn, payload, response_code);
-                }
-            }
-        }
+    if (ctx->wire) {
+        uint32_t fields[] = { (uint32_t)ship->armor_slot_1_type, (uint32_t)ship->armor_slot_1_value,
+                              (uint32_t)ship->armor_slot_2_type, (uint32_t)ship->armor_slot_2_value };
+        reply_wire(ctx, RESP_ARMOR_INFO_OK, fields, 4);
+        return;
     }
-    else if (strcmp(type, "BUYARMOR") == 0) {
-        // TODO: Parse armor type
-        int armor_type;
-        if (sscanf(payload, "%d", &armor_type) != 1) {
-            response_code = RESP_SYNTAX_ERROR;
-            snprintf(response, sizeof(response), "%d\r\n", response_code);
-            log_activity("BUYARMOR", session->username, false, payload, response_code);
-        } else {
-            // Call handler (single-threaded, no locking needed)
-            response_code = server_handle_buyarmor(session, app_context_get_user_table(), armor_type);
-            snprintf(response, sizeof(response), "%d\r\n", response_code);
-            log_activity("BUYARMOR", session->username, session->isLoggedIn, payload, response_code);
-        }
+    ctx->response_code = RESP_ARMOR_INFO_OK;
+    snprintf(ctx->response, ctx->response_size, "%d %d %d %d %d\r\n",
+             ctx->response_code,
+             ship->armor_slot_1_type, ship->armor_slot_1_value,
+             ship->armor_slot_2_type, ship->armor_slot_2_value);
+}
+
+static void route_buyarmor(RouteContext *ctx) {
+    int armor_type;
+    if (next_int(ctx, &armor_type) != 0) {
+        reply_code(ctx, RESP_SYNTAX_ERROR);
+        return;
     }
-    else if (strcmp(type, "GET_WEAPON") == 0) {
-        if(session->isLoggedIn == false) {
-            response_code = RESP_NOT_LOGGED;
-            snprintf(response, sizeof(response), "%d\r\n", response_code);
-            log_activity("GET_WEAPON", session->username, false, payload, response_code);
-        } else {
-            int match_id = session->current_match_id;
-            if (match_id <= 0) {
-                match_id = find_current_match_by_username(session->username);
-            }
-            if (match_id <= 0) {
-                response_code = RESP_NOT_IN_MATCH;
-                snprintf(response, sizeof(response), "%d\r\n", response_code);
-                log_activity("GET_WEAPON", session->username, session->isLoggedIn, payload, response_code);
-            } else {
-                Ship *ship = find_ship(match_id, session->username);
-                if (ship) {
-                    response_code = RESP_MATCH_INFO_OK;
-                    snprintf(response, sizeof(response), "%d %d %d %d\r\n",
-                             response_code,
-                             ship->cannon_ammo,
-                             ship->laser_count,
-                             ship->missile_count);
-                    log_activity("GET_WEAPON", session->username, session->isLoggedIn, payload, response_code);
-                } else {
-                    response_code = RESP_INTERNAL_ERROR;
-                    snprintf(response, sizeof(response), "%d\r\n", response_code);
-                    log_activity("GET_WEAPON", session->username, session->isLoggedIn, payload, response_code);
-                }
-            }
-        }
+    reply_code(ctx, server_handle_buyarmor(ctx->session, app_context_get_user_table(), armor_type));
+}
+
+static void route_get_weapon(RouteContext *ctx) {
+    Ship *ship = find_ship(ctx->match_id, ctx->session->username);
+    if (!ship) {
+        reply_code(ctx, RESP_INTERNAL_ERROR);
+        return;
     }
-    else if (strcmp(type, "BUY_WEAPON") == 0) {
-        int weapon_type;
-        if (sscanf(payload, "%d", &weapon_type) != 1) {
-            response_code = RESP_SYNTAX_ERROR;
-            snprintf(response, sizeof(response), "%d\r\n", response_code);
-            log_activity("BUY_WEAPON", session->username, false, payload, response_code);
-        } else {
-            response_code = server_handle_buy_weapon(session, app_context_get_user_table(), weapon_type);
-            snprintf(response, sizeof(response), "%d\r\n", response_code);
-            log_activity("BUY_WEAPON", session->username, session->isLoggedIn, payload, response_code);
-        }
+    if (ctx->wire) {
+        uint32_t fields[] = { (uint32_t)ship->cannon_ammo, (uint32_t)ship->laser_count,
+                              (uint32_t)ship->missile_count };
+        reply_wire(ctx, RESP_MATCH_INFO_OK, fields, 3);
+        return;
     }
-    else if (strcmp(type,"GET_MATCH_RESULT") == 0) {
-        int match_id = -1;
-        if (payload && sscanf(payload, "%d", &match_id) == 1 && match_id > 0) {
-            response_code = server_handle_get_match_result(session, match_id);
-        } else {
-            response_code = RESP_SYNTAX_ERROR;
-        }
-        if (response_code == RESP_MATCH_RESULT_OK) {
-            int winner = get_match_result(match_id);
-            snprintf(response, sizeof(response), "%d %d %d\r\n", response_code, match_id, winner);
-        } else {
-            snprintf(response, sizeof(response), "%d\r\n", response_code);
-        }
-        log_activity("GET_MATCH_RESULT", session->username, session->isLoggedIn, payload, response_code);
+    ctx->response_code = RESP_MATCH_INFO_OK;
+    snprintf(ctx->response, ctx->response_size, "%d %d %d %d\r\n",
+             ctx->response_code,
+             ship->cannon_ammo,
+             ship->laser_count,
+             ship->missile_count);
+}
+
+static void route_buy_weapon(RouteContext *ctx) {
+    int weapon_type;
+    if (next_int(ctx, &weapon_type) != 0) {
+        reply_code(ctx, RESP_SYNTAX_ERROR);
+        return;
     }
-    else if (strcmp(type, "START_MATCH") == 0) {
-        int opponent_team_id = -1;
-        if (payload && sscanf(payload, "%d", &opponent_team_id) == 1 && opponent_team_id > 0) {
-            response_code = server_handle_start_match(session, opponent_team_id);
-        } else {
-            response_code = RESP_SYNTAX_ERROR;
+    reply_code(ctx, server_handle_buy_weapon(ctx->session, app_context_get_user_table(), weapon_type));
+}
+
+static void route_get_match_result(RouteContext *ctx) {
+    int match_id = -1;
+    if (next_int(ctx, &match_id) != 0 || match_id <= 0) {
+        reply_code(ctx, RESP_SYNTAX_ERROR);
+        return;
+    }
+    ctx->response_code = server_handle_get_match_result(ctx->session, match_id);
+    if (ctx->response_code == RESP_MATCH_RESULT_OK) {
+        int winner = get_match_result(match_id);
+        snprintf(ctx->response, ctx->response_size, "%d %d %d\r\n", ctx->response_code, match_id, winner);
+    } else {
+        reply_code(ctx, ctx->response_code);
+    }
+}
+
+static void route_start_match(RouteContext *ctx) {
+    int opponent_team_id = -1;
+    if (next_int(ctx, &opponent_team_id) != 0 || opponent_team_id <= 0) {
+        reply_code(ctx, RESP_SYNTAX_ERROR);
+        return;
+    }
+    reply_code(ctx, server_handle_start_match(ctx->session, opponent_team_id));
+}
+
+static void route_end_match(RouteContext *ctx) {
+    int match_id = -1;
+    if (next_int(ctx, &match_id) != 0 || match_id <= 0) {
+        reply_code(ctx, RESP_SYNTAX_ERROR);
+        return;
+    }
+    reply_code(ctx, server_handle_end_match(ctx->session, match_id));
+}
+
+/* ============================================================================
+ * TEAM COMMANDS
+ * ============================================================================ */
+
+static void route_create_team(RouteContext *ctx) {
+    if (ctx->payload[0] == '\0') reply_code(ctx, RESP_SYNTAX_ERROR);
+    else reply_code(ctx, handle_create_team(ctx->session, app_context_get_user_table(), ctx->payload));
+}
+
+static void route_delete_team(RouteContext *ctx) {
+    reply_code(ctx, handle_delete_team(ctx->session));
+}
+
+static void route_list_teams(RouteContext *ctx) {
+    char list_buf[4096] = "";
+    ctx->response_code = handle_list_teams(ctx->session, list_buf, sizeof(list_buf));
+    if (ctx->response_code == RESP_LIST_TEAMS_OK && list_buf[0] != '\0')
+        snprintf(ctx->response, ctx->response_size, "%s\r\n", list_buf);
+    else
+        reply_code(ctx, ctx->response_code);
+}
+
+static void route_join_request(RouteContext *ctx) {
+    if (ctx->payload[0] == '\0') reply_code(ctx, RESP_SYNTAX_ERROR);
+    else reply_code(ctx, handle_join_request(ctx->session, ctx->payload));
+}
+
+static void route_join_approve(RouteContext *ctx) {
+    if (ctx->payload[0] == '\0') reply_code(ctx, RESP_SYNTAX_ERROR);
+    else reply_code(ctx, handle_join_approve(ctx->session, ctx->payload, app_context_get_user_table()));
+}
+
+static void route_join_reject(RouteContext *ctx) {
+    if (ctx->payload[0] == '\0') reply_code(ctx, RESP_SYNTAX_ERROR);
+    else reply_code(ctx, handle_join_reject(ctx->session, ctx->payload));
+}
+
+static void route_team_member_list(RouteContext *ctx) {
+    char members_buf[2048] = "";
+    ctx->response_code = handle_team_member_list(ctx->session, members_buf, sizeof(members_buf));
+    if (ctx->response_code == RESP_TEAM_MEMBERS_LIST_OK)
+        snprintf(ctx->response, ctx->response_size, "%d %s\r\n", ctx->response_code, members_buf);
+    else
+        reply_code(ctx, ctx->response_code);
+}
+
+static void route_leave_team(RouteContext *ctx) {
+    reply_code(ctx, handle_leave_team(ctx->session));
+}
+
+static void route_kick_member(RouteContext *ctx) {
+    if (ctx->payload[0] == '\0') reply_code(ctx, RESP_SYNTAX_ERROR);
+    else reply_code(ctx, handle_kick_member(ctx->session, ctx->payload));
+}
+
+static void route_invite(RouteContext *ctx) {
+    if (ctx->payload[0] == '\0') reply_code(ctx, RESP_SYNTAX_ERROR);
+    else reply_code(ctx, handle_invite(ctx->session, ctx->payload, app_context_get_user_table()));
+}
+
+static void route_invite_accept(RouteContext *ctx) {
+    if (ctx->payload[0] == '\0') reply_code(ctx, RESP_SYNTAX_ERROR);
+    else reply_code(ctx, handle_invite_accept(ctx->session, ctx->payload));
+}
+
+static void route_invite_reject(RouteContext *ctx) {
+    if (ctx->payload[0] == '\0') reply_code(ctx, RESP_SYNTAX_ERROR);
+    else reply_code(ctx, handle_invite_reject(ctx->session, ctx->payload));
+}
+
+static void route_check_invites(RouteContext *ctx) {
+    char invite_list[4096] = "";
+    ctx->response_code = handle_check_invites(ctx->session, invite_list, sizeof(invite_list));
+
+    if (invite_list[0] != '\0') {
+        // Gửi về dạng: "206 TeamA|TeamB|"
+        snprintf(ctx->response, ctx->response_size, "206 %s\r\n", invite_list);
+    } else {
+        // Không có lời mời
+        snprintf(ctx->response, ctx->response_size, "404 No pending invites\r\n");
+    }
+}
+
+static void route_check_join_requests(RouteContext *ctx) {
+    char req_list[4096] = "";
+    ctx->response_code = handle_check_join_requests(ctx->session, req_list, sizeof(req_list));
+
+    if (req_list[0] != '\0') {
+        // Gửi danh sách nếu có (206 là mã ví dụ cho List OK)
+        snprintf(ctx->response, ctx->response_size, "206 %s\r\n", req_list);
+    } else {
+        // Gửi mã lỗi nếu không có (404)
+        snprintf(ctx->response, ctx->response_size, "404 No requests\r\n");
+    }
+}
+
+/* ============================================================================
+ * MATCH COMMANDS
+ * ============================================================================ */
+
+static void route_repair(RouteContext *ctx) {
+    int amt = -1;
+    if (next_int(ctx, &amt) != 0) {
+        reply_code(ctx, RESP_SYNTAX_ERROR);
+        return;
+    }
+    RepairResult repair_result = {0};
+    ctx->response_code = server_handle_repair(ctx->session, app_context_get_user_table(), amt, &repair_result);
+    if (ctx->response_code == RESP_REPAIR_OK)
+        snprintf(ctx->response, ctx->response_size, "%d %d %d\r\n", ctx->response_code, repair_result.hp, repair_result.coin);
+    else
+        reply_code(ctx, ctx->response_code);
+}
+
+static void route_match_info(RouteContext *ctx) {
+    int match_id = -1;
+    if (next_int(ctx, &match_id) != 0) {
+        reply_code(ctx, RESP_SYNTAX_ERROR);
+        return;
+    }
+    char match_info[4096] = {0};
+    ctx->response_code = server_handle_match_info(match_id, match_info, sizeof(match_info));
+    if (ctx->response_code != RESP_MATCH_INFO_OK) {
+        reply_code(ctx, ctx->response_code);
+        return;
+    }
+    // Replace newlines with | to send as single line
+    for (int i = 0; match_info[i] != '\0'; i++) {
+        if (match_info[i] == '\n') match_info[i] = '|';
+    }
+    snprintf(ctx->response, ctx->response_size, "%d %s\r\n", ctx->response_code, match_info);
+}
+
+static void route_match_subscribe(RouteContext *ctx) {
+    int match_id = -1;
+    if (next_int(ctx, &match_id) != 0) {
+        reply_code(ctx, RESP_SYNTAX_ERROR);
+        return;
+    }
+    ctx->response_code = match_feed_subscribe(ctx->session, match_id, ctx->response, ctx->response_size);
+    if (ctx->response_code != RESP_MATCH_SNAPSHOT) reply_code(ctx, ctx->response_code);
+}
+
+static void route_match_unsubscribe(RouteContext *ctx) {
+    reply_code(ctx, match_feed_unsubscribe(ctx->session));
+}
+
+/*
+ * The reply goes out here, as the last text line: the connection reads
+ * and writes frames from the next byte on
+ */
+static void route_binary(RouteContext *ctx) {
+    reply_code(ctx, RESP_BINARY_OK);
+    if (connection_is_binary(ctx->client_sock)) return;
+    connection_send(ctx->client_sock, ctx->response, strlen(ctx->response));
+    connection_set_binary(ctx->client_sock);
+    ctx->sent = 1;
+}
+
+static void route_get_hp(RouteContext *ctx) {
+    int hp = -1, maxhp = -1;
+    ctx->response_code = server_handle_get_hp(ctx->session, &hp, &maxhp);
+    if (ctx->wire) {
+        uint32_t fields[] = { (uint32_t)hp, (uint32_t)maxhp };
+        reply_wire(ctx, ctx->response_code, fields, ctx->response_code == RESP_HP_INFO_OK ? 2 : 0);
+    } else if (ctx->response_code == RESP_HP_INFO_OK)
+        snprintf(ctx->response, ctx->response_size, "%d %d %d\r\n", ctx->response_code, hp, maxhp);
+    else
+        reply_code(ctx, ctx->response_code);
+    ctx->log_input = "";
+}
+
+// Reply to FIRE: the shot on a hit, otherwise the reason
+static void format_fire_reply(char *out, size_t size, int code, const char *attacker,
+                              const char *target_name, const FireResult *result) {
+    if (code == RESP_FIRE_OK) {
+        snprintf(out, size, "200 %s %s %d %d %d\r\n",
+                 attacker,
+                 target_name,
+                 result->damage_dealt,
+                 result->target_remaining_hp,
+                 result->target_remaining_armor);
+        return;
+    }
+
+    //Xử lý thông báo lỗi chi tiết
+    const char *err_msg = "FIRE_FAIL";
+    if (code == RESP_OUT_OF_AMMO) err_msg = "Out of Ammo";
+    else if (code == RESP_WEAPON_NOT_EQUIPPED) err_msg = "Weapon Not Equipped";
+    else if (code == RESP_TARGET_DESTROYED) err_msg = "Target Destroyed";
+    else if (code == RESP_INVALID_TARGET) err_msg = "Invalid Target";
+    else if (code == RESP_NOT_IN_MATCH) err_msg = "Not in Match";
+
+    snprintf(out, size, "%d %s\r\n", code, err_msg);
+}
+
+// Binary reply to FIRE (wire.h); returns bytes written
+static size_t encode_fire_reply(void *out, size_t size, int code, const FireResult *result) {
+    uint32_t fields[] = { (uint32_t)result->damage_dealt, (uint32_t)result->target_remaining_hp,
+                          (uint32_t)result->target_remaining_armor };
+    return encode_reply(out, size, WIRE_FIRE, code, fields, code == RESP_FIRE_OK ? 3 : 0);
+}
+
+/* The match's tick (world lock held): apply a queued FIRE and answer it */
+static int route_fire_apply(MatchInput *in) {
+    char response[256];
+    char input[2 * MAX_USERNAME];
+
+    SessionNode *node = find_session_by_handle(in->socket_fd, in->session_id);
+    if (!node) return -1;   // Closed while the shot was queued
+    ServerSession *session = &node->session;
+
+    // Only this match's ships are locked: the shooter must still be in it
+    int code = session->current_match_id == in->match_id
+             ? server_handle_fire(session, in->target, in->weapon, &in->result)
+             : RESP_NOT_IN_MATCH;
+    snprintf(input, sizeof(input), "%s %d", in->target, in->weapon);
+    log_activity("FIRE", session->username, session->isLoggedIn, input, code);
+    if (in->wire) {
+        size_t len = encode_fire_reply(response, sizeof(response), code, &in->result);
+        connection_send_frame(in->socket_fd, response, len, NULL);
+        return code;
+    }
+    format_fire_reply(response, sizeof(response), code, session->username, in->target, &in->result);
+    connection_send(in->socket_fd, response, strlen(response));
+    return code;
+}
+
+/**
+ * Queue the shot for the match's next tick. The connection is held until
+ * the tick answers, so later commands are answered in order.
+ *
+ * @return 0 if deferred, -1 to apply it now (no tick engine on the match)
+ */
+static int route_defer_fire(RouteContext *ctx, const char *target_name, int weapon_id) {
+    if (!ctx->session->isLoggedIn) return -1;
+    int match_id = ctx->session->current_match_id;
+    if (match_id <= 0) match_id = find_current_match_by_username(ctx->session->username);
+    Match *match = find_match_by_id(match_id);
+    if (!match || !match->ticker) return -1;
+    // Not joined yet (so run under app_lock()): the tick only applies shots of members
+    if (ctx->session->current_match_id <= 0) session_join_match(ctx->session, match_id);
+
+    MatchInput *in = calloc(1, sizeof(MatchInput));
+    if (!in) return -1;
+    in->socket_fd = ctx->client_sock;
+    in->session_id = ctx->session->session_id;
+    snprintf(in->attacker, sizeof(in->attacker), "%s", ctx->session->username);
+    snprintf(in->target, sizeof(in->target), "%s", target_name);
+    in->weapon = weapon_id;
+    in->match_id = match_id;
+    in->wire = ctx->wire != WIRE_TEXT;
+    in->apply = route_fire_apply;
+    if (match_engine_submit(match, in) != 0) {
+        free(in);
+        return -1;
+    }
+    connection_hold(ctx->client_sock);
+    ctx->deferred = 1;
+    return 0;
+}
+
+static void route_fire(RouteContext *ctx) {
+    int weapon_id;
+    // Parse: FIRE <target> <weapon>
+    const char *target_name = command_next_token(&ctx->args, NULL);
+    if (!target_name || next_int(ctx, &weapon_id) != 0) {
+        if (ctx->wire) {
+            reply_code(ctx, RESP_SYNTAX_ERROR);
+            return;
         }
-        snprintf(response, sizeof(response), "%d\r\n", response_code);
-        log_activity("START_MATCH", session->username, session->isLoggedIn, payload, response_code);
+        ctx->response_code = RESP_SYNTAX_ERROR;
+        snprintf(ctx->response, ctx->response_size, "301 SYNTAX_ERROR\r\n");
+        return;
     }
-    else if (strcmp(type, "END_MATCH") == 0) {
-        int match_id = -1;
-        if (payload && sscanf(payload, "%d", &match_id) == 1 && match_id > 0) {
-            response_code = server_handle_end_match(session, match_id);
-        } else {
-            response_code = RESP_SYNTAX_ERROR;
+
+    // With the tick engine (match_engine.h) the shot lands at the next tick
+    if (route_defer_fire(ctx, target_name, weapon_id) == 0) return;
+
+    FireResult result;
+    memset(&result, 0, sizeof(FireResult));
+    ctx->response_code = server_handle_fire(ctx->session, target_name, weapon_id, &result);
+    if (ctx->wire) {
+        ctx->response_len = encode_fire_reply(ctx->response, ctx->response_size,
+                                              ctx->response_code, &result);
+    } else {
+        format_fire_reply(ctx->response, ctx->response_size, ctx->response_code,
+                          ctx->session->username, target_name, &result);
+    }
+
+    if (ctx->response_code == RESP_FIRE_OK) {
+        // Broadcast fire event tới tất cả (trừ attacker) - bao gồm cả target
+        broadcast_fire_event(ctx->session->current_match_id, ctx->session->username, target_name,
+                             result.damage_dealt,
+                             result.target_remaining_hp,
+                             result.target_remaining_armor);
+    }
+}
+
+/* ============================================================================
+ * CHALLENGE COMMANDS
+ * ============================================================================ */
+
+static void route_send_challenge(RouteContext *ctx) {
+    int target_team = next_id(ctx);
+    int cid = 0;
+    ctx->response_code = server_handle_send_challenge(ctx->session, target_team, &cid);
+
+    if (ctx->response_code == RESP_CHALLENGE_SENT)
+        snprintf(ctx->response, ctx->response_size, "%d CHALLENGE_SENT %d\r\n", ctx->response_code, cid);
+    else
+        snprintf(ctx->response, ctx->response_size, "%d CHALLENGE_FAIL\r\n", ctx->response_code);
+}
+
+static void route_accept_challenge(RouteContext *ctx) {
+    // Nếu client không gửi ID, tìm challenge ID đang PENDING của team này
+    int cid = next_id(ctx);
+    if (cid == 0) {
+        cid = find_latest_pending_challenge_for_team(ctx->session->current_team_id);
+    }
+    ctx->response_code = server_handle_accept_challenge(ctx->session, cid);
+    snprintf(ctx->response, ctx->response_size, "%d CHALLENGE_ACCEPTED %d\r\n", ctx->response_code, cid);
+
+    // Gửi response ngay lập tức để đảm bảo response đến trước broadcast chest drop
+    connection_send(ctx->client_sock, ctx->response, strlen(ctx->response));
+    ctx->sent = 1;
+
+    // Sau khi gửi response, gửi 151 MATCH_STARTED và broadcast chest drop nếu challenge được accept thành công
+    if (ctx->response_code == RESP_CHALLENGE_ACCEPTED) {
+        // Lấy match_id từ session hiện tại (đã được cập nhật trong server_handle_accept_challenge)
+        int match_id = ctx->session->current_match_id;
+        if (match_id > 0) {
+            // Bước 1: Gửi 151 MATCH_STARTED tới tất cả thành viên
+            broadcast_match_started(match_id);
+
+            // Bước 2: Sau đó mới broadcast chest drop (141)
+            broadcast_chest_drop(match_id, -1);
         }
-        snprintf(response, sizeof(response), "%d\r\n", response_code);
-        log_activity("END_MATCH", session->username, session->isLoggedIn, payload, response_code);
-    }
-
-    // ========== Team/Challenge Commands (Future) ==========
-    // TODO: Add more commands here as you implement team features
-    // Examples:
-    // - CREATE_TEAM
-    // - DELETE_TEAM
-    // - JOIN_REQUEST
-    // - TEAM_INVITE
-    // - SEND_CHALLENGE
-    // etc.
-
-    // else if (strcmp(type, "FIRE") == 0) {
-    //     int target_id, weapon_id;
-    //     // Parse: FIRE <target> <weapon>
-    //     if (sscanf(payload, "%d %d", &target_id, &weapon_id) == 2) {
-    //         FireResult result;
-    //         memset(&result, 0, sizeof(FireResult));
-            
-    //         // Gọi Logic (Lưu ý: session ở đây đã có sẵn từ code gốc, không cần tạo mới)
-    //         response_code = server_handle_fire(session, target_id, weapon_id, &result);
-            
-    //         if (response_code == RESP_COIN_OK) {
-    //             // 1. Chuẩn bị response cho người bắn (sẽ được gửi ở cuối hàm)
-    //             snprintf(response, sizeof(response), "131 %d %d %d %d\r\n", 
-    //                      result.target_id, result.damage_dealt, 
-    //                      result.target_remaining_hp, result.target_remaining_armor);
-                
-    //             // 2. Broadcast cho mọi người khác (Gửi ngay lập tức)
-    //             broadcast_fire_event(result.attacker_id, result.target_id, result.damage_dealt, result.target_remaining_hp, result.target_remaining_armor);
-    //         } else {
-    //             // Gửi lỗi
-    //             snprintf(response, sizeof(response), "%d FIRE_FAIL\r\n", response_code);
-    //         }
-    //     } else {
-    //         snprintf(response, sizeof(response), "301 SYNTAX_ERROR\r\n");
-    //     }
-    // }
-
-    // // --- XỬ LÝ CHALLENGE (Thách đấu) ---
-    // else if (strcmp(type, "SEND_CHALLENGE") == 0) {
-    //     int target_team = atoi(payload);
-    //     int cid = 0;
-    //     response_code = server_handle_send_challenge(session, target_team, &cid);
-        
-    //     if (response_code == RESP_CHALLENGE_SENT)
-    //         snprintf(response, sizeof(response), "130 CHALLENGE_SENT %d\r\n", cid);
-    //     else 
-    //         snprintf(response, sizeof(response), "%d CHALLENGE_FAIL\r\n", response_code);
-    // }
-    // else if (strcmp(type, "ACCEPT_CHALLENGE") == 0) {
-    //     int cid = atoi(payload);
-    //     response_code = server_handle_accept_challenge(session, cid);
-    //     snprintf(response, sizeof(response), "%d CHALLENGE_ACCEPTED %d\r\n", response_code, cid);
-    // }
-    // else if (strcmp(type, "DECLINE_CHALLENGE") == 0) {
-    //     int cid = atoi(payload);
-    //     response_code = server_handle_decline_challenge(session, cid);
-    //     snprintf(response, sizeof(response), "%d CHALLENGE_DECLINED %d\r\n", response_code, cid);
-    // }
-    // else if (strcmp(type, "CANCEL_CHALLENGE") == 0) {
-    //     int cid = atoi(payload);
-    //     response_code = server_handle_cancel_challenge(session, cid);
-    //     snprintf(response, sizeof(response), "%d CHALLENGE_CANCELED %d\r\n", response_code, cid);
-    // }
-
-    // // --- XỬ LÝ CHEST (Rương) ---
-    // else if (strcmp(type, "CHEST_OPEN") == 0) {
-    //     int chest_id;
-    //     char answer[128];
-    //     if (sscanf(payload, "%d %[^\n]", &chest_id, answer) == 2) {
-    //         response_code = server_handle_open_chest(session, chest_id, answer);
-            
-    //         if (response_code == RESP_CHEST_OPEN_OK)
-    //             snprintf(response, sizeof(response), "127 CHEST_OPEN_SUCCESS\r\n");
-    //         else
-    //             snprintf(response, sizeof(response), "%d CHEST_OPEN_FAIL\r\n", response_code);
-    //         log_activity("CHEST_OPEN", session->username, session->isLoggedIn, payload, response_code);
-    //     } else {
-    //         snprintf(response, sizeof(response), "301 SYNTAX_ERROR\r\n");
-    //         log_activity("CHEST_OPEN", session->username, session->isLoggedIn, payload, RESP_SYNTAX_ERROR);
-    //     }
-    // }
-
-    // ========== TEAM COMMANDS (moved from server.c) ==========
-    else if (strcmp(type, "CREATE_TEAM") == 0 || strcmp(type, "CREATETEAM") == 0) {
-        if (!payload || strlen(payload) == 0) {
-            response_code = RESP_SYNTAX_ERROR;
+    }
+}
+
+static void route_decline_challenge(RouteContext *ctx) {
+    int cid = next_id(ctx);
+    ctx->response_code = server_handle_decline_challenge(ctx->session, cid);
+    snprintf(ctx->response, ctx->response_size, "%d CHALLENGE_DECLINED %d\r\n", ctx->response_code, cid);
+}
+
+static void route_cancel_challenge(RouteContext *ctx) {
+    int cid = next_id(ctx);
+    ctx->response_code = server_handle_cancel_challenge(ctx->session, cid);
+    snprintf(ctx->response, ctx->response_size, "%d CHALLENGE_CANCELED %d\r\n", ctx->response_code, cid);
+}
+
+/* ============================================================================
+ * CHEST COMMANDS
+ * ============================================================================ */
+
+static void route_chest_open(RouteContext *ctx) {
+    int chest_id;
+
+    // Thử đọc 2 tham số: ID và Đáp án
+    if (next_int(ctx, &chest_id) != 0) {
+        ctx->response_code = RESP_SYNTAX_ERROR;
+        snprintf(ctx->response, ctx->response_size, "301 SYNTAX_ERROR\r\n");
+        return;
+    }
+    const char *answer = command_rest(&ctx->args);
+
+    if (answer[0] == '\0') {
+        // TRƯỜNG HỢP 1: Client chỉ gửi ID -> Muốn lấy câu hỏi
+        char question[256];
+        ctx->response_code = server_handle_get_chest_question(ctx->session, chest_id, question);
+
+        if (ctx->response_code == RESP_CHEST_QUESTION) { // 211
+            snprintf(ctx->response, ctx->response_size, "211 %s\r\n", question);
         } else {
-            response_code = handle_create_team(session, app_context_get_user_table(), payload);
+            // Gửi lỗi nếu không tìm thấy rương
+            snprintf(ctx->response, ctx->response_size, "%d CHEST_ERROR\r\n", ctx->response_code);
         }
-        snprintf(response, sizeof(response), "%d\r\n", response_code);
-        log_activity("CREATE_TEAM", session->username, session->isLoggedIn, payload, response_code);
-    }
-    else if (strcmp(type, "DELETE_TEAM") == 0) {
-        response_code = handle_delete_team(session);
-        snprintf(response, sizeof(response), "%d\r\n", response_code);
-        log_activity("DELETE_TEAM", session->username, session->isLoggedIn, payload, response_code);
-    }
-    else if (strcmp(type, "LIST_TEAMS") == 0) {
-        char list_buf[4096] = "";
-        response_code = handle_list_teams(session, list_buf, sizeof(list_buf));
-        if (response_code == RESP_LIST_TEAMS_OK && strlen(list_buf) > 0)
-            snprintf(response, sizeof(response), "%s\r\n", list_buf);
-        else
-            snprintf(response, sizeof(response), "%d\r\n", response_code);
-        log_activity("LIST_TEAMS", session->username, session->isLoggedIn, payload, response_code);
-    }
-    else if (strcmp(type, "JOIN_REQUEST") == 0) {
-        if (!payload || strlen(payload) == 0) response_code = RESP_SYNTAX_ERROR;
-        else response_code = handle_join_request(session, payload);
-        snprintf(response, sizeof(response), "%d\r\n", response_code);
-        log_activity("JOIN_REQUEST", session->username, session->isLoggedIn, payload, response_code);
-    }
-    else if (strcmp(type, "JOIN_APPROVE") == 0) {
-        if (!payload || strlen(payload) == 0) response_code = RESP_SYNTAX_ERROR;
-        else response_code = handle_join_approve(session, payload, app_context_get_user_table());
-        snprintf(response, sizeof(response), "%d\r\n", response_code);
-        log_activity("JOIN_APPROVE", session->username, session->isLoggedIn, payload, response_code);
-    }
-    else if (strcmp(type, "JOIN_REJECT") == 0) {
-        if (!payload || strlen(payload) == 0) response_code = RESP_SYNTAX_ERROR;
-        else response_code = handle_join_reject(session, payload);
-        snprintf(response, sizeof(response), "%d\r\n", response_code);
-        log_activity("JOIN_REJECT", session->username, session->isLoggedIn, payload, response_code);
-    }
-    else if (strcmp(type, "TEAM_MEMBER_LIST") == 0) {
-        char members_buf[2048] = "";
-        response_code = handle_team_member_list(session, members_buf, sizeof(members_buf));
-        if (response_code == RESP_TEAM_MEMBERS_LIST_OK)
-            snprintf(response, sizeof(response), "%d %s\r\n", response_code, members_buf);
+    }
+    else {
+        // TRƯỜNG HỢP 2: Client gửi ID + Đáp án -> Muốn trả lời
+        ctx->response_code = server_handle_open_chest(ctx->session, app_context_get_user_table(), chest_id, answer);
+
+        if (ctx->response_code == RESP_CHEST_OPEN_OK) // 145
+            snprintf(ctx->response, ctx->response_size, "%d CHEST_OPEN_SUCCESS\r\n", RESP_CHEST_OPEN_OK);
         else
-            snprintf(response, sizeof(response), "%d\r\n", response_code);
-        log_activity("TEAM_MEMBER_LIST", session->username, session->isLoggedIn, payload, response_code);
-    }
-    else if (strcmp(type, "LEAVE_TEAM") == 0) {
-        response_code = handle_leave_team(session);
-        snprintf(response, sizeof(response), "%d\r\n", response_code);
-        log_activity("LEAVE_TEAM", session->username, session->isLoggedIn, payload, response_code);
-    }
-    else if (strcmp(type, "KICK_MEMBER") == 0) {
-        if (!payload || strlen(payload) == 0) response_code = RESP_SYNTAX_ERROR;
-        else response_code = handle_kick_member(session, payload);
-        snprintf(response, sizeof(response), "%d\r\n", response_code);
-        log_activity("KICK_MEMBER", session->username, session->isLoggedIn, payload, response_code);
-    }
-    else if (strcmp(type, "INVITE") == 0) {
-        if (!payload || strlen(payload) == 0) response_code = RESP_SYNTAX_ERROR;
-        else response_code = handle_invite(session, payload, app_context_get_user_table());
-        snprintf(response, sizeof(response), "%d\r\n", response_code);
-        log_activity("INVITE", session->username, session->isLoggedIn, payload, response_code);
-    }
-    else if (strcmp(type, "INVITE_ACCEPT") == 0) {
-        if (!payload || strlen(payload) == 0) response_code = RESP_SYNTAX_ERROR;
-        else response_code = handle_invite_accept(session, payload);
-        snprintf(response, sizeof(response), "%d\r\n", response_code);
-        log_activity("INVITE_ACCEPT", session->username, session->isLoggedIn, payload, response_code);
-    }
-    else if (strcmp(type, "INVITE_REJECT") == 0) {
-        if (!payload || strlen(payload) == 0) response_code = RESP_SYNTAX_ERROR;
-        else response_code = handle_invite_reject(session, payload);
-        snprintf(response, sizeof(response), "%d\r\n", response_code);
-        log_activity("INVITE_REJECT", session->username, session->isLoggedIn, payload, response_code);
-    }
-    else if (strcmp(type, "CHECK_INVITES") == 0 || strcmp(type, "GET_INVITES") == 0) {
-        char invite_list[4096] = "";
-        // Giả sử RESP_INVITE_LIST_OK là 206 (hoặc bạn tự define trong config.h)
-        // Nếu chưa có, bạn có thể dùng tạm RESP_OK (200) hoặc số 206 cứng.
-        int code = handle_check_invites(session, invite_list, sizeof(invite_list));
-        
-        // Nếu tìm thấy lời mời (giả sử hàm trả về RESP_OK hoặc 206 khi có dữ liệu)
-        if (strlen(invite_list) > 0) {
-            // Gửi về dạng: "206 TeamA|TeamB|"
-            snprintf(response, sizeof(response), "206 %s\r\n", invite_list);
-            // Lưu ý: 206 là mã ví dụ, hãy đảm bảo Client.c check đúng mã này
-        } else {
-            // Không có lời mời
-            snprintf(response, sizeof(response), "404 No pending invites\r\n");
-        }
-        log_activity("CHECK_INVITES", session->username, session->isLoggedIn, payload, code);
-    }
-    else if (strcmp(type, "CHECK_JOIN_REQUESTS") == 0) {
-        char req_list[4096] = "";
-        response_code = handle_check_join_requests(session, req_list, sizeof(req_list));
-        
-        if (strlen(req_list) > 0) {
-            // Gửi danh sách nếu có (206 là mã ví dụ cho List OK)
-            snprintf(response, sizeof(response), "206 %s\r\n", req_list);
-        } else {
-            // Gửi mã lỗi nếu không có (404)
-            snprintf(response, sizeof(response), "404 No requests\r\n");
-        }
-        log_activity("CHECK_JOIN_REQUESTS", session->username, session->isLoggedIn, payload, response_code);
-    }
-
-    // ========== REPAIR ==========
-    else if (strcmp(type, "REPAIR") == 0) {
-        int amt = -1;
-        if (payload && sscanf(payload, "%d", &amt) == 1) {
-            RepairResult repair_result = {0};
-            response_code = server_handle_repair(session, app_context_get_user_table(), amt, &repair_result);
-            if (response_code == RESP_REPAIR_OK)
-                snprintf(response, sizeof(response), "%d %d %d\r\n", response_code, repair_result.hp, repair_result.coin);
-            else
-                snprintf(response, sizeof(response), "%d\r\n", response_code);
-        } else {
-            response_code = RESP_SYNTAX_ERROR;
-            snprintf(response, sizeof(response), "%d\r\n", response_code);
-        }
-        log_activity("REPAIR", session->username, session->isLoggedIn, payload, response_code);
-    }
-
-    // ========== MATCH INFO ==========
-    else if (strcmp(type, "MATCH_INFO") == 0) {
-        int match_id = -1;
-        if (payload && sscanf(payload, "%d", &match_id) == 1) {
-            char match_info[4096] = {0};
-            response_code = server_handle_match_info(match_id, match_info, sizeof(match_info), app_context_get_user_table());
-            printf("[DEBUG] MATCH_INFO response_code=%d, info_len=%zu\n", response_code, strlen(match_info));
-            if (response_code == RESP_MATCH_INFO_OK) {
-                // Replace newlines with | to send as single line
-                for (int i = 0; match_info[i] != '\0'; i++) {
-                    if (match_info[i] == '\n') match_info[i] = '|';
-                }
-                int written = snprintf(response, sizeof(response), "%d %s\r\n", response_code, match_info);
-                printf("[DEBUG] Response length: %d bytes, response: %.100s...\n", written, response);
-            } else {
-                snprintf(response, sizeof(response), "%d\r\n", response_code);
-            }
-        } else {
-            response_code = RESP_SYNTAX_ERROR;
-            snprintf(response, sizeof(response), "%d\r\n", response_code);
-        }
-        log_activity("MATCH_INFO", session->username, session->isLoggedIn, payload, response_code);
+            snprintf(ctx->response, ctx->response_size, "%d CHEST_OPEN_FAIL\r\n", ctx->response_code);
     }
+}
 
-        // ========== GET HP ==========
+//test rương
+static void route_debug_chest(RouteContext *ctx) {
+    if (ctx->session->current_match_id > 0) {
+        // Truyền session->socket_fd để hàm broadcast biết đường tránh
+        int chest_id = broadcast_chest_drop(ctx->session->current_match_id, ctx->session->socket_fd);
 
-    else if (strcmp(type, "GET_HP") == 0) {
+        // Chỉ gửi tin nhắn 200 này về cho người thả
+        ctx->response_code = 200;
+        snprintf(ctx->response, ctx->response_size, "200 CHEST_DROPPED %d\r\n", chest_id);
+    } else {
+        ctx->response_code = 500;
+        snprintf(ctx->response, ctx->response_size, "500 NOT_IN_MATCH\r\n");
+    }
+}
 
-        int hp = -1, maxhp = -1;
+/* ============================================================================
+ * COMMAND REGISTRY
+ * ============================================================================ */
 
-        response_code = server_handle_get_hp(session, &hp, &maxhp);
+static const Route route_table[] = {
+    // Authentication
+    { "REGISTER",            route_register,            0,                                       "REGISTER" },
+    { "LOGIN",               route_login,               0,                                       "LOGIN" },
+    { "WHOAMI",              route_whoami,              ROUTE_USERS,                             "WHOAMI" },
+    { "BINARY",              route_binary,              0,                                       "BINARY" },
+    { "BYE",                 route_logout,              0,                                       "LOGOUT" },
+    { "LOGOUT",              route_logout,              0,                                       "LOGOUT" },
 
-        if (response_code == RESP_HP_INFO_OK) {
+    // Game
+    { "GETCOIN",             route_getcoin,             ROUTE_AUTH | ROUTE_USERS,                "GETCOIN" },
+    { "GETARMOR",            route_getarmor,            ROUTE_AUTH | ROUTE_MATCH | ROUTE_SHARED, "GETARMOR" },
+    { "BUYARMOR",            route_buyarmor,            ROUTE_SHIP,                              "BUYARMOR" },
+    { "GET_WEAPON",          route_get_weapon,          ROUTE_AUTH | ROUTE_MATCH | ROUTE_SHARED, "GET_WEAPON" },
+    { "BUY_WEAPON",          route_buy_weapon,          ROUTE_SHIP,                              "BUY_WEAPON" },
+    { "GET_MATCH_RESULT",    route_get_match_result,    0,                                       "GET_MATCH_RESULT" },
+    { "START_MATCH",         route_start_match,         0,                                       "START_MATCH" },
+    { "END_MATCH",           route_end_match,           0,                                       "END_MATCH" },
 
-            snprintf(response, sizeof(response), "%d %d %d\r\n", response_code, hp, maxhp);
+    // Team
+    { "CREATE_TEAM",         route_create_team,         0,                                       "CREATE_TEAM" },
+    { "CREATETEAM",          route_create_team,         0,                                       "CREATE_TEAM" },
+    { "DELETE_TEAM",         route_delete_team,         0,                                       "DELETE_TEAM" },
+    { "LIST_TEAMS",          route_list_teams,          0,                                       "LIST_TEAMS" },
+    { "JOIN_REQUEST",        route_join_request,        0,                                       "JOIN_REQUEST" },
+    { "JOIN_APPROVE",        route_join_approve,        0,                                       "JOIN_APPROVE" },
+    { "JOIN_REJECT",         route_join_reject,         0,                                       "JOIN_REJECT" },
+    { "TEAM_MEMBER_LIST",    route_team_member_list,    0,                                       "TEAM_MEMBER_LIST" },
+    { "LEAVE_TEAM",          route_leave_team,          0,                                       "LEAVE_TEAM" },
+    { "KICK_MEMBER",         route_kick_member,         0,                                       "KICK_MEMBER" },
+    { "INVITE",              route_invite,              0,                                       "INVITE" },
+    { "INVITE_ACCEPT",       route_invite_accept,       0,                                       "INVITE_ACCEPT" },
+    { "INVITE_REJECT",       route_invite_reject,       0,                                       "INVITE_REJECT" },
+    { "CHECK_INVITES",       route_check_invites,       0,                                       "CHECK_INVITES" },
+    { "GET_INVITES",         route_check_invites,       0,                                       "CHECK_INVITES" },
+    { "CHECK_JOIN_REQUESTS", route_check_join_requests, 0,                                       "CHECK_JOIN_REQUESTS" },
 
-        } else {
+    // Match
+    { "REPAIR",              route_repair,              ROUTE_SHIP,                              "REPAIR" },
+    { "MATCH_INFO",          route_match_info,          0,                                       "MATCH_INFO" },
+    { "MATCH_SUBSCRIBE",     route_match_subscribe,     ROUTE_AUTH,                              "MATCH_SUBSCRIBE" },
+    { "MATCH_UNSUBSCRIBE",   route_match_unsubscribe,   ROUTE_AUTH,                              "MATCH_UNSUBSCRIBE" },
+    { "GET_HP",              route_get_hp,              ROUTE_SHARED,                            "GET_HP" },
+    { "FIRE",                route_fire,                ROUTE_SHIP | ROUTE_SHARED,               "FIRE" },
 
-            snprintf(response, sizeof(response), "%d\r\n", response_code);
+    // Challenge
+    { "SEND_CHALLENGE",      route_send_challenge,      0,                                       "SEND_CHALLENGE" },
+    { "ACCEPT_CHALLENGE",    route_accept_challenge,    0,                                       "ACCEPT_CHALLENGE" },
+    { "DECLINE_CHALLENGE",   route_decline_challenge,   0,                                       "DECLINE_CHALLENGE" },
+    { "CANCEL_CHALLENGE",    route_cancel_challenge,    0,                                       "CANCEL_CHALLENGE" },
 
-        }
+    // Chest
+    { "CHEST_OPEN",          route_chest_open,          0,                                       "CHEST_OPEN" },
+    { "DEBUG_CHEST",         route_debug_chest,         0,                                       "DEBUG_CHEST" },
+};
 
-        log_activity("GET_HP", session->username, session->isLoggedIn, "", response_code);
-
-    }
-     // =================Fire===============
-    else if (strcmp(type, "FIRE") == 0) {
-        char target_name[128];
-        int  weapon_id;
-        // Parse: FIRE <target> <weapon>
-        if (sscanf(payload, "%s %d", target_name , &weapon_id) == 2) {
-            FireResult result;
-            memset(&result, 0, sizeof(FireResult));
-            
-            // Gọi Logic
-            response_code = server_handle_fire(session, target_name, weapon_id, &result);
-            
-
-            if (response_code == RESP_FIRE_OK) { // Sửa lại hằng số này cho đúng với config.h
-                // Chuẩn bị response cho người bắn
-                snprintf(response, sizeof(response), "200 %s %s %d %d %d\r\n", 
-                         session->username,         
-                         target_name,              
-                         result.damage_dealt, 
-                         result.target_remaining_hp, 
-                         result.target_remaining_armor);
-                
-                // Broadcast fire event tới tất cả (trừ attacker) - bao gồm cả target
-                broadcast_fire_event(session->username, target_name, 
-                                     result.damage_dealt, 
-                                     result.target_remaining_hp, 
-                                     result.target_remaining_armor);
-            } else {
-                //Xử lý thông báo lỗi chi tiết
-                const char *err_msg = "FIRE_FAIL";
-                if (response_code == RESP_OUT_OF_AMMO) err_msg = "Out of Ammo";
-                else if (response_code == RESP_WEAPON_NOT_EQUIPPED) err_msg = "Weapon Not Equipped";
-                else if (response_code == RESP_TARGET_DESTROYED) err_msg = "Target Destroyed";
-                else if (response_code == RESP_INVALID_TARGET) err_msg = "Invalid Target";
-                else if (response_code == RESP_NOT_IN_MATCH) err_msg = "Not in Match";
-
-                snprintf(response, sizeof(response), "%d %s\r\n", response_code, err_msg);
-            }
-        } else {
-            snprintf(response, sizeof(response), "301 SYNTAX_ERROR\r\n");
+#define ROUTE_COUNT       ((int)(sizeof(route_table) / sizeof(route_table[0])))
+#define ROUTE_INDEX_SIZE  256   /**< Power of two, well above ROUTE_COUNT */
+#define ROUTE_EMPTY       0xFF
+
+static uint8_t route_index[ROUTE_INDEX_SIZE];
+static uint32_t route_seed = 0;
+static int route_perfect = 0;   /**< 1 when every name owns its slot under route_seed */
+
+// Seeded FNV-1a so router_init() can search for a collision-free seed
+static uint32_t route_hash(uint32_t seed, const char *s) {
+    uint32_t h = 2166136261u ^ seed;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h ^ (h >> 16);
+}
+
+// Fill route_index for a seed; returns 0 on a collision unless probing is allowed
+static int route_build(uint32_t seed, int allow_probe) {
+    memset(route_index, ROUTE_EMPTY, sizeof(route_index));
+    for (int i = 0; i < ROUTE_COUNT; i++) {
+        uint32_t slot = route_hash(seed, route_table[i].name) & (ROUTE_INDEX_SIZE - 1);
+        while (route_index[slot] != ROUTE_EMPTY) {
+            if (!allow_probe) return 0;
+            slot = (slot + 1) & (ROUTE_INDEX_SIZE - 1);
         }
+        route_index[slot] = (uint8_t)i;
     }
+    return 1;
+}
 
-    // --- XỬ LÝ CHALLENGE (Thách đấu) ---
-    else if (strcmp(type, "SEND_CHALLENGE") == 0) {
-        int target_team = atoi(payload);
-        int cid = 0;
-        response_code = server_handle_send_challenge(session, target_team, &cid);
-        
-        if (response_code == RESP_CHALLENGE_SENT)
-            snprintf(response, sizeof(response), "%d CHALLENGE_SENT %d\r\n", response_code, cid);
-        else 
-            snprintf(response, sizeof(response), "%d CHALLENGE_FAIL\r\n", response_code);
-    }
-    else if (strcmp(type, "ACCEPT_CHALLENGE") == 0) {
-        int cid;
-        // Nếu client không gửi ID, tìm challenge ID đang PENDING của team này
-        if (strlen(payload) == 0) {
-            cid = find_latest_pending_challenge_for_team(session->current_team_id);
-        } else {
-            cid = atoi(payload);
+void router_init(void) {
+    // The table is small, so a perfect seed turns up after a handful of tries
+    for (uint32_t seed = 1; seed < 100000; seed++) {
+        if (route_build(seed, 0)) {
+            route_seed = seed;
+            route_perfect = 1;
+            return;
         }
-        response_code = server_handle_accept_challenge(session, cid);
-        snprintf(response, sizeof(response), "%d CHALLENGE_ACCEPTED %d\r\n", response_code, cid);
-        // Gửi response ngay lập tức để đảm bảo response đến trước broadcast chest drop
-        connection_send(client_sock, response, strlen(response));
-        log_activity("ACCEPT_CHALLENGE", session->username, session->isLoggedIn, payload, response_code);
-        
-        // Sau khi gửi response, gửi 151 MATCH_STARTED và broadcast chest drop nếu challenge được accept thành công
-        if (response_code == RESP_CHALLENGE_ACCEPTED) {
-            // Lấy match_id từ session hiện tại (đã được cập nhật trong server_handle_accept_challenge)
-            int match_id = session->current_match_id;
-            if (match_id > 0) {
-                // Bước 1: Gửi 151 MATCH_STARTED tới tất cả thành viên
-                broadcast_match_started(match_id);
-                
-                // Bước 2: Sau đó mới broadcast chest drop (141)
-                broadcast_chest_drop(match_id, -1);
-            }
+    }
+    // Should not happen; fall back to linear probing
+    fprintf(stderr, "[WARN] No perfect hash seed for command table, using probing\n");
+    route_seed = 0;
+    route_perfect = 0;
+    route_build(route_seed, 1);
+}
+
+static const Route *route_lookup(const char *type) {
+    uint32_t slot = route_hash(route_seed, type) & (ROUTE_INDEX_SIZE - 1);
+    while (route_index[slot] != ROUTE_EMPTY) {
+        const Route *r = &route_table[route_index[slot]];
+        if (strcmp(r->name, type) == 0) return r;
+        if (route_perfect) return NULL;
+        slot = (slot + 1) & (ROUTE_INDEX_SIZE - 1);
+    }
+    return NULL;
+}
+
+/* ============================================================================
+ * DISPATCHER
+ * ============================================================================ */
+
+/**
+ * @struct RouteLock
+ * @brief Locks held while a request runs (see app_context.h)
+ */
+typedef struct {
+    unsigned int mode;      /**< ROUTE_USERS, ROUTE_SHARED, or 0 for app_lock() */
+    int match_id;           /**< Match lock held under ROUTE_SHARED, 0 if none */
+} RouteLock;
+
+static void route_unlock(RouteLock *lock) {
+    if (lock->mode == ROUTE_USERS) {
+        app_users_unlock();
+    } else if (lock->mode == ROUTE_SHARED) {
+        if (lock->match_id > 0) app_match_unlock(lock->match_id);
+        app_unlock_shared();
+    } else {
+        app_unlock();
+    }
+}
+
+/**
+ * Take the locks for a route's flags and find the socket's session.
+ * ROUTE_SHARED falls back to app_lock() for a logged-in session that has
+ * not joined a match yet: its handler may look one up and join it.
+ *
+ * @return The session with the locks held, or NULL (no locks held, 500 sent)
+ */
+static ServerSession *route_lock(RouteLock *lock, unsigned int flags, int client_sock) {
+    lock->mode = 0;
+    lock->match_id = 0;
+    if (flags & ROUTE_USERS) {
+        lock->mode = ROUTE_USERS;
+        app_users_lock();
+    } else if (flags & ROUTE_SHARED) {
+        app_lock_shared();
+        SessionNode *node = find_session_by_socket(client_sock);
+        if (node && (node->session.current_match_id > 0 || !node->session.isLoggedIn)) {
+            lock->mode = ROUTE_SHARED;
+            lock->match_id = node->session.current_match_id > 0 ? node->session.current_match_id : 0;
+            if (lock->match_id > 0) app_match_lock(lock->match_id);
+            return &node->session;
         }
-        return; // Không gọi connection_send ở cuối nữa
-    }
-    else if (strcmp(type, "DECLINE_CHALLENGE") == 0) {
-        int cid = atoi(payload);
-        response_code = server_handle_decline_challenge(session, cid);
-        snprintf(response, sizeof(response), "%d CHALLENGE_DECLINED %d\r\n", response_code, cid);
-    }
-    else if (strcmp(type, "CANCEL_CHALLENGE") == 0) {
-        int cid = atoi(payload);
-        response_code = server_handle_cancel_challenge(session, cid);
-        snprintf(response, sizeof(response), "%d CHALLENGE_CANCELED %d\r\n", response_code, cid);
-    }
-
-    // --- XỬ LÝ CHEST (Rương) ---
-    else if (strcmp(type, "CHEST_OPEN") == 0) {
-        int chest_id;
-        char answer[128] = "";
-
-        // Thử đọc 2 tham số: ID và Đáp án
-        int args = sscanf(payload, "%d %[^\n]", &chest_id, answer);
-
-        if (args == 1) { 
-            // TRƯỜNG HỢP 1: Client chỉ gửi ID -> Muốn lấy câu hỏi
-            char question[256];
-            response_code = server_handle_get_chest_question(session, chest_id, question);
-            
-            if (response_code == RESP_CHEST_QUESTION) { // 211
-                snprintf(response, sizeof(response), "211 %s\r\n", question);
-            } else {
-                // Gửi lỗi nếu không tìm thấy rương
-                snprintf(response, sizeof(response), "%d CHEST_ERROR\r\n", response_code);
-            }
-        } 
-        else if (args == 2) {
-            // TRƯỜNG HỢP 2: Client gửi ID + Đáp án -> Muốn trả lời
-            response_code = server_handle_open_chest(session, app_context_get_user_table(), chest_id, answer);
-            
-            if (response_code == RESP_CHEST_OPEN_OK) // 145
-                snprintf(response, sizeof(response), "%d CHEST_OPEN_SUCCESS\r\n", RESP_CHEST_OPEN_OK);
-            else
-                snprintf(response, sizeof(response), "%d CHEST_OPEN_FAIL\r\n", response_code);
-        } 
-        else {
-            snprintf(response, sizeof(response), "301 SYNTAX_ERROR\r\n");
+        app_unlock_shared();
+        app_lock();
+    } else {
+        app_lock();
+    }
+
+    SessionNode *node = find_session_by_socket(client_sock);
+    if (!node) {
+        // No session found - this shouldn't happen since connection_create() creates session
+        fprintf(stderr, "[ERROR] No session for socket %d\n", client_sock);
+        const char *err = "500 INTERNAL_ERROR no_session\r\n";
+        connection_send(client_sock, err, strlen(err));
+        route_unlock(lock);
+        return NULL;
+    }
+    return &node->session;
+}
+
+static void route_context_init(RouteContext *ctx, int client_sock, ServerSession *session,
+                               char *payload, char *response, size_t response_size) {
+    ctx->client_sock = client_sock;
+    ctx->session = session;
+    ctx->payload = payload;
+    command_args_init(&ctx->args, payload);
+    ctx->response = response;
+    ctx->response_size = response_size;
+    ctx->response_code = 0;
+    ctx->match_id = -1;
+    ctx->log_user = NULL;
+    ctx->log_input = NULL;
+    ctx->sent = 0;
+    ctx->deferred = 0;
+    ctx->wire = WIRE_TEXT;
+    ctx->response_len = 0;
+    memcpy(ctx->user_before, session->username, MAX_USERNAME);
+}
+
+// Steps 4-6 of a request, text or binary
+static void route_dispatch(RouteContext *ctx, const Route *route) {
+    ServerSession *session = ctx->session;
+
+    // Step 4: Shared preamble, then the handler
+    if ((route->flags & ROUTE_AUTH) && !session->isLoggedIn) {
+        reply_code(ctx, RESP_NOT_LOGGED);
+    } else if (route->flags & ROUTE_MATCH) {
+        ctx->match_id = session->current_match_id;
+        if (ctx->match_id <= 0) {
+            ctx->match_id = find_current_match_by_username(session->username);
         }
+        if (ctx->match_id <= 0) reply_code(ctx, RESP_NOT_IN_MATCH);
+        else route->handler(ctx);
+    } else {
+        route->handler(ctx);
     }
-    //test rương
-    else if (strcmp(type, "DEBUG_CHEST") == 0) {
-        if (session->current_match_id > 0) {
-            // Truyền session->socket_fd để hàm broadcast biết đường tránh
-            int chest_id = broadcast_chest_drop(session->current_match_id, session->socket_fd); 
-            
-            // Chỉ gửi tin nhắn 200 này về cho người thả
-            snprintf(response, sizeof(response), "200 CHEST_DROPPED %d\r\n", chest_id);
-        } else {
-            snprintf(response, sizeof(response), "500 NOT_IN_MATCH\r\n");
+
+    // Step 5: Log, then send response back to client
+    command_args_restore(&ctx->args);
+    if (ctx->deferred) return;
+    log_activity(route->log_name,
+                 ctx->log_user ? ctx->log_user : session->username,
+                 session->isLoggedIn,
+                 ctx->log_input ? ctx->log_input : ctx->payload,
+                 ctx->response_code);
+
+    if (!ctx->sent) {
+        if (ctx->wire) connection_send_frame(ctx->client_sock, ctx->response, ctx->response_len, NULL);
+        else connection_send(ctx->client_sock, ctx->response, strlen(ctx->response));
+    }
+
+    // Step 6: Subscribers of the match hear what changed (deferred FIRE: at the tick)
+    if ((route->flags & ROUTE_SHIP) && session->isLoggedIn) {
+        int match_id = session->current_match_id;
+        if (match_id <= 0) match_id = find_current_match_by_username(session->username);
+        match_feed_publish(find_match_by_id(match_id));
+    }
+}
+
+void command_routes(int client_sock, char *command) {
+    // Step 1: Parse the command
+    Command cmd = parse_command(command);
+    const char *type = cmd.type ? cmd.type : "";
+    char *payload = cmd.user_input;
+
+    // Step 2: Look up the route
+    const Route *route = route_lookup(type);
+
+    // Step 3: Take its locks and find the session by socket
+    // (an unknown command only reads the session, to log it)
+    RouteLock lock;
+    ServerSession *session = route_lock(&lock, route ? route->flags : ROUTE_USERS, client_sock);
+    if (!session) return;
+
+    // Prepare response buffer (increased for MATCH_INFO)
+    char response[8192];
+    RouteContext ctx;
+    route_context_init(&ctx, client_sock, session, payload, response, sizeof(response));
+
+    if (!route) {
+        reply_code(&ctx, RESP_SYNTAX_ERROR);
+        log_activity("UNKNOWN_COMMAND", session->username, session->isLoggedIn, command, ctx.response_code);
+        connection_send(client_sock, response, strlen(response));
+    } else {
+        route_dispatch(&ctx, route);
+    }
+    route_unlock(&lock);
+}
+
+void command_routes_frame(int client_sock, const uint8_t *payload, size_t len) {
+    WireReader r;
+    wire_reader_init(&r, payload, len);
+    int type = wire_get_byte(&r);
+
+    if (type == WIRE_TEXT) {
+        char *line = malloc(len);
+        if (!line) return;
+        memcpy(line, payload + 1, len - 1);
+        line[len - 1] = '\0';
+        command_routes(client_sock, line);
+        free(line);
+        return;
+    }
+
+    // Step 1: Decode into the text arguments of the same route
+    const char *name = NULL;
+    char args[MAX_USERNAME + 16] = "";
+    switch (type) {
+    case WIRE_FIRE: {
+        char target[MAX_USERNAME];
+        wire_get_str(&r, target, sizeof(target));
+        uint32_t weapon = wire_get_uint(&r);
+        // A blank in the name would shift the arguments
+        if (!r.error && target[0] && !strpbrk(target, " \t")) {
+            snprintf(args, sizeof(args), "%s %u", target, weapon);
         }
+        name = "FIRE";
+        break;
+    }
+    case WIRE_GET_HP:     name = "GET_HP"; break;
+    case WIRE_GET_WEAPON: name = "GET_WEAPON"; break;
+    case WIRE_GET_ARMOR:  name = "GETARMOR"; break;
+    default: break;
     }
 
-    // ========== Unknown Command ==========
-    else {
-        // TODO: Send syntax error for unknown commands
-        response_code = RESP_SYNTAX_ERROR;
-        snprintf(response, sizeof(response), "%d\r\n", response_code);
-        log_activity("UNKNOWN_COMMAND", session->username, session->isLoggedIn, command, response_code);
+    // Step 2: Take the route's locks and find the session by socket
+    const Route *route = name ? route_lookup(name) : NULL;
+    RouteLock lock;
+    ServerSession *session = route_lock(&lock, route ? route->flags : ROUTE_USERS, client_sock);
+    if (!session) return;
+
+    if (!route) {
+        const char *err = "301\r\n";
+        log_activity("UNKNOWN_COMMAND", session->username, session->isLoggedIn, "", RESP_SYNTAX_ERROR);
+        connection_send(client_sock, err, strlen(err));
+        route_unlock(&lock);
+        return;
     }
 
-    // TODO Step 4: Send response back to client
-    connection_send(client_sock, response, strlen(response));
+    char response[256];
+    RouteContext ctx;
+    route_context_init(&ctx, client_sock, session, args, response, sizeof(response));
+    ctx.wire = type;
+
+    // Step 3: Trailing bytes are as malformed as missing ones
+    if (r.error || r.pos != r.len) {
+        reply_code(&ctx, RESP_SYNTAX_ERROR);
+        log_activity(name, session->username, session->isLoggedIn, "", ctx.response_code);
+        connection_send_frame(client_sock, response, ctx.response_len, NULL);
+    } else {
+        route_dispatch(&ctx, route);
+    }
+    route_unlock(&lock);
 }
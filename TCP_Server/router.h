@@ -1,6 +1,9 @@
 #ifndef ROUTER_H
 #define ROUTER_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 /**
  * @file router.h
  * @brief Command routing layer - dispatches parsed commands to business logic
@@ -9,29 +12,39 @@
  * It receives parsed commands and routes them to appropriate handlers.
  */
 
+/**
+ * @brief Build the command lookup index
+ *
+ * Must be called once at startup, before the first command_routes().
+ */
+void router_init(void);
+
 /**
  * @brief Routes a command from client to the appropriate handler
- * 
- * Called by connect.c when a complete line is received from client.
- * Parses the command type and delegates to session/user/game handlers.
- * 
+ *
+ * Called by connect.c for each complete line, without any lock held.
+ * Parses the line, looks the command up in the route table, takes the
+ * locks its route needs (app_context.h), finds the session by socket
+ * and runs the handler, which replies with connection_send(). Unknown
+ * commands and bad arguments are answered with an error code.
+ *
  * @param client_sock Socket file descriptor
- * @param command Raw command string (e.g., "REGISTER user1 pass123")
- * 
- * TODO: This function should:
- * 1. Parse command using parse_command() from command.h
- * 2. Look up session by socket using find_session_by_socket()
- * 3. Route to handlers in session.c:
- *    - REGISTER -> server_handle_register()
- *    - LOGIN -> server_handle_login()
- *    - WHOAMI -> server_handle_whoami()
- *    - BYE/LOGOUT -> server_handle_bye()
- *    - GETCOIN -> direct user table lookup
- *    - GETARMOR -> find_ship() + format response
- *    - BUYARMOR -> server_handle_buyarmor()
- * 4. Format response and call connection_send()
- * 5. Handle errors gracefully (RESP_SYNTAX_ERROR, RESP_NOT_LOGGED, etc.)
+ * @param command Raw command line (e.g., "REGISTER user1 pass123"),
+ *                modified in place
  */
 void command_routes(int client_sock, char *command);
 
+/**
+ * @brief Routes one binary frame's payload (wire.h) from a client in binary mode
+ *
+ * WIRE_TEXT payloads go through command_routes(); the fixed-layout
+ * requests run the same routes and are answered with binary replies.
+ * An unknown type is answered with a WIRE_TEXT syntax error.
+ *
+ * @param client_sock Socket file descriptor
+ * @param payload Frame payload (type byte first)
+ * @param len Payload length, at least 1
+ */
+void command_routes_frame(int client_sock, const uint8_t *payload, size_t len);
+
 #endif // ROUTER_H
@@ -9,6 +9,16 @@
 #include "epoll.h"
 #include "config.h"
 #include "app_context.h"
+#include "connect.h"
+#include "router.h"
+#include "logger.h"
+#include "user_store.h"
+#include "hash.h"
+#include "db_schema.h"
+#include "auth.h"
+#include "users.h"
+#include "session.h"
+#include "match_engine.h"
 #include <signal.h>
 
 #include <stdio.h>
@@ -23,7 +33,10 @@
 #include <arpa/inet.h>
 #include <sys/ioctl.h>
 
-static int listen_sock = -1;
+static int listen_socks[MAX_REACTORS];
+static int listen_count = 0;
+static int reactor_threads = DEFAULT_REACTOR_THREADS;
+static int auth_workers = AUTH_WORKER_THREADS;
 
 static void handle_signal(int sig) {
     (void)sig;
@@ -37,62 +50,116 @@ int set_nonblocking(int fd) {
     return 0;
 }
 
-int server_init(void) {
-    int rc;
+/**
+ * @brief Create a non-blocking listening socket bound to PORT.
+ *
+ * @param reuseport Set SO_REUSEPORT so several sockets can share the port
+ * @return Socket fd, or -1 on failure
+ */
+static int open_listen_socket(int reuseport) {
     int on = 1;
     struct sockaddr_in server_addr;
 
-    // Step 1: Initialize context
-    if (app_context_init() != 0) {
-        fprintf(stderr, "[ERROR] Failed to initialize application context\n");
-        return -1;
-    }
-
-    // Step 2: Create socket
-    listen_sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (listen_sock < 0) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) {
         perror("[ERROR] socket() failed");
-        app_context_cleanup();
         return -1;
     }
 
-    if (set_nonblocking(listen_sock) < 0) {
+    if (set_nonblocking(sock) < 0) {
         perror("[ERROR] set_nonblocking() failed");
-        close(listen_sock);
-        app_context_cleanup();
+        close(sock);
         return -1;
     }
 
-    if (setsockopt(listen_sock, SOL_SOCKET, SO_REUSEADDR, (char *)&on, sizeof(on)) < 0) {
+    if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (char *)&on, sizeof(on)) < 0) {
         perror("[WARN] setsockopt(SO_REUSEADDR) failed");
     }
 
+    if (reuseport && setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, (char *)&on, sizeof(on)) < 0) {
+        close(sock);
+        return -1;
+    }
+
     memset(&server_addr, 0, sizeof(server_addr));
     server_addr.sin_family = AF_INET;
     server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
     server_addr.sin_port = htons(PORT);
 
-    rc = bind(listen_sock, (struct sockaddr *)&server_addr, sizeof(server_addr));
-    if (rc < 0) {
-        perror("[ERROR] bind() failed");
-        close(listen_sock);
-        app_context_cleanup();
+    if (bind(sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+        if (!reuseport) perror("[ERROR] bind() failed");
+        close(sock);
         return -1;
     }
 
-    rc = listen(listen_sock, BACKLOG);
-    if (rc < 0) {
+    if (listen(sock, BACKLOG) < 0) {
         perror("[ERROR] listen() failed");
-        close(listen_sock);
+        close(sock);
+        return -1;
+    }
+
+    return sock;
+}
+
+static void close_listen_sockets(void) {
+    for (int i = 0; i < listen_count; i++) {
+        if (listen_socks[i] >= 0) close(listen_socks[i]);
+        listen_socks[i] = -1;
+    }
+    listen_count = 0;
+}
+
+int server_init(void) {
+    int socks[MAX_REACTORS];
+
+    // Step 1: Initialize context (seed the name hash before any table is filled)
+    hash_seed_init();
+    if (app_context_init() != 0) {
+        fprintf(stderr, "[ERROR] Failed to initialize application context\n");
+        return -1;
+    }
+    router_init();
+    if (logger_init(LOG_FILE) != 0) {
+        fprintf(stderr, "[WARN] Activity log disabled\n");
+    }
+    if (auth_start(auth_workers) != 0) {
         app_context_cleanup();
         return -1;
     }
 
-    epoll_init(listen_sock);
+    // Step 2: One SO_REUSEPORT listener per reactor so the kernel balances accepts
+    if (reactor_threads > 1) {
+        for (int i = 0; i < reactor_threads; i++) {
+            int sock = open_listen_socket(1);
+            if (sock < 0) {
+                fprintf(stderr, "[WARN] SO_REUSEPORT unavailable, sharing one listener\n");
+                close_listen_sockets();
+                break;
+            }
+            listen_socks[listen_count++] = sock;
+        }
+    }
+
+    // Fallback (and the single-reactor case): one socket shared by all reactors
+    if (listen_count == 0) {
+        int sock = open_listen_socket(0);
+        if (sock < 0) {
+            auth_stop();
+            app_context_cleanup();
+            return -1;
+        }
+        listen_socks[listen_count++] = sock;
+    }
+
+    for (int i = 0; i < reactor_threads; i++) {
+        socks[i] = listen_socks[i < listen_count ? i : 0];
+    }
+    epoll_init(socks, reactor_threads);
 
     printf("========================================\n");
     printf("Server Hybrid (Epoll + Non-blocking I/O)\n");
     printf("Port: %d\n", PORT);
+    printf("Reactors: %d\n", reactor_threads);
     printf("========================================\n");
 
     return 0;
@@ -103,22 +170,104 @@ void server_run(void) {
 }
 
 void server_shutdown(void) {
-    if (listen_sock >= 0) {
-        close(listen_sock);
-        listen_sock = -1;
-    }
+    close_listen_sockets();
+    auth_stop();
     app_context_cleanup();
+    logger_shutdown();
     printf("[INFO] Server shutdown complete.\n");
 }
 
+// Offline users.txt <-> users.bin conversion; run with the server stopped
+static int convert_users(const char *mode) {
+    UserIOStatus status;
+    if (strcmp(mode, "text2bin") == 0) {
+        status = user_store_from_text(USERS_FILE, USERS_BIN_FILE);
+    } else if (strcmp(mode, "bin2text") == 0) {
+        // users.bin wins at startup, so the caller removes it afterwards
+        status = user_store_to_text(USERS_BIN_FILE, USERS_FILE);
+    } else if (strcmp(mode, "verify") == 0) {
+        UserStore *store = user_store_open(USERS_BIN_FILE);
+        if (!store) return EXIT_FAILURE;
+        bool ok = user_store_verify(store);
+        printf("%s: %llu users, lsn %llu, checksum %s\n", USERS_BIN_FILE,
+               (unsigned long long)store->hdr->count, (unsigned long long)store->hdr->lsn,
+               ok ? "OK" : "MISMATCH");
+        user_store_close(store);
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    } else {
+        fprintf(stderr, "Unknown conversion '%s' (text2bin|bin2text|verify)\n", mode);
+        return EXIT_FAILURE;
+    }
+    printf("%s: %s\n", mode, getUserIOStatusMessage(status));
+    return status == USER_IO_OK ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 int main(int argc, char *argv[]) {
-    (void)argc; // PORT is from config.h, not command line
-    (void)argv;
+    int opt;
+
+    DbLimits limits = DB_LIMITS_DEFAULT;
+
+    // PORT is from config.h; threads, output and table limits are configurable
+    while ((opt = getopt(argc, argv, "t:w:l:c:T:M:C:a:k:i:m:r:")) != -1) {
+        switch (opt) {
+        case 't':
+            reactor_threads = atoi(optarg);
+            break;
+        case 'w':
+            connection_set_output_limit((size_t)strtoul(optarg, NULL, 10));
+            break;
+        case 'l': {
+            LogLevel level;
+            if (logger_parse_level(optarg, &level) != 0) {
+                fprintf(stderr, "Unknown log level '%s' (debug|info|warn|error)\n", optarg);
+                return EXIT_FAILURE;
+            }
+            logger_set_level(level);
+            break;
+        }
+        case 'c':
+            return convert_users(optarg);
+        case 'T':
+            limits.max_teams = atoi(optarg);
+            break;
+        case 'M':
+            limits.max_matches = atoi(optarg);
+            break;
+        case 'C':
+            limits.max_challenges = atoi(optarg);
+            break;
+        case 'a':
+            auth_workers = atoi(optarg);
+            break;
+        case 'k':
+            setPasswordCost((uint32_t)strtoul(optarg, NULL, 10));
+            break;
+        case 'i':
+            connection_set_idle_timeout(strtoul(optarg, NULL, 10));
+            break;
+        case 'm':
+            server_set_match_time_limit(strtoul(optarg, NULL, 10));
+            break;
+        case 'r':
+            match_engine_set_rate((unsigned int)strtoul(optarg, NULL, 10));
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-t reactor_threads] [-w output_high_water_bytes] [-l log_level]\n"
+                            "          [-T max_teams] [-M max_matches] [-C max_challenges] (0 = unlimited)\n"
+                            "          [-a auth_workers] [-k password_hash_iterations]\n"
+                            "          [-i idle_timeout_sec] [-m match_time_limit_sec] (0 = none)\n"
+                            "          [-r match_ticks_per_sec] (0 = FIRE applies on arrival)\n"
+                            "       %s -c text2bin|bin2text|verify\n", argv[0], argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (reactor_threads < 1) reactor_threads = 1;
+    if (reactor_threads > MAX_REACTORS) reactor_threads = MAX_REACTORS;
+    db_set_limits(&limits);
 
     // Register signal handlers for graceful shutdown
     signal(SIGINT, handle_signal);
     signal(SIGTERM, handle_signal);
-    (void)argc; (void)argv;
 
     if (server_init() != 0) {
         fprintf(stderr, "[ERROR] Server initialization failed\n");
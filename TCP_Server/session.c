@@ -10,28 +10,55 @@
 #include "users_io.h"
 #include <ctype.h>
 #include "db_schema.h"  // For FILE_USERS and function declarations
+#include "connect.h"
+#include "buffer.h"
+#include "app_context.h"
+#include "match_engine.h"
+#include "match_feed.h"
 
 
 
-/* Global session manager with mutex for thread safety */
-static SessionManager session_mgr = {NULL, 0};
+/* Global session manager; guarded by the world lock (see app_context.h) */
+static SessionManager session_mgr;
+static SessionNode session_slots[MAX_CLIENTS];  /* Indexed by socket fd */
+static unsigned long session_serial = 0;        /* Last session_id handed out */
+
+static void join_online_members(Match *match);
+static void match_timers_start(Match *match);
+
+static unsigned long match_time_limit_sec = MATCH_TIME_LIMIT_SEC;
 
 //từ db.c
-extern TreasureChest active_chests[];
 extern ChestPuzzle puzzles[];
 extern WeaponTemplate weapon_templates[];
 void initServerSession(ServerSession *s) {
     if (!s) return;
     s->isLoggedIn = false;
     s->username[0] = '\0';
+    s->user_id = 0;
     s->socket_fd = -1;
     memset(&s->client_addr, 0, sizeof(s->client_addr));
     s->current_match_id = -1;
+    s->subscribed_match_id = -1;
     s->current_team_id = -1;    
 }
 
 int server_handle_login(ServerSession *session, UserTable *ut, const char *username, const char *password) {
-    if (!session || !ut || !username || !password) {
+    if (!password) {
+        return RESP_SYNTAX_ERROR;
+    }
+    
+    char stored_hash[MAX_PASSWORD_HASH];
+    int code = server_login_begin(session, ut, username, stored_hash);
+    if (code != 0) {
+        return code;
+    }
+    
+    return server_login_finish(session, ut, username, verifyPassword(password, stored_hash), stored_hash, NULL);
+}
+
+int server_login_begin(ServerSession *session, UserTable *ut, const char *username, char *stored_hash) {
+    if (!session || !ut || !username || !stored_hash) {
         return RESP_SYNTAX_ERROR;
     }
     
@@ -50,27 +77,67 @@ int server_handle_login(ServerSession *session, UserTable *ut, const char *usern
         return RESP_ACCOUNT_LOCKED;
     }
     
+    memcpy(stored_hash, user->password_hash, MAX_PASSWORD_HASH);
+    return 0;
+}
+
+int server_login_finish(ServerSession *session, UserTable *ut, const char *username,
+                        bool password_ok, const char *checked_hash, const char *new_hash) {
+    if (!session || !ut || !username || !checked_hash) {
+        return RESP_SYNTAX_ERROR;
+    }
+    
+    if (session->isLoggedIn) {
+        return RESP_ALREADY_LOGGED;
+    }
+    
+    User *user = findUser(ut, username);
+    if (!user) {
+        return RESP_ACCOUNT_NOT_FOUND;
+    }
+    
+    if (user->status == USER_BANNED) {
+        return RESP_ACCOUNT_LOCKED;
+    }
+    
     /* Validate password */
-    if (!verifyPassword(password, user->password_hash)) {
+    if (!password_ok) {
         return RESP_WRONG_PASSWORD;
     }
     
+    /* Legacy or cheaper hash: keep the one computed from this password,
+       unless a concurrent login upgraded it first */
+    if (new_hash && new_hash[0] && strcmp(user->password_hash, checked_hash) == 0) {
+        setUserPasswordHash(ut, user->username, new_hash);
+    }
+    
     /* Login successful - update session */
     session->isLoggedIn = true;
     strncpy(session->username, user->username, MAX_USERNAME - 1);
     session->username[MAX_USERNAME - 1] = '\0';
+    session->user_id = user->user_id;
     
     session->current_team_id = find_team_id_by_username(session->username);
-    /* Update session in manager */
-    if (!update_session_by_socket(session->socket_fd, session)) {
-        /* If update failed, try to add new session */
-        add_session(session);
-    }
+    /* Make the session reachable by username */
+    session_bind_username(session);
     
     return RESP_LOGIN_OK;
 }
 
 int server_handle_register(UserTable *ut, const char *username, const char *password) {
+    int code = server_register_begin(ut, username, password);
+    if (code != 0) {
+        return code;
+    }
+    
+    /* Hash password */
+    char password_hash[MAX_PASSWORD_HASH];
+    hashPassword(password, password_hash);
+    
+    return server_register_finish(ut, username, password_hash);
+}
+
+int server_register_begin(UserTable *ut, const char *username, const char *password) {
     if (!ut || !username || !password) {
         return RESP_SYNTAX_ERROR;
     }
@@ -90,18 +157,24 @@ int server_handle_register(UserTable *ut, const char *username, const char *pass
         return RESP_USERNAME_EXISTS;
     }
     
-    /* Hash password */
-    char password_hash[MAX_PASSWORD_HASH];
-    hashPassword(password, password_hash);
+    return 0;
+}
+
+int server_register_finish(UserTable *ut, const char *username, const char *password_hash) {
+    if (!ut || !username || !password_hash) {
+        return RESP_SYNTAX_ERROR;
+    }
+    
+    if (findUser(ut, username)) {
+        return RESP_USERNAME_EXISTS;
+    }
     
     /* Create new user */
     User *user = createUser(ut, username, password_hash);
     if (!user) {
         return RESP_INTERNAL_ERROR;
     }
-    
-    /* Save to file for persistence */
-    saveUsers(ut, FILE_USERS);
+    /* createUser() journals the new account */
     
     return RESP_REGISTER_OK;
 }
@@ -115,12 +188,13 @@ int server_handle_bye(ServerSession *session) {
         return RESP_NOT_LOGGED;
     }
     
-    /* Update local session first */
+    /* Drop from the match roster and username index before the name is cleared */
+    session_leave_match(session);
+    match_feed_unsubscribe(session);
+    session_unbind_username(session);
     session->isLoggedIn = false;
     session->username[0] = '\0';
-    
-    /* Update session in manager */
-    update_session_by_socket(session->socket_fd, session);
+    session->user_id = 0;
     
     return RESP_LOGOUT_OK;
 }
@@ -210,16 +284,17 @@ int server_handle_repair(ServerSession *session, UserTable *ut, int repair_amoun
         return RESP_NOT_ENOUGH_COIN;
     }
 
-    /* Apply changes */
+    /* Apply changes: the coin goes through the journal like purchases */
+    if (updateUserCoin(ut, session->username, -cost) != 0) {
+        return RESP_DATABASE_ERROR;
+    }
     ship->hp += actualRepair;
-    user->coin -= cost;
 
     if (out) {
         out->hp = ship->hp;
         out->coin = user->coin;
     }
 
-    // TODO: persist ship & user to DB
     return RESP_REPAIR_OK;
 }
 
@@ -237,7 +312,7 @@ int server_handle_buy_weapon(ServerSession *session, UserTable *ut, int weapon_t
         /* Fallback */
         match_id = find_current_match_by_username(session->username);
         if (match_id > 0) {
-            session->current_match_id = match_id; 
+            session_join_match(session, match_id);
         }
     }
     
@@ -319,46 +394,12 @@ int server_handle_start_match(ServerSession *session, int opponent_team_id) {
         return RESP_MATCH_CREATE_FAILED;
     }
     
-    // 12. Create ships for all team members
-    extern TeamMember team_members[];
-    extern int team_member_count;
-    
-    /* Create ships for all members and update their sessions' current_match_id */
-    for (int i = 0; i < team_member_count; i++) {
-        int tid = team_members[i].team_id;
-        if (tid == new_match->team1_id || tid == new_match->team2_id) {
-            const char *member_username = team_members[i].username;
-
-            /* Create ship for member */
-            create_ship(new_match->match_id, member_username);
-
-            /* Update member session if online */
-            SessionNode *node = find_session_by_username(member_username);
-            if (node) {
-                node->session.current_match_id = new_match->match_id;
-                update_session_by_socket(node->session.socket_fd, &node->session);
-            }
-        }
-    }
+    // 12. Ships were created by create_match(); put online members on the roster
+    join_online_members(new_match);
+    match_timers_start(new_match);
     
     // 13. Update session with new match ID
-    session->current_match_id = new_match->match_id;
-    update_session_by_socket(session->socket_fd, session);
-    
-    // 14. Cập nhật current_match_id cho tất cả players trong match TRƯỚC
-    extern TeamMember team_members[];
-    extern int team_member_count;
-    SessionNode *current = session_mgr.head;
-    while (current != NULL) {
-        if (current->session.isLoggedIn) {
-            int user_team_id_check = find_team_id_by_username(current->session.username);
-            if (user_team_id_check == user_team_id || user_team_id_check == opponent_team_id) {
-                current->session.current_match_id = new_match->match_id;
-                update_session_by_socket(current->session.socket_fd, &current->session);
-            }
-        }
-        current = current->next;
-    }
+    session_join_match(session, new_match->match_id);
     
     // 15. Không gọi broadcast_chest_drop() ở đây nữa
     // Router sẽ gọi broadcast sau khi gửi response để đảm bảo thứ tự đúng
@@ -368,13 +409,16 @@ int server_handle_start_match(ServerSession *session, int opponent_team_id) {
 }
 
 static void clear_match_from_sessions(int match_id) {
-    SessionNode *cur = session_mgr.head;
-    while (cur) {
-        if (cur->session.current_match_id == match_id) {
-            cur->session.current_match_id = -1;
+    Match *match = find_match_by_id(match_id);
+    if (!match) return;
+
+    for (int i = 0; i < match->roster_count; i++) {
+        SessionNode *node = find_session_by_socket(match->roster[i]);
+        if (node && node->session.current_match_id == match_id) {
+            node->session.current_match_id = -1;
         }
-        cur = cur->next;
     }
+    match->roster_count = 0;
 }
 
 int server_handle_end_match(ServerSession *session, int match_id) {
@@ -405,8 +449,11 @@ int server_handle_end_match(ServerSession *session, int match_id) {
         return RESP_MATCH_RUNNING;
     }
 
-    // End the match and record winner (or draw if -1)
+    // End the match and record winner (or draw if -1); subscribers get
+    // the last delta while the ships still exist
+    match_feed_publish(match);
     end_match(match_id, winner_team_id);
+    match_feed_close(match);
 
     // Clear match_id from all sessions participating in this match
     clear_match_from_sessions(match_id);
@@ -464,7 +511,7 @@ int server_handle_get_hp(ServerSession *session, int *hp_out, int *max_hp_out) {
 
 
 int server_handle_fire(ServerSession *session,
-                       char* target_name,
+                       const char* target_name,
                        int weapon_type,
                        FireResult *result)
 {
@@ -474,7 +521,7 @@ int server_handle_fire(ServerSession *session,
     if (session->current_match_id <= 0) {
         int found_match = find_current_match_by_username(session->username);
         if (found_match > 0) {
-            session->current_match_id = found_match;
+            session_join_match(session, found_match);
         } else {
             return RESP_NOT_IN_MATCH; 
         }
@@ -502,7 +549,7 @@ int server_handle_fire(ServerSession *session,
         session->username
     );
 
-    Ship *target = find_ship_by_name(clean_name);
+    Ship *target = find_ship(session->current_match_id, clean_name);
 
     if (!attacker || !target) {
         return RESP_INVALID_TARGET;//343
@@ -613,8 +660,6 @@ int calculate_and_update_damage(Ship* attacker, Ship* target, int weapon_type, F
     }
     //Ghi kết quả
     if (out) {
-        out->attacker_id = hashFunc(attacker->player_username);
-        out->target_id = hashFunc(target->player_username);
         out->damage_dealt = total_damage_dealt;
         out->target_remaining_hp = target->hp;
         out->target_remaining_armor = target->armor_slot_1_value + target->armor_slot_2_value;
@@ -665,7 +710,7 @@ int server_handle_send_challenge(ServerSession *session, int target_team_id, int
                      id);
             
             // Gửi tin nhắn vào Socket của đối thủ
-            write(target_session->session.socket_fd, msg, strlen(msg));
+            connection_send(target_session->session.socket_fd, msg, strlen(msg));
         }
     }
 
@@ -686,7 +731,7 @@ int server_handle_accept_challenge(ServerSession *session, int challenge_id) {
     }
     
     // Đánh dấu challenge đã được accept
-    ch->status = CHALLENGE_ACCEPTED;
+    respond_challenge(ch, CHALLENGE_ACCEPTED);
     
     // Tìm session của sender team leader để gọi start_match
     Team *sender_team = find_team_by_id(ch->sender_team_id);
@@ -703,21 +748,9 @@ int server_handle_accept_challenge(ServerSession *session, int challenge_id) {
             return RESP_MATCH_CREATE_FAILED;
         }
         // Cập nhật match_id cho tất cả thành viên
-        int match_id = new_match->match_id;
-        session->current_match_id = match_id;
-        update_session_by_socket(session->socket_fd, session);
-        
-        SessionNode *current = session_mgr.head;
-        while (current != NULL) {
-            if (current->session.isLoggedIn) {
-                int user_team_id = find_team_id_by_username(current->session.username);
-                if (user_team_id == ch->sender_team_id || user_team_id == ch->target_team_id) {
-                    current->session.current_match_id = match_id;
-                    update_session_by_socket(current->session.socket_fd, &current->session);
-                }
-            }
-            current = current->next;
-        }
+        join_online_members(new_match);
+        match_timers_start(new_match);
+        session_join_match(session, new_match->match_id);
         
         // Lưu ý: Gửi 151 MATCH_STARTED và broadcast_chest_drop sẽ được xử lý trong router.c
         // sau khi gửi response để đảm bảo thứ tự đúng: Response -> 151 -> 141
@@ -732,22 +765,7 @@ int server_handle_accept_challenge(ServerSession *session, int challenge_id) {
         
         // --- CẬP NHẬT MATCH_ID CHO TẤT CẢ THÀNH VIÊN (đã có trong server_handle_start_match, nhưng đảm bảo chắc chắn) ---
         // server_handle_start_match đã cập nhật, nhưng cần đảm bảo cả session hiện tại (B) cũng được cập nhật
-        session->current_match_id = match_id;
-        update_session_by_socket(session->socket_fd, session);
-        
-        // Đảm bảo tất cả thành viên đều có match_id được cập nhật
-        SessionNode *current = session_mgr.head;
-        while (current != NULL) {
-            if (current->session.isLoggedIn) {
-                int user_team_id = find_team_id_by_username(current->session.username);
-                if (user_team_id == ch->sender_team_id || user_team_id == ch->target_team_id) {
-                    // Đảm bảo match_id đã được cập nhật
-                    current->session.current_match_id = match_id;
-                    update_session_by_socket(current->session.socket_fd, &current->session);
-                }
-            }
-            current = current->next;
-        }
+        session_join_match(session, match_id);
         
         // Lưu ý: Gửi 151 MATCH_STARTED sẽ được xử lý trong router.c sau khi gửi response
         // để đảm bảo thứ tự đúng: Response -> 151 -> 141
@@ -767,7 +785,7 @@ int server_handle_decline_challenge(ServerSession *session, int challenge_id) {
     if (ch->status != CHALLENGE_PENDING) return RESP_ALREADY_RESPONDED;
 
     // Chỉ Leader team nhận lời mời mới được từ chối
-    ch->status = CHALLENGE_DECLINED;
+    respond_challenge(ch, CHALLENGE_DECLINED);
     return RESP_CHALLENGE_DECLINED;
 }
 
@@ -781,30 +799,32 @@ int server_handle_cancel_challenge(ServerSession *session, int challenge_id) {
     // Kiểm tra: Chỉ đội gửi lời mời mới được hủy
     if (ch->sender_team_id != session->current_team_id) return RESP_NOT_SENDER;
 
-    ch->status = CHALLENGE_CANCELED;
+    respond_challenge(ch, CHALLENGE_CANCELED);
     return RESP_CHALLENGE_CANCELED;
 }
 
 //Tạo rương 
 int server_spawn_chest(int match_id) {
+    Match *match = find_match_by_id(match_id);
+    if (!match) return -1;
     srand(time(NULL));//Sinh ngẫu nhiên = nowtime
-    int idx = match_id % MAX_TEAMS;
-    
-    active_chests[idx].chest_id = rand() % 1000 + 1; // (1->1000)
-    active_chests[idx].match_id = match_id;
+    TreasureChest *chest = &match->chest;
+
+    chest->chest_id = rand() % 1000 + 1; // (1->1000)
+    chest->match_id = match_id;
     
     // Ngẫu nhiên "loại rương" theo tỷ lệ
     int r = rand() % 100;//tạo ngẫu nhiên từ 0->99
-    if (r < 60) active_chests[idx].type = CHEST_BRONZE;      // 100 coin
-    else if (r < 90) active_chests[idx].type = CHEST_SILVER; // 500 coin
-    else active_chests[idx].type = CHEST_GOLD;               // 2000 coin
+    if (r < 60) chest->type = CHEST_BRONZE;      // 100 coin
+    else if (r < 90) chest->type = CHEST_SILVER; // 500 coin
+    else chest->type = CHEST_GOLD;               // 2000 coin
 
-    active_chests[idx].position_x = MAP_WIDTH / 2; 
-    active_chests[idx].position_y = MAP_HEIGHT / 2;
-    active_chests[idx].is_collected = false;
+    chest->position_x = MAP_WIDTH / 2; 
+    chest->position_y = MAP_HEIGHT / 2;
+    chest->is_collected = false;
+    chest->spawn_time = time(NULL);
 
-
-    return active_chests[idx].chest_id;
+    return chest->chest_id;
 }
 
 void broadcast_match_started(int match_id) {
@@ -816,14 +836,17 @@ void broadcast_match_started(int match_id) {
              match_id);
     
     // Gửi tới tất cả thành viên trong match
-    SessionNode *current = session_mgr.head;
-    while (current != NULL) {
-        if (current->session.isLoggedIn && 
-            current->session.current_match_id == match_id) {
-            (void)write(current->session.socket_fd, msg, strlen(msg));
+    Match *match = find_match_by_id(match_id);
+    if (!match) return;
+    shared_buf_t *buf = shared_buf_new(msg, strlen(msg));
+    if (!buf) return;
+    for (int i = 0; i < match->roster_count; i++) {
+        SessionNode *node = find_session_by_socket(match->roster[i]);
+        if (node && node->session.isLoggedIn) {
+            connection_send_shared(node->session.socket_fd, buf);
         }
-        current = current->next;
     }
+    shared_buf_unref(buf);
 }
 
 //Sinh rương và tb all
@@ -839,21 +862,84 @@ int broadcast_chest_drop(int match_id, int exclude_socket_fd) {
              RESP_CHEST_DROP_OK, c_id, (int)chest->type, chest->position_x, chest->position_y);
 
     // 3. Gửi cho TẤT CẢ players trong match (nếu exclude_socket_fd == -1 thì gửi cho tất cả)
-    SessionNode *current = session_mgr.head;
-    while (current != NULL) {
-        if (current->session.isLoggedIn && 
-            current->session.current_match_id == match_id) {
+    Match *match = find_match_by_id(match_id);
+    shared_buf_t *buf = shared_buf_new(notify, strlen(notify));
+    for (int i = 0; match && buf && i < match->roster_count; i++) {
+        SessionNode *node = find_session_by_socket(match->roster[i]);
+        if (node && node->session.isLoggedIn) {
             // Nếu exclude_socket_fd == -1 thì gửi cho tất cả, ngược lại loại trừ exclude_socket_fd
-            if (exclude_socket_fd == -1 || current->session.socket_fd != exclude_socket_fd) {
-                (void)write(current->session.socket_fd, notify, strlen(notify));
+            if (exclude_socket_fd == -1 || node->session.socket_fd != exclude_socket_fd) {
+                connection_send_shared(node->session.socket_fd, buf);
             }
         }
-        current = current->next;
     }
+    shared_buf_unref(buf);
 
     printf("[SERVER INFO] Chest %d dropped in match %d\n", c_id, match_id);
     return c_id;
 }
+
+void server_set_match_time_limit(unsigned long seconds) {
+    match_time_limit_sec = seconds;
+}
+
+/* 152 MATCH_ENDED <match_id> <winner_team_id> to everyone on the roster */
+static void broadcast_match_ended(Match *match) {
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%d MATCH_ENDED %d %d\r\n",
+             RESP_MATCH_ENDED_NOTIFY, match->match_id, match->winner_team_id);
+
+    shared_buf_t *buf = shared_buf_new(msg, strlen(msg));
+    if (!buf) return;
+    for (int i = 0; i < match->roster_count; i++) {
+        SessionNode *node = find_session_by_socket(match->roster[i]);
+        if (node && node->session.isLoggedIn) {
+            connection_send_shared(node->session.socket_fd, buf);
+        }
+    }
+    shared_buf_unref(buf);
+}
+
+void server_finish_match(Match *match, int winner_team_id) {
+    match_feed_publish(match);
+    end_match(match->match_id, winner_team_id);
+    broadcast_match_ended(match);
+    match_feed_close(match);
+    clear_match_from_sessions(match->match_id);
+}
+
+/* World timer (world lock held): the match ran out of time */
+static void match_time_up(Timer *timer) {
+    Match *match = timer->arg;
+    if (match->status != MATCH_RUNNING) return;
+
+    int winner_team_id = -1;
+    if (!can_end_match(match->match_id, &winner_team_id)) {
+        winner_team_id = match_timeout_winner(match->match_id);
+    }
+    printf("[INFO] Match %d reached its time limit, winner %d\n", match->match_id, winner_team_id);
+    server_finish_match(match, winner_team_id);
+}
+
+/* World timer (world lock held): drop the next chest */
+static void match_chest_due(Timer *timer) {
+    Match *match = timer->arg;
+    if (match->status != MATCH_RUNNING) return;
+
+    broadcast_chest_drop(match->match_id, -1);
+    app_timer_arm(&match->chest_timer, CHEST_SPAWN_INTERVAL_SEC * 1000UL);
+}
+
+/* Arm a new match's timers (end_match() cancels them) and start its ticks */
+static void match_timers_start(Match *match) {
+    timer_init(&match->limit_timer, match_time_up, match);
+    timer_init(&match->chest_timer, match_chest_due, match);
+    if (match_time_limit_sec > 0) {
+        app_timer_arm(&match->limit_timer, match_time_limit_sec * 1000);
+    }
+    app_timer_arm(&match->chest_timer, CHEST_SPAWN_INTERVAL_SEC * 1000UL);
+    match_engine_start(match);
+}
 int server_handle_open_chest(ServerSession *session, UserTable *ut, int chest_id, const char *answer) {
     if (!session || !session->isLoggedIn) return RESP_NOT_LOGGED; // 315
 
@@ -884,14 +970,15 @@ int server_handle_open_chest(ServerSession *session, UserTable *ut, int chest_id
     snprintf(notify, sizeof(notify), "210 CHEST_COLLECTED %s %d\r\n", session->username, chest_id);
     
     // Gửi broadcast cho tất cả players trong match
-    SessionNode *current = session_mgr.head;
-    while (current != NULL) {
-        if (current->session.isLoggedIn && 
-            current->session.current_match_id == session->current_match_id) {
-            (void)write(current->session.socket_fd, notify, strlen(notify));
+    Match *match = find_match_by_id(session->current_match_id);
+    shared_buf_t *buf = shared_buf_new(notify, strlen(notify));
+    for (int i = 0; match && buf && i < match->roster_count; i++) {
+        SessionNode *node = find_session_by_socket(match->roster[i]);
+        if (node && node->session.isLoggedIn) {
+            connection_send_shared(node->session.socket_fd, buf);
         }
-        current = current->next;
     }
+    shared_buf_unref(buf);
 
     return RESP_CHEST_OPEN_OK; // 127
 }
@@ -915,36 +1002,66 @@ void get_chest_puzzle(ChestType type, char *q_out, char *a_out) {
     strcpy(a_out, puzzles[(int)type].answer);
 }
 
-//Tìm rương trong trận đấu theo id
+//Tìm rương trong trận đấu theo id (mỗi trận giữ rương rơi gần nhất)
 TreasureChest* find_chest_by_id_in_match(int match_id, int chest_id) {
-    int idx = match_id % MAX_TEAMS;
-    if (active_chests[idx].chest_id == chest_id && active_chests[idx].match_id == match_id) {
-        return &active_chests[idx];
-    }
-    return NULL;
+    Match *match = find_match_by_id(match_id);
+    if (!match || chest_id <= 0 || match->chest.chest_id != chest_id) return NULL;
+    return &match->chest;
 }
 
 
   
 /* ====== Session Manager Implementation ====== */
 
+static unsigned long session_name_bucket(const char *username) {
+    return hashFunc(username) & (SESSION_NAME_BUCKETS - 1);
+}
+
+void session_join_match(ServerSession *session, int match_id) {
+    if (!session || match_id <= 0) return;
+    if (session->current_match_id != match_id) {
+        session_leave_match(session);
+    }
+    session->current_match_id = match_id;
+    if (!match_roster_add(find_match_by_id(match_id), session->socket_fd)) {
+        fprintf(stderr, "[WARN] Match %d roster full, socket %d not added\n",
+                match_id, session->socket_fd);
+    }
+}
+
+void session_leave_match(ServerSession *session) {
+    if (!session || session->current_match_id <= 0) return;
+    match_roster_remove(find_match_by_id(session->current_match_id), session->socket_fd);
+    session->current_match_id = -1;
+}
+
+/* Put every online member of both teams on the match roster */
+static void join_online_members(Match *match) {
+    int team_ids[2] = { match->team1_id, match->team2_id };
+
+    for (int t = 0; t < 2; t++) {
+        TeamMember *members[MAX_TEAM_MEMBERS];
+        int count = get_team_members(team_ids[t], members, MAX_TEAM_MEMBERS);
+        for (int i = 0; i < count; i++) {
+            SessionNode *node = find_session_by_username(members[i]->username);
+            if (node) {
+                session_join_match(&node->session, match->match_id);
+            }
+        }
+    }
+}
+
 void init_session_manager(void) {
     /* Initialize session manager */
-    session_mgr.head = NULL;
-    session_mgr.count = 0;
+    memset(&session_mgr, 0, sizeof(session_mgr));
+    memset(session_slots, 0, sizeof(session_slots));
 }
 
 void cleanup_session_manager(void) {
-    SessionNode *current = session_mgr.head;
-    while (current != NULL) {
-        SessionNode *next = current->next;
-        free(current);
-        current = next;
-    }
-    session_mgr.head = NULL;
-    session_mgr.count = 0;
+    /* Slots are static; just forget every session */
+    init_session_manager();
 }
- 
+
 // Hàm gửi phản hồi lỗi nhanh qua socket
 void send_error_response(int socket_fd, int error_code, const char *details) {
     char buffer[512];
@@ -952,50 +1069,45 @@ void send_error_response(int socket_fd, int error_code, const char *details) {
     snprintf(buffer, sizeof(buffer), "%d %s\r\n", error_code, details ? details : "UNKNOWN_ERROR");
     
     if (socket_fd > 0) {
-        (void)write(socket_fd, buffer, strlen(buffer));
+        connection_send(socket_fd, buffer, strlen(buffer));
     }
 }
-void broadcast_fire_event(const char* attacker_name, const char* target_name, int damage_dealt, int target_remaining_hp, int target_remaining_armor) {
-    //Tìm trận đấu (match_id) dựa vào người bắn
-    Ship *attacker_ship = find_ship_by_name(attacker_name);
-    if (!attacker_ship) return;
-    
-    int match_id = attacker_ship->match_id;
+void broadcast_fire_event(int match_id, const char* attacker_name, const char* target_name, int damage_dealt, int target_remaining_hp, int target_remaining_armor) {
+    Match *match = find_match_by_id(match_id);
+    if (!match) return;
 
     //Tạo bản tin thông báo (Protocol 131)
     char msg[512];
     snprintf(msg, sizeof(msg), "131 FIRE_EVENT %s %s %d %d %d\r\n", 
              attacker_name, target_name, damage_dealt, target_remaining_hp, target_remaining_armor);
 
-    // Duyệt danh sách session và gửi cho những người CÙNG TRẬN ĐẤU
-    // pthread_mutex_lock(&session_mutex);
-    SessionNode *current = session_mgr.head;
-    while (current != NULL) {
-        // Chỉ gửi nếu đã login và đang ở trong cùng match_id
-        if (current->session.isLoggedIn && current->session.current_match_id == match_id) {
-            // Kiểm tra: Nếu là người bắn thì KHÔNG gửi broadcast (tránh trùng lặp)
-            if (strcmp(current->session.username, attacker_name) != 0) {
-                (void)write(current->session.socket_fd, msg, strlen(msg));
-            }
+    // Serialize once, queue the same buffer for every recipient
+    shared_buf_t *buf = shared_buf_new(msg, strlen(msg));
+    if (!buf) return;
+
+    // Chỉ gửi cho những người CÙNG TRẬN ĐẤU (roster của match)
+    for (int i = 0; i < match->roster_count; i++) {
+        SessionNode *node = find_session_by_socket(match->roster[i]);
+        if (!node || !node->session.isLoggedIn) continue;
+        // Kiểm tra: Nếu là người bắn thì KHÔNG gửi broadcast (tránh trùng lặp)
+        if (strcmp(node->session.username, attacker_name) != 0) {
+            connection_send_shared(node->session.socket_fd, buf);
         }
-        current = current->next;
     }
-    // pthread_mutex_unlock(&session_mutex);
+    shared_buf_unref(buf);
 }
 SessionNode *find_session_by_username(const char *username) {
     if (!username) return NULL;
     
-    SessionNode *current = session_mgr.head;
-    SessionNode *result = NULL;
+    SessionNode *current = session_mgr.name_buckets[session_name_bucket(username)];
     while (current != NULL) {
         if (current->session.isLoggedIn && 
             strcmp(current->session.username, username) == 0) {
-            result = current;
-            break;
+            return current;
         }
-        current = current->next;
+        current = current->name_next;
     }
-    return result;
+    return NULL;
 }
 
 int get_fd_by_username(const char *username) {
@@ -1010,102 +1122,92 @@ int get_fd_by_username(const char *username) {
 
 
 SessionNode *find_session_by_socket(int socket_fd) {
-    SessionNode *current = session_mgr.head;
-    SessionNode *result = NULL;
-    while (current != NULL) {
-        if (current->session.socket_fd == socket_fd) {
-            result = current;
+    if (socket_fd < 0 || socket_fd >= MAX_CLIENTS) return NULL;
+    SessionNode *node = &session_slots[socket_fd];
+    return node->in_use ? node : NULL;
+}
+
+SessionNode *find_session_by_handle(int socket_fd, unsigned long session_id) {
+    SessionNode *node = find_session_by_socket(socket_fd);
+    return node && node->session.session_id == session_id ? node : NULL;
+}
+
+void session_bind_username(ServerSession *session) {
+    SessionNode *node = find_session_by_socket(session ? session->socket_fd : -1);
+    if (!node || &node->session != session || node->name_bound) return;
+    if (!session->isLoggedIn || session->username[0] == '\0') return;
+
+    unsigned long b = session_name_bucket(session->username);
+    node->name_next = session_mgr.name_buckets[b];
+    session_mgr.name_buckets[b] = node;
+    node->name_bound = true;
+}
+
+void session_unbind_username(ServerSession *session) {
+    SessionNode *node = find_session_by_socket(session ? session->socket_fd : -1);
+    if (!node || &node->session != session || !node->name_bound) return;
+
+    SessionNode **pp = &session_mgr.name_buckets[session_name_bucket(session->username)];
+    while (*pp != NULL) {
+        if (*pp == node) {
+            *pp = node->name_next;
             break;
         }
-        current = current->next;
+        pp = &(*pp)->name_next;
     }
-    return result;
+    node->name_next = NULL;
+    node->name_bound = false;
 }
 
 bool add_session(ServerSession *session) {
-    if (!session || session->socket_fd < 0) return false;
+    if (!session || session->socket_fd < 0 || session->socket_fd >= MAX_CLIENTS) return false;
     
     /* Check if session with this socket already exists */
-    SessionNode *existing = session_mgr.head;
-    while (existing != NULL) {
-        if (existing->session.socket_fd == session->socket_fd) {
-            return false; /* Already exists */
-        }
-        existing = existing->next;
-    }
-    
-    /* Create new session node */
-    SessionNode *new_node = (SessionNode *)malloc(sizeof(SessionNode));
-    if (!new_node) {
-        return false;
+    SessionNode *node = &session_slots[session->socket_fd];
+    if (node->in_use) {
+        return false; /* Already exists */
     }
     
-    new_node->session = *session;
-    new_node->next = session_mgr.head;
-    session_mgr.head = new_node;
+    node->session = *session;
+    node->session.session_id = ++session_serial;
+    node->in_use = true;
+    node->name_bound = false;
+    node->name_next = NULL;
+
+    node->prev = NULL;
+    node->next = session_mgr.head;
+    if (session_mgr.head) session_mgr.head->prev = node;
+    session_mgr.head = node;
     session_mgr.count++;
+
+    session_bind_username(&node->session);
     return true;
 }
 
 bool remove_session_by_socket(int socket_fd) {
-    SessionNode *current = session_mgr.head;
-    SessionNode *prev = NULL;
-    
-    while (current != NULL) {
-        if (current->session.socket_fd == socket_fd) {
-            if (prev == NULL) {
-                session_mgr.head = current->next;
-            } else {
-                prev->next = current->next;
-            }
-            free(current);
-            session_mgr.count--;
-            return true;
-        }
-        prev = current;
-        current = current->next;
-    }
-    return false;
-}
+    SessionNode *node = find_session_by_socket(socket_fd);
+    if (!node) return false;
 
-bool remove_session_by_username(const char *username) {
-    if (!username) return false;
-    
-    SessionNode *current = session_mgr.head;
-    SessionNode *prev = NULL;
-    
-    while (current != NULL) {
-        if (current->session.isLoggedIn && 
-            strcmp(current->session.username, username) == 0) {
-            if (prev == NULL) {
-                session_mgr.head = current->next;
-            } else {
-                prev->next = current->next;
-            }
-            free(current);
-            session_mgr.count--;
-            return true;
-        }
-        prev = current;
-        current = current->next;
+    session_leave_match(&node->session);
+    match_feed_unsubscribe(&node->session);
+    session_unbind_username(&node->session);
+
+    if (node->prev) {
+        node->prev->next = node->next;
+    } else {
+        session_mgr.head = node->next;
     }
-    
-    return false;
+    if (node->next) node->next->prev = node->prev;
+
+    memset(node, 0, sizeof(*node));
+    session_mgr.count--;
+    return true;
 }
 
-bool update_session_by_socket(int socket_fd, ServerSession *session) {
-    if (!session || socket_fd < 0) return false;
-    
-    SessionNode *current = session_mgr.head;
-    while (current != NULL) {
-        if (current->session.socket_fd == socket_fd) {
-            current->session = *session;
-            return true;
-        }
-        current = current->next;
-    }
-    
-    return false;
+bool remove_session_by_username(const char *username) {
+    SessionNode *node = find_session_by_username(username);
+    if (!node) return false;
+    return remove_session_by_socket(node->session.socket_fd);
 }
 
 int get_active_session_count(void) {
@@ -1116,11 +1218,35 @@ int get_active_session_count(void) {
  * MATCH INFO HANDLER
  * ============================================================================ */
 
-// External references to db.c arrays
-extern TeamMember team_members[];
-extern int team_member_count;
+/* "--- TEAM n: ... ---" followed by one line per player; returns the new offset */
+static int append_team_info(char *buffer, size_t size, int offset, int label, const Team *team, int match_id) {
+    offset += snprintf(buffer + offset, size - offset,
+                      "--- TEAM %d: %s (ID: %d) ---\n", label, team->name, team->team_id);
+
+    TeamMember *members[MAX_TEAM_MEMBERS];
+    int member_count = get_team_members(team->team_id, members, MAX_TEAM_MEMBERS);
+    for (int i = 0; i < member_count; i++) {
+        const char *username = members[i]->username;
+        offset += snprintf(buffer + offset, size - offset, "  Player: %s", username);
+
+        Ship *ship = find_ship(match_id, username);
+        if (ship) {
+            offset += snprintf(buffer + offset, size - offset,
+                             " | HP: %d | Armor1: %d | Armor2: %d | Cannon: %d | Laser: %d | Missile: %d\n",
+                             ship->hp,
+                             ship->armor_slot_1_value,
+                             ship->armor_slot_2_value,
+                             ship->cannon_ammo,
+                             ship->laser_count,
+                             ship->missile_count);
+        } else {
+            offset += snprintf(buffer + offset, size - offset, " | No ship data\n");
+        }
+    }
+    return offset;
+}
 
-int server_handle_match_info(int match_id, char *output, size_t output_size, UserTable *user_table) {
+int server_handle_match_info(int match_id, char *output, size_t output_size) {
     if (!output || output_size == 0) {
         return RESP_INTERNAL_ERROR;
     }
@@ -1165,71 +1291,10 @@ int server_handle_match_info(int match_id, char *output, size_t output_size, Use
     
     offset += snprintf(buffer + offset, sizeof(buffer) - offset, "\n");
     
-    // Team 1 info
-    offset += snprintf(buffer + offset, sizeof(buffer) - offset,
-                      "--- TEAM 1: %s (ID: %d) ---\n", team1->name, team1->team_id);
-    // Get team 1 members
-    for (int i = 0; i < team_member_count; i++) {
-        if (team_members[i].team_id == team1->team_id) {
-            const char *username = team_members[i].username;
-            offset += snprintf(buffer + offset, sizeof(buffer) - offset,
-                             "  Player: %s", username);
-            User *user = findUser(user_table, username);
-            if (user) {
-            } else {
-            }
-            // Find ship for this player
-            Ship *ship = find_ship(match_id, username);
-            if (ship) {
-                offset += snprintf(buffer + offset, sizeof(buffer) - offset,
-                                 " | HP: %d | Armor1: %d | Armor2: %d | Cannon: %d | Laser: %d | Missile: %d\n",
-                                 ship->hp,
-                                 ship->armor_slot_1_value,
-                                 ship->armor_slot_2_value,
-                                 ship->cannon_ammo,
-                                 ship->laser_count,
-                                 ship->missile_count);
-        
-            } else {
-                offset += snprintf(buffer + offset, sizeof(buffer) - offset,
-                                 " | No ship data\n");
-            }
-        }
-    }
-    
+    // One block per team: its players and their ships
+    offset = append_team_info(buffer, sizeof(buffer), offset, 1, team1, match_id);
     offset += snprintf(buffer + offset, sizeof(buffer) - offset, "\n");
-    
-    // Team 2 info
-    offset += snprintf(buffer + offset, sizeof(buffer) - offset,
-                      "--- TEAM 2: %s (ID: %d) ---\n", team2->name, team2->team_id);
-    // Get team 2 members
-    for (int i = 0; i < team_member_count; i++) {
-        if (team_members[i].team_id == team2->team_id) {
-            const char *username = team_members[i].username;
-            offset += snprintf(buffer + offset, sizeof(buffer) - offset,
-                             "  Player: %s", username);
-                             
-            User *user = findUser(user_table, username);
-        
-
-            // Find ship for this player
-            Ship *ship = find_ship(match_id, username);
-            if (ship) {
-                offset += snprintf(buffer + offset, sizeof(buffer) - offset,
-                                 " | HP: %d | Armor1: %d | Armor2: %d | Cannon: %d | Laser: %d | Missile: %d\n",
-                                 ship->hp,
-                                 ship->armor_slot_1_value,
-                                 ship->armor_slot_2_value,
-                                 ship->cannon_ammo,
-                                 ship->laser_count,
-                                 ship->missile_count);
-            
-            } else {
-                offset += snprintf(buffer + offset, sizeof(buffer) - offset,
-                                 " | No ship data\n");
-            }
-        }
-    }
+    offset = append_team_info(buffer, sizeof(buffer), offset, 2, team2, match_id);
     
     // Copy to output
     strncpy(output, buffer, output_size - 1);
@@ -16,6 +16,12 @@
  */
 #define MAX_SESSIONS 4096
 
+/**
+ * @def SESSION_NAME_BUCKETS
+ * @brief Bucket count of the username -> session index (power of two).
+ */
+#define SESSION_NAME_BUCKETS 4096
+
 /**
  * @struct Session
  * @brief Stores the current user session state.
@@ -32,30 +38,47 @@ typedef struct {
 typedef struct {
     bool isLoggedIn;
     char username[MAX_USERNAME];
+    int user_id;                /**< User.user_id of the logged-in account, 0 if none */
     int socket_fd;              /**< Socket identifier on server */
+    unsigned long session_id;   /**< Set by add_session(), never reused; with socket_fd, the handle for late replies */
     struct sockaddr_in client_addr; /**< Client address */
     int current_team_id;        /**< Current team ID, -1 if not in team */
     int current_match_id;       /**< Current match ID, -1 if not in match */
+    int subscribed_match_id;    /**< Match whose deltas are pushed here (match_feed.h), -1 if none */
     int coins; //Lượng thêm
 } ServerSession;
 
 /**
  * @struct SessionNode
- * @brief Node in the linked list of active sessions.
+ * @brief Slot holding one active session.
+ *
+ * Slots live in a fixed array indexed by socket fd, so a SessionNode
+ * pointer stays valid until the connection closes. Handlers modify
+ * node->session in place; there is nothing to write back.
  */
 typedef struct SessionNode {
     ServerSession session;
-    struct SessionNode *next;
+    struct SessionNode *next;       /**< Next active session (iteration order) */
+    struct SessionNode *prev;       /**< Previous active session */
+    struct SessionNode *name_next;  /**< Next session in the same username bucket */
+    bool in_use;                    /**< Slot holds a live session */
+    bool name_bound;                /**< Linked into the username index */
 } SessionNode;
 
 /**
  * @struct SessionManager
  * @brief Global session manager to track all active sessions.
- * Uses simple linked list (no mutex needed for single-threaded select()).
+ *
+ * - Lookup by socket: O(1), slot = fd.
+ * - Lookup by username: O(1) average, hash index kept in sync on LOGIN/BYE.
+ * - Iteration: intrusive list through the active slots.
+ * Changed only under app_lock(); read under either side of the world
+ * lock, or under the user lock alone (see app_context.h).
  */
 typedef struct {
-    SessionNode *head;          /**< Head of the session linked list */
+    SessionNode *head;          /**< Head of the active session list */
     int count;                  /**< Number of active sessions */
+    SessionNode *name_buckets[SESSION_NAME_BUCKETS]; /**< Username index */
 } SessionManager;
 
 /**
@@ -117,6 +140,33 @@ void initServerSession(ServerSession *s);
  */
 int server_handle_login(ServerSession *session, UserTable *ut, const char *username, const char *password);
 
+/**
+ * @brief First half of LOGIN: everything but the password check
+ *
+ * The server checks the password on an auth worker (auth.h) between
+ * server_login_begin() and server_login_finish();
+ * server_handle_login() does all three inline.
+ *
+ * @param stored_hash Output: the account's password hash (MAX_PASSWORD_HASH bytes)
+ * @return 0 if the password must be checked against stored_hash,
+ *         otherwise the response code (211, 212, 213)
+ */
+int server_login_begin(ServerSession *session, UserTable *ut, const char *username, char *stored_hash);
+
+/**
+ * @brief Second half of LOGIN, after the password check
+ *
+ * Checks the account again (it may have been banned meanwhile).
+ * new_hash replaces the stored hash only if that is still checked_hash.
+ *
+ * @param password_ok Result of verifyPassword() against checked_hash
+ * @param checked_hash Hash returned by server_login_begin()
+ * @param new_hash Rehashed password to store (see passwordNeedsRehash()), or NULL/""
+ * @return Response code, as server_handle_login()
+ */
+int server_login_finish(ServerSession *session, UserTable *ut, const char *username,
+                        bool password_ok, const char *checked_hash, const char *new_hash);
+
 /**
  * @brief Handle REGISTER command for TCP server
  * Creates a new user account with password validation
@@ -128,6 +178,21 @@ int server_handle_login(ServerSession *session, UserTable *ut, const char *usern
  */
 int server_handle_register(UserTable *ut, const char *username, const char *password);
 
+/**
+ * @brief First half of REGISTER: validation, before the password is hashed
+ * @return 0 if the password must be hashed, otherwise the response code (215, 216, 217)
+ */
+int server_register_begin(UserTable *ut, const char *username, const char *password);
+
+/**
+ * @brief Second half of REGISTER: create the account with a ready hash
+ *
+ * The name is checked again: another REGISTER may have taken it meanwhile.
+ *
+ * @return Response code, as server_handle_register()
+ */
+int server_register_finish(UserTable *ut, const char *username, const char *password_hash);
+
 /**
  * @brief Handle BYE command for TCP server
  * 
@@ -218,6 +283,28 @@ int server_handle_buy_weapon(ServerSession *session, UserTable *ut, int weapon_t
  */
 int server_handle_start_match(ServerSession *session, int opponent_team_id);
 
+/**
+ * @brief Set the time limit of matches started from now on
+ *
+ * A match still running at the limit ends with the team that has more
+ * ships afloat as winner (draw if even); players get 152 MATCH_ENDED.
+ *
+ * @param seconds Limit (0 = matches only end through END_MATCH)
+ */
+void server_set_match_time_limit(unsigned long seconds);
+
+/**
+ * @brief End a running match decided by the server, not by END_MATCH
+ *
+ * Pushes the last ship deltas to subscribers, records the result
+ * (end_match()), tells the roster and subscribers with
+ * 152 MATCH_ENDED <match_id> <winner_team_id> and takes the match off
+ * the players' sessions.
+ *
+ * @param winner_team_id Winning team, -1 for a draw
+ */
+void server_finish_match(Match *match, int winner_team_id);
+
 /**
  * @brief Handle GET_MATCH_RESULT command - retrieves match result
  * @param session Current session
@@ -246,10 +333,10 @@ int server_handle_end_match(ServerSession *session, int match_id);
 int calculate_and_update_damage(Ship* attacker, Ship* target, int weapon_id, FireResult *out);
 void send_error_response(int socket_fd, int error_code, const char *details);
 void send_fire_ok(int attacker_socket, int target_id, int damage, int hp, int armor);
-void broadcast_fire_event(const char* attacker_name, const char* target_name, int dam, int hp, int armor);
+void broadcast_fire_event(int match_id, const char* attacker_name, const char* target_name, int dam, int hp, int armor);
 
 
-int server_handle_fire(ServerSession *session, char* target_name, int weapon_type, FireResult *result);
+int server_handle_fire(ServerSession *session, const char* target_name, int weapon_type, FireResult *result);
 
 /**
  * @brief Xử lý yêu cầu gửi lời thách đấu
@@ -282,7 +369,7 @@ int server_handle_cancel_challenge(ServerSession *session, int challenge_id);
 /**
  * @brief Khởi tạo rương cho một trận đấu
  * @param match_id ID của trận đấu diễn ra
- * @return ID của rương được tạo
+ * @return ID của rương được tạo (thay rương cũ trên Match), -1 nếu không có trận
  */
 int server_spawn_chest(int match_id);
 
@@ -343,19 +430,38 @@ void cleanup_session_manager(void);
  */
 SessionNode *find_session_by_username(const char *username);
 
+/**
+ * @brief Get the socket of a logged-in user
+ *
+ * @param username Username to search for
+ * @return Socket fd, or -1 if the user is not online
+ */
+int get_fd_by_username(const char *username);
+
 /**
  * @brief Find a session by socket file descriptor
  * 
  * @param socket_fd Socket file descriptor
  * @return Pointer to SessionNode if found, NULL otherwise
  */
-
-int get_fd_by_username(const char *username);
-
 SessionNode *find_session_by_socket(int socket_fd);
 
+/**
+ * @brief Find a session by its handle (socket fd and session id)
+ *
+ * For replies computed off the reactor (auth.h): the socket may have been
+ * closed and its fd reused by a new connection since the handle was taken.
+ *
+ * @return Pointer to SessionNode if that session is still open, NULL otherwise
+ */
+SessionNode *find_session_by_handle(int socket_fd, unsigned long session_id);
+
 /**
  * @brief Add a new session to the manager
+ *
+ * The session is copied into the slot of its socket_fd; use
+ * find_session_by_socket() afterwards to get the stable pointer.
+ * If the session is already logged in it is also indexed by username.
  * 
  * @param session Pointer to the session to add
  * @return true if added successfully, false if session already exists
@@ -379,13 +485,42 @@ bool remove_session_by_socket(int socket_fd);
 bool remove_session_by_username(const char *username);
 
 /**
- * @brief Update session in manager by socket
- * 
- * @param socket_fd Socket file descriptor
- * @param session Pointer to updated session data
- * @return true if updated successfully, false if not found
+ * @brief Index a managed session under its (just set) username
+ *
+ * Called after a successful login. The session must be the one stored in
+ * the manager (obtained from find_session_by_socket()).
+ *
+ * @param session Managed session with isLoggedIn and username set
+ */
+void session_bind_username(ServerSession *session);
+
+/**
+ * @brief Drop a managed session from the username index
+ *
+ * Called before the username is cleared (logout, disconnect).
+ *
+ * @param session Managed session
+ */
+void session_unbind_username(ServerSession *session);
+
+/**
+ * @brief Move a session into a match and onto its broadcast roster
+ *
+ * Leaves the previous match first if it differs.
+ *
+ * @param session Managed session
+ * @param match_id Match to join
+ */
+void session_join_match(ServerSession *session, int match_id);
+
+/**
+ * @brief Remove a session from its current match roster
+ *
+ * Clears current_match_id. Called on logout and disconnect.
+ *
+ * @param session Managed session
  */
-bool update_session_by_socket(int socket_fd, ServerSession *session);
+void session_leave_match(ServerSession *session);
 
 /**
  * @brief Get current number of active sessions.
@@ -402,7 +537,7 @@ int get_active_session_count(void);
  *   - RESP_MATCH_INFO_OK (206): Success
  *   - RESP_MATCH_NOT_FOUND (414): Match not found
  */
-int server_handle_match_info(int match_id, char *output, size_t output_size, UserTable *user);
+int server_handle_match_info(int match_id, char *output, size_t output_size);
 TreasureChest* find_chest_by_id_in_match(int match_id, int chest_id);
 
 
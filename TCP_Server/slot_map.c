@@ -0,0 +1,142 @@
+/**
+ * ============================================================================
+ * SLOT MAP MODULE - IMPLEMENTATION
+ * ============================================================================
+ */
+
+#include "slot_map.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Each row is preceded by its slot number so slot_map_handle_of() is O(1) */
+typedef struct {
+    uint32_t slot;
+    uint32_t pad;
+} RowHeader;
+
+#define ROW_ALIGN   16
+
+static unsigned char* slot_row(const SlotMap *m, uint32_t slot) {
+    return m->chunks[slot / SLOT_MAP_CHUNK] + (size_t)(slot % SLOT_MAP_CHUNK) * m->stride + ROW_ALIGN;
+}
+
+static SlotHandle make_handle(const SlotMap *m, uint32_t slot) {
+    return ((SlotHandle)m->generation[slot] << 32) | ((SlotHandle)slot + 1);
+}
+
+// Add one chunk of free slots
+static bool grow(SlotMap *m) {
+    if (m->stride == 0) {
+        m->stride = (ROW_ALIGN + m->elem_size + ROW_ALIGN - 1) / ROW_ALIGN * ROW_ALIGN;
+    }
+    size_t slots = m->slots + SLOT_MAP_CHUNK;
+    if (slots > UINT32_MAX) return false;
+
+    unsigned char **chunks = realloc(m->chunks, (m->chunk_count + 1) * sizeof(*chunks));
+    if (!chunks) return false;
+    m->chunks = chunks;
+
+    uint32_t *generation = realloc(m->generation, slots * sizeof(uint32_t));
+    if (!generation) return false;
+    m->generation = generation;
+
+    uint32_t *dense_pos = realloc(m->dense_pos, slots * sizeof(uint32_t));
+    if (!dense_pos) return false;
+    m->dense_pos = dense_pos;
+
+    uint32_t *dense = realloc(m->dense, slots * sizeof(uint32_t));
+    if (!dense) return false;
+    m->dense = dense;
+
+    unsigned char *chunk = calloc(SLOT_MAP_CHUNK, m->stride);
+    if (!chunk) return false;
+    m->chunks[m->chunk_count++] = chunk;
+
+    // Chain the new slots onto the free list, lowest first
+    for (size_t i = slots; i-- > m->slots; ) {
+        RowHeader *hdr = (RowHeader *)(chunk + (i - m->slots) * m->stride);
+        hdr->slot = (uint32_t)i;
+        m->generation[i] = 0;
+        m->dense_pos[i] = m->free_head;
+        m->free_head = (uint32_t)i;
+    }
+    m->slots = slots;
+    return true;
+}
+
+void* slot_map_insert(SlotMap *m, SlotHandle *out) {
+    if (!m) return NULL;
+    if (m->free_head == UINT32_MAX && !grow(m)) return NULL;
+
+    uint32_t slot = m->free_head;
+    m->free_head = m->dense_pos[slot];
+    m->dense_pos[slot] = (uint32_t)m->count;
+    m->dense[m->count++] = slot;
+
+    unsigned char *row = slot_row(m, slot);
+    memset(row, 0, m->elem_size);
+    if (out) *out = make_handle(m, slot);
+    return row;
+}
+
+static bool slot_live(const SlotMap *m, SlotHandle h, uint32_t *slot_out) {
+    if (!m || h == SLOT_HANDLE_NONE) return false;
+    uint64_t slot = (h & 0xffffffffULL) - 1;
+    if (slot >= m->slots || m->generation[slot] != (uint32_t)(h >> 32)) return false;
+    // Free slots hold a free-list link in dense_pos, so check the back pointer too
+    uint32_t pos = m->dense_pos[slot];
+    if (pos >= m->count || m->dense[pos] != slot) return false;
+    *slot_out = (uint32_t)slot;
+    return true;
+}
+
+void* slot_map_get(const SlotMap *m, SlotHandle h) {
+    uint32_t slot;
+    return slot_live(m, h, &slot) ? slot_row(m, slot) : NULL;
+}
+
+SlotHandle slot_map_handle_of(const SlotMap *m, const void *row) {
+    if (!m || !row) return SLOT_HANDLE_NONE;
+    const RowHeader *hdr = (const RowHeader *)((const unsigned char *)row - ROW_ALIGN);
+    return make_handle(m, hdr->slot);
+}
+
+bool slot_map_remove(SlotMap *m, SlotHandle h) {
+    uint32_t slot;
+    if (!slot_live(m, h, &slot)) return false;
+
+    // Keep dense packed: the last live slot takes the hole
+    uint32_t pos = m->dense_pos[slot];
+    uint32_t last = m->dense[--m->count];
+    m->dense[pos] = last;
+    m->dense_pos[last] = pos;
+
+    m->generation[slot]++;
+    m->dense_pos[slot] = m->free_head;
+    m->free_head = slot;
+    return true;
+}
+
+size_t slot_map_count(const SlotMap *m) {
+    return m ? m->count : 0;
+}
+
+void* slot_map_at(const SlotMap *m, size_t i) {
+    if (!m || i >= m->count) return NULL;
+    return slot_row(m, m->dense[i]);
+}
+
+void slot_map_clear(SlotMap *m) {
+    if (!m) return;
+    for (size_t i = 0; i < m->chunk_count; i++) {
+        free(m->chunks[i]);
+    }
+    free(m->chunks);
+    free(m->generation);
+    free(m->dense_pos);
+    free(m->dense);
+    m->chunks = NULL;
+    m->generation = m->dense_pos = m->dense = NULL;
+    m->chunk_count = m->count = m->slots = 0;
+    m->free_head = UINT32_MAX;
+}
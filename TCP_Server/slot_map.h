@@ -0,0 +1,95 @@
+/**
+ * ============================================================================
+ * SLOT MAP MODULE
+ * ============================================================================
+ *
+ * Generational slot map: storage for table rows that are created and
+ * deleted all the time (ships, join requests, invites, team members).
+ *
+ *   - Rows live in fixed-size chunks that are never moved or freed while
+ *     the map exists, so a row pointer stays valid until the row is
+ *     removed, whatever happens to other rows.
+ *   - A SlotHandle names a row safely: it carries the slot's generation,
+ *     which is bumped on removal, so a handle to a removed row resolves
+ *     to NULL instead of to whatever reuses the slot.
+ *   - Insert and remove are O(1) (free list of slots).
+ *   - A packed array of live slots gives dense iteration with
+ *     slot_map_at(0 .. slot_map_count() - 1). Removing a row moves the
+ *     last one into its position, so iterate backwards when removing
+ *     while iterating. Iteration order is not insertion order.
+ * ============================================================================
+ */
+
+#ifndef SLOT_MAP_H
+#define SLOT_MAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SLOT_MAP_CHUNK      64      /**< Rows per chunk */
+
+/** (generation << 32) | (slot + 1); 0 is never a valid handle */
+typedef uint64_t SlotHandle;
+
+#define SLOT_HANDLE_NONE    ((SlotHandle)0)
+
+/**
+ * @struct SlotMap
+ * @brief Zero-initialize with SLOT_MAP_INIT(type)
+ */
+typedef struct {
+    size_t          elem_size;      /**< sizeof the row type */
+    size_t          stride;         /**< Bytes per row in a chunk (with slot header) */
+    unsigned char **chunks;
+    size_t          chunk_count;
+    uint32_t       *generation;     /**< Per slot */
+    uint32_t       *dense_pos;      /**< Per slot: position in dense, or next free slot */
+    uint32_t       *dense;          /**< Live slots, packed */
+    size_t          count;          /**< Live rows */
+    size_t          slots;          /**< Slots allocated (chunk_count * SLOT_MAP_CHUNK) */
+    uint32_t        free_head;      /**< First free slot, UINT32_MAX if none */
+} SlotMap;
+
+#define SLOT_MAP_INIT(type) { sizeof(type), 0, NULL, 0, NULL, NULL, NULL, 0, 0, UINT32_MAX }
+
+/**
+ * @brief Add a zeroed row
+ * @param out Receives the row's handle (may be NULL)
+ * @return The row, or NULL if out of memory
+ */
+void* slot_map_insert(SlotMap *m, SlotHandle *out);
+
+/**
+ * @brief Resolve a handle
+ * @return The row, or NULL if it was removed
+ */
+void* slot_map_get(const SlotMap *m, SlotHandle h);
+
+/**
+ * @brief Handle of a row returned by this map
+ */
+SlotHandle slot_map_handle_of(const SlotMap *m, const void *row);
+
+/**
+ * @brief Remove a row (by handle); stale handles are ignored
+ * @return true if a row was removed
+ */
+bool slot_map_remove(SlotMap *m, SlotHandle h);
+
+/**
+ * @brief Number of live rows
+ */
+size_t slot_map_count(const SlotMap *m);
+
+/**
+ * @brief i-th live row, for 0 <= i < slot_map_count()
+ */
+void* slot_map_at(const SlotMap *m, size_t i);
+
+/**
+ * @brief Remove every row and free all memory
+ */
+void slot_map_clear(SlotMap *m);
+
+#endif // SLOT_MAP_H
@@ -9,18 +9,11 @@
 #include "users.h"
 #include "config.h"
 #include "file_transfer.h"
-#include "hash.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
-extern Team teams[MAX_TEAMS]; 
-extern TeamMember team_members[MAX_TEAM_MEMBERS * MAX_TEAMS];
 extern UserTable *g_user_table;
-extern int team_member_count;
-extern JoinRequest join_requests[MAX_JOIN_REQUESTS];
-extern int join_request_count;
-extern TeamInvite team_invites[MAX_TEAM_INVITES];
-extern int team_invite_count;
 
 /* ============================================================================
  * CREATE TEAM
@@ -54,7 +47,6 @@ int handle_create_team(ServerSession *session, UserTable *ut, const char *name)
     }
     
     session->current_team_id = new_team->team_id;
-    update_session_by_socket(session->socket_fd, session);
     printf("[INFO] User '%s' created team '%s' (ID: %d)\n", 
            session->username, new_team->name, new_team->team_id);
     return RESP_TEAM_CREATED;
@@ -89,7 +81,6 @@ int handle_delete_team(ServerSession *session) {
     }
     
     session->current_team_id = -1;
-    update_session_by_socket(session->socket_fd, session);
     
     return RESP_TEAM_DELETED;
 }
@@ -97,6 +88,12 @@ int handle_delete_team(ServerSession *session) {
 /* ============================================================================
  * LIST TEAMS 
  * ============================================================================ */
+static int compare_team_id(const void *a, const void *b) {
+    int ia = (*(Team * const *)a)->team_id;
+    int ib = (*(Team * const *)b)->team_id;
+    return (ia > ib) - (ia < ib);
+}
+
 int handle_list_teams(ServerSession *session, char *output_buf, size_t buf_size) {
     if (!session || !output_buf || buf_size == 0) {
         return RESP_SYNTAX_ERROR;
@@ -110,14 +107,22 @@ int handle_list_teams(ServerSession *session, char *output_buf, size_t buf_size)
     int count = 0;
     char temp[256];
 
-    for (int i = 0; i < MAX_TEAMS; i++) {
-        if (teams[i].team_id > 0 && strlen(teams[i].name) > 0 && teams[i].status == TEAM_ACTIVE) {
+    // Storage order is not creation order; list by team id
+    int team_count = get_team_count();
+    Team **sorted = malloc((team_count > 0 ? team_count : 1) * sizeof(Team*));
+    if (!sorted) return RESP_INTERNAL_ERROR;
+    for (int i = 0; i < team_count; i++) sorted[i] = get_team_at(i);
+    qsort(sorted, (size_t)team_count, sizeof(Team*), compare_team_id);
+
+    for (int i = 0; i < team_count; i++) {
+        Team *team = sorted[i];
+        if (team->team_id > 0 && strlen(team->name) > 0 && team->status == TEAM_ACTIVE) {
             
-            int member_count = get_team_member_count(teams[i].team_id);
+            int member_count = get_team_member_count(team->team_id);
         
             snprintf(temp, sizeof(temp), "[%d] %s (%d/%d)|", 
-                     teams[i].team_id, 
-                     teams[i].name, 
+                     team->team_id, 
+                     team->name, 
                      member_count, 
                      MAX_TEAM_MEMBERS);
             
@@ -129,6 +134,7 @@ int handle_list_teams(ServerSession *session, char *output_buf, size_t buf_size)
             }
         }
     }
+    free(sorted);
     
     if (count == 0) {
         snprintf(output_buf, buf_size, "No active teams available.");
@@ -175,17 +181,16 @@ int handle_team_member_list(ServerSession *session, char *output_buf, size_t buf
     char temp[MAX_USERNAME + 5]; 
     int count = 0;
 
-    for (int i = 0; i < team_member_count; i++) {
-        if (team_members[i].team_id == team_id) {
-
-            snprintf(temp, sizeof(temp), "%s|", team_members[i].username);
+    TeamMember *members[MAX_TEAM_MEMBERS];
+    int member_count = get_team_members(team_id, members, MAX_TEAM_MEMBERS);
+    for (int i = 0; i < member_count; i++) {
+        snprintf(temp, sizeof(temp), "%s|", members[i]->username);
 
-            if (strlen(output_buf) + strlen(temp) < buf_size - 1) {
-                strcat(output_buf, temp);
-                count++;
-            } else {
-                break; 
-            }
+        if (strlen(output_buf) + strlen(temp) < buf_size - 1) {
+            strcat(output_buf, temp);
+            count++;
+        } else {
+            break; 
         }
     }
     
@@ -213,49 +218,26 @@ int handle_leave_team(ServerSession *session) {
             return RESP_INTERNAL_ERROR;
         }
         session->current_team_id = -1;
-        update_session_by_socket(session->socket_fd, session);
         return RESP_TEAM_LEAVE_OK; 
     }
     
     
     
     bool is_creator = (strcmp(team->creator_username, session->username) == 0);
-    int remove_index = -1;
 
-    for (int i = 0; i < team_member_count; i++) {
-        if (team_members[i].team_id == team_id && 
-            strcmp(team_members[i].username, session->username) == 0) {
-            remove_index = i;
-            break;
-        }
-    }
-
-    if (remove_index != -1) {
-        for (int i = remove_index; i < team_member_count - 1; i++) {
-            team_members[i] = team_members[i + 1];
-        }
-        team_member_count--;
-        
+    if (remove_team_member(team_id, session->username)) {
         if (is_creator) {
-            int new_captain_index = -1;
-            for (int i = 0; i < team_member_count; i++) {
-                if (team_members[i].team_id == team_id) {
-                    new_captain_index = i;
-                    break; 
-                }
-            }
+            // The longest-standing member becomes captain
+            TeamMember *new_captain = NULL;
+            get_team_members(team_id, &new_captain, 1);
 
-            if (new_captain_index != -1) {
-                strncpy(team->creator_username, team_members[new_captain_index].username, MAX_USERNAME - 1);
-                team->creator_username[MAX_USERNAME - 1] = '\0';
-
-                team_members[new_captain_index].role = ROLE_CREATOR; 
+            if (new_captain != NULL) {
+                set_team_captain(team_id, new_captain->username);
             }
         }
     }
     
     session->current_team_id = -1;
-    update_session_by_socket(session->socket_fd, session);
     
     return RESP_TEAM_LEAVE_OK;
 }
@@ -288,23 +270,7 @@ int handle_kick_member(ServerSession *session, const char *username) {
     }
     
     
-    int index = -1;
-    for (int i = 0; i < team_member_count; i++) {
-        if (team_members[i].team_id == team_id && 
-            strcmp(team_members[i].username, username) == 0) {
-            index = i;
-            break;
-        }
-    }
-
-    if (index != -1) {
-        for (int i = index; i < team_member_count - 1; i++) {
-            team_members[i] = team_members[i + 1];
-        }
-        team_member_count--; 
-    }
-    
-    if (index == -1) {
+    if (!remove_team_member(team_id, username)) {
         return RESP_INTERNAL_ERROR; 
     }
     // --------------------------------------
@@ -344,30 +310,15 @@ int handle_join_request(ServerSession *session, const char *name) {
     }
 
     // Kiểm tra xem đã gửi request chưa (tránh spam)
-    for (int i = 0; i < join_request_count; i++) {
-        if (join_requests[i].team_id == team->team_id &&
-            strcmp(join_requests[i].username, session->username) == 0 && // So sánh tên
-            join_requests[i].status == STATUS_PENDING) { 
-            
-            return RESP_JOIN_REQUEST_SENT; // Đã gửi rồi
-        }
+    if (find_join_request(team->team_id, session->username)) {
+        return RESP_JOIN_REQUEST_SENT; // Đã gửi rồi
     }
 
-    if (join_request_count >= MAX_JOIN_REQUESTS) {
+    // TẠO REQUEST MỚI (lưu tên user thay vì ID)
+    if (!create_join_request(team->team_id, session->username)) {
         return RESP_INTERNAL_ERROR;
     }
 
-    // TẠO REQUEST MỚI
-    JoinRequest *req = &join_requests[join_request_count++];
-    req->team_id = team->team_id;
-    
-    // [QUAN TRỌNG] Lưu tên user thay vì ID
-    strncpy(req->username, session->username, MAX_USERNAME - 1);
-    req->username[MAX_USERNAME - 1] = '\0';
-    
-    req->requested_at = time(NULL);
-    req->status = STATUS_PENDING;
-
     return RESP_JOIN_REQUEST_SENT;
 }
 
@@ -393,13 +344,15 @@ int handle_check_join_requests(ServerSession *session, char *output_buf, size_t
     output_buf[0] = '\0';
     char temp[256];
 
-    for (int i = 0; i < join_request_count; i++) {
+    int total = get_join_request_count();
+    for (int i = 0; i < total; i++) {
+        JoinRequest *req = get_join_request_at(i);
         // Lọc request của team mình & trạng thái Pending
-        if (join_requests[i].team_id == team_id && 
-            join_requests[i].status == STATUS_PENDING) {
+        if (req->team_id == team_id && 
+            req->status == STATUS_PENDING) {
             
             // [CỰC KỲ ĐƠN GIẢN] Lấy tên trực tiếp từ struct
-            snprintf(temp, sizeof(temp), "%s|", join_requests[i].username);
+            snprintf(temp, sizeof(temp), "%s|", req->username);
             
             if (strlen(output_buf) + strlen(temp) < buf_size - 1) {
                 strcat(output_buf, temp);
@@ -431,18 +384,8 @@ int handle_join_approve(ServerSession *session, const char *target_username, Use
     }
 
     // Tìm request khớp với tên người dùng được chọn
-    int req_index = -1;
-    for (int i = 0; i < join_request_count; i++) {
-        if (join_requests[i].team_id == team->team_id &&
-            strcmp(join_requests[i].username, target_username) == 0 && // So sánh tên
-            join_requests[i].status == STATUS_PENDING) { 
-            
-            req_index = i;
-            break;
-        }
-    }
-
-    if (req_index == -1) {
+    JoinRequest *req = find_join_request(team->team_id, target_username);
+    if (!req) {
         return RESP_NOT_FOUND_REQUEST; 
     }
 
@@ -452,27 +395,17 @@ int handle_join_approve(ServerSession *session, const char *target_username, Use
     // Check nếu user đã vào team khác rồi
     if (find_team_id_by_username(target_username) > 0) {
         // Xóa request này đi vì không còn hợp lệ
-        // (Logic xóa: dời các phần tử phía sau lên)
-        for (int i = req_index; i < join_request_count - 1; i++) {
-            join_requests[i] = join_requests[i + 1];
-        }
-        join_request_count--;
+        delete_join_request(req);
         return RESP_ALREADY_IN_TEAM;
     }
 
     // THÊM THÀNH VIÊN
-    TeamMember *member = &team_members[team_member_count++];
-    member->team_id = team->team_id;
-    strncpy(member->username, target_username, MAX_USERNAME - 1);
-    member->username[MAX_USERNAME - 1] = '\0';
-    member->role = 1; // Member
-    member->joined_at = time(NULL);
+    if (!add_team_member(team->team_id, target_username, ROLE_MEMBER)) {
+        return RESP_INTERNAL_ERROR;
+    }
 
     // Xóa request sau khi duyệt
-    for (int i = req_index; i < join_request_count - 1; i++) {
-        join_requests[i] = join_requests[i + 1];
-    }
-    join_request_count--;
+    delete_join_request(req);
 
     // Cập nhật session nếu người chơi đang online
     SessionNode *target_node = find_session_by_username(target_username);
@@ -497,26 +430,13 @@ int handle_join_reject(ServerSession *session, const char *target_username) {
         return RESP_NOT_CREATOR;
     }
     
-    int req_index = -1;
-    for (int i = 0; i < join_request_count; i++) {
-        if (join_requests[i].team_id == team->team_id &&
-            strcmp(join_requests[i].username, target_username) == 0 && // So sánh tên
-            join_requests[i].status == STATUS_PENDING) { 
-            
-            req_index = i;
-            break;
-        }
-    }
-    
-    if (req_index == -1) {
+    JoinRequest *req = find_join_request(team->team_id, target_username);
+    if (!req) {
         return RESP_NOT_FOUND_REQUEST; 
     }
     
     // Xóa request
-    for (int i = req_index; i < join_request_count - 1; i++) {
-        join_requests[i] = join_requests[i + 1];
-    }
-    join_request_count--;
+    delete_join_request(req);
     
     return RESP_JOIN_REJECTED;
 }
@@ -548,28 +468,16 @@ int handle_invite(ServerSession *session, const char *target_username, UserTable
     int target_team_id = find_team_id_by_username(target_username);
     if (target_team_id > 0) return RESP_ALREADY_IN_TEAM;
 
-    int inviter_id = hashFunc(session->username);
-    int invitee_id = hashFunc(target_username);
+    int inviter_id = session->user_id;
+    int invitee_id = target_user->user_id;
 
-    for (int i = 0; i < team_invite_count; i++) {
-        if (team_invites[i].team_id == team->team_id &&
-            team_invites[i].invitee_id == invitee_id && 
-            team_invites[i].status == STATUS_PENDING) {  
-            
-            return RESP_TEAM_INVITED; 
-        }
+    if (find_team_invite(team->team_id, invitee_id)) {
+        return RESP_TEAM_INVITED; 
     }
 
-    if (team_invite_count >= MAX_TEAM_INVITES) {
+    if (!create_team_invite(team->team_id, inviter_id, invitee_id)) {
         return RESP_INVITE_QUEUE_FULL;
     }
-    TeamInvite *invite = &team_invites[team_invite_count++];
-    
-    invite->team_id = team->team_id;
-    invite->inviter_id = inviter_id;
-    invite->invitee_id = invitee_id; 
-    invite->invited_at = time(NULL);
-    invite->status = STATUS_PENDING;
 
     return RESP_TEAM_INVITED;
 }
@@ -592,41 +500,18 @@ int handle_invite_accept(ServerSession *session, const char *name) {
         return RESP_TEAM_FULL;
     }
     
-    int my_user_id = hashFunc(session->username);
-
-
-    int invite_index = -1;
-
-    for (int i = 0; i < team_invite_count; i++) {
-        if (team_invites[i].team_id == team->team_id &&
-            team_invites[i].invitee_id == my_user_id) { 
-            invite_index = i;
-            break;
-        }
-    }
-
-    if (invite_index == -1) {
+    TeamInvite *invite = find_team_invite(team->team_id, session->user_id);
+    if (!invite) {
         return RESP_INVITE_NOT_FOUND; 
     }
 
-    for (int i = invite_index; i < team_invite_count - 1; i++) {
-        team_invites[i] = team_invites[i + 1];
-    }
-    team_invite_count--;
+    delete_team_invite(invite);
 
-    if (team_member_count >= MAX_TEAMS * MAX_TEAM_MEMBERS) {
+    if (!add_team_member(team->team_id, session->username, ROLE_MEMBER)) {
         return RESP_INTERNAL_ERROR;
     }
 
-    TeamMember *member = &team_members[team_member_count++];
-    member->team_id = team->team_id;
-    strncpy(member->username, session->username, MAX_USERNAME - 1);
-    member->username[MAX_USERNAME - 1] = '\0';
-    member->role = 1; 
-    member->joined_at = time(NULL);
-
     session->current_team_id = team->team_id;
-    update_session_by_socket(session->socket_fd, session);
     
     return RESP_TEAM_INVITE_ACCEPTED;
 }
@@ -641,26 +526,12 @@ int handle_invite_reject(ServerSession *session, const char *name) {
     Team *team = find_team_by_name(name);
     if (!team) return RESP_TEAM_NOT_FOUND;
     
-    int my_user_id = hashFunc(session->username);
-
-    int invite_index = -1;
-
-    for (int i = 0; i < team_invite_count; i++) {
-        if (team_invites[i].team_id == team->team_id &&
-            team_invites[i].invitee_id == my_user_id) {
-            invite_index = i;
-            break;
-        }
-    }
-
-    if (invite_index == -1) {
+    TeamInvite *invite = find_team_invite(team->team_id, session->user_id);
+    if (!invite) {
         return RESP_INVITE_NOT_FOUND; 
     }
 
-    for (int i = invite_index; i < team_invite_count - 1; i++) {
-        team_invites[i] = team_invites[i + 1];
-    }
-    team_invite_count--;
+    delete_team_invite(invite);
 
     return RESP_TEAM_INVITE_REJECTED;
 }
@@ -672,18 +543,20 @@ int handle_check_invites(ServerSession *session, char *output_buf, size_t buf_si
     if (!session || !output_buf || buf_size == 0) return RESP_SYNTAX_ERROR;
     if (!session->isLoggedIn) return RESP_NOT_LOGGED;
 
-    int my_id = hashFunc(session->username);
+    int my_id = session->user_id;
     int count = 0;
     output_buf[0] = '\0';
     char temp[256];
 
     // Duyệt qua tất cả lời mời
-    for (int i = 0; i < team_invite_count; i++) {
+    int total = get_team_invite_count();
+    for (int i = 0; i < total; i++) {
+        TeamInvite *invite = get_team_invite_at(i);
         // Kiểm tra xem lời mời có phải gửi cho mình không và trạng thái Pending
-        if (team_invites[i].invitee_id == my_id && 
-            team_invites[i].status == STATUS_PENDING) {
+        if (invite->invitee_id == my_id && 
+            invite->status == STATUS_PENDING) {
             
-            Team *t = find_team_by_id(team_invites[i].team_id);
+            Team *t = find_team_by_id(invite->team_id);
             if (t) {
                 // Format: "TeamName (ID: X)|"
                 // Dùng dấu | làm vách ngăn để Client dễ tách
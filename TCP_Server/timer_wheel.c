@@ -0,0 +1,135 @@
+/**
+ * ============================================================================
+ * TIMER WHEEL MODULE - IMPLEMENTATION
+ * ============================================================================
+ */
+
+#include "timer_wheel.h"
+#include "config.h"
+#include <stddef.h>
+#include <time.h>
+
+#define LEVEL_SHIFT(level)  ((level) * TIMER_WHEEL_BITS)
+#define SLOT_MASK           (TIMER_WHEEL_SLOTS - 1)
+
+uint64_t timer_now_tick(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t ms = (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+    return ms / TIMER_TICK_MS;
+}
+
+uint64_t timer_ms_to_ticks(uint64_t ms) {
+    return (ms + TIMER_TICK_MS - 1) / TIMER_TICK_MS;
+}
+
+void timer_wheel_init(TimerWheel *w, uint64_t now) {
+    w->now = now;
+    w->count = 0;
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+            w->slots[level][slot] = NULL;
+        }
+    }
+}
+
+void timer_init(Timer *t, TimerFn fn, void *arg) {
+    t->next = NULL;
+    t->pprev = NULL;
+    t->wheel = NULL;
+    t->expires = 0;
+    t->fn = fn;
+    t->arg = arg;
+}
+
+bool timer_armed(const Timer *t) {
+    return t->pprev != NULL;
+}
+
+/*
+ * Link t into the slot for t->expires as seen from w->now: the lowest
+ * level whose slots share everything above it with now. A timer due at
+ * now itself lands in the level-0 slot being run.
+ */
+static void timer_link(TimerWheel *w, Timer *t) {
+    Timer **slot = NULL;
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        if (((t->expires ^ w->now) >> LEVEL_SHIFT(level + 1)) == 0) {
+            slot = &w->slots[level][(t->expires >> LEVEL_SHIFT(level)) & SLOT_MASK];
+            break;
+        }
+    }
+    if (!slot) {
+        // Out of range: park in the top slot reached last, then place again
+        int top = TIMER_WHEEL_LEVELS - 1;
+        slot = &w->slots[top][((w->now >> LEVEL_SHIFT(top)) - 1) & SLOT_MASK];
+    }
+
+    t->next = *slot;
+    if (t->next) t->next->pprev = &t->next;
+    *slot = t;
+    t->pprev = slot;
+}
+
+static void timer_unlink(Timer *t) {
+    *t->pprev = t->next;
+    if (t->next) t->next->pprev = t->pprev;
+    t->next = NULL;
+    t->pprev = NULL;
+}
+
+void timer_arm(TimerWheel *w, Timer *t, uint64_t expires) {
+    timer_cancel(t);
+    t->wheel = w;
+    t->expires = expires > w->now ? expires : w->now + 1;
+    timer_link(w, t);
+    w->count++;
+}
+
+void timer_cancel(Timer *t) {
+    if (!t->pprev) return;
+    timer_unlink(t);
+    t->wheel->count--;
+}
+
+/* Spread one slot of a higher level over the levels below */
+static void timer_cascade(TimerWheel *w, int level) {
+    Timer **slot = &w->slots[level][(w->now >> LEVEL_SHIFT(level)) & SLOT_MASK];
+    Timer *t = *slot;
+    *slot = NULL;
+    while (t) {
+        Timer *next = t->next;
+        timer_link(w, t);
+        t = next;
+    }
+}
+
+void timer_wheel_advance(TimerWheel *w, uint64_t now) {
+    while (w->now < now) {
+        if (w->count == 0) {
+            w->now = now;   // Nothing can fire on the way
+            return;
+        }
+        w->now++;
+
+        // Crossing a level-L boundary brings its next slot into range;
+        // higher levels first so their timers can fall further down
+        int top = 0;
+        while (top + 1 < TIMER_WHEEL_LEVELS
+               && (w->now & (((uint64_t)1 << LEVEL_SHIFT(top + 1)) - 1)) == 0) {
+            top++;
+        }
+        for (int level = top; level > 0; level--) {
+            timer_cascade(w, level);
+        }
+
+        // One at a time: a callback may cancel others in the same slot
+        Timer **slot = &w->slots[0][w->now & SLOT_MASK];
+        Timer *t;
+        while ((t = *slot) != NULL) {
+            timer_unlink(t);
+            w->count--;
+            t->fn(t);
+        }
+    }
+}
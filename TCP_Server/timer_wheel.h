@@ -0,0 +1,101 @@
+/**
+ * ============================================================================
+ * TIMER WHEEL MODULE
+ * ============================================================================
+ *
+ * Hierarchical timing wheel: TIMER_WHEEL_LEVELS levels of 64 slots, one
+ * tick being TIMER_TICK_MS. Level 0 holds timers due within 64 ticks,
+ * level 1 within 64^2, and so on (about 9 days at 50 ms); later ones
+ * wait in the last level and are placed again when it comes round.
+ *
+ *   - Arm and cancel are O(1): a Timer is an intrusive list node and
+ *     knows its wheel, so nothing is allocated or searched.
+ *   - Advancing by one tick runs one level-0 slot; every 64 ticks one
+ *     slot of the next level is spread over the levels below. Work is
+ *     proportional to timers that fire or move, never to all timers.
+ *
+ * A wheel has no lock; each one is used by a single thread, or under
+ * the lock guarding the objects its timers belong to.
+ * ============================================================================
+ */
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TIMER_WHEEL_BITS    6
+#define TIMER_WHEEL_SLOTS   (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS  4
+
+typedef struct Timer Timer;
+typedef struct TimerWheel TimerWheel;
+
+/** Runs when the timer expires; it is no longer armed and may be re-armed */
+typedef void (*TimerFn)(Timer *timer);
+
+/**
+ * @struct Timer
+ * @brief Embed in the object the timer belongs to; set up with timer_init()
+ */
+struct Timer {
+    Timer      *next;
+    Timer     **pprev;      /**< Link pointing at this timer; NULL when not armed */
+    TimerWheel *wheel;      /**< Wheel it is armed on */
+    uint64_t    expires;    /**< Tick */
+    TimerFn     fn;
+    void       *arg;        /**< For fn */
+};
+
+struct TimerWheel {
+    uint64_t now;                                           /**< Last tick run */
+    Timer   *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    unsigned long count;                                    /**< Armed timers */
+};
+
+/**
+ * @brief Current tick (CLOCK_MONOTONIC / TIMER_TICK_MS)
+ */
+uint64_t timer_now_tick(void);
+
+/**
+ * @brief Convert milliseconds to ticks, rounding up
+ */
+uint64_t timer_ms_to_ticks(uint64_t ms);
+
+/**
+ * @brief Start an empty wheel at tick now
+ */
+void timer_wheel_init(TimerWheel *w, uint64_t now);
+
+/**
+ * @brief Set a timer's callback (the timer is not armed)
+ */
+void timer_init(Timer *t, TimerFn fn, void *arg);
+
+/**
+ * @brief Arm (or move) a timer to fire at tick expires
+ *
+ * Expiry times not after w->now fire on the next tick.
+ */
+void timer_arm(TimerWheel *w, Timer *t, uint64_t expires);
+
+/**
+ * @brief Disarm a timer; no-op if it is not armed
+ */
+void timer_cancel(Timer *t);
+
+/**
+ * @brief Whether the timer is armed
+ */
+bool timer_armed(const Timer *t);
+
+/**
+ * @brief Run every timer due up to tick now, in tick order
+ *
+ * Callbacks may arm and cancel any timer, including other due ones.
+ */
+void timer_wheel_advance(TimerWheel *w, uint64_t now);
+
+#endif // TIMER_WHEEL_H
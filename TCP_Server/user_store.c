@@ -0,0 +1,283 @@
+/**
+ * ============================================================================
+ * USER STORE MODULE - IMPLEMENTATION
+ * ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#include "user_store.h"
+#include "config.h"
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/random.h>
+
+/* ============================================================================
+ * HASHING
+ * ============================================================================ */
+
+// Checksums only; the name index is keyed wyhash
+static uint64_t fnv1a64(uint64_t h, const void *data, size_t len) {
+    const unsigned char *p = data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+#define FNV64_BASIS  0xcbf29ce484222325ULL
+
+static uint64_t name_hash(uint64_t seed, const char *name) {
+    return hash_bytes(name, strlen(name), seed);
+}
+
+// Fresh per file and kept in the header, so index slots can't be
+// precomputed from usernames; readers hash with hdr->hash_seed
+static uint64_t new_index_seed(void) {
+    uint64_t seed;
+    if (getrandom(&seed, sizeof(seed), 0) != (ssize_t)sizeof(seed)) {
+        // No entropy source: still differs per run
+        seed = (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32);
+    }
+    return seed;
+}
+
+static uint64_t header_checksum(const UserStoreHeader *hdr) {
+    return fnv1a64(FNV64_BASIS, hdr, offsetof(UserStoreHeader, header_checksum));
+}
+
+static size_t image_size(uint64_t count, uint64_t slots) {
+    return sizeof(UserStoreHeader) + count * sizeof(UserRecord) + slots * sizeof(uint32_t);
+}
+
+/* ============================================================================
+ * READING
+ * ============================================================================ */
+
+UserStore* user_store_open(const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(UserStoreHeader)) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t len = (size_t)st.st_size;
+    void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap() users.bin error:");
+        return NULL;
+    }
+
+    const UserStoreHeader *hdr = map;
+    const char *why = NULL;
+    if (hdr->magic != USER_STORE_MAGIC) why = "bad magic";
+    else if (hdr->version != USER_STORE_VERSION) why = "unsupported version";
+    else if (hdr->record_size != sizeof(UserRecord)) why = "record size mismatch";
+    else if (hdr->header_checksum != header_checksum(hdr)) why = "header checksum mismatch";
+    else if (hdr->index_slots == 0 || (hdr->index_slots & (hdr->index_slots - 1)) != 0 ||
+             hdr->index_slots < hdr->count) why = "bad index size";
+    else if (image_size(hdr->count, hdr->index_slots) != len) why = "size mismatch";
+    if (why) {
+        fprintf(stderr, "[ERROR] %s: %s\n", path, why);
+        munmap(map, len);
+        return NULL;
+    }
+
+    UserStore *store = malloc(sizeof(UserStore));
+    if (!store) {
+        munmap(map, len);
+        return NULL;
+    }
+    store->map = map;
+    store->map_len = len;
+    store->hdr = hdr;
+    store->records = (const UserRecord *)((const char *)map + sizeof(UserStoreHeader));
+    store->index = (const uint32_t *)(store->records + hdr->count);
+
+    // Lookups hop around the file; don't let the kernel read ahead
+    madvise(map, len, MADV_RANDOM);
+    return store;
+}
+
+void user_store_close(UserStore *store) {
+    if (!store) return;
+    munmap(store->map, store->map_len);
+    free(store);
+}
+
+const UserRecord* user_store_find(const UserStore *store, const char *username) {
+    if (!store || !username) return NULL;
+
+    uint64_t mask = store->hdr->index_slots - 1;
+    uint64_t slot = name_hash(store->hdr->hash_seed, username) & mask;
+    for (uint64_t probes = 0; probes <= mask; probes++) {
+        uint32_t ref = store->index[slot];
+        if (ref == 0) return NULL;
+        if (ref <= store->hdr->count) {
+            const UserRecord *rec = &store->records[ref - 1];
+            if (strncmp(rec->username, username, MAX_USERNAME) == 0) return rec;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return NULL;
+}
+
+const UserRecord* user_store_find_id(const UserStore *store, int user_id) {
+    if (!store) return NULL;
+
+    size_t lo = 0, hi = (size_t)store->hdr->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int id = store->records[mid].user_id;
+        if (id == user_id) return &store->records[mid];
+        if (id < user_id) lo = mid + 1;
+        else hi = mid;
+    }
+    return NULL;
+}
+
+bool user_store_verify(const UserStore *store) {
+    if (!store) return false;
+    size_t data_len = store->map_len - sizeof(UserStoreHeader);
+    uint64_t sum = fnv1a64(FNV64_BASIS, store->records, data_len);
+    return sum == store->hdr->data_checksum;
+}
+
+void user_record_to_user(const UserRecord *rec, User *user) {
+    memcpy(user->username, rec->username, MAX_USERNAME);
+    user->username[MAX_USERNAME - 1] = '\0';
+    memcpy(user->password_hash, rec->password_hash, MAX_PASSWORD_HASH);
+    user->password_hash[MAX_PASSWORD_HASH - 1] = '\0';
+    user->status = (UserStatus)rec->status;
+    user->coin = (long)rec->coin;
+    user->created_at = (time_t)rec->created_at;
+    user->updated_at = (time_t)rec->updated_at;
+    user->user_id = rec->user_id;
+}
+
+/* ============================================================================
+ * WRITING
+ * ============================================================================ */
+
+static int compare_user_id(const void *a, const void *b) {
+    int ia = (*(const User * const *)a)->user_id;
+    int ib = (*(const User * const *)b)->user_id;
+    return (ia > ib) - (ia < ib);
+}
+
+UserIOStatus user_store_write(const char *path, const User *users, size_t count, unsigned long long lsn) {
+    if (!path || (count > 0 && !users)) return USER_IO_FILE_ERROR;
+    if (count >= UINT32_MAX) return USER_IO_FORMAT_ERROR;
+
+    // Keep the index at most half full so probe chains stay short
+    uint64_t slots = 16;
+    while (slots < 2 * (uint64_t)count) slots <<= 1;
+
+    size_t len = image_size(count, slots);
+    char *image = calloc(1, len);
+    if (!image) return USER_IO_MEMORY_ERROR;
+
+    UserStoreHeader *hdr = (UserStoreHeader *)image;
+    UserRecord *records = (UserRecord *)(image + sizeof(UserStoreHeader));
+    uint32_t *index = (uint32_t *)(records + count);
+
+    // Records go out in id order so user_store_find_id() can bisect
+    const User **order = malloc((count ? count : 1) * sizeof(User*));
+    if (!order) {
+        free(image);
+        return USER_IO_MEMORY_ERROR;
+    }
+    for (size_t i = 0; i < count; i++) order[i] = &users[i];
+    qsort(order, count, sizeof(User*), compare_user_id);
+
+    uint64_t seed = new_index_seed();
+    uint32_t next_user_id = 1;
+    for (size_t i = 0; i < count; i++) {
+        const User *user = order[i];
+        UserRecord *rec = &records[i];
+        snprintf(rec->username, MAX_USERNAME, "%s", user->username);
+        snprintf(rec->password_hash, MAX_PASSWORD_HASH, "%s", user->password_hash);
+        rec->status = (int32_t)user->status;
+        rec->user_id = (int32_t)user->user_id;
+        rec->coin = (int64_t)user->coin;
+        rec->created_at = (int64_t)user->created_at;
+        rec->updated_at = (int64_t)user->updated_at;
+        if ((uint32_t)user->user_id >= next_user_id) next_user_id = (uint32_t)user->user_id + 1;
+
+        uint64_t slot = name_hash(seed, rec->username) & (slots - 1);
+        while (index[slot] != 0) slot = (slot + 1) & (slots - 1);
+        index[slot] = (uint32_t)(i + 1);
+    }
+    free(order);
+
+    hdr->magic = USER_STORE_MAGIC;
+    hdr->version = USER_STORE_VERSION;
+    hdr->record_size = sizeof(UserRecord);
+    hdr->next_user_id = next_user_id;
+    hdr->count = count;
+    hdr->index_slots = slots;
+    hdr->hash_seed = seed;
+    hdr->lsn = lsn;
+    hdr->data_checksum = fnv1a64(FNV64_BASIS, records, len - sizeof(UserStoreHeader));
+    hdr->header_checksum = header_checksum(hdr);
+
+    UserIOStatus status = writeUsersFile(path, image, len);
+    free(image);
+    return status;
+}
+
+/* ============================================================================
+ * CONVERSION
+ * ============================================================================ */
+
+UserIOStatus user_store_from_text(const char *txt_path, const char *bin_path) {
+    UserTable *ut = initUserTable(HASH_SIZE);
+    if (!ut) return USER_IO_MEMORY_ERROR;
+
+    unsigned long long lsn = 0;
+    size_t count;
+    UserIOStatus status = loadUsers(ut, txt_path, &lsn);
+    if (status == USER_IO_OK) {
+        User *users = copyUsers(ut, &count);
+        status = users ? user_store_write(bin_path, users, count, lsn) : USER_IO_MEMORY_ERROR;
+        free(users);
+    }
+    freeUserTable(ut);
+    return status;
+}
+
+UserIOStatus user_store_to_text(const char *bin_path, const char *txt_path) {
+    UserStore *store = user_store_open(bin_path);
+    if (!store) return USER_IO_FILE_ERROR;
+    if (!user_store_verify(store)) {
+        user_store_close(store);
+        return USER_IO_FORMAT_ERROR;
+    }
+
+    size_t count = (size_t)store->hdr->count, len;
+    User *users = malloc((count ? count : 1) * sizeof(User));
+    if (!users) {
+        user_store_close(store);
+        return USER_IO_MEMORY_ERROR;
+    }
+    for (size_t i = 0; i < count; i++) user_record_to_user(&store->records[i], &users[i]);
+
+    char *data = formatUsers(users, count, store->hdr->lsn, &len);
+    UserIOStatus status = data ? writeUsersFile(txt_path, data, len) : USER_IO_MEMORY_ERROR;
+    free(data);
+    free(users);
+    user_store_close(store);
+    return status;
+}
@@ -0,0 +1,139 @@
+/**
+ * ============================================================================
+ * USER STORE MODULE
+ * ============================================================================
+ *
+ * Optional binary snapshot of the user table (users.bin), mmap()ed at
+ * startup instead of parsing users.txt. Opening it costs O(1): only the
+ * header is checked. Records are paged in by the kernel when first
+ * touched, and findUser() copies a record into the in-memory UserTable
+ * the first time the account is used.
+ *
+ * Layout (host byte order):
+ *   UserStoreHeader
+ *   UserRecord  records[count]       sorted by user_id
+ *   uint32_t    index[index_slots]   open addressing, linear probing on
+ *                                    hash_bytes(name, hash_seed);
+ *                                    0 = empty, else record number + 1
+ *
+ * The mapping is MAP_PRIVATE and read-only: changes live in the
+ * UserTable and reach disk through the journal and checkpoints, which
+ * rewrite the whole file with user_store_write().
+ * ============================================================================
+ */
+
+#ifndef USER_STORE_H
+#define USER_STORE_H
+
+#include "users.h"
+#include "users_io.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#define USER_STORE_MAGIC    0x42525355u     /**< "USRB" */
+#define USER_STORE_VERSION  3u              /**< 3: index hashed with hash_bytes() */
+
+/**
+ * @struct UserStoreHeader
+ * @brief First 64 bytes of users.bin
+ */
+typedef struct {
+    uint32_t magic;             /**< USER_STORE_MAGIC */
+    uint32_t version;           /**< USER_STORE_VERSION */
+    uint32_t record_size;       /**< sizeof(UserRecord) when written */
+    uint32_t next_user_id;      /**< Above every user_id in the file */
+    uint64_t count;             /**< Number of records */
+    uint64_t index_slots;       /**< Power of two, >= 2 * count */
+    uint64_t hash_seed;         /**< Seed of the index hash, random per write */
+    uint64_t lsn;               /**< Last journal LSN contained */
+    uint64_t data_checksum;     /**< FNV-1a 64 over records and index */
+    uint64_t header_checksum;   /**< FNV-1a 64 over the fields above */
+} UserStoreHeader;
+
+/**
+ * @struct UserRecord
+ * @brief Fixed-size on-disk form of a User
+ */
+typedef struct {
+    char     username[MAX_USERNAME];
+    char     password_hash[MAX_PASSWORD_HASH];
+    int32_t  status;
+    int32_t  user_id;
+    int64_t  coin;
+    int64_t  created_at;
+    int64_t  updated_at;
+} UserRecord;
+
+/**
+ * @struct UserStore
+ * @brief An open, mapped users.bin
+ */
+typedef struct UserStore {
+    void                  *map;       /**< Whole file */
+    size_t                 map_len;
+    const UserStoreHeader *hdr;
+    const UserRecord      *records;
+    const uint32_t        *index;
+} UserStore;
+
+/**
+ * @brief Map a users.bin file and validate its header.
+ *
+ * The data checksum is not checked here (that would read the whole
+ * file); use user_store_verify() for that.
+ *
+ * @param path Path to users.bin.
+ * @return Store, or NULL if the file is missing or invalid.
+ */
+UserStore* user_store_open(const char *path);
+
+/**
+ * @brief Unmap and free a store.
+ */
+void user_store_close(UserStore *store);
+
+/**
+ * @brief Look a username up in the on-disk index.
+ * @return Record inside the mapping, or NULL if absent.
+ */
+const UserRecord* user_store_find(const UserStore *store, const char *username);
+
+/**
+ * @brief Look a user id up (binary search over the records).
+ * @return Record inside the mapping, or NULL if absent.
+ */
+const UserRecord* user_store_find_id(const UserStore *store, int user_id);
+
+/**
+ * @brief Check the data checksum (reads every page).
+ * @return true if the records and index match the header.
+ */
+bool user_store_verify(const UserStore *store);
+
+/**
+ * @brief Convert a record to a User.
+ */
+void user_record_to_user(const UserRecord *rec, User *user);
+
+/**
+ * @brief Build a users.bin image and atomically replace path with it.
+ *
+ * @param path Destination file.
+ * @param users Users to store (e.g. from copyUsers()).
+ * @param count Number of users.
+ * @param lsn Journal LSN to record in the header.
+ * @return UserIOStatus code indicating success or type of failure.
+ */
+UserIOStatus user_store_write(const char *path, const User *users, size_t count, unsigned long long lsn);
+
+/**
+ * @brief Convert a users.txt snapshot to users.bin (keeps its LSN).
+ */
+UserIOStatus user_store_from_text(const char *txt_path, const char *bin_path);
+
+/**
+ * @brief Convert a users.bin snapshot back to users.txt (keeps its LSN).
+ */
+UserIOStatus user_store_to_text(const char *bin_path, const char *txt_path);
+
+#endif // USER_STORE_H
@@ -4,27 +4,131 @@
  * ============================================================================
  */
 
+#define _GNU_SOURCE
+
 #include "users.h"
 #include "hash.h"
+#include "kdf.h"
 #include "users_io.h"
+#include "journal.h"
+#include "user_store.h"
 #include "config.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/random.h>
 
 /* ============================================================================
  * HASHTABLE OPERATIONS
  * ============================================================================ */
 
+// Index hashes are never 0 so that 0 can mark an empty slot
+static uint64_t slotHash(const char *username) {
+    uint64_t hash = (uint64_t)hashFunc(username);
+    return hash ? hash : 1;
+}
+
+static size_t roundSlots(size_t size) {
+    size_t slots = 16;
+    while (slots < size) slots <<= 1;
+    return slots;
+}
+
+// How far the entry in slot i sits from its home slot
+static size_t probeDistance(uint64_t hash, size_t i, size_t mask) {
+    return (i - (size_t)hash) & mask;
+}
+
+// Robin Hood insert: an entry closer to home than us gives up its slot
+static void placeSlot(UserSlot *slots, size_t mask, uint64_t hash, User *user) {
+    size_t i = (size_t)hash & mask;
+    size_t dist = 0;
+    for (;;) {
+        UserSlot *s = &slots[i];
+        if (s->hash == 0) {
+            s->hash = hash;
+            s->user = user;
+            return;
+        }
+        size_t d = probeDistance(s->hash, i, mask);
+        if (d < dist) {
+            UserSlot tmp = *s;
+            s->hash = hash;
+            s->user = user;
+            hash = tmp.hash;
+            user = tmp.user;
+            dist = d;
+        }
+        i = (i + 1) & mask;
+        dist++;
+    }
+}
+
+static User* findSlot(const UserSlot *slots, size_t size, uint64_t hash, const char *username) {
+    size_t mask = size - 1;
+    size_t i = (size_t)hash & mask;
+    for (size_t dist = 0; dist < size; dist++) {
+        const UserSlot *s = &slots[i];
+        // Past the point where Robin Hood would have placed it
+        if (s->hash == 0 || probeDistance(s->hash, i, mask) < dist) return NULL;
+        if (s->hash == hash && strcmp(s->user->username, username) == 0) return s->user;
+        i = (i + 1) & mask;
+    }
+    return NULL;
+}
+
+// Entry for user_id in the id index, allocating its page if create is set
+static User** idSlot(UserTable *ut, int user_id, bool create) {
+    size_t page = (size_t)user_id / USER_ID_PAGE;
+    if (page >= ut->id_page_count) {
+        if (!create) return NULL;
+        size_t n = ut->id_page_count ? ut->id_page_count : 16;
+        while (n <= page) n *= 2;
+        User ***grown = realloc(ut->id_pages, n * sizeof(User**));
+        if (!grown) return NULL;
+        memset(grown + ut->id_page_count, 0, (n - ut->id_page_count) * sizeof(User**));
+        ut->id_pages = grown;
+        ut->id_page_count = n;
+    }
+    if (!ut->id_pages[page]) {
+        if (!create) return NULL;
+        ut->id_pages[page] = calloc(USER_ID_PAGE, sizeof(User*));
+        if (!ut->id_pages[page]) return NULL;
+    }
+    return &ut->id_pages[page][(size_t)user_id % USER_ID_PAGE];
+}
+
+// Move up to budget old slots into the current index
+static void migrateSlots(UserTable *ut, size_t budget) {
+    while (ut->old_slots && budget-- > 0) {
+        if (ut->old_pos == ut->old_size) {
+            free(ut->old_slots);
+            ut->old_slots = NULL;
+            ut->old_size = ut->old_pos = 0;
+            break;
+        }
+        const UserSlot *s = &ut->old_slots[ut->old_pos++];
+        if (s->hash) placeSlot(ut->slots, ut->size - 1, s->hash, s->user);
+    }
+}
+
 UserTable* initUserTable(size_t size) {
     UserTable *ut = malloc(sizeof(UserTable));
     if (!ut) return NULL;
     
-    ut->size = size;
+    ut->size = roundSlots(size);
     ut->count = 0;
-    ut->table = calloc(size, sizeof(User*));
-    if (!ut->table) {
+    ut->old_slots = NULL;
+    ut->old_size = ut->old_pos = 0;
+    ut->id_pages = NULL;
+    ut->id_page_count = 0;
+    ut->next_user_id = 1;
+    ut->store = NULL;
+    ut->slots = calloc(ut->size, sizeof(UserSlot));
+    if (!ut->slots) {
         free(ut);
         return NULL;
     }
@@ -34,40 +138,36 @@ UserTable* initUserTable(size_t size) {
 void freeUserTable(UserTable *ut) {
     if (!ut) return;
     
-    for (size_t i = 0; i < ut->size; i++) {
-        User *curr = ut->table[i];
-        while (curr) {
-            User *tmp = curr;
-            curr = curr->next;
-            free(tmp);
-        }
+    size_t cursor = 0;
+    User *user;
+    while ((user = nextLoadedUser(ut, &cursor)) != NULL) {
+        free(user);
+    }
+    free(ut->slots);
+    free(ut->old_slots);
+    for (size_t i = 0; i < ut->id_page_count; i++) {
+        free(ut->id_pages[i]);
     }
-    free(ut->table);
+    free(ut->id_pages);
+    user_store_close(ut->store);
     free(ut);
 }
 
 bool rehashUserTable(UserTable *ut, size_t new_size) {
     if (!ut || new_size == 0) return false;
-    
-    User **new_table = calloc(new_size, sizeof(User*));
-    if (!new_table) return false;
-    
-    // Reinsert all users into the new table
-    for (size_t i = 0; i < ut->size; i++) {
-        User *curr = ut->table[i];
-        while (curr) {
-            User *next = curr->next;
-            
-            unsigned long idx = hashFunc(curr->username) % new_size;
-            curr->next = new_table[idx];
-            new_table[idx] = curr;
-            
-            curr = next;
-        }
-    }
-    
-    free(ut->table);
-    ut->table = new_table;
+    new_size = roundSlots(new_size);
+    if ((double)ut->count / new_size > 0.75) return false;
+
+    // Only one resize in flight at a time
+    migrateSlots(ut, SIZE_MAX);
+
+    UserSlot *new_slots = calloc(new_size, sizeof(UserSlot));
+    if (!new_slots) return false;
+
+    ut->old_slots = ut->slots;
+    ut->old_size = ut->size;
+    ut->old_pos = 0;
+    ut->slots = new_slots;
     ut->size = new_size;
     return true;
 }
@@ -84,47 +184,98 @@ bool insertUser(UserTable *ut, User *user) {
             return false;
         }
     }
+    migrateSlots(ut, USER_REHASH_STEP);
+
+    // Keep ids read from disk; new users (and clashes) get the next one
+    User **id_slot = user->user_id > 0 ? idSlot(ut, user->user_id, false) : NULL;
+    if (user->user_id <= 0 || (id_slot && *id_slot)) {
+        user->user_id = ut->next_user_id;
+    }
+    id_slot = idSlot(ut, user->user_id, true);
+    if (!id_slot) return false;
     
-    unsigned long idx = hashFunc(user->username) % ut->size;
-    user->next = ut->table[idx];
-    ut->table[idx] = user;
+    placeSlot(ut->slots, ut->size - 1, slotHash(user->username), user);
+    *id_slot = user;
+    if (user->user_id >= ut->next_user_id) ut->next_user_id = user->user_id + 1;
     ut->count++;
     return true;
 }
 
+User* nextLoadedUser(const UserTable *ut, size_t *cursor) {
+    if (!ut || !cursor) return NULL;
 
-// TODO : find co can mutex ko?
-User* findUser(UserTable *ut, const char *username) {
-    if (!ut || !username) return NULL;
-    unsigned long idx = hashFunc(username) % ut->size;
-    User *curr = ut->table[idx];
-    
-    while (curr) {
-        if (strcmp(curr->username, username) == 0) {
-            return curr;
-        }
-        curr = curr->next;
+    // Current slots first, then the old ones not yet moved
+    while (*cursor < ut->size) {
+        const UserSlot *s = &ut->slots[(*cursor)++];
+        if (s->hash) return s->user;
+    }
+    if (*cursor < ut->size + ut->old_pos) *cursor = ut->size + ut->old_pos;
+    while (*cursor < ut->size + ut->old_size) {
+        const UserSlot *s = &ut->old_slots[(*cursor)++ - ut->size];
+        if (s->hash) return s->user;
     }
-    
     return NULL;
 }
 
-char* find_username_by_id(UserTable *ut, int user_id) {
-    if (!ut) return NULL;
+User* findLoadedUser(UserTable *ut, const char *username) {
+    if (!ut || !username) return NULL;
+    uint64_t hash = slotHash(username);
 
-    // Duyệt qua mảng table
-    for (size_t i = 0; i < ut->size; i++) {
-        User *current = ut->table[i]; 
-        
+    User *user = findSlot(ut->slots, ut->size, hash, username);
+    if (!user && ut->old_slots) {
+        user = findSlot(ut->old_slots, ut->old_size, hash, username);
+    }
+    return user;
+}
 
-        while (current) {
-            if ((int)hashFunc(current->username) == user_id) {
-                return current->username;
-            }
-            current = current->next;
-        }
+// Caller holds the user lock: a first use inserts into the table
+User* findUser(UserTable *ut, const char *username) {
+    User *user = findLoadedUser(ut, username);
+    if (user || !ut || !ut->store) return user;
+
+    // First use of an account from users.bin: copy it into the table
+    const UserRecord *rec = user_store_find(ut->store, username);
+    if (!rec) return NULL;
+    user = malloc(sizeof(User));
+    if (!user) return NULL;
+    user_record_to_user(rec, user);
+    if (!insertUser(ut, user)) {
+        free(user);
+        return NULL;
+    }
+    return user;
+}
+
+void attachUserStore(UserTable *ut, struct UserStore *store) {
+    if (!ut) return;
+    user_store_close(ut->store);
+    ut->store = store;
+    // Ids of records not loaded yet must not be handed out again
+    if (store && (int)store->hdr->next_user_id > ut->next_user_id) {
+        ut->next_user_id = (int)store->hdr->next_user_id;
     }
-    return NULL;
+}
+
+size_t maxUserCount(const UserTable *ut) {
+    if (!ut) return 0;
+    return ut->count + (ut->store ? (size_t)ut->store->hdr->count : 0);
+}
+
+User* findUserById(UserTable *ut, int user_id) {
+    if (!ut || user_id <= 0) return NULL;
+
+    User **slot = idSlot(ut, user_id, false);
+    if (slot && *slot) return *slot;
+
+    // Not loaded yet: the store keeps records sorted by id
+    if (!ut->store) return NULL;
+    const UserRecord *rec = user_store_find_id(ut->store, user_id);
+    return rec ? findUser(ut, rec->username) : NULL;
+}
+
+char* find_username_by_id(UserTable *ut, int user_id) {
+    User *user = findUserById(ut, user_id);
+    return user ? user->username : NULL;
 }
 
 /* ============================================================================
@@ -151,12 +302,13 @@ User* createUser(UserTable *ut, const char *username, const char *password_hash)
     user->coin = USER_DEFAULT_COIN;
     user->created_at = time(NULL);
     user->updated_at = time(NULL);
-    user->next = NULL;
+    user->user_id = 0;      // Assigned by insertUser()
     
     if (!insertUser(ut, user)) {
         free(user);
         return NULL;
     }
+    journal_log_new_user(user);
     
     return user;
 }
@@ -172,40 +324,75 @@ int updateUserCoin(UserTable *ut, const char *username, long delta) {
     user->coin += delta;
     user->updated_at = time(NULL);
     
-    // Persist to file
-    saveUsers(ut, USERS_FILE);
+    // Persist: one journal line instead of rewriting users.txt
+    journal_log_coin(user, delta);
 
     return 0;
 }
 
-// TODO : lockUser should also write to file?
 bool lockUser(UserTable *ut, const char *username) {
     User *user = findUser(ut, username);
     if (!user) return false;
     user->status = USER_BANNED;
     user->updated_at = time(NULL);
+    journal_log_status(user);
     
     return true;
 }
 
-// TODO : unlockUser should also write to file?
 bool unlockUser(UserTable *ut, const char *username) {
     User *user = findUser(ut, username);
     if (!user) return false;
     user->status = USER_ACTIVE;
     user->updated_at = time(NULL);
+    journal_log_status(user);
     
     return true;
 }
 
+bool setUserPasswordHash(UserTable *ut, const char *username, const char *password_hash) {
+    User *user = findUser(ut, username);
+    if (!user || !password_hash) return false;
+    strncpy(user->password_hash, password_hash, MAX_PASSWORD_HASH - 1);
+    user->password_hash[MAX_PASSWORD_HASH - 1] = '\0';
+    user->updated_at = time(NULL);
+    journal_log_password(user);
+
+    return true;
+}
+
 /* ============================================================================
  * PASSWORD & VALIDATION
  * ============================================================================ */
 
-void hashPassword(const char *password, char *output) {
-    if (!password || !output) return;
-    
-    // Use djb2 hash algorithm
+static uint32_t password_cost = PASSWORD_KDF_ITERATIONS;
+
+void setPasswordCost(uint32_t iterations) {
+    if (iterations > 0) password_cost = iterations;
+}
+
+static void toHex(const uint8_t *bytes, size_t len, char *out) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; i++) {
+        out[2 * i] = digits[bytes[i] >> 4];
+        out[2 * i + 1] = digits[bytes[i] & 0x0f];
+    }
+    out[2 * len] = '\0';
+}
+
+static bool fromHex(const char *hex, uint8_t *out, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        int hi = hex[2 * i], lo = hi ? hex[2 * i + 1] : 0;
+        if (!isxdigit(hi) || !isxdigit(lo)) return false;
+        hi = isdigit(hi) ? hi - '0' : tolower(hi) - 'a' + 10;
+        lo = isdigit(lo) ? lo - '0' : tolower(lo) - 'a' + 10;
+        out[i] = (uint8_t)(hi << 4 | lo);
+    }
+    return hex[2 * len] == '\0' || hex[2 * len] == '$';
+}
+
+// Accounts created before salted hashes: unsalted djb2 in hex
+static void legacyHash(const char *password, char *output) {
     unsigned long hash = 5381;
     int c;
     const char *str = password;
@@ -217,6 +404,51 @@ void hashPassword(const char *password, char *output) {
     snprintf(output, MAX_PASSWORD_HASH, "%lx", hash);
 }
 
+// Split "pbkdf2$<iterations>$<salt>$<key>"; false for legacy or malformed hashes
+static bool parseHash(const char *stored, uint32_t *iterations, uint8_t *salt, uint8_t *key) {
+    const char *prefix = PASSWORD_HASH_PREFIX "$";
+    size_t plen = strlen(prefix);
+    if (strncmp(stored, prefix, plen) != 0) return false;
+
+    char *end;
+    unsigned long iter = strtoul(stored + plen, &end, 10);
+    if (end == stored + plen || *end != '$' || iter == 0 || iter > UINT32_MAX) return false;
+    const char *salt_hex = end + 1;
+    if (!fromHex(salt_hex, salt, PASSWORD_SALT_LEN) || salt_hex[2 * PASSWORD_SALT_LEN] != '$') return false;
+    if (!fromHex(salt_hex + 2 * PASSWORD_SALT_LEN + 1, key, PASSWORD_KEY_LEN)) return false;
+    *iterations = (uint32_t)iter;
+    return true;
+}
+
+void hashPassword(const char *password, char *output) {
+    if (!password || !output) return;
+    
+    uint8_t salt[PASSWORD_SALT_LEN];
+    uint8_t key[PASSWORD_KEY_LEN];
+    if (getrandom(salt, sizeof(salt), 0) != (ssize_t)sizeof(salt)) {
+        // No entropy source: still unique per account and run
+        uint64_t mix = hash_bytes(password, strlen(password), (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32));
+        memcpy(salt, &mix, sizeof(mix));
+        mix = hash_bytes(&mix, sizeof(mix), (uint64_t)(uintptr_t)output);
+        memcpy(salt + sizeof(mix), &mix, sizeof(salt) - sizeof(mix));
+    }
+    kdf_pbkdf2_sha256(password, strlen(password), salt, sizeof(salt), password_cost, key, sizeof(key));
+
+    char salt_hex[2 * PASSWORD_SALT_LEN + 1];
+    char key_hex[2 * PASSWORD_KEY_LEN + 1];
+    toHex(salt, sizeof(salt), salt_hex);
+    toHex(key, sizeof(key), key_hex);
+    snprintf(output, MAX_PASSWORD_HASH, PASSWORD_HASH_PREFIX "$%u$%s$%s", password_cost, salt_hex, key_hex);
+}
+
+bool passwordNeedsRehash(const char *stored_hash) {
+    uint32_t iterations;
+    uint8_t salt[PASSWORD_SALT_LEN];
+    uint8_t key[PASSWORD_KEY_LEN];
+    if (!stored_hash || !parseHash(stored_hash, &iterations, salt, key)) return true;
+    return iterations < password_cost;
+}
+
 bool validateUsername(const char *username) {
     if (!username) return false;
     
@@ -256,8 +488,19 @@ bool validatePassword(const char *password) {
 bool verifyPassword(const char *password, const char *stored_hash) {
     if (!password || !stored_hash) return false;
     
-    char hash[MAX_PASSWORD_HASH];
-    hashPassword(password, hash);
-    
-    return strcmp(hash, stored_hash) == 0;
+    uint32_t iterations;
+    uint8_t salt[PASSWORD_SALT_LEN];
+    uint8_t key[PASSWORD_KEY_LEN];
+    uint8_t derived[PASSWORD_KEY_LEN];
+    if (!parseHash(stored_hash, &iterations, salt, key)) {
+        char hash[MAX_PASSWORD_HASH];
+        legacyHash(password, hash);
+        return strcmp(hash, stored_hash) == 0;
+    }
+    kdf_pbkdf2_sha256(password, strlen(password), salt, sizeof(salt), iterations, derived, sizeof(derived));
+
+    // Compare every byte so the time taken does not tell how many matched
+    uint8_t diff = 0;
+    for (size_t i = 0; i < sizeof(key); i++) diff |= key[i] ^ derived[i];
+    return diff == 0;
 }
@@ -3,16 +3,20 @@
  * USERS MODULE
  * ============================================================================
  * 
- * Manages user accounts with HashTable (collision chaining).
+ * Manages user accounts with HashTable (open addressing, Robin Hood).
  * 
  * Features:
- *   - HashTable with automatic rehashing (load factor > 0.75)
- *   - Password hashing (djb2)
+ *   - HashTable with incremental rehashing (load factor > 0.75)
+ *   - Password hashing: salted PBKDF2-HMAC-SHA256, run on the auth
+ *     workers (auth.h); legacy djb2 hashes are upgraded on login
+ *   - Keyed name hashing (wyhash, see hash.h)
  *   - Username/password validation
- *   - Thread-safe with mutex (in users.c)
+ *   - No lock of its own: callers hold the user lock (app_users_lock(),
+ *     also taken by app_lock()); hashPassword() and verifyPassword()
+ *     need none
  * 
  * File: users.txt
- * Format: <username> <password_hash> <status> <coin> <created_at> <updated_at>
+ * Format: <username> <password_hash> <status> <coin> <created_at> <updated_at> <user_id>
  * ============================================================================
  */
 
@@ -21,6 +25,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <time.h>
 
 /* ============================================================================
@@ -28,7 +33,11 @@
  * ============================================================================ */
 #define MAX_USERNAME        64
 #define MAX_PASSWORD_HASH   128
+#define PASSWORD_HASH_PREFIX "pbkdf2"  /**< Salted hashes: pbkdf2$<iterations>$<salt>$<key> (hex) */
+#define PASSWORD_SALT_LEN   16
+#define PASSWORD_KEY_LEN    32
 #define USER_DEFAULT_COIN   500
+#define USER_ID_PAGE        4096    /**< Ids per page of the id index */
 
 /* ============================================================================
  * USER STATUS
@@ -52,20 +61,47 @@ typedef struct User {
     long        coin;                           /**< Persistent currency */
     time_t      created_at;                     /**< Account creation time */
     time_t      updated_at;                     /**< Last update time */
-    struct User *next;                          /**< Linked list for hash collision */
+    int         user_id;                        /**< Stable numeric id (> 0), never reused */
 } User;
 
 /* ============================================================================
  * USER HASHTABLE
  * ============================================================================ */
+/**
+ * @struct UserSlot
+ * @brief One index entry: the full hash and the user it belongs to.
+ *
+ * Probes compare the stored hash first, so a lookup only touches the
+ * (much larger) User record of a probable match.
+ */
+typedef struct {
+    uint64_t    hash;       /**< hashFunc(username), never 0; 0 = empty slot */
+    User       *user;       /**< Owned by the table */
+} UserSlot;
+
 /**
  * @struct UserTable
- * @brief Hash table storing users with collision chaining.
+ * @brief Open-addressing hash table of users (Robin Hood linear probing).
+ *
+ * Growing does not relink everything at once: the previous slot array
+ * is kept in old_slots and every insert moves USER_REHASH_STEP of its
+ * slots into the new one. Lookups check both arrays until it is drained.
+ * User pointers stay valid for the lifetime of the table.
+ *
+ * A second index maps user_id to User: a directory of USER_ID_PAGE-sized
+ * pages, so it grows without moving existing entries.
  */
 typedef struct {
-    User      **table;      /**< Array of buckets */
-    size_t      size;       /**< Current number of buckets */
-    size_t      count;      /**< Number of users stored */
+    UserSlot   *slots;      /**< Current index, size is a power of two */
+    size_t      size;       /**< Number of slots */
+    size_t      count;      /**< Number of users loaded in the table */
+    UserSlot   *old_slots;  /**< Index being drained after a resize, or NULL */
+    size_t      old_size;   /**< Number of slots in old_slots */
+    size_t      old_pos;    /**< Old slots below this are already moved */
+    User     ***id_pages;   /**< Id index: id_pages[id / USER_ID_PAGE][id % USER_ID_PAGE] */
+    size_t      id_page_count; /**< Entries in id_pages */
+    int         next_user_id;  /**< Id given to the next new user */
+    struct UserStore *store; /**< Mapped users.bin backing the table, or NULL */
 } UserTable;
 
 /* ============================================================================
@@ -74,7 +110,7 @@ typedef struct {
 
 /**
  * @brief Initialize a user hash table.
- * @param size Initial number of buckets.
+ * @param size Initial number of slots (rounded up to a power of two).
  * @return Pointer to the hash table or NULL if allocation fails.
  */
 UserTable* initUserTable(size_t size);
@@ -87,7 +123,8 @@ void freeUserTable(UserTable *ut);
 
 /**
  * @brief Insert a user into the hash table.
- * If load factor exceeds 0.75, the table is rehashed.
+ * If load factor exceeds 0.75, an incremental rehash is started.
+ * A user_id of 0 (or one already taken) is replaced by the next free id.
  * @param ut Pointer to the hash table.
  * @param user Pointer to user (caller allocated).
  * @return true if inserted successfully, false otherwise.
@@ -102,11 +139,63 @@ bool insertUser(UserTable *ut, User *user);
  */
 User* findUser(UserTable *ut, const char *username);
 
+/**
+ * @brief Find a user among those already loaded in the table.
+ *
+ * Unlike findUser(), never copies a record in from the mapped store.
+ * @param ut Pointer to the hash table.
+ * @param username The username to search.
+ * @return Pointer to User or NULL if not loaded.
+ */
+User* findLoadedUser(UserTable *ut, const char *username);
+
+/**
+ * @brief Back the table with a mapped users.bin.
+ *
+ * findUser() copies a store record into the table the first time that
+ * username is looked up. The table takes ownership of the store.
+ * @param ut Pointer to the hash table.
+ * @param store Store from user_store_open().
+ */
+void attachUserStore(UserTable *ut, struct UserStore *store);
+
+/**
+ * @brief Upper bound on the number of distinct users (loaded + mapped).
+ * @param ut Pointer to the hash table.
+ */
+size_t maxUserCount(const UserTable *ut);
+
+/**
+ * @brief Iterate over the loaded users.
+ *
+ * Start with *cursor = 0; each call returns the next user, or NULL at
+ * the end. The table must not be modified during the iteration.
+ * @param ut Pointer to the hash table.
+ * @param cursor Iteration state.
+ */
+User* nextLoadedUser(const UserTable *ut, size_t *cursor);
+
+/**
+ * @brief Find a user by numeric id.
+ * @param ut Pointer to the hash table.
+ * @param user_id Id from User.user_id.
+ * @return Pointer to User or NULL if not found.
+ */
+User* findUserById(UserTable *ut, int user_id);
+
+/**
+ * @brief Username of a user id (see findUserById()).
+ * @return Username, or NULL if not found.
+ */
 char* find_username_by_id(UserTable *table, int user_id);
+
 /**
- * @brief Rehash the hash table to a new capacity.
+ * @brief Move the hash table to a new capacity.
+ *
+ * Finishes any rehash in progress, then allocates the new slot array;
+ * entries migrate from the old one during later inserts.
  * @param ut Pointer to the hash table.
- * @param new_size The new capacity.
+ * @param new_size The new capacity (rounded up to a power of two).
  * @return true if successful, false otherwise.
  */
 bool rehashUserTable(UserTable *ut, size_t new_size);
@@ -149,17 +238,47 @@ bool lockUser(UserTable *ut, const char *username);
  */
 bool unlockUser(UserTable *ut, const char *username);
 
+/**
+ * @brief Replace a user's password hash (journaled).
+ * @param ut Pointer to the hash table.
+ * @param username Username of the user.
+ * @param password_hash New hash from hashPassword().
+ * @return true if successful, false if user not found.
+ */
+bool setUserPasswordHash(UserTable *ut, const char *username, const char *password_hash);
+
 /* ============================================================================
  * PASSWORD & VALIDATION
  * ============================================================================ */
 
 /**
- * @brief Hash password using djb2 algorithm.
+ * @brief Hash password with PBKDF2-HMAC-SHA256 and a fresh random salt.
+ *
+ * Takes milliseconds by design (see setPasswordCost()); the server calls
+ * it on the auth workers. Thread-safe.
+ *
  * @param password Plain text password.
  * @param output Buffer to store hash (min MAX_PASSWORD_HASH bytes).
  */
 void hashPassword(const char *password, char *output);
 
+/**
+ * @brief Set the PBKDF2 iteration count for new hashes.
+ *
+ * Existing hashes keep the count they were made with. Call at startup,
+ * before any worker hashes.
+ *
+ * @param iterations Iterations (0 keeps the current value).
+ */
+void setPasswordCost(uint32_t iterations);
+
+/**
+ * @brief Whether a stored hash is legacy djb2 or cheaper than the current cost.
+ * @param stored_hash Stored password hash.
+ * @return true if it should be replaced after the next successful login.
+ */
+bool passwordNeedsRehash(const char *stored_hash);
+
 /**
  * @brief Validate username format.
  * Rules: alphanumeric only, 3-20 characters.
@@ -178,6 +297,7 @@ bool validatePassword(const char *password);
 
 /**
  * @brief Verify password against stored hash.
+ * Accepts salted hashes and legacy unsalted djb2 ones. Thread-safe.
  * @param password Plain text password.
  * @param stored_hash Stored password hash.
  * @return true if password matches, false otherwise.
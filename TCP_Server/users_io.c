@@ -4,17 +4,24 @@
  * ============================================================================
  */
 
+#define _GNU_SOURCE
+
 #include "users_io.h"
+#include "user_store.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
 
 /* ============================================================================
  * FILE OPERATIONS
  * ============================================================================ */
 
-UserIOStatus loadUsers(UserTable *ut, const char *filename) {
+UserIOStatus loadUsers(UserTable *ut, const char *filename, unsigned long long *lsn_out) {
     if (!ut || !filename) return USER_IO_FILE_ERROR;
+    if (lsn_out) *lsn_out = 0;
     
     FILE *fp = fopen(filename, "r");
     if (!fp) {
@@ -28,8 +35,16 @@ UserIOStatus loadUsers(UserTable *ut, const char *filename) {
     int status;
     long coin;
     long created_at, updated_at;
+    int user_id;
     
     while (fgets(line, sizeof(line), fp)) {
+        // Journal position header
+        unsigned long long lsn;
+        if (sscanf(line, "# lsn %llu", &lsn) == 1) {
+            if (lsn_out) *lsn_out = lsn;
+            continue;
+        }
+
         // Skip empty lines and comments
         if (line[0] == '\n' || line[0] == '#') continue;
         
@@ -42,8 +57,8 @@ UserIOStatus loadUsers(UserTable *ut, const char *filename) {
         }
         
         // Try to parse full format first (with coin and timestamps)
-        int parsed = sscanf(line, "%63s %127s %d %ld %ld %ld",
-            username_buf, password_hash_buf, &status, &coin, &created_at, &updated_at);
+        int parsed = sscanf(line, "%63s %127s %d %ld %ld %ld %d",
+            username_buf, password_hash_buf, &status, &coin, &created_at, &updated_at, &user_id);
         
         if (parsed < 3) {
             // Invalid format
@@ -82,8 +97,9 @@ UserIOStatus loadUsers(UserTable *ut, const char *filename) {
             user->created_at = time(NULL);
             user->updated_at = time(NULL);
         }
-        
-        user->next = NULL;
+
+        // Files written before ids existed get fresh ones from insertUser()
+        user->user_id = parsed >= 7 ? user_id : 0;
         
         // Insert into hash table
         if (!insertUser(ut, user)) {
@@ -96,40 +112,185 @@ UserIOStatus loadUsers(UserTable *ut, const char *filename) {
     return USER_IO_OK;
 }
 
-UserIOStatus saveUsers(UserTable *ut, const char *filename) {
-    if (!ut || !filename) return USER_IO_FILE_ERROR;
-    
-    FILE *fp = fopen(filename, "w");
-    if (!fp) {
-        perror("Error opening users file for writing");
-        return USER_IO_FILE_ERROR;
+User* copyLoadedUsers(UserTable *ut, size_t *count_out) {
+    if (!ut || !count_out) return NULL;
+    *count_out = 0;
+
+    size_t max = ut->count;
+    User *users = malloc((max ? max : 1) * sizeof(User));
+    if (!users) return NULL;
+
+    size_t n = 0, cursor = 0;
+    User *curr;
+    while (n < max && (curr = nextLoadedUser(ut, &cursor)) != NULL) {
+        users[n++] = *curr;
     }
-    
+    *count_out = n;
+    return users;
+}
+
+User* mergeStoredUsers(const struct UserStore *store, User *users, size_t count, size_t *count_out) {
+    if (!users || !count_out) return NULL;
+    *count_out = count;
+    if (!store || store->hdr->count == 0) return users;
+
+    // Mark the records the loaded copies replace (one bit per record)
+    size_t records = (size_t)store->hdr->count;
+    unsigned char *loaded = calloc((records + 7) / 8, 1);
+    User *merged = realloc(users, (count + records) * sizeof(User));
+    if (!loaded || !merged) {
+        free(loaded);
+        free(merged ? merged : users);
+        return NULL;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const UserRecord *rec = user_store_find(store, merged[i].username);
+        if (rec) {
+            size_t r = (size_t)(rec - store->records);
+            loaded[r / 8] |= (unsigned char)(1u << (r % 8));
+        }
+    }
+
+    // Mapped accounts never loaded are unchanged since the snapshot
+    size_t n = count;
+    for (size_t r = 0; r < records; r++) {
+        if (loaded[r / 8] & (1u << (r % 8))) continue;
+        user_record_to_user(&store->records[r], &merged[n++]);
+    }
+    free(loaded);
+    *count_out = n;
+    return merged;
+}
+
+User* copyUsers(UserTable *ut, size_t *count_out) {
+    size_t loaded;
+    User *users = copyLoadedUsers(ut, &loaded);
+    if (!users) return NULL;
+    return mergeStoredUsers(ut->store, users, loaded, count_out);
+}
+
+char* formatUsers(const User *users, size_t count, unsigned long long lsn, size_t *len_out) {
+    if (!len_out) return NULL;
+
+    char *buf = NULL;
+    size_t len = 0;
+    FILE *fp = open_memstream(&buf, &len);
+    if (!fp) return NULL;
+
     // Write header comment
     fprintf(fp, "# Users Database\n");
-    fprintf(fp, "# Format: username password_hash status coin created_at updated_at\n");
+    fprintf(fp, "# Format: username password_hash status coin created_at updated_at user_id\n");
     fprintf(fp, "# status: 0 = banned, 1 = active\n");
+    fprintf(fp, "# lsn %llu\n", lsn);
     fprintf(fp, "#\n");
     
     // Write all users
-    for (size_t i = 0; i < ut->size; i++) {
-        User *curr = ut->table[i];
-        while (curr) {
-            fprintf(fp, "%s %s %d %ld %ld %ld\n",
-                curr->username,
-                curr->password_hash,
-                curr->status,
-                curr->coin,
-                (long)curr->created_at,
-                (long)curr->updated_at);
-            curr = curr->next;
-        }
+    for (size_t i = 0; i < count; i++) {
+        fprintf(fp, "%s %s %d %ld %ld %ld %d\n",
+            users[i].username,
+            users[i].password_hash,
+            users[i].status,
+            users[i].coin,
+            (long)users[i].created_at,
+            (long)users[i].updated_at,
+            users[i].user_id);
     }
     
-    fclose(fp);
+    if (fclose(fp) != 0) {
+        free(buf);
+        return NULL;
+    }
+    *len_out = len;
+    return buf;
+}
+
+// fsync the directory holding path so a rename() in it is durable
+static int sync_parent_dir(const char *path) {
+    char dir[1024];
+    const char *slash = strrchr(path, '/');
+    if (!slash) {
+        strcpy(dir, ".");
+    } else if (slash == path) {
+        strcpy(dir, "/");
+    } else {
+        size_t n = (size_t)(slash - path);
+        if (n >= sizeof(dir)) return -1;
+        memcpy(dir, path, n);
+        dir[n] = '\0';
+    }
+
+    int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    int rc = fsync(fd);
+    close(fd);
+    return rc;
+}
+
+UserIOStatus writeUsersFile(const char *filename, const char *data, size_t len) {
+    if (!filename || !data) return USER_IO_FILE_ERROR;
+
+    char tmp_path[1024];
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", filename) >= (int)sizeof(tmp_path)) {
+        return USER_IO_FILE_ERROR;
+    }
+
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror("Error opening users file for writing");
+        return USER_IO_FILE_ERROR;
+    }
+
+    size_t off = 0;
+    while (off < len) {
+        ssize_t n = write(fd, data + off, len - off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("Error writing users file");
+            close(fd);
+            unlink(tmp_path);
+            return USER_IO_FILE_ERROR;
+        }
+        off += (size_t)n;
+    }
+
+    // Data must be on disk before the rename makes it visible
+    if (fsync(fd) != 0) {
+        perror("Error syncing users file");
+        close(fd);
+        unlink(tmp_path);
+        return USER_IO_FILE_ERROR;
+    }
+    close(fd);
+
+    if (rename(tmp_path, filename) != 0) {
+        perror("Error replacing users file");
+        unlink(tmp_path);
+        return USER_IO_FILE_ERROR;
+    }
+    if (sync_parent_dir(filename) != 0) {
+        perror("Error syncing users directory");
+        return USER_IO_FILE_ERROR;
+    }
     return USER_IO_OK;
 }
 
+UserIOStatus saveUsers(UserTable *ut, const char *filename, unsigned long long lsn) {
+    if (!ut || !filename) return USER_IO_FILE_ERROR;
+
+    size_t count;
+    User *users = copyUsers(ut, &count);
+    if (!users) return USER_IO_MEMORY_ERROR;
+
+    size_t len;
+    char *data = formatUsers(users, count, lsn, &len);
+    free(users);
+    if (!data) return USER_IO_MEMORY_ERROR;
+
+    UserIOStatus status = writeUsersFile(filename, data, len);
+    free(data);
+    return status;
+}
+
 const char* getUserIOStatusMessage(UserIOStatus status) {
     switch (status) {
         case USER_IO_OK:
@@ -7,6 +7,9 @@
  * 
  * File: users.txt
  * Format: <username> <password_hash> <status> <coin> <created_at> <updated_at>
+ *
+ * users.txt is a snapshot. Its "# lsn <n>" header names the last journal
+ * record (see journal.h) already folded into it.
  * ============================================================================
  */
 
@@ -36,22 +39,96 @@ typedef enum {
  * File format (each line):
  *   <username> <password_hash> <status> <coin> <created_at> <updated_at>
  * 
- * Lines starting with '#' are comments and skipped.
+ * Lines starting with '#' are comments and skipped, except the
+ * "# lsn <n>" header.
  * 
  * @param ut Pointer to the user hash table.
  * @param filename Path to the users file.
+ * @param lsn_out Receives the snapshot's journal LSN (0 if none). May be NULL.
  * @return UserIOStatus code indicating success or type of failure.
  */
-UserIOStatus loadUsers(UserTable *ut, const char *filename);
+UserIOStatus loadUsers(UserTable *ut, const char *filename, unsigned long long *lsn_out);
+
+/**
+ * @brief Copy the users loaded in the table into a flat array.
+ *
+ * This is the only step of a checkpoint that needs the user lock: it is
+ * a plain memcpy per loaded user (accounts used or created since the
+ * snapshot), not per account. The copy is a consistent point-in-time
+ * view that formatUsers() can serialize while the table keeps changing.
+ *
+ * @param ut Pointer to the user hash table.
+ * @param count_out Receives the number of users copied.
+ * @return malloc'd array (caller frees), or NULL
+ *         on allocation failure.
+ */
+User* copyLoadedUsers(UserTable *ut, size_t *count_out);
+
+/**
+ * @brief Add the accounts of a users.bin that were never loaded.
+ *
+ * Needs no lock: the mapping is read-only, and an account never loaded
+ * is unchanged since that snapshot. Linear in loaded users plus records.
+ *
+ * @param store Attached users.bin (ut->store), or NULL.
+ * @param users Array from copyLoadedUsers(); reallocated or freed.
+ * @param count Number of users in it.
+ * @param count_out Receives the merged count.
+ * @return malloc'd array (caller frees), or NULL
+ *         on allocation failure (users is freed).
+ */
+User* mergeStoredUsers(const struct UserStore *store, User *users, size_t count, size_t *count_out);
+
+/**
+ * @brief Copy every user into a flat array.
+ *
+ * copyLoadedUsers() then mergeStoredUsers(), for callers that own the
+ * table.
+ *
+ * @param ut Pointer to the user hash table.
+ * @param count_out Receives the number of users copied.
+ * @return malloc'd array (caller frees), or NULL
+ *         on allocation failure.
+ */
+User* copyUsers(UserTable *ut, size_t *count_out);
+
+/**
+ * @brief Serialize users in users.txt format.
+ *
+ * @param users Array from copyUsers().
+ * @param count Number of users.
+ * @param lsn Journal LSN to record in the header.
+ * @param len_out Receives the length in bytes.
+ * @return malloc'd buffer (caller frees), or NULL on allocation failure.
+ */
+char* formatUsers(const User *users, size_t count, unsigned long long lsn, size_t *len_out);
 
 /**
  * @brief Save users from hash table to a text file.
+ *
+ * Same steps as a checkpoint (copyUsers(), formatUsers(),
+ * writeUsersFile()), so the file is replaced atomically.
  * 
  * @param ut Pointer to the user hash table.
  * @param filename Path to the users file.
+ * @param lsn Journal LSN to record in the header.
+ * @return UserIOStatus code indicating success or type of failure.
+ */
+UserIOStatus saveUsers(UserTable *ut, const char *filename, unsigned long long lsn);
+
+/**
+ * @brief Atomically replace a file with an already formatted snapshot.
+ *
+ * Writes <filename>.tmp, fsyncs it, rename()s it over filename and
+ * fsyncs the directory. A crash at any point leaves either the old or
+ * the new snapshot, never a truncated one.
+ *
+ * @param filename Path to the users file.
+ * @param data Output of formatUsers().
+ * @param len Length of data.
  * @return UserIOStatus code indicating success or type of failure.
  */
-UserIOStatus saveUsers(UserTable *ut, const char *filename);
+UserIOStatus writeUsersFile(const char *filename, const char *data, size_t len);
 
 /**
  * @brief Get error message for UserIOStatus code.
@@ -35,36 +35,5 @@ void clearInputBuffer();
  */
 void safeInput(char * buffer, size_t size);
 
-/**
- * @brief Write a structured activity log line.
- *
- * Fields written per line:
- *   timestamp, level ([info]|[warn]|[error]), action, user, input, code, message
- *
- * - Level is derived automatically from code: <300 => info, 300-499 => warn, >=500 => error
- * - If not logged in, user will be "-".
- * - Control characters in input are sanitized to spaces.
- *
- * @param action       Operation name, e.g. "REGISTER", "LOGIN"
- * @param username     Username if known (NULL or empty if anonymous)
- * @param is_logged_in Whether the session is logged in
- * @param user_input   Raw user payload (will be sanitized)
- * @param code         Response code
- */
-void log_activity(const char *action,
-				  const char *username,
-				  bool is_logged_in,
-				  const char *user_input,
-				  ResponseCode code);
-
-/* Convenience macro when you have a ServerSession pointer available. */
-/* Intentionally not including session.h here to avoid coupling.        */
-#define LOG_ACTIVITY_SESSION(action, sessionPtr, input, code)                                       \
-	do {                                                                                           \
-		const char *_u_ = ((sessionPtr) && (sessionPtr)->isLoggedIn) ? (sessionPtr)->username : NULL; \
-		bool _lg_ = ((sessionPtr) && (sessionPtr)->isLoggedIn);                                    \
-		log_activity((action), _u_, _lg_, (input), (code));                                        \
-	} while (0)
-
 #endif /* UTIL_H */
 
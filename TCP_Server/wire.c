@@ -0,0 +1,105 @@
+/**
+ * ============================================================================
+ * WIRE PROTOCOL - IMPLEMENTATION
+ * ============================================================================
+ */
+
+#include "wire.h"
+#include <string.h>
+
+void wire_writer_init(WireWriter *w, void *buf, size_t cap) {
+    w->data = buf;
+    w->cap = cap;
+    w->len = 0;
+    w->overflow = 0;
+}
+
+void wire_put_byte(WireWriter *w, uint8_t b) {
+    if (w->len >= w->cap) {
+        w->overflow = 1;
+        return;
+    }
+    w->data[w->len++] = b;
+}
+
+void wire_put_uint(WireWriter *w, uint32_t v) {
+    while (v >= 0x80) {
+        wire_put_byte(w, (uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    wire_put_byte(w, (uint8_t)v);
+}
+
+void wire_put_str(WireWriter *w, const char *s) {
+    size_t len = strlen(s);
+    wire_put_uint(w, (uint32_t)len);
+    if (w->len + len > w->cap) {
+        w->overflow = 1;
+        return;
+    }
+    memcpy(w->data + w->len, s, len);
+    w->len += len;
+}
+
+void wire_reader_init(WireReader *r, const void *buf, size_t len) {
+    r->data = buf;
+    r->len = len;
+    r->pos = 0;
+    r->error = 0;
+}
+
+uint8_t wire_get_byte(WireReader *r) {
+    if (r->error || r->pos >= r->len) {
+        r->error = 1;
+        return 0;
+    }
+    return r->data[r->pos++];
+}
+
+uint32_t wire_get_uint(WireReader *r) {
+    uint32_t v = 0;
+    for (int i = 0; i < WIRE_VARINT_MAX; i++) {
+        uint8_t b = wire_get_byte(r);
+        if (r->error) return 0;
+        v |= (uint32_t)(b & 0x7F) << (7 * i);
+        if (!(b & 0x80)) return v;
+    }
+    r->error = 1;   // Longer than any 32-bit value
+    return 0;
+}
+
+void wire_get_str(WireReader *r, char *out, size_t size) {
+    uint32_t len = wire_get_uint(r);
+    if (r->error || len >= size || len > r->len - r->pos) {
+        r->error = 1;
+        if (size > 0) out[0] = '\0';
+        return;
+    }
+    memcpy(out, r->data + r->pos, len);
+    out[len] = '\0';
+    r->pos += len;
+}
+
+size_t wire_frame_header(uint8_t *out, size_t payload_len) {
+    WireWriter w;
+    wire_writer_init(&w, out, WIRE_VARINT_MAX);
+    wire_put_uint(&w, (uint32_t)payload_len);
+    return w.len;
+}
+
+int wire_frame_parse(const void *buf, size_t len, size_t max_payload,
+                     size_t *header_len, size_t *payload_len) {
+    WireReader r;
+    wire_reader_init(&r, buf, len);
+    uint32_t payload = wire_get_uint(&r);
+    if (r.error) {
+        // Ran out of bytes mid-varint, or the varint itself is too long
+        return len < WIRE_VARINT_MAX ? 0 : -1;
+    }
+    if (payload == 0 || payload > max_payload) return -1;
+    if (len - r.pos < payload) return 0;
+
+    *header_len = r.pos;
+    *payload_len = payload;
+    return 1;
+}
@@ -0,0 +1,116 @@
+#ifndef WIRE_H
+#define WIRE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file wire.h
+ * @brief Binary wire protocol, shared by the server and the client
+ *
+ * A connection starts in the text protocol. After the 120 greeting the
+ * client may send the line "BINARY"; the server answers "209" as text
+ * and from the next byte on both directions carry frames:
+ *
+ *   frame   = varint payload_len, payload
+ *   payload = type byte, fields
+ *
+ * Integers are unsigned LEB128 varints (7 bits per byte, low bits first;
+ * at most WIRE_VARINT_MAX bytes). A string is a varint length followed
+ * by its bytes, without a NUL.
+ *
+ * WIRE_TEXT carries the text protocol unchanged: a command line (no CRLF)
+ * from the client, one or more CRLF-terminated lines from the server, so
+ * every command keeps working and stays readable when debugging. The hot
+ * commands have fixed layouts instead:
+ *
+ *   WIRE_FIRE         -> str target, uint weapon
+ *   WIRE_GET_HP       -> (none)
+ *   WIRE_GET_WEAPON   -> (none)
+ *   WIRE_GET_ARMOR    -> (none)
+ *
+ * The reply to request type t has type t | WIRE_REPLY and starts with the
+ * response code; the other fields only follow a success code:
+ *
+ *   FIRE       uint code [uint damage, uint target_hp, uint target_armor]
+ *   GET_HP     uint code [uint hp, uint max_hp]
+ *   GET_WEAPON uint code [uint cannon, uint laser, uint missile]
+ *   GET_ARMOR  uint code [uint type1, uint value1, uint type2, uint value2]
+ *
+ * The server pushes match deltas (match_feed.h) as WIRE_MATCH_DELTA:
+ *
+ *   uint match_id, uint seq, uint n, n x {str user, uint mask, uint value...}
+ *
+ * and everything else as WIRE_TEXT.
+ */
+
+#define WIRE_VARINT_MAX 5                       /**< Bytes of a 32-bit varint */
+#define WIRE_HEADER_MAX (WIRE_VARINT_MAX + 1)   /**< Frame length plus type byte */
+#define WIRE_MAX_FRAME (64 * 1024)              /**< Largest payload a peer accepts */
+
+typedef enum {
+    WIRE_TEXT = 0x00,           /**< Text protocol lines */
+    WIRE_FIRE = 0x01,
+    WIRE_GET_HP = 0x02,
+    WIRE_GET_WEAPON = 0x03,
+    WIRE_GET_ARMOR = 0x04,
+    WIRE_REPLY = 0x80,          /**< Or-ed into a request type for its reply */
+    WIRE_MATCH_DELTA = 0x90     /**< Pushed 155 MATCH_DELTA */
+} WireType;
+
+/**
+ * @struct WireWriter
+ * @brief Appends fields to a caller-owned buffer
+ *
+ * Writes past cap are dropped and set overflow; check it once at the end.
+ */
+typedef struct {
+    uint8_t *data;
+    size_t cap;
+    size_t len;
+    int overflow;
+} WireWriter;
+
+/**
+ * @struct WireReader
+ * @brief Reads fields from a payload
+ *
+ * Reading past the end or a malformed field sets error and returns 0 /
+ * an empty string from then on; check it once at the end.
+ */
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+    size_t pos;
+    int error;
+} WireReader;
+
+void wire_writer_init(WireWriter *w, void *buf, size_t cap);
+void wire_put_byte(WireWriter *w, uint8_t b);
+void wire_put_uint(WireWriter *w, uint32_t v);
+void wire_put_str(WireWriter *w, const char *s);
+
+void wire_reader_init(WireReader *r, const void *buf, size_t len);
+uint8_t wire_get_byte(WireReader *r);
+uint32_t wire_get_uint(WireReader *r);
+/** Strings longer than size - 1 set error */
+void wire_get_str(WireReader *r, char *out, size_t size);
+
+/**
+ * @brief Encode the length prefix of a frame
+ * @param out At least WIRE_VARINT_MAX bytes
+ * @return Bytes written
+ */
+size_t wire_frame_header(uint8_t *out, size_t payload_len);
+
+/**
+ * @brief Find the first frame in received bytes
+ * @param max_payload Largest payload accepted
+ * @return 1 if a whole frame is there (header_len and payload_len set),
+ *         0 if more bytes are needed, -1 if the length is malformed or
+ *         over max_payload
+ */
+int wire_frame_parse(const void *buf, size_t len, size_t max_payload,
+                     size_t *header_len, size_t *payload_len);
+
+#endif // WIRE_H
@@ -0,0 +1,243 @@
+/**
+ * ============================================================================
+ * BENCH: USER-TABLE HASH
+ * ============================================================================
+ *
+ * Compares hashFunc() (seeded wyhash, hash.c) with the djb2 it replaced:
+ *
+ *   - throughput: ns per hash over a set of usernames;
+ *   - probe lengths: the usernames inserted into an open-addressing table
+ *     laid out like UserTable (power-of-two slots, load <= 0.75, full
+ *     hash stored per slot, strcmp only on a hash match), then looked up.
+ *
+ * Sets:
+ *   realistic   "<adjective>_<noun><n>", "user<n>" and "player_<n>" names
+ *   adversarial 3^9 names of 18 chars built from "Ez", "FY" and "G8",
+ *               which all have the same djb2 value
+ *
+ * Usage: make bench_hash  (or bench/bench_hash [realistic_count])
+ * ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#define NAME_LEN    32
+#define ADV_BLOCKS  9       /**< Blocks per adversarial name: 3^9 names */
+
+typedef uint64_t (*hash_fn)(const char *name);
+
+typedef struct {
+    char   (*names)[NAME_LEN];
+    size_t count;
+} NameSet;
+
+/* ============================================================================
+ * HASHES
+ * ============================================================================ */
+
+static uint64_t djb2(const char *str) {
+    unsigned long hash = 5381;
+    int c;
+    while ((c = *str++)) hash = ((hash << 5) + hash) + c; // hash * 33 + c
+    return hash;
+}
+
+static uint64_t wyhash(const char *str) {
+    return (uint64_t)hashFunc(str);
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* ============================================================================
+ * NAME SETS
+ * ============================================================================ */
+
+static NameSet realistic_set(size_t count) {
+    static const char *adjectives[] = {
+        "brave", "silent", "red", "iron", "lucky", "dark", "swift", "old",
+        "salty", "wild", "grim", "golden", "stormy", "blue", "mad", "cold"
+    };
+    static const char *nouns[] = {
+        "shark", "captain", "kraken", "pirate", "gull", "anchor", "wave",
+        "cannon", "sailor", "reef", "tide", "mast", "hook", "whale"
+    };
+    size_t na = sizeof(adjectives) / sizeof(adjectives[0]);
+    size_t nn = sizeof(nouns) / sizeof(nouns[0]);
+
+    NameSet set = { calloc(count, NAME_LEN), count };
+    if (!set.names) return set;
+    for (size_t i = 0; i < count; i++) {
+        switch (i % 4) {
+            case 0:
+                snprintf(set.names[i], NAME_LEN, "user%zu", i);
+                break;
+            case 1:
+                snprintf(set.names[i], NAME_LEN, "player_%05zu", i);
+                break;
+            default:
+                snprintf(set.names[i], NAME_LEN, "%s_%s%zu",
+                         adjectives[i % na], nouns[(i / na) % nn], i / (na * nn));
+                break;
+        }
+    }
+    return set;
+}
+
+static NameSet adversarial_set(void) {
+    static const char *blocks[] = { "Ez", "FY", "G8" };    // 33 * c1 + c2 = 2399 each
+    size_t count = 1;
+    for (int i = 0; i < ADV_BLOCKS; i++) count *= 3;
+
+    NameSet set = { calloc(count, NAME_LEN), count };
+    if (!set.names) return set;
+    for (size_t i = 0; i < count; i++) {
+        size_t n = i;
+        for (int b = 0; b < ADV_BLOCKS; b++) {
+            memcpy(set.names[i] + 2 * b, blocks[n % 3], 2);
+            n /= 3;
+        }
+    }
+    return set;
+}
+
+/* ============================================================================
+ * TABLE
+ * ============================================================================ */
+
+typedef struct {
+    uint64_t    hash;   /**< 0 = empty */
+    const char *name;
+} Slot;
+
+typedef struct {
+    double insert_ns;   /**< Per name */
+    double lookup_ns;   /**< Per successful lookup */
+    double avg_probe;   /**< Slots visited per successful lookup */
+    size_t max_probe;
+} TableStats;
+
+static uint64_t slot_hash(hash_fn fn, const char *name) {
+    uint64_t h = fn(name);
+    return h ? h : 1;
+}
+
+static TableStats table_run(hash_fn fn, const NameSet *set) {
+    TableStats st = { 0, 0, 0, 0 };
+    size_t size = 16;
+    while ((double)set->count / (double)size > 0.75) size <<= 1;
+    size_t mask = size - 1;
+    Slot *slots = calloc(size, sizeof(Slot));
+    if (!slots) return st;
+
+    double t0 = now_sec();
+    for (size_t i = 0; i < set->count; i++) {
+        uint64_t h = slot_hash(fn, set->names[i]);
+        size_t s = (size_t)h & mask;
+        while (slots[s].hash != 0) s = (s + 1) & mask;
+        slots[s].hash = h;
+        slots[s].name = set->names[i];
+    }
+    double t1 = now_sec();
+
+    size_t probes = 0;
+    for (size_t i = 0; i < set->count; i++) {
+        const char *name = set->names[i];
+        uint64_t h = slot_hash(fn, name);
+        size_t s = (size_t)h & mask, n = 1;
+        while (slots[s].hash != h || strcmp(slots[s].name, name) != 0) {
+            s = (s + 1) & mask;
+            n++;
+        }
+        probes += n;
+        if (n > st.max_probe) st.max_probe = n;
+    }
+    double t2 = now_sec();
+
+    st.insert_ns = (t1 - t0) * 1e9 / (double)set->count;
+    st.lookup_ns = (t2 - t1) * 1e9 / (double)set->count;
+    st.avg_probe = (double)probes / (double)set->count;
+    free(slots);
+    return st;
+}
+
+/* ============================================================================
+ * MAIN
+ * ============================================================================ */
+
+static double throughput_ns(hash_fn fn, const NameSet *set) {
+    size_t rounds = 1 + 20000000 / set->count;
+    volatile uint64_t sink = 0;
+    double t0 = now_sec();
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < set->count; i++) sink ^= fn(set->names[i]);
+    }
+    (void)sink;
+    return (now_sec() - t0) * 1e9 / (double)(rounds * set->count);
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Names sharing a full hash: the table has to strcmp through all of them
+static size_t distinct_hashes(hash_fn fn, const NameSet *set) {
+    uint64_t *h = malloc(set->count * sizeof(uint64_t));
+    if (!h) return 0;
+    for (size_t i = 0; i < set->count; i++) h[i] = fn(set->names[i]);
+    size_t distinct = 0;
+    qsort(h, set->count, sizeof(uint64_t), compare_u64);
+    for (size_t i = 0; i < set->count; i++) {
+        if (i == 0 || h[i] != h[i - 1]) distinct++;
+    }
+    free(h);
+    return distinct;
+}
+
+static void report(const char *label, const NameSet *set) {
+    static const struct { const char *name; hash_fn fn; } hashes[] = {
+        { "djb2", djb2 },
+        { "wyhash", wyhash },
+    };
+
+    printf("\n%s: %zu names\n", label, set->count);
+    printf("  %-7s %10s %10s %10s %10s %10s %10s\n",
+           "hash", "ns/hash", "distinct", "insert ns", "lookup ns", "avg probe", "max probe");
+    for (size_t i = 0; i < sizeof(hashes) / sizeof(hashes[0]); i++) {
+        TableStats st = table_run(hashes[i].fn, set);
+        printf("  %-7s %10.2f %10zu %10.1f %10.1f %10.2f %10zu\n",
+               hashes[i].name, throughput_ns(hashes[i].fn, set), distinct_hashes(hashes[i].fn, set),
+               st.insert_ns, st.lookup_ns, st.avg_probe, st.max_probe);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 200000;
+    if (count == 0) count = 200000;
+
+    hash_seed_init();
+    NameSet realistic = realistic_set(count);
+    NameSet adversarial = adversarial_set();
+    if (!realistic.names || !adversarial.names) {
+        fprintf(stderr, "bench_hash: out of memory\n");
+        return 1;
+    }
+
+    report("realistic", &realistic);
+    report("adversarial (djb2 collisions)", &adversarial);
+
+    free(realistic.names);
+    free(adversarial.names);
+    return 0;
+}
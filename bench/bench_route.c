@@ -0,0 +1,160 @@
+/**
+ * ============================================================================
+ * BENCH: COMMAND LOOKUP AND TOKENIZER
+ * ============================================================================
+ *
+ * Times the two per-command steps of the router that run before any
+ * handler:
+ *
+ *   lookup    route_lookup() (perfect-hashed route_table) against a linear
+ *             strcmp() scan of the same table, which is what the old
+ *             if/else chain did
+ *   tokenize  parse_command() plus the CommandArgs cursor against
+ *             parse_command() plus sscanf()/atoi(), on typical lines
+ *
+ * router.c is included so its static table and lookup are benchmarked
+ * as compiled into the server; the rest of the server objects are linked
+ * only to satisfy the handlers it references.
+ *
+ * Usage: make bench_route  (or bench/bench_route [iterations])
+ * ============================================================================
+ */
+
+#include "router.c"
+#include <time.h>
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Old dispatch: compare against every name in turn
+static const Route *linear_lookup(const char *type) {
+    for (int i = 0; i < ROUTE_COUNT; i++) {
+        if (strcmp(route_table[i].name, type) == 0) return &route_table[i];
+    }
+    return NULL;
+}
+
+/* Commands as a busy match sends them, plus a few unknown ones */
+static const char *lookup_mix[] = {
+    "FIRE", "FIRE", "FIRE", "FIRE", "GET_HP", "GET_HP", "GETCOIN", "GETARMOR",
+    "GET_WEAPON", "BUY_WEAPON", "REPAIR", "WHOAMI", "CHEST_OPEN", "LOGIN",
+    "LIST_TEAMS", "TEAM_INFO", "SEND_CHALLENGE", "NOPE", "fire", "GET_HPX"
+};
+#define LOOKUP_MIX_COUNT ((int)(sizeof(lookup_mix) / sizeof(lookup_mix[0])))
+
+static void bench_lookup(unsigned long iterations) {
+    static const struct { const char *name; const Route *(*fn)(const char *); } ways[] = {
+        { "perfect hash", route_lookup },
+        { "linear strcmp", linear_lookup },
+    };
+    printf("lookup (%d commands in the table, %d-name mix)\n", ROUTE_COUNT, LOOKUP_MIX_COUNT);
+    for (size_t w = 0; w < sizeof(ways) / sizeof(ways[0]); w++) {
+        unsigned long found = 0;
+        double t0 = now_sec();
+        for (unsigned long i = 0; i < iterations; i++) {
+            if (ways[w].fn(lookup_mix[i % LOOKUP_MIX_COUNT])) found++;
+        }
+        double ns = (now_sec() - t0) * 1e9 / (double)iterations;
+        printf("  %-14s %8.2f ns/lookup   (%lu found)\n", ways[w].name, ns, found);
+    }
+}
+
+/* ============================================================================
+ * TOKENIZER
+ * ============================================================================ */
+
+typedef struct {
+    const char *line;
+    int kind;           /**< 0: <name> <int>, 1: <int>, 2: <name> <name>, 3: free text */
+} Line;
+
+static const Line lines[] = {
+    { "FIRE test3 2\r\n", 0 },
+    { "BUY_WEAPON 1\r\n", 1 },
+    { "LOGIN captain_hook Passw0rd@2024\r\n", 2 },
+    { "CREATE_TEAM The Salty Gulls\r\n", 3 },
+    { "REPAIR 150\r\n", 1 },
+    { "SEND_CHALLENGE 17\r\n", 1 },
+};
+#define LINE_COUNT ((int)(sizeof(lines) / sizeof(lines[0])))
+
+// What the routes do now
+static int tokenize_cursor(char *buf, int kind) {
+    Command cmd = parse_command(buf);
+    CommandArgs args;
+    long v = 0;
+    command_args_init(&args, cmd.user_input);
+    switch (kind) {
+        case 0: {
+            const char *name = command_next_token(&args, NULL);
+            if (!name || command_next_int(&args, INT_MIN, INT_MAX, &v) != 0) return -1;
+            return name[0] + (int)v;
+        }
+        case 1:
+            if (command_next_int(&args, INT_MIN, INT_MAX, &v) != 0) return -1;
+            return (int)v;
+        case 2: {
+            const char *a = command_next_token(&args, NULL);
+            const char *b = command_next_token(&args, NULL);
+            return a && b ? a[0] + b[0] : -1;
+        }
+        default:
+            return command_rest(&args)[0];
+    }
+}
+
+// What the routes did before: copies through sscanf()/atoi()
+static int tokenize_sscanf(char *buf, int kind) {
+    Command cmd = parse_command(buf);
+    char a[128], b[128];
+    int v;
+    switch (kind) {
+        case 0:
+            if (sscanf(cmd.user_input, "%127s %d", a, &v) != 2) return -1;
+            return a[0] + v;
+        case 1:
+            return atoi(cmd.user_input);
+        case 2:
+            if (sscanf(cmd.user_input, "%127s %127s", a, b) != 2) return -1;
+            return a[0] + b[0];
+        default:
+            snprintf(a, sizeof(a), "%s", cmd.user_input);
+            return a[0];
+    }
+}
+
+static void bench_tokenize(unsigned long iterations) {
+    static const struct { const char *name; int (*fn)(char *, int); } ways[] = {
+        { "CommandArgs", tokenize_cursor },
+        { "sscanf/atoi", tokenize_sscanf },
+    };
+    char buf[BUFF_SIZE];
+    size_t len[LINE_COUNT];
+    for (int i = 0; i < LINE_COUNT; i++) len[i] = strlen(lines[i].line) + 1;
+
+    printf("tokenize (%d typical lines, each copied into the line buffer first)\n", LINE_COUNT);
+    for (size_t w = 0; w < sizeof(ways) / sizeof(ways[0]); w++) {
+        long sum = 0;
+        double t0 = now_sec();
+        for (unsigned long i = 0; i < iterations; i++) {
+            const Line *l = &lines[i % LINE_COUNT];
+            memcpy(buf, l->line, len[i % LINE_COUNT]);
+            sum += ways[w].fn(buf, l->kind);
+        }
+        double ns = (now_sec() - t0) * 1e9 / (double)iterations;
+        printf("  %-14s %8.2f ns/line     (checksum %ld)\n", ways[w].name, ns, sum);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    unsigned long iterations = argc > 1 ? strtoul(argv[1], NULL, 10) : 20000000UL;
+    if (iterations == 0) iterations = 20000000UL;
+
+    router_init();
+    bench_lookup(iterations);
+    bench_tokenize(iterations / 4);
+    return 0;
+}
@@ -0,0 +1,182 @@
+/**
+ * ============================================================================
+ * BENCH: SERVER STARTUP
+ * ============================================================================
+ *
+ * Times how long the server takes to come up with a large user base,
+ * parsing users.txt versus mapping users.bin (user_store.h):
+ *
+ *   1. text:     start with only TCP_Server/users.txt
+ *   2. text2bin: "server -c text2bin" (offline conversion)
+ *   3. bin:      start with TCP_Server/users.bin
+ *
+ * A start is timed from fork() until a client gets the greeting. Then one
+ * LOGIN for the last account is timed: with users.bin it is the first
+ * access that copies a record into the table. The server is killed after
+ * each run and its journal removed, so every run starts from the same
+ * snapshot.
+ *
+ * Usage: bench/bench_startup <server binary> <dir holding TCP_Server/users.txt> <count>
+ *        (make bench_startup generates the directory with gen_users)
+ * ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define START_TIMEOUT_SEC  300
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int try_connect(void) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// One CRLF-terminated reply (bench only: byte at a time is fine)
+static int read_line(int fd, char *buf, size_t size) {
+    size_t n = 0;
+    while (n + 1 < size) {
+        ssize_t r = read(fd, buf + n, 1);
+        if (r <= 0) return -1;
+        if (buf[n] == '\n') break;
+        n++;
+    }
+    buf[n] = '\0';
+    if (n > 0 && buf[n - 1] == '\r') buf[n - 1] = '\0';
+    return 0;
+}
+
+static pid_t spawn(char *const argv[]) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+        }
+        execv(argv[0], argv);
+        _exit(127);
+    }
+    return pid;
+}
+
+/**
+ * Start the server, wait for its greeting, time a LOGIN, kill it.
+ * @return 0 on success
+ */
+static int time_start(const char *server, const char *label, unsigned long count) {
+    char *argv[] = { (char *)server, NULL };
+    char line[256];
+
+    double t0 = now_sec();
+    pid_t pid = spawn(argv);
+    if (pid < 0) return -1;
+
+    int fd = -1;
+    while ((fd = try_connect()) < 0) {
+        if (waitpid(pid, NULL, WNOHANG) == pid) {
+            fprintf(stderr, "%s: server exited during startup\n", label);
+            return -1;
+        }
+        if (now_sec() - t0 > START_TIMEOUT_SEC) {
+            fprintf(stderr, "%s: no listener after %d s\n", label, START_TIMEOUT_SEC);
+            kill(pid, SIGKILL);
+            waitpid(pid, NULL, 0);
+            return -1;
+        }
+        usleep(1000);
+    }
+    int rc = read_line(fd, line, sizeof(line));
+    double t1 = now_sec();
+
+    char login[128];
+    snprintf(login, sizeof(login), "LOGIN bench%lu Bench@2024\r\n", count);
+    double t2 = now_sec();
+    if (rc == 0 && write(fd, login, strlen(login)) == (ssize_t)strlen(login)) {
+        rc = read_line(fd, line, sizeof(line));
+    } else {
+        rc = -1;
+    }
+    double t3 = now_sec();
+    close(fd);
+
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    unlink("TCP_Server/users.journal");
+
+    if (rc != 0) {
+        fprintf(stderr, "%s: no reply from server\n", label);
+        return -1;
+    }
+    printf("  %-9s %10.3f s to greeting   first LOGIN %8.2f ms (reply %s)\n",
+           label, t1 - t0, (t3 - t2) * 1e3, line);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 4) {
+        fprintf(stderr, "Usage: %s <server> <dir> <count>\n", argv[0]);
+        return 1;
+    }
+    char server[4096];
+    if (!realpath(argv[1], server)) {
+        perror("server binary");
+        return 1;
+    }
+    unsigned long count = strtoul(argv[3], NULL, 10);
+    if (chdir(argv[2]) != 0) {
+        perror("bench directory");
+        return 1;
+    }
+
+    int fd = try_connect();
+    if (fd >= 0) {
+        close(fd);
+        fprintf(stderr, "Port %d is already in use; stop the running server first\n", PORT);
+        return 1;
+    }
+
+    printf("Startup with %lu users\n", count);
+    unlink("TCP_Server/users.bin");
+    unlink("TCP_Server/users.journal");
+    if (time_start(server, "text", count) != 0) return 1;
+
+    char *convert[] = { server, "-c", "text2bin", NULL };
+    double t0 = now_sec();
+    pid_t pid = spawn(convert);
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "text2bin failed\n");
+        return 1;
+    }
+    printf("  %-9s %10.3f s (offline, once)\n", "text2bin", now_sec() - t0);
+
+    return time_start(server, "bin", count) != 0;
+}
@@ -0,0 +1,67 @@
+/**
+ * ============================================================================
+ * BENCH: USERS.TXT GENERATOR
+ * ============================================================================
+ *
+ * Writes a users.txt with <count> accounts to stdout, in the format
+ * loadUsers() reads. Every account is "bench<n>" with password
+ * BENCH_PASSWORD; they share one salted PBKDF2 hash at the default cost
+ * (deriving a million of them would take hours), so LOGIN works and
+ * no hash needs an upgrade.
+ *
+ * Usage: bench/gen_users <count> > TCP_Server/users.txt
+ * ============================================================================
+ */
+
+#include "users.h"
+#include "config.h"
+#include "kdf.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_PASSWORD "Bench@2024"
+
+static void to_hex(const uint8_t *bytes, size_t len, char *out) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; i++) {
+        out[2 * i] = digits[bytes[i] >> 4];
+        out[2 * i + 1] = digits[bytes[i] & 0x0f];
+    }
+    out[2 * len] = '\0';
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <count>\n", argv[0]);
+        return 1;
+    }
+    unsigned long count = strtoul(argv[1], NULL, 10);
+
+    // Fixed salt: the file is only for benchmarks
+    uint8_t salt[PASSWORD_SALT_LEN];
+    uint8_t key[PASSWORD_KEY_LEN];
+    for (size_t i = 0; i < sizeof(salt); i++) salt[i] = (uint8_t)(0xb0 + i);
+    kdf_pbkdf2_sha256(BENCH_PASSWORD, strlen(BENCH_PASSWORD), salt, sizeof(salt),
+                      PASSWORD_KDF_ITERATIONS, key, sizeof(key));
+
+    char salt_hex[2 * PASSWORD_SALT_LEN + 1];
+    char key_hex[2 * PASSWORD_KEY_LEN + 1];
+    to_hex(salt, sizeof(salt), salt_hex);
+    to_hex(key, sizeof(key), key_hex);
+    char hash[MAX_PASSWORD_HASH];
+    snprintf(hash, sizeof(hash), PASSWORD_HASH_PREFIX "$%u$%s$%s",
+             (unsigned)PASSWORD_KDF_ITERATIONS, salt_hex, key_hex);
+
+    long now = (long)time(NULL);
+    printf("# Users Database\n");
+    printf("# Format: username password_hash status coin created_at updated_at user_id\n");
+    printf("# status: 0 = banned, 1 = active\n");
+    printf("# lsn 0\n");
+    printf("#\n");
+    for (unsigned long i = 1; i <= count; i++) {
+        printf("bench%lu %s 1 %d %ld %ld %lu\n", i, hash, USER_DEFAULT_COIN, now, now, i);
+    }
+    return fflush(stdout) == 0 ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+/**
+ * ============================================================================
+ * TEST: LOG WRITER BATCHING
+ * ============================================================================
+ *
+ * Checks that the log writer groups lines: records queued within
+ * LOG_FLUSH_MS of the first unflushed one go out in a single write(),
+ * and a burst after a quiet period starts a new one. write() is wrapped
+ * (-Wl,--wrap=write) to count the writer's calls; nothing else in this
+ * process writes to a descriptor above stderr.
+ *
+ * Usage: make test_logger
+ * ============================================================================
+ */
+
+#define _GNU_SOURCE
+
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+
+ssize_t __real_write(int fd, const void *buf, size_t count);
+
+static atomic_int log_writes;
+
+ssize_t __wrap_write(int fd, const void *buf, size_t count) {
+    if (fd > STDERR_FILENO) atomic_fetch_add(&log_writes, 1);
+    return __real_write(fd, buf, count);
+}
+
+static void sleep_ms(long ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+static int count_lines(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    int lines = 0, c;
+    while ((c = fgetc(fp)) != EOF) {
+        if (c == '\n') lines++;
+    }
+    fclose(fp);
+    return lines;
+}
+
+static int failures = 0;
+
+static void expect(const char *what, int got, int want) {
+    printf("%-48s %s (got %d, want %d)\n", what, got == want ? "ok" : "FAIL", got, want);
+    if (got != want) failures++;
+}
+
+int main(void) {
+    char path[] = "/tmp/test_logger_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+    if (logger_init(path) != 0) return 1;
+
+    // 1. A burst, then records spread over less than LOG_FLUSH_MS
+    for (int i = 0; i < 50; i++) {
+        log_activity("GETCOIN", "alice", true, "", RESP_COIN_OK);
+    }
+    for (int i = 0; i < 4; i++) {
+        sleep_ms(LOG_FLUSH_MS / 10);
+        log_activity("GET_HP", "alice", true, "", RESP_COIN_OK);
+    }
+    sleep_ms(3 * LOG_FLUSH_MS);
+    expect("lines within LOG_FLUSH_MS: one write()", atomic_load(&log_writes), 1);
+
+    // 2. Quiet for longer than LOG_FLUSH_MS: the next burst is a new write
+    for (int i = 0; i < 10; i++) {
+        log_activity("WHOAMI", "bob", true, "", RESP_COIN_OK);
+    }
+    sleep_ms(3 * LOG_FLUSH_MS);
+    expect("next burst: one more write()", atomic_load(&log_writes), 2);
+
+    logger_shutdown();
+    expect("lines in the file", count_lines(path), 64);
+    unlink(path);
+    return failures ? 1 : 0;
+}